@@ -27,6 +27,7 @@
 //
 
 using System;
+using System.Collections.Generic;
 using System.Threading;
 using System.Runtime.InteropServices;
 using Mono.Unix;
@@ -43,11 +44,21 @@ namespace Banshee.GStreamer
 {
     public class AudioCdRipper : IAudioCdRipper
     {
+        private class Job
+        {
+            public TrackInfo Track;
+            public string OutputPath;
+        }
+
+        // Raw audio waiting to be encoded; a whole CD is about 800 MB
+        private const ulong SpoolLimit = 1024 * 1024 * 1024;
+
         private HandleRef handle;
         private string encoder_pipeline;
         private string output_extension;
-        private string output_path;
-        private TrackInfo current_track;
+        private string mimetype;
+        private bool spooling;
+        private Dictionary<int, Job> jobs = new Dictionary<int, Job> ();
 
         private RipperProgressHandler progress_handler;
         private RipperMimeTypeHandler mimetype_handler;
@@ -93,6 +104,20 @@ namespace Banshee.GStreamer
                 int paranoia_mode = enableErrorCorrection ? 255 : 0;
                 handle = new HandleRef (this, br_new (device, paranoia_mode, encoder_pipeline));
 
+                // Tracks are ripped in disc order, so the drive can keep
+                // reading from one track into the next
+                br_set_whole_disc (handle, true);
+
+                // Read the disc into a spool and encode from there on all
+                // cores, instead of reading at the pace of one encoder
+                IntPtr spool_dir = GLib.Marshaller.StringToPtrGStrdup (Paths.Combine (Paths.ApplicationCache, "rip-spool"));
+                spooling = br_set_spool (handle, spool_dir, SpoolLimit, 0);
+                GLib.Marshaller.Free (spool_dir);
+
+                // With a spool to patch, read the disc fast and re-read
+                // only what the drive had trouble with in paranoid mode
+                br_set_adaptive_paranoia (handle, spooling && enableErrorCorrection);
+
                 progress_handler = new RipperProgressHandler (OnNativeProgress);
                 br_set_progress_callback (handle, progress_handler);
 
@@ -111,11 +136,12 @@ namespace Banshee.GStreamer
 
         public void Finish ()
         {
-            if (output_path != null) {
-                Banshee.IO.File.Delete (new SafeUri (output_path));
+            foreach (Job job in jobs.Values) {
+                Banshee.IO.File.Delete (new SafeUri (job.OutputPath));
             }
 
-            TrackReset ();
+            jobs.Clear ();
+            mimetype = null;
 
             encoder_pipeline = null;
             output_extension = null;
@@ -129,32 +155,50 @@ namespace Banshee.GStreamer
             Finish ();
         }
 
-        private void TrackReset ()
-        {
-            current_track = null;
-            output_path = null;
+        public int MaxConcurrentTracks {
+            get { return spooling ? Int32.MaxValue : 1; }
         }
 
         public void RipTrack (int trackIndex, TrackInfo track, SafeUri outputUri, out bool taggingSupported)
         {
-            TrackReset ();
-            current_track = track;
-
             using (TagList tags = new TagList (track)) {
-                output_path = String.Format ("{0}.{1}", outputUri.LocalPath, output_extension);
+                string output_path = String.Format ("{0}.{1}", outputUri.LocalPath, output_extension);
 
-                // Avoid overwriting an existing file
+                // Avoid overwriting an existing file, or one a track still
+                // being ripped is going to write
                 int i = 1;
-                while (Banshee.IO.File.Exists (new SafeUri (output_path))) {
+                while (Banshee.IO.File.Exists (new SafeUri (output_path)) || IsJobOutput (output_path)) {
                     output_path = String.Format ("{0} ({1}).{2}", outputUri.LocalPath, i++, output_extension);
                 }
 
                 Log.DebugFormat ("GStreamer ripping track {0} to {1}", trackIndex, output_path);
 
+                jobs[trackIndex + 1] = new Job () { Track = track, OutputPath = output_path };
                 br_rip_track (handle, trackIndex + 1, output_path, tags.Handle, out taggingSupported);
             }
         }
 
+        private bool IsJobOutput (string path)
+        {
+            foreach (Job job in jobs.Values) {
+                if (job.OutputPath == path) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // With spooled rips the track being read is not the one being
+        // finished; errors end the whole rip, so they go to any of them
+        private TrackInfo AnyTrack {
+            get {
+                foreach (Job job in jobs.Values) {
+                    return job.Track;
+                }
+                return null;
+            }
+        }
+
         protected virtual void OnProgress (TrackInfo track, TimeSpan ellapsedTime)
         {
             AudioCdRipperProgressHandler handler = Progress;
@@ -179,34 +223,44 @@ namespace Banshee.GStreamer
             }
         }
 
-        private void OnNativeProgress (IntPtr ripper, int mseconds)
+        private void OnNativeProgress (IntPtr ripper, int mseconds, int trackNumber)
         {
-            OnProgress (current_track, TimeSpan.FromMilliseconds (mseconds));
+            Job job;
+            if (jobs.TryGetValue (trackNumber, out job)) {
+                OnProgress (job.Track, TimeSpan.FromMilliseconds (mseconds));
+            }
         }
 
+        // Every track is encoded the same way, so the type found for one
+        // applies to all of them
         private void OnNativeMimeType (IntPtr ripper, IntPtr mimetype)
         {
-            if (mimetype != IntPtr.Zero && current_track != null) {
+            if (mimetype != IntPtr.Zero) {
                 string type = GLib.Marshaller.Utf8PtrToString (mimetype);
                 if (type != null) {
                     string [] split = type.Split (';', '.', ' ', '\t');
                     if (split != null && split.Length > 0) {
-                        current_track.MimeType = split[0].Trim ();
+                        this.mimetype = split[0].Trim ();
                     } else {
-                        current_track.MimeType = type.Trim ();
+                        this.mimetype = type.Trim ();
                     }
                 }
             }
         }
 
-        private void OnNativeFinished (IntPtr ripper)
+        private void OnNativeFinished (IntPtr ripper, int trackNumber)
         {
-            SafeUri uri = new SafeUri (output_path);
-            TrackInfo track = current_track;
+            Job job;
+            if (!jobs.TryGetValue (trackNumber, out job)) {
+                return;
+            }
 
-            TrackReset ();
+            jobs.Remove (trackNumber);
+            if (mimetype != null) {
+                job.Track.MimeType = mimetype;
+            }
 
-            OnTrackFinished (track, uri);
+            OnTrackFinished (job.Track, new SafeUri (job.OutputPath));
         }
 
         private void OnNativeError (IntPtr ripper, IntPtr error, IntPtr debug)
@@ -220,12 +274,12 @@ namespace Banshee.GStreamer
                 }
             }
 
-            OnError (current_track, error_message);
+            OnError (AnyTrack, error_message);
         }
 
-        private delegate void RipperProgressHandler (IntPtr ripper, int mseconds);
+        private delegate void RipperProgressHandler (IntPtr ripper, int mseconds, int trackNumber);
         private delegate void RipperMimeTypeHandler (IntPtr ripper, IntPtr mimetype);
-        private delegate void RipperFinishedHandler (IntPtr ripper);
+        private delegate void RipperFinishedHandler (IntPtr ripper, int trackNumber);
         private delegate void RipperErrorHandler (IntPtr ripper, IntPtr error, IntPtr debug);
 
         [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
@@ -238,6 +292,16 @@ namespace Banshee.GStreamer
         private static extern void br_rip_track (HandleRef handle, int track_number, string output_path,
             HandleRef tag_list, out bool tagging_supported);
 
+        [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
+        private static extern void br_set_whole_disc (HandleRef handle, bool whole_disc);
+
+        [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
+        private static extern bool br_set_spool (HandleRef handle, IntPtr directory, ulong spool_limit,
+            int max_encoders);
+
+        [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
+        private static extern void br_set_adaptive_paranoia (HandleRef handle, bool adaptive);
+
         [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
         private static extern void br_set_progress_callback (HandleRef handle, RipperProgressHandler callback);
 
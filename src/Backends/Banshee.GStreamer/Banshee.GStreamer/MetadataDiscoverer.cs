@@ -0,0 +1,309 @@
+//
+// MetadataDiscoverer.cs
+//
+// Copyright (C) 2026 Banshee Project Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+using System;
+using System.Collections.Generic;
+using System.Runtime.InteropServices;
+
+using Mono.Unix;
+
+using Hyena;
+
+using Banshee.Base;
+using Banshee.Collection;
+
+namespace Banshee.GStreamer
+{
+    public class DiscoveredFile
+    {
+        internal DiscoveredFile ()
+        {
+        }
+
+        public SafeUri Uri { get; internal set; }
+        public bool IsValid { get; internal set; }
+        public TimeSpan Duration { get; internal set; }
+        public string MimeType { get; internal set; }
+        public string Caps { get; internal set; }
+        public int BitRate { get; internal set; }
+        public int SampleRate { get; internal set; }
+        public int Channels { get; internal set; }
+        public bool HasAudio { get; internal set; }
+        public bool HasVideo { get; internal set; }
+
+        public string TrackTitle { get; internal set; }
+        public string ArtistName { get; internal set; }
+        public string AlbumTitle { get; internal set; }
+        public string AlbumArtist { get; internal set; }
+        public string Genre { get; internal set; }
+        public string Composer { get; internal set; }
+        public string Comment { get; internal set; }
+        public int TrackNumber { get; internal set; }
+        public int TrackCount { get; internal set; }
+        public int DiscNumber { get; internal set; }
+        public int DiscCount { get; internal set; }
+        public int Year { get; internal set; }
+        public int Bpm { get; internal set; }
+
+        // Copies what was found over the track's metadata, leaving
+        // whatever discovery did not find alone
+        public void MergeInto (TrackInfo track)
+        {
+            if (Duration > TimeSpan.Zero) track.Duration = Duration;
+            if (MimeType != null) track.MimeType = MimeType;
+            if (BitRate > 0) track.BitRate = BitRate;
+            if (SampleRate > 0) track.SampleRate = SampleRate;
+
+            if (TrackTitle != null) track.TrackTitle = TrackTitle;
+            if (ArtistName != null) track.ArtistName = ArtistName;
+            if (AlbumTitle != null) track.AlbumTitle = AlbumTitle;
+            if (AlbumArtist != null) track.AlbumArtist = AlbumArtist;
+            if (Genre != null) track.Genre = Genre;
+            if (Composer != null) track.Composer = Composer;
+            if (Comment != null) track.Comment = Comment;
+            if (TrackNumber > 0) track.TrackNumber = TrackNumber;
+            if (TrackCount > 0) track.TrackCount = TrackCount;
+            if (DiscNumber > 0) track.DiscNumber = DiscNumber;
+            if (DiscCount > 0) track.DiscCount = DiscCount;
+            if (Year > 0) track.Year = Year;
+            if (Bpm > 0) track.Bpm = Bpm;
+
+            if (HasVideo) {
+                track.MediaAttributes |= TrackMediaAttributes.VideoStream;
+            } else if (HasAudio) {
+                track.MediaAttributes |= TrackMediaAttributes.AudioStream;
+            }
+        }
+    }
+
+    public class MetadataDiscoveredArgs : EventArgs
+    {
+        private readonly DiscoveredFile [] files;
+
+        public MetadataDiscoveredArgs (DiscoveredFile [] files)
+        {
+            this.files = files;
+        }
+
+        public DiscoveredFile [] Files {
+            get { return files; }
+        }
+    }
+
+    // Reads the duration, stream properties and tags of many files at once
+    // with GStreamer's discoverer, on a pool of native workers. Results
+    // arrive on the main loop in batches, in no particular order.
+    public class MetadataDiscoverer : IDisposable
+    {
+        [StructLayout (LayoutKind.Sequential)]
+        private struct NativeRecord
+        {
+            public IntPtr uri;
+            public int result;
+            public ulong duration;
+            public IntPtr mime_type;
+            public IntPtr caps;
+            public uint bitrate;
+            public int sample_rate;
+            public int channels;
+            public bool has_audio;
+            public bool has_video;
+
+            public IntPtr title;
+            public IntPtr artist;
+            public IntPtr album;
+            public IntPtr album_artist;
+            public IntPtr genre;
+            public IntPtr composer;
+            public IntPtr comment;
+            public int track_number;
+            public int track_count;
+            public int disc_number;
+            public int disc_count;
+            public int year;
+            public int bpm;
+        }
+
+        // GST_DISCOVERER_OK
+        private const int ResultOk = 0;
+
+        private static readonly int record_size = Marshal.SizeOf (typeof (NativeRecord));
+
+        private HandleRef handle;
+
+        private DiscovererRecordsCallback records_callback;
+        private DiscovererFinishedCallback finished_callback;
+
+        public event EventHandler<MetadataDiscoveredArgs> Discovered;
+        public event EventHandler Finished;
+
+        public MetadataDiscoverer () : this (0, 0)
+        {
+        }
+
+        public MetadataDiscoverer (int maxWorkers, int timeoutSeconds)
+        {
+            IntPtr ptr = bdi_new (maxWorkers, timeoutSeconds);
+
+            if (ptr == IntPtr.Zero) {
+                throw new ApplicationException (Catalog.GetString ("Could not create metadata discoverer"));
+            }
+
+            handle = new HandleRef (this, ptr);
+
+            records_callback = new DiscovererRecordsCallback (OnNativeRecords);
+            finished_callback = new DiscovererFinishedCallback (OnNativeFinished);
+
+            bdi_set_records_callback (handle, records_callback);
+            bdi_set_finished_callback (handle, finished_callback);
+        }
+
+        public void Dispose ()
+        {
+            if (handle.Handle != IntPtr.Zero) {
+                bdi_destroy (handle);
+                handle = new HandleRef (this, IntPtr.Zero);
+            }
+        }
+
+        public void Discover (IEnumerable<SafeUri> uris)
+        {
+            var uri_ptrs = new List<IntPtr> ();
+
+            try {
+                foreach (SafeUri uri in uris) {
+                    uri_ptrs.Add (GLib.Marshaller.StringToPtrGStrdup (uri.AbsoluteUri));
+                }
+
+                bdi_add_uris (handle, uri_ptrs.ToArray (), uri_ptrs.Count);
+            } finally {
+                foreach (IntPtr uri_ptr in uri_ptrs) {
+                    GLib.Marshaller.Free (uri_ptr);
+                }
+            }
+        }
+
+        public void Cancel ()
+        {
+            bdi_cancel (handle);
+        }
+
+        public bool IsDiscovering {
+            get { return bdi_get_is_discovering (handle); }
+        }
+
+        // Maximum number of files per Discovered event
+        public int BatchSize {
+            set { bdi_set_batch_size (handle, value); }
+        }
+
+        private static string PtrToString (IntPtr ptr)
+        {
+            return ptr == IntPtr.Zero ? null : GLib.Marshaller.Utf8PtrToString (ptr);
+        }
+
+        private static DiscoveredFile ToDiscoveredFile (NativeRecord record)
+        {
+            return new DiscoveredFile () {
+                Uri = new SafeUri (PtrToString (record.uri)),
+                IsValid = record.result == ResultOk,
+                Duration = TimeSpan.FromTicks ((long)(record.duration / 100)),
+                MimeType = PtrToString (record.mime_type),
+                Caps = PtrToString (record.caps),
+                BitRate = (int)(record.bitrate / 1000),
+                SampleRate = record.sample_rate,
+                Channels = record.channels,
+                HasAudio = record.has_audio,
+                HasVideo = record.has_video,
+                TrackTitle = PtrToString (record.title),
+                ArtistName = PtrToString (record.artist),
+                AlbumTitle = PtrToString (record.album),
+                AlbumArtist = PtrToString (record.album_artist),
+                Genre = PtrToString (record.genre),
+                Composer = PtrToString (record.composer),
+                Comment = PtrToString (record.comment),
+                TrackNumber = record.track_number,
+                TrackCount = record.track_count,
+                DiscNumber = record.disc_number,
+                DiscCount = record.disc_count,
+                Year = record.year,
+                Bpm = record.bpm
+            };
+        }
+
+        private void OnNativeRecords (IntPtr discoverer, IntPtr records, int count)
+        {
+            var handler = Discovered;
+            if (handler == null) {
+                return;
+            }
+
+            var files = new DiscoveredFile[count];
+            for (int i = 0; i < count; i++) {
+                IntPtr ptr = new IntPtr (records.ToInt64 () + (long)i * record_size);
+                files[i] = ToDiscoveredFile ((NativeRecord)Marshal.PtrToStructure (ptr, typeof (NativeRecord)));
+            }
+
+            handler (this, new MetadataDiscoveredArgs (files));
+        }
+
+        private void OnNativeFinished (IntPtr discoverer)
+        {
+            var handler = Finished;
+            if (handler != null) {
+                handler (this, EventArgs.Empty);
+            }
+        }
+
+        [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+        private delegate void DiscovererRecordsCallback (IntPtr discoverer, IntPtr records, int count);
+        [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+        private delegate void DiscovererFinishedCallback (IntPtr discoverer);
+
+        [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
+        private static extern IntPtr bdi_new (int max_workers, int timeout_seconds);
+
+        [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
+        private static extern void bdi_destroy (HandleRef handle);
+
+        [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
+        private static extern bool bdi_add_uris (HandleRef handle, IntPtr [] uris, int count);
+
+        [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
+        private static extern void bdi_cancel (HandleRef handle);
+
+        [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
+        private static extern bool bdi_get_is_discovering (HandleRef handle);
+
+        [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
+        private static extern void bdi_set_batch_size (HandleRef handle, int batch_size);
+
+        [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
+        private static extern void bdi_set_records_callback (HandleRef handle, DiscovererRecordsCallback cb);
+
+        [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
+        private static extern void bdi_set_finished_callback (HandleRef handle, DiscovererFinishedCallback cb);
+    }
+}
@@ -33,6 +33,7 @@ using System.Threading;
 using Mono.Unix;
 using Hyena;
 using Hyena.Data;
+using Hyena.Data.Sqlite;
 
 using Banshee.Base;
 using Banshee.Streaming;
@@ -111,6 +112,7 @@ namespace Banshee.GStreamer
         private uint iterate_timeout_id = 0;
 
         private bool gapless_enabled;
+        private ReplayGainScanner replaygain_scanner;
         private EventWaitHandle next_track_set;
 
         private event VisualizationDataHandler data_available = null;
@@ -195,9 +197,13 @@ namespace Banshee.GStreamer
 
             OnStateChanged (PlayerState.Ready);
 
+            ReplayGainScanner.LoadStore ();
+            ServiceManager.StartupFinished += OnStartupFinished;
+
             InstallPreferences ();
             ReplayGainEnabled = ReplayGainEnabledSchema.Get ();
             GaplessEnabled = GaplessEnabledSchema.Get ();
+            ImpulseResponse = ImpulseResponseSchema.Get ();
             Log.InformationFormat ("GStreamer version {0}, gapless: {1}, replaygain: {2}", gstreamer_version_string (), GaplessEnabled, ReplayGainEnabled);
 
             is_initialized = true;
@@ -209,6 +215,12 @@ namespace Banshee.GStreamer
 
         public override void Dispose ()
         {
+            ServiceManager.StartupFinished -= OnStartupFinished;
+            if (replaygain_scanner != null) {
+                replaygain_scanner.Dispose ();
+                replaygain_scanner = null;
+            }
+
             UninstallPreferences ();
             base.Dispose ();
             bp_destroy (handle);
@@ -744,6 +756,12 @@ namespace Banshee.GStreamer
             bp_equalizer_set_gain (handle, band, gain);
         }
 
+        public void SetEqualizerGains (double [] gains, double amplifierLevel)
+        {
+            double scale = Math.Pow (10.0, amplifierLevel / 20.0);
+            bp_equalizer_set_gains (handle, gains, (uint)gains.Length, scale);
+        }
+
         private static string [] source_capabilities = { "file", "http", "cdda", "dvd", "vcd" };
         public override IEnumerable SourceCapabilities {
             get { return source_capabilities; }
@@ -759,6 +777,74 @@ namespace Banshee.GStreamer
             set { bp_replaygain_set_enabled (handle, value); }
         }
 
+        private void OnStartupFinished (object o, EventArgs args)
+        {
+            ScanLibraryReplayGain ();
+        }
+
+        // Tracks without ReplayGain tags fall back to the scanner's results,
+        // so the music library is analyzed in the background; tracks that
+        // already have a result are skipped, and only new ones get scanned
+        // on later runs
+        private void ScanLibraryReplayGain ()
+        {
+            var library = ServiceManager.SourceManager == null ? null : ServiceManager.SourceManager.MusicLibrary;
+            if (!ReplayGainEnabled || library == null || replaygain_scanner != null) {
+                return;
+            }
+
+            var scanner = new ReplayGainScanner ();
+            int count = 0;
+
+            using (var reader = new HyenaDataReader (ServiceManager.DbConnection.Query (@"
+                    SELECT CoreTracks.Uri, CoreAlbums.ArtistName, CoreAlbums.Title
+                    FROM CoreTracks LEFT JOIN CoreAlbums ON CoreAlbums.AlbumID = CoreTracks.AlbumID
+                    WHERE CoreTracks.PrimarySourceID = ?", library.DbId))) {
+                while (reader.Read ()) {
+                    string uri = reader.Get<string> (0);
+                    if (uri == null || !uri.StartsWith ("file://") || ReplayGainScanner.HasResult (uri)) {
+                        continue;
+                    }
+
+                    scanner.Add (uri, ReplayGainScanner.GetAlbumKey (reader.Get<string> (1), reader.Get<string> (2)));
+                    count++;
+                }
+            }
+
+            if (count == 0) {
+                scanner.Dispose ();
+                return;
+            }
+
+            Log.DebugFormat ("Scanning ReplayGain of {0} library tracks", count);
+
+            replaygain_scanner = scanner;
+            // Not disposed from within its own callback
+            replaygain_scanner.Finished += delegate {
+                GLib.Idle.Add (delegate {
+                    if (replaygain_scanner == scanner) {
+                        replaygain_scanner.Dispose ();
+                        replaygain_scanner = null;
+                    }
+                    return false;
+                });
+            };
+            replaygain_scanner.Start ();
+        }
+
+        private string ImpulseResponse {
+            set {
+                IntPtr path_ptr = GLib.Marshaller.StringToPtrGStrdup (value ?? String.Empty);
+                try {
+                    if (!bp_equalizer_set_impulse_response (handle, path_ptr) && !String.IsNullOrEmpty (value)) {
+                        Log.WarningFormat ("Could not load room correction impulse response {0}", value);
+                    }
+                } finally {
+                    GLib.Marshaller.Free (path_ptr);
+                }
+            }
+        }
+
         private bool GaplessEnabled {
             get { return gapless_enabled; }
             set
@@ -890,7 +976,10 @@ namespace Banshee.GStreamer
             replaygain_preference = service["general"]["misc"].Add (new SchemaPreference<bool> (ReplayGainEnabledSchema,
                 Catalog.GetString ("_Enable ReplayGain correction"),
                 Catalog.GetString ("For tracks that have ReplayGain data, automatically scale (normalize) playback volume"),
-                delegate { ReplayGainEnabled = ReplayGainEnabledSchema.Get (); }
+                delegate {
+                    ReplayGainEnabled = ReplayGainEnabledSchema.Get ();
+                    ScanLibraryReplayGain ();
+                }
             ));
             gapless_preference = service["general"]["misc"].Add (new SchemaPreference<bool> (GaplessEnabledSchema,
                     Catalog.GetString ("Enable _gapless playback"),
@@ -926,6 +1015,13 @@ namespace Banshee.GStreamer
             "Eliminate the small playback gap on track change. Useful for concept albums and classical music"
         );
 
+        public static readonly SchemaEntry<string> ImpulseResponseSchema = new SchemaEntry<string> (
+            "player_engine", "room_correction_impulse_response",
+            String.Empty,
+            "Room correction impulse response",
+            "WAV file with an impulse response to convolve the audio output with, for room correction"
+        );
+
 
 #endregion
 
@@ -1050,6 +1146,12 @@ namespace Banshee.GStreamer
         [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
         private static extern void bp_equalizer_set_gain (HandleRef player, uint bandnum, double gain);
 
+        [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
+        private static extern void bp_equalizer_set_gains (HandleRef player, double [] gains, uint n, double preamp);
+
+        [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
+        private static extern bool bp_equalizer_set_impulse_response (HandleRef player, IntPtr path);
+
         [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
         private static extern void bp_equalizer_get_bandrange (HandleRef player, out int min, out int max);
 
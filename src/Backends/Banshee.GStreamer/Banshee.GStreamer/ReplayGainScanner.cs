@@ -0,0 +1,274 @@
+//
+// ReplayGainScanner.cs
+//
+// Copyright (C) 2026 Banshee Project Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+using System;
+using System.Collections.Generic;
+using System.Runtime.InteropServices;
+
+using Mono.Unix;
+
+using Hyena;
+
+using Banshee.Base;
+using Banshee.Collection;
+
+namespace Banshee.GStreamer
+{
+    public class ReplayGainResultArgs : EventArgs
+    {
+        private readonly string name;
+        private readonly double gain;
+        private readonly double peak;
+
+        public ReplayGainResultArgs (string name, double gain, double peak)
+        {
+            this.name = name;
+            this.gain = gain;
+            this.peak = peak;
+        }
+
+        // The track URI for track results, the album key for album results
+        public string Name {
+            get { return name; }
+        }
+
+        public double Gain {
+            get { return gain; }
+        }
+
+        public double Peak {
+            get { return peak; }
+        }
+    }
+
+    // Computes track and album gain (EBU R128 loudness, reported relative to
+    // the ReplayGain 2.0 reference of -18 LUFS) for many tracks in parallel.
+    // Results are kept in a store that the player consults when a track has
+    // no ReplayGain tags of its own.
+    public class ReplayGainScanner : IDisposable
+    {
+        private HandleRef handle;
+
+        private ReplayGainScannerResultCallback track_callback;
+        private ReplayGainScannerResultCallback album_callback;
+        private ReplayGainScannerFinishedCallback finished_callback;
+        private ReplayGainScannerErrorCallback error_callback;
+
+        public event EventHandler<ReplayGainResultArgs> TrackScanned;
+        public event EventHandler<ReplayGainResultArgs> AlbumScanned;
+        public event EventHandler Finished;
+
+        public ReplayGainScanner () : this (0)
+        {
+        }
+
+        public ReplayGainScanner (int maxWorkers)
+        {
+            IntPtr ptr = brg_scanner_new (maxWorkers);
+
+            if (ptr == IntPtr.Zero) {
+                throw new ApplicationException (Catalog.GetString ("Could not create ReplayGain scanner"));
+            }
+
+            handle = new HandleRef (this, ptr);
+
+            track_callback = new ReplayGainScannerResultCallback (OnNativeTrack);
+            album_callback = new ReplayGainScannerResultCallback (OnNativeAlbum);
+            finished_callback = new ReplayGainScannerFinishedCallback (OnNativeFinished);
+            error_callback = new ReplayGainScannerErrorCallback (OnNativeError);
+
+            brg_scanner_set_track_callback (handle, track_callback);
+            brg_scanner_set_album_callback (handle, album_callback);
+            brg_scanner_set_finished_callback (handle, finished_callback);
+            brg_scanner_set_error_callback (handle, error_callback);
+        }
+
+        public void Dispose ()
+        {
+            if (handle.Handle != IntPtr.Zero) {
+                brg_scanner_destroy (handle);
+                handle = new HandleRef (this, IntPtr.Zero);
+            }
+        }
+
+        public void Scan (IEnumerable<TrackInfo> tracks)
+        {
+            foreach (TrackInfo track in tracks) {
+                Add (track.Uri.AbsoluteUri, GetAlbumKey (track.AlbumArtist, track.AlbumTitle));
+            }
+
+            Start ();
+        }
+
+        // Queues a track; nothing is analyzed until Start, so that every
+        // track of an album is known before its album gain is computed
+        public void Add (string uri, string albumKey)
+        {
+            IntPtr uri_ptr = GLib.Marshaller.StringToPtrGStrdup (uri);
+            IntPtr album_ptr = GLib.Marshaller.StringToPtrGStrdup (albumKey);
+            try {
+                brg_scanner_add_track (handle, uri_ptr, album_ptr);
+            } finally {
+                GLib.Marshaller.Free (uri_ptr);
+                GLib.Marshaller.Free (album_ptr);
+            }
+        }
+
+        public void Start ()
+        {
+            brg_scanner_start (handle);
+        }
+
+        public static string GetAlbumKey (string albumArtist, string albumTitle)
+        {
+            return String.IsNullOrEmpty (albumTitle)
+                ? null
+                : String.Format ("{0}\n{1}", albumArtist, albumTitle);
+        }
+
+        // Whether the store has a result for the track at uri
+        public static bool HasResult (string uri)
+        {
+            IntPtr uri_ptr = GLib.Marshaller.StringToPtrGStrdup (uri);
+            try {
+                return brg_store_lookup (uri_ptr, false, IntPtr.Zero, IntPtr.Zero);
+            } finally {
+                GLib.Marshaller.Free (uri_ptr);
+            }
+        }
+
+        public void Cancel ()
+        {
+            brg_scanner_cancel (handle);
+        }
+
+        public bool IsScanning {
+            get { return brg_scanner_get_is_scanning (handle); }
+        }
+
+        public static string StorePath {
+            get { return Paths.Combine (Paths.ApplicationCache, "replaygain.cache"); }
+        }
+
+        public static bool LoadStore ()
+        {
+            return brg_store_load (StorePath);
+        }
+
+        public static bool SaveStore ()
+        {
+            return brg_store_save (StorePath);
+        }
+
+        private void OnNativeTrack (IntPtr scanner, IntPtr uri, double gain, double peak)
+        {
+            var handler = TrackScanned;
+            if (handler != null) {
+                handler (this, new ReplayGainResultArgs (GLib.Marshaller.Utf8PtrToString (uri), gain, peak));
+            }
+        }
+
+        private void OnNativeAlbum (IntPtr scanner, IntPtr album, double gain, double peak)
+        {
+            var handler = AlbumScanned;
+            if (handler != null) {
+                handler (this, new ReplayGainResultArgs (GLib.Marshaller.Utf8PtrToString (album), gain, peak));
+            }
+        }
+
+        private void OnNativeFinished (IntPtr scanner)
+        {
+            if (!SaveStore ()) {
+                Log.Warning ("Could not save ReplayGain scan results", StorePath);
+            }
+
+            var handler = Finished;
+            if (handler != null) {
+                handler (this, EventArgs.Empty);
+            }
+        }
+
+        private void OnNativeError (IntPtr scanner, IntPtr uri, IntPtr error, IntPtr debug)
+        {
+            string error_message = GLib.Marshaller.Utf8PtrToString (error);
+
+            if (debug != IntPtr.Zero) {
+                string debug_string = GLib.Marshaller.Utf8PtrToString (debug);
+                if (!String.IsNullOrEmpty (debug_string)) {
+                    error_message = String.Format ("{0}: {1}", error_message, debug_string);
+                }
+            }
+
+            Log.DebugFormat ("ReplayGain analysis failed for {0}: {1}",
+                GLib.Marshaller.Utf8PtrToString (uri), error_message);
+        }
+
+        [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+        private delegate void ReplayGainScannerResultCallback (IntPtr scanner, IntPtr name, double gain, double peak);
+        [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+        private delegate void ReplayGainScannerFinishedCallback (IntPtr scanner);
+        [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+        private delegate void ReplayGainScannerErrorCallback (IntPtr scanner, IntPtr uri, IntPtr error, IntPtr debug);
+
+        [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
+        private static extern IntPtr brg_scanner_new (int max_workers);
+
+        [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
+        private static extern void brg_scanner_destroy (HandleRef handle);
+
+        [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
+        private static extern void brg_scanner_add_track (HandleRef handle, IntPtr uri, IntPtr album_key);
+
+        [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
+        private static extern bool brg_scanner_start (HandleRef handle);
+
+        [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
+        private static extern void brg_scanner_cancel (HandleRef handle);
+
+        [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
+        private static extern bool brg_scanner_get_is_scanning (HandleRef handle);
+
+        [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
+        private static extern void brg_scanner_set_track_callback (HandleRef handle, ReplayGainScannerResultCallback cb);
+
+        [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
+        private static extern void brg_scanner_set_album_callback (HandleRef handle, ReplayGainScannerResultCallback cb);
+
+        [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
+        private static extern void brg_scanner_set_finished_callback (HandleRef handle, ReplayGainScannerFinishedCallback cb);
+
+        [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
+        private static extern void brg_scanner_set_error_callback (HandleRef handle, ReplayGainScannerErrorCallback cb);
+
+        [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
+        private static extern bool brg_store_lookup (IntPtr uri, bool album_mode, IntPtr gain, IntPtr peak);
+
+        [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
+        private static extern bool brg_store_load (string path);
+
+        [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
+        private static extern bool brg_store_save (string path);
+    }
+}
@@ -81,8 +81,14 @@ namespace Banshee.GStreamer
             }
         }
 
+        [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
+        private static extern void banshee_log_shutdown ();
+
         void IDisposable.Dispose ()
         {
+            // Hands the messages still queued in libbanshee to the log and
+            // stops its log thread
+            banshee_log_shutdown ();
         }
 
         private void NativeLogHandler (LogEntryType type, IntPtr componentPtr, IntPtr messagePtr)
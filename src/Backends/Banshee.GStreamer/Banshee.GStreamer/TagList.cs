@@ -27,16 +27,48 @@
 //
 
 using System;
+using System.Collections.Generic;
 using System.Runtime.InteropServices;
+using System.Text;
 
 using Banshee.Streaming;
 using Banshee.Collection;
 
 namespace Banshee.GStreamer
 {
+    // Values are collected on the managed side and added to the native list
+    // in one call when its handle is next needed, rather than crossing into
+    // native code once per tag. Strings are packed as UTF-8 into one block
+    // that entries point into by offset, so nothing is allocated natively.
     public class TagList : IDisposable
     {
+        private enum TagType
+        {
+            String,
+            UInt,
+            Date
+        }
+
+        [StructLayout (LayoutKind.Sequential)]
+        private struct TagEntry
+        {
+            public int tag;
+            public TagType type;
+            public int str_offset;
+            public uint number;
+            public int year;
+            public int month;
+            public int day;
+        }
+
+        // GST_TAG_DATE
+        private const string DateTag = "date";
+
+        private static Dictionary<string, int> tag_ids = new Dictionary<string, int> ();
+
         private HandleRef handle;
+        private List<TagEntry> pending = new List<TagEntry> ();
+        private List<byte> pending_strings = new List<byte> ();
 
         public TagList ()
         {
@@ -76,37 +108,89 @@ namespace Banshee.GStreamer
         public void AddTag (string tagName, string value)
         {
             if (!String.IsNullOrEmpty (value)) {
-                AddTag (tagName, (object)value);
+                pending.Add (new TagEntry () {
+                    tag = GetTagId (tagName),
+                    type = TagType.String,
+                    str_offset = pending_strings.Count
+                });
+                pending_strings.AddRange (Encoding.UTF8.GetBytes (value));
+                pending_strings.Add (0);
             }
         }
 
         public void AddTag (string tagName, uint value)
         {
             if (value > 0) {
-                AddTag (tagName, (object)value);
+                pending.Add (new TagEntry () { tag = GetTagId (tagName), type = TagType.UInt, number = value });
             }
         }
 
         public void AddDate (DateTime date)
         {
-            bt_tag_list_add_date (Handle, date.Year, date.Month, date.Day);
+            AddDate (date.Year, date.Month, date.Day);
         }
 
         public void AddYear (int year)
         {
             if (year > 1) {
-                bt_tag_list_add_date (Handle, year, 1, 1);
+                AddDate (year, 1, 1);
             }
         }
 
+        private void AddDate (int year, int month, int day)
+        {
+            pending.Add (new TagEntry () {
+                tag = GetTagId (DateTag),
+                type = TagType.Date,
+                year = year,
+                month = month,
+                day = day
+            });
+        }
+
         public void AddTag (string tagName, object value)
         {
-            GLib.Value g_value = new GLib.Value (value);
-            bt_tag_list_add_value (Handle, tagName, ref g_value);
+            if (value is string) {
+                AddTag (tagName, (string)value);
+            } else if (value is uint) {
+                AddTag (tagName, (uint)value);
+            } else {
+                GLib.Value g_value = new GLib.Value (value);
+                bt_tag_list_add_value (Handle, tagName, ref g_value);
+            }
+        }
+
+        private static int GetTagId (string tagName)
+        {
+            lock (tag_ids) {
+                int id;
+                if (!tag_ids.TryGetValue (tagName, out id)) {
+                    id = bt_tag_intern (tagName);
+                    tag_ids[tagName] = id;
+                }
+                return id;
+            }
+        }
+
+        private void Flush ()
+        {
+            if (pending.Count == 0) {
+                return;
+            }
+
+            TagEntry [] entries = pending.ToArray ();
+            byte [] strings = pending_strings.ToArray ();
+            pending.Clear ();
+            pending_strings.Clear ();
+
+            bt_tag_list_add_entries (handle, entries, entries.Length, strings, strings.Length);
         }
 
         public void Dispose ()
         {
+            pending.Clear ();
+            pending_strings.Clear ();
+
             if (handle.Handle != IntPtr.Zero) {
                 bt_tag_list_free (handle);
                 handle = new HandleRef (this, IntPtr.Zero);
@@ -116,7 +200,10 @@ namespace Banshee.GStreamer
         }
 
         public HandleRef Handle {
-            get { return handle; }
+            get {
+                Flush ();
+                return handle;
+            }
         }
 
         [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
@@ -129,6 +216,10 @@ namespace Banshee.GStreamer
         private static extern void bt_tag_list_add_value (HandleRef tag_list, string tag_name, ref GLib.Value value);
 
         [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
-        private static extern void bt_tag_list_add_date (HandleRef tag_list, int year, int month, int day);
+        private static extern int bt_tag_intern (string tag_name);
+
+        [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
+        private static extern void bt_tag_list_add_entries (HandleRef tag_list, TagEntry [] entries, int count,
+            byte [] strings, int strings_length);
     }
 }
@@ -27,6 +27,7 @@
 //
 
 using System;
+using System.Collections.Generic;
 using System.Threading;
 using System.Runtime.InteropServices;
 using Mono.Unix;
@@ -47,17 +48,22 @@ namespace Banshee.GStreamer
         public event TranscoderTrackFinishedHandler TrackFinished;
         public event TranscoderErrorHandler Error;
 
+        private class Job
+        {
+            public TrackInfo Track;
+            public SafeUri OutputUri;
+        }
+
         private HandleRef handle;
-        private GstTranscoderProgressCallback ProgressCallback;
-        private GstTranscoderFinishedCallback FinishedCallback;
-        private GstTranscoderErrorCallback ErrorCallback;
-        private TrackInfo current_track;
+        private GstTranscoderPoolProgressCallback ProgressCallback;
+        private GstTranscoderPoolFinishedCallback FinishedCallback;
+        private GstTranscoderPoolErrorCallback ErrorCallback;
+        private Dictionary<uint, Job> jobs = new Dictionary<uint, Job> ();
         private string error_message;
-        private SafeUri managed_output_uri;
 
         public Transcoder ()
         {
-            IntPtr ptr = gst_transcoder_new();
+            IntPtr ptr = gst_transcoder_pool_new(0);
 
             if(ptr == IntPtr.Zero) {
                 throw new NullReferenceException(Catalog.GetString("Could not create transcoder"));
@@ -65,60 +71,96 @@ namespace Banshee.GStreamer
 
             handle = new HandleRef(this, ptr);
 
-            ProgressCallback = new GstTranscoderProgressCallback(OnNativeProgress);
-            FinishedCallback = new GstTranscoderFinishedCallback(OnNativeFinished);
-            ErrorCallback = new GstTranscoderErrorCallback(OnNativeError);
+            ProgressCallback = new GstTranscoderPoolProgressCallback(OnNativeProgress);
+            FinishedCallback = new GstTranscoderPoolFinishedCallback(OnNativeFinished);
+            ErrorCallback = new GstTranscoderPoolErrorCallback(OnNativeError);
+
+            gst_transcoder_pool_set_progress_callback(handle, ProgressCallback);
+            gst_transcoder_pool_set_finished_callback(handle, FinishedCallback);
+            gst_transcoder_pool_set_error_callback(handle, ErrorCallback);
 
-            gst_transcoder_set_progress_callback(handle, ProgressCallback);
-            gst_transcoder_set_finished_callback(handle, FinishedCallback);
-            gst_transcoder_set_error_callback(handle, ErrorCallback);
+            // Re-syncing the same library then copies earlier conversions
+            long cache_size = (long)Math.Max (0, CacheSizeSchema.Get ()) * 1024 * 1024;
+            IntPtr cache_dir = GLib.Marshaller.StringToPtrGStrdup(Paths.Combine (Paths.ApplicationCache, "transcode-cache"));
+            gst_transcoder_pool_set_cache(handle, cache_dir, (ulong)cache_size);
+            GLib.Marshaller.Free(cache_dir);
         }
 
         public void Finish ()
         {
-            gst_transcoder_free(handle);
+            gst_transcoder_pool_free(handle);
             handle = new HandleRef (this, IntPtr.Zero);
+
+            lock (jobs) {
+                jobs.Clear ();
+            }
         }
 
         public void Cancel ()
         {
-            gst_transcoder_cancel(handle);
-            handle = new HandleRef (this, IntPtr.Zero);
+            gst_transcoder_pool_cancel(handle);
+            Finish ();
         }
 
         public void TranscodeTrack (TrackInfo track, SafeUri outputUri, ProfileConfiguration config)
         {
-            if(IsTranscoding) {
-                throw new ApplicationException("Transcoder is busy");
-            }
-
             Log.DebugFormat ("Transcoding {0} to {1}", track.Uri, outputUri);
             SafeUri inputUri = track.Uri;
-            managed_output_uri = outputUri;
             IntPtr input_uri = GLib.Marshaller.StringToPtrGStrdup(inputUri.AbsoluteUri);
             IntPtr output_uri = GLib.Marshaller.StringToPtrGStrdup(outputUri.AbsoluteUri);
 
             error_message = null;
 
-            current_track = track;
-            gst_transcoder_transcode(handle, input_uri, output_uri, config.Profile.Pipeline.GetProcessById("gstreamer"));
+            // Jobs only start from the main loop, so no callback can arrive
+            // before the job is known here
+            lock (jobs) {
+                uint id = gst_transcoder_pool_add_job(handle, input_uri, output_uri,
+                    config.Profile.Pipeline.GetProcessById("gstreamer"));
+                jobs[id] = new Job () { Track = track, OutputUri = outputUri };
+            }
 
             GLib.Marshaller.Free(input_uri);
             GLib.Marshaller.Free(output_uri);
         }
 
-        private void OnNativeProgress(IntPtr transcoder, double fraction)
+        private Job TakeJob (uint id, bool remove)
+        {
+            lock (jobs) {
+                Job job;
+                if (!jobs.TryGetValue (id, out job)) {
+                    return null;
+                }
+
+                if (remove) {
+                    jobs.Remove (id);
+                }
+                return job;
+            }
+        }
+
+        private void OnNativeProgress(IntPtr pool, uint id, double fraction)
         {
-            OnProgress (current_track, fraction);
+            Job job = TakeJob (id, false);
+            if (job != null) {
+                OnProgress (job.Track, fraction);
+            }
         }
 
-        private void OnNativeFinished(IntPtr transcoder)
+        private void OnNativeFinished(IntPtr pool, uint id)
         {
-            OnTrackFinished (current_track, managed_output_uri);
+            Job job = TakeJob (id, true);
+            if (job != null) {
+                OnTrackFinished (job.Track, job.OutputUri);
+            }
         }
 
-        private void OnNativeError(IntPtr transcoder, IntPtr error, IntPtr debug)
+        private void OnNativeError(IntPtr pool, uint id, IntPtr error, IntPtr debug)
         {
+            Job job = TakeJob (id, true);
+            if (job == null) {
+                return;
+            }
+
             error_message = GLib.Marshaller.Utf8PtrToString(error);
 
             if(debug != IntPtr.Zero) {
@@ -129,10 +171,10 @@ namespace Banshee.GStreamer
             }
 
             try {
-                Banshee.IO.File.Delete (managed_output_uri);
+                Banshee.IO.File.Delete (job.OutputUri);
             } catch {}
 
-            OnError (current_track, error_message);
+            OnError (job.Track, error_message);
         }
 
         protected virtual void OnProgress (TrackInfo track, double fraction)
@@ -160,43 +202,61 @@ namespace Banshee.GStreamer
         }
 
         public bool IsTranscoding {
-            get { return gst_transcoder_get_is_transcoding(handle); }
+            get { return gst_transcoder_pool_get_job_count(handle) > 0; }
+        }
+
+        public int MaxConcurrentTracks {
+            get { return (int)gst_transcoder_pool_get_max_jobs(handle); }
         }
 
         public string ErrorMessage {
             get { return error_message; }
         }
 
-        private delegate void GstTranscoderProgressCallback(IntPtr transcoder, double progress);
-        private delegate void GstTranscoderFinishedCallback(IntPtr transcoder);
-        private delegate void GstTranscoderErrorCallback(IntPtr transcoder, IntPtr error, IntPtr debug);
+        public static readonly SchemaEntry<int> CacheSizeSchema = new SchemaEntry<int> (
+            "transcoder", "cache_size",
+            1024,
+            "Transcode cache size",
+            "Maximum size in megabytes of converted files kept for reuse by later syncs; 0 disables the cache"
+        );
+
+        private delegate void GstTranscoderPoolProgressCallback(IntPtr pool, uint id, double progress);
+        private delegate void GstTranscoderPoolFinishedCallback(IntPtr pool, uint id);
+        private delegate void GstTranscoderPoolErrorCallback(IntPtr pool, uint id, IntPtr error, IntPtr debug);
 
         [DllImport(PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
-        private static extern IntPtr gst_transcoder_new();
+        private static extern IntPtr gst_transcoder_pool_new(int max_jobs);
 
         [DllImport(PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
-        private static extern void gst_transcoder_free(HandleRef handle);
+        private static extern void gst_transcoder_pool_free(HandleRef handle);
 
         [DllImport(PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
-        private static extern void gst_transcoder_transcode(HandleRef handle, IntPtr input_uri,
+        private static extern uint gst_transcoder_pool_add_job(HandleRef handle, IntPtr input_uri,
             IntPtr output_uri, string encoder_pipeline);
 
         [DllImport(PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
-        private static extern void gst_transcoder_cancel(HandleRef handle);
+        private static extern void gst_transcoder_pool_cancel(HandleRef handle);
+
+        [DllImport(PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
+        private static extern void gst_transcoder_pool_set_cache(HandleRef handle, IntPtr directory,
+            ulong max_size);
+
+        [DllImport(PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
+        private static extern uint gst_transcoder_pool_get_max_jobs(HandleRef handle);
 
         [DllImport(PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
-        private static extern void gst_transcoder_set_progress_callback(HandleRef handle,
-            GstTranscoderProgressCallback cb);
+        private static extern uint gst_transcoder_pool_get_job_count(HandleRef handle);
 
         [DllImport(PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
-        private static extern void gst_transcoder_set_finished_callback(HandleRef handle,
-            GstTranscoderFinishedCallback cb);
+        private static extern void gst_transcoder_pool_set_progress_callback(HandleRef handle,
+            GstTranscoderPoolProgressCallback cb);
 
         [DllImport(PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
-        private static extern void gst_transcoder_set_error_callback(HandleRef handle,
-            GstTranscoderErrorCallback cb);
+        private static extern void gst_transcoder_pool_set_finished_callback(HandleRef handle,
+            GstTranscoderPoolFinishedCallback cb);
 
         [DllImport(PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
-        private static extern bool gst_transcoder_get_is_transcoding(HandleRef handle);
+        private static extern void gst_transcoder_pool_set_error_callback(HandleRef handle,
+            GstTranscoderPoolErrorCallback cb);
     }
 }
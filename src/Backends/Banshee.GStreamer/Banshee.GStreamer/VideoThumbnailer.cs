@@ -0,0 +1,257 @@
+//
+// VideoThumbnailer.cs
+//
+// Copyright (C) 2026 Banshee Project Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+using System;
+using System.Collections.Generic;
+using System.Runtime.InteropServices;
+
+using Mono.Unix;
+
+using Hyena;
+
+using Banshee.Base;
+
+namespace Banshee.GStreamer
+{
+    public enum ThumbnailFormat
+    {
+        Jpeg,
+        Png
+    }
+
+    public class VideoThumbnail
+    {
+        internal VideoThumbnail ()
+        {
+        }
+
+        public SafeUri Uri { get; internal set; }
+        public bool IsValid { get; internal set; }
+        public bool IsCached { get; internal set; }
+
+        // One image file per position, in position order
+        public string [] Paths { get; internal set; }
+    }
+
+    public class VideoThumbnailedArgs : EventArgs
+    {
+        private readonly VideoThumbnail [] thumbnails;
+
+        public VideoThumbnailedArgs (VideoThumbnail [] thumbnails)
+        {
+            this.thumbnails = thumbnails;
+        }
+
+        public VideoThumbnail [] Thumbnails {
+            get { return thumbnails; }
+        }
+    }
+
+    // Grabs still frames of many videos at once on a pool of native
+    // workers, seeking to keyframes only, and keeps them in a disk cache
+    // keyed by URI and modification time. Results arrive on the main loop
+    // in batches, in no particular order.
+    public class VideoThumbnailer : IDisposable
+    {
+        [StructLayout (LayoutKind.Sequential)]
+        private struct NativeRecord
+        {
+            public IntPtr uri;
+            public bool success;
+            public bool cached;
+            public int count;
+            public IntPtr paths;
+        }
+
+        private static readonly int record_size = Marshal.SizeOf (typeof (NativeRecord));
+
+        private HandleRef handle;
+
+        private ThumbnailerRecordsCallback records_callback;
+        private ThumbnailerFinishedCallback finished_callback;
+
+        public event EventHandler<VideoThumbnailedArgs> Thumbnailed;
+        public event EventHandler Finished;
+
+        public VideoThumbnailer () : this (Paths.Combine (Paths.ApplicationCache, "video-thumbnails"), 0)
+        {
+        }
+
+        public VideoThumbnailer (string cacheDirectory, int maxWorkers)
+        {
+            IntPtr directory = GLib.Marshaller.StringToPtrGStrdup (cacheDirectory);
+            IntPtr ptr = bth_new (directory, maxWorkers);
+            GLib.Marshaller.Free (directory);
+
+            if (ptr == IntPtr.Zero) {
+                throw new ApplicationException (Catalog.GetString ("Could not create video thumbnailer"));
+            }
+
+            handle = new HandleRef (this, ptr);
+
+            records_callback = new ThumbnailerRecordsCallback (OnNativeRecords);
+            finished_callback = new ThumbnailerFinishedCallback (OnNativeFinished);
+
+            bth_set_records_callback (handle, records_callback);
+            bth_set_finished_callback (handle, finished_callback);
+        }
+
+        public void Dispose ()
+        {
+            if (handle.Handle != IntPtr.Zero) {
+                bth_destroy (handle);
+                handle = new HandleRef (this, IntPtr.Zero);
+            }
+        }
+
+        public void Thumbnail (IEnumerable<SafeUri> uris)
+        {
+            var uri_ptrs = new List<IntPtr> ();
+
+            try {
+                foreach (SafeUri uri in uris) {
+                    uri_ptrs.Add (GLib.Marshaller.StringToPtrGStrdup (uri.AbsoluteUri));
+                }
+
+                bth_add_uris (handle, uri_ptrs.ToArray (), uri_ptrs.Count);
+            } finally {
+                foreach (IntPtr uri_ptr in uri_ptrs) {
+                    GLib.Marshaller.Free (uri_ptr);
+                }
+            }
+        }
+
+        public void Cancel ()
+        {
+            bth_cancel (handle);
+        }
+
+        public bool IsRunning {
+            get { return bth_get_is_running (handle); }
+        }
+
+        // Where to grab frames, as fractions of the duration; a preview
+        // strip is several of them. Applies to videos added afterwards.
+        public double [] Positions {
+            set { bth_set_positions (handle, value, value == null ? 0 : value.Length); }
+        }
+
+        // Width of the images in pixels, the height follows the video
+        public int Width {
+            set { bth_set_width (handle, value); }
+        }
+
+        public ThumbnailFormat Format {
+            set { bth_set_format (handle, (int)value); }
+        }
+
+        // Maximum number of videos per Thumbnailed event
+        public int BatchSize {
+            set { bth_set_batch_size (handle, value); }
+        }
+
+        private static string PtrToString (IntPtr ptr)
+        {
+            return ptr == IntPtr.Zero ? null : GLib.Marshaller.Utf8PtrToString (ptr);
+        }
+
+        private static VideoThumbnail ToVideoThumbnail (NativeRecord record)
+        {
+            var paths = new string[record.count];
+            for (int i = 0; i < record.count; i++) {
+                paths[i] = PtrToString (Marshal.ReadIntPtr (record.paths, i * IntPtr.Size));
+            }
+
+            return new VideoThumbnail () {
+                Uri = new SafeUri (PtrToString (record.uri)),
+                IsValid = record.success,
+                IsCached = record.cached,
+                Paths = paths
+            };
+        }
+
+        private void OnNativeRecords (IntPtr thumbnailer, IntPtr records, int count)
+        {
+            var handler = Thumbnailed;
+            if (handler == null) {
+                return;
+            }
+
+            var thumbnails = new VideoThumbnail[count];
+            for (int i = 0; i < count; i++) {
+                IntPtr ptr = new IntPtr (records.ToInt64 () + (long)i * record_size);
+                thumbnails[i] = ToVideoThumbnail ((NativeRecord)Marshal.PtrToStructure (ptr, typeof (NativeRecord)));
+            }
+
+            handler (this, new VideoThumbnailedArgs (thumbnails));
+        }
+
+        private void OnNativeFinished (IntPtr thumbnailer)
+        {
+            var handler = Finished;
+            if (handler != null) {
+                handler (this, EventArgs.Empty);
+            }
+        }
+
+        [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+        private delegate void ThumbnailerRecordsCallback (IntPtr thumbnailer, IntPtr records, int count);
+        [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+        private delegate void ThumbnailerFinishedCallback (IntPtr thumbnailer);
+
+        [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
+        private static extern IntPtr bth_new (IntPtr cache_directory, int max_workers);
+
+        [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
+        private static extern void bth_destroy (HandleRef handle);
+
+        [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
+        private static extern bool bth_add_uris (HandleRef handle, IntPtr [] uris, int count);
+
+        [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
+        private static extern void bth_cancel (HandleRef handle);
+
+        [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
+        private static extern bool bth_get_is_running (HandleRef handle);
+
+        [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
+        private static extern void bth_set_positions (HandleRef handle, double [] positions, int count);
+
+        [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
+        private static extern void bth_set_width (HandleRef handle, int width);
+
+        [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
+        private static extern void bth_set_format (HandleRef handle, int format);
+
+        [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
+        private static extern void bth_set_batch_size (HandleRef handle, int batch_size);
+
+        [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
+        private static extern void bth_set_records_callback (HandleRef handle, ThumbnailerRecordsCallback cb);
+
+        [DllImport (PlayerEngine.LibBansheeLibrary, CallingConvention = CallingConvention.Cdecl)]
+        private static extern void bth_set_finished_callback (HandleRef handle, ThumbnailerFinishedCallback cb);
+    }
+}
@@ -0,0 +1,330 @@
+//
+// banshee-batch-pool.c
+//
+// Copyright (C) 2026 Banshee Project Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "banshee-batch-pool.h"
+
+// Records are gathered for this long before they are reported, so they
+// reach the records function in batches rather than one by one
+#define BBP_DISPATCH_INTERVAL 100
+
+struct BansheeBatchPool {
+    gsize record_size;
+    gint batch_size;
+    gboolean is_running;
+
+    // Cancelling starts a new generation; jobs pushed in an older one are
+    // dropped instead of run or reported
+    volatile gint generation;
+
+    GThreadPool *threads;
+
+    // Records filled but not reported yet, jobs dropped since the last
+    // dispatch, and jobs pushed but not reported or dropped yet
+    GMutex *lock;
+    GArray *records;
+    guint dropped;
+    guint pending;
+    guint dispatch_id;
+
+    BansheeBatchPoolRunFunc run;
+    GDestroyNotify job_free;
+    BansheeBatchPoolClearFunc record_clear;
+    BansheeBatchPoolRecordsFunc records_func;
+    BansheeBatchPoolFinishedFunc finished_func;
+    gpointer user_data;
+};
+
+typedef struct {
+    gpointer data;
+    gint generation;
+} BbpJob;
+
+// ---------------------------------------------------------------------------
+// Private Functions
+// ---------------------------------------------------------------------------
+
+static void
+bbp_clear_records (BansheeBatchPool *pool, GArray *records)
+{
+    guint i;
+
+    if (pool->record_clear == NULL) {
+        return;
+    }
+
+    for (i = 0; i < records->len; i++) {
+        pool->record_clear (records->data + i * pool->record_size);
+    }
+}
+
+static gboolean
+bbp_dispatch (gpointer data)
+{
+    BansheeBatchPool *pool = (BansheeBatchPool *)data;
+    GArray *records;
+    guint handled, i;
+    gboolean finished;
+    gint generation;
+
+    g_mutex_lock (pool->lock);
+    pool->dispatch_id = 0;
+    generation = g_atomic_int_get (&pool->generation);
+    records = pool->records;
+    pool->records = g_array_new (FALSE, TRUE, pool->record_size);
+    handled = records->len + pool->dropped;
+    pool->dropped = 0;
+    g_mutex_unlock (pool->lock);
+
+    for (i = 0; i < records->len; i += pool->batch_size) {
+        // The records function may cancel, which drops the batches left
+        if (pool->records_func != NULL && generation == g_atomic_int_get (&pool->generation)) {
+            pool->records_func (records->data + i * pool->record_size,
+                MIN ((guint)pool->batch_size, records->len - i), pool->user_data);
+        }
+    }
+
+    bbp_clear_records (pool, records);
+    g_array_free (records, TRUE);
+
+    g_mutex_lock (pool->lock);
+    pool->pending -= MIN (pool->pending, handled);
+    finished = pool->pending == 0;
+    g_mutex_unlock (pool->lock);
+
+    if (finished) {
+        pool->is_running = FALSE;
+        if (pool->finished_func != NULL) {
+            pool->finished_func (pool->user_data);
+        }
+    }
+
+    return FALSE;
+}
+
+// Called with the lock held
+static void
+bbp_schedule_dispatch (BansheeBatchPool *pool)
+{
+    if (pool->dispatch_id == 0) {
+        pool->dispatch_id = g_timeout_add (BBP_DISPATCH_INTERVAL, bbp_dispatch, pool);
+    }
+}
+
+static void
+bbp_run (gpointer data, gpointer user_data)
+{
+    BansheeBatchPool *pool = (BansheeBatchPool *)user_data;
+    BbpJob *job = (BbpJob *)data;
+    gpointer record = g_malloc0 (pool->record_size);
+    gboolean cancelled;
+
+    cancelled = job->generation != g_atomic_int_get (&pool->generation);
+
+    if (!cancelled) {
+        pool->run (job->data, record, pool->user_data);
+    }
+
+    g_mutex_lock (pool->lock);
+
+    // Cancelled while the job was running
+    cancelled = cancelled || job->generation != g_atomic_int_get (&pool->generation);
+
+    if (cancelled) {
+        pool->dropped++;
+        if (pool->record_clear != NULL) {
+            pool->record_clear (record);
+        }
+    } else {
+        g_array_append_vals (pool->records, record, 1);
+    }
+
+    bbp_schedule_dispatch (pool);
+
+    g_mutex_unlock (pool->lock);
+
+    g_free (record);
+    if (pool->job_free != NULL) {
+        pool->job_free (job->data);
+    }
+    g_free (job);
+}
+
+// ---------------------------------------------------------------------------
+// Internal Functions
+// ---------------------------------------------------------------------------
+
+BansheeBatchPool *
+bbp_new (gint max_workers, gsize record_size, gint batch_size,
+    BansheeBatchPoolRunFunc run, GDestroyNotify job_free,
+    BansheeBatchPoolClearFunc record_clear,
+    BansheeBatchPoolRecordsFunc records,
+    BansheeBatchPoolFinishedFunc finished,
+    gpointer user_data, GError **error)
+{
+    BansheeBatchPool *pool;
+
+    g_return_val_if_fail (record_size > 0, NULL);
+    g_return_val_if_fail (batch_size > 0, NULL);
+    g_return_val_if_fail (run != NULL, NULL);
+
+    if (max_workers <= 0) {
+#if GLIB_CHECK_VERSION(2,36,0)
+        max_workers = g_get_num_processors ();
+#else
+        max_workers = 2;
+#endif
+    }
+
+    pool = g_new0 (BansheeBatchPool, 1);
+    pool->record_size = record_size;
+    pool->batch_size = batch_size;
+    pool->run = run;
+    pool->job_free = job_free;
+    pool->record_clear = record_clear;
+    pool->records_func = records;
+    pool->finished_func = finished;
+    pool->user_data = user_data;
+    pool->lock = g_mutex_new ();
+    pool->records = g_array_new (FALSE, TRUE, record_size);
+
+    pool->threads = g_thread_pool_new (bbp_run, pool, max_workers, FALSE, error);
+    if (pool->threads == NULL) {
+        bbp_free (pool);
+        return NULL;
+    }
+
+    return pool;
+}
+
+// Waits for the jobs that are running; the ones queued are dropped
+void
+bbp_free (BansheeBatchPool *pool)
+{
+    g_return_if_fail (pool != NULL);
+
+    bbp_cancel (pool);
+
+    if (pool->threads != NULL) {
+        g_thread_pool_free (pool->threads, FALSE, TRUE);
+    }
+
+    if (pool->dispatch_id != 0) {
+        g_source_remove (pool->dispatch_id);
+    }
+
+    bbp_clear_records (pool, pool->records);
+    g_array_free (pool->records, TRUE);
+
+    g_mutex_free (pool->lock);
+    g_free (pool);
+}
+
+// Takes every one of the count jobs, even when it returns FALSE because
+// some could not be queued; those are freed and not waited for
+gboolean
+bbp_push (BansheeBatchPool *pool, gpointer *jobs, gint count)
+{
+    gint generation, i;
+
+    g_return_val_if_fail (pool != NULL, FALSE);
+    g_return_val_if_fail (jobs != NULL || count <= 0, FALSE);
+
+    if (count <= 0) {
+        return TRUE;
+    }
+
+    g_mutex_lock (pool->lock);
+    pool->pending += count;
+    pool->is_running = TRUE;
+    g_mutex_unlock (pool->lock);
+
+    // Jobs still queued from before a cancel stay dropped
+    generation = g_atomic_int_get (&pool->generation);
+
+    for (i = 0; i < count; i++) {
+        BbpJob *job = g_new (BbpJob, 1);
+        gint j;
+
+        job->data = jobs[i];
+        job->generation = generation;
+
+        if (g_thread_pool_push (pool->threads, job, NULL)) {
+            continue;
+        }
+
+        g_free (job);
+        for (j = i; j < count && pool->job_free != NULL; j++) {
+            pool->job_free (jobs[j]);
+        }
+
+        // The dispatch reports finished if nothing else is left
+        g_mutex_lock (pool->lock);
+        pool->pending -= MIN (pool->pending, (guint)(count - i));
+        bbp_schedule_dispatch (pool);
+        g_mutex_unlock (pool->lock);
+
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+// Jobs pushed so far that are not reported yet are dropped, including
+// those running; jobs pushed later run as usual. finished is still called
+// once the workers are done.
+void
+bbp_cancel (BansheeBatchPool *pool)
+{
+    g_return_if_fail (pool != NULL);
+
+    g_mutex_lock (pool->lock);
+
+    g_atomic_int_inc (&pool->generation);
+
+    bbp_clear_records (pool, pool->records);
+    pool->dropped += pool->records->len;
+    g_array_set_size (pool->records, 0);
+
+    g_mutex_unlock (pool->lock);
+}
+
+gboolean
+bbp_get_is_running (BansheeBatchPool *pool)
+{
+    g_return_val_if_fail (pool != NULL, FALSE);
+    return pool->is_running;
+}
+
+void
+bbp_set_batch_size (BansheeBatchPool *pool, gint batch_size)
+{
+    g_return_if_fail (pool != NULL);
+    g_return_if_fail (batch_size > 0);
+    pool->batch_size = batch_size;
+}
@@ -0,0 +1,62 @@
+//
+// banshee-batch-pool.h
+//
+// Copyright (C) 2026 Banshee Project Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef _BANSHEE_BATCH_POOL_H
+#define _BANSHEE_BATCH_POOL_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct BansheeBatchPool BansheeBatchPool;
+
+// Fills record, record_size zeroed bytes, with the result of job; called
+// on a worker thread
+typedef void (* BansheeBatchPoolRunFunc)      (gpointer job, gpointer record, gpointer user_data);
+// Frees what a record holds, not the record itself
+typedef void (* BansheeBatchPoolClearFunc)    (gpointer record);
+typedef void (* BansheeBatchPoolRecordsFunc)  (gconstpointer records, gint count, gpointer user_data);
+typedef void (* BansheeBatchPoolFinishedFunc) (gpointer user_data);
+
+// Runs jobs on up to max_workers threads and hands the records they fill
+// to records on the main loop, in batches of at most batch_size and in no
+// particular order. finished is called each time every job pushed so far
+// has been reported or dropped. The pool owns the jobs pushed to it and
+// frees each one with job_free once it is run or dropped.
+BansheeBatchPool *bbp_new            (gint max_workers, gsize record_size, gint batch_size,
+                                      BansheeBatchPoolRunFunc run, GDestroyNotify job_free,
+                                      BansheeBatchPoolClearFunc record_clear,
+                                      BansheeBatchPoolRecordsFunc records,
+                                      BansheeBatchPoolFinishedFunc finished,
+                                      gpointer user_data, GError **error);
+void              bbp_free           (BansheeBatchPool *pool);
+gboolean          bbp_push           (BansheeBatchPool *pool, gpointer *jobs, gint count);
+void              bbp_cancel         (BansheeBatchPool *pool);
+gboolean          bbp_get_is_running (BansheeBatchPool *pool);
+void              bbp_set_batch_size (BansheeBatchPool *pool, gint batch_size);
+
+G_END_DECLS
+
+#endif /* _BANSHEE_BATCH_POOL_H */
@@ -0,0 +1,1045 @@
+//
+// banshee-benchmark.c
+//
+// Copyright (C) 2026 Banshee Project Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+// Headless benchmark of the native engine. It generates short synthetic
+// files, plays, seeks, transcodes and analyzes them through libbanshee with
+// a fake audio sink, and writes the measurements as NUnit style results so
+// tests/compare-perf-results can compare runs. Every value is a cost, lower
+// is better, and its unit is part of its name.
+//
+//   banshee-benchmark [--output=FILE] [--duration=SECONDS]
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <glib/gstdio.h>
+
+#include "banshee-gst.h"
+#include "banshee-player-private.h"
+#include "banshee-player-metrics.h"
+#include "banshee-player-pipeline.h"
+#include "banshee-discoverer.h"
+
+// Exported without a header, the managed side declares them for P/Invoke
+BansheePlayer *bp_new (void);
+void     bp_destroy (BansheePlayer *player);
+gboolean bp_initialize_pipeline (BansheePlayer *player);
+gboolean bp_open (BansheePlayer *player, const gchar *uri, gboolean maybe_video);
+void     bp_stop (BansheePlayer *player, gboolean nullstate);
+void     bp_play (BansheePlayer *player);
+gboolean bp_set_next_track (BansheePlayer *player, const gchar *uri, gboolean maybe_video);
+gboolean bp_set_position (BansheePlayer *player, guint64 time_ms, gboolean accurate_seek);
+gboolean bp_get_pipeline_elements (BansheePlayer *player, GstElement **playbin,
+    GstElement **audiobin, GstElement **audiotee);
+void     bp_set_eos_callback (BansheePlayer *player, BansheePlayerEosCallback cb);
+void     bp_set_error_callback (BansheePlayer *player, BansheePlayerErrorCallback cb);
+void     bp_set_about_to_finish_callback (BansheePlayer *player, BansheePlayerAboutToFinishCallback cb);
+void     bp_replaygain_set_enabled (BansheePlayer *player, gboolean enabled);
+
+typedef struct GstTranscoder GstTranscoder;
+typedef void (* GstTranscoderFinishedCallback) (GstTranscoder *transcoder);
+typedef void (* GstTranscoderErrorCallback) (GstTranscoder *transcoder, const gchar *error, const gchar *debug);
+
+GstTranscoder *gst_transcoder_new (void);
+void gst_transcoder_free (GstTranscoder *transcoder);
+void gst_transcoder_transcode (GstTranscoder *transcoder, const gchar *input_uri,
+    const gchar *output_uri, const gchar *encoder_pipeline);
+void gst_transcoder_set_finished_callback (GstTranscoder *transcoder, GstTranscoderFinishedCallback cb);
+void gst_transcoder_set_error_callback (GstTranscoder *transcoder, GstTranscoderErrorCallback cb);
+
+typedef struct BansheeBpmDetector BansheeBpmDetector;
+typedef void (* BansheeBpmDetectorFinishedCallback) ();
+typedef void (* BansheeBpmDetectorErrorCallback) (const gchar *error, const gchar *debug);
+
+BansheeBpmDetector *bbd_new (void);
+void     bbd_destroy (BansheeBpmDetector *detector);
+gboolean bbd_process_file (BansheeBpmDetector *detector, const gchar *path);
+void     bbd_set_finished_callback (BansheeBpmDetector *detector, BansheeBpmDetectorFinishedCallback cb);
+void     bbd_set_error_callback (BansheeBpmDetector *detector, BansheeBpmDetectorErrorCallback cb);
+
+#define BENCH_SUITE              "Banshee.Native"
+#define BENCH_RATE               44100
+#define BENCH_SHORT_DURATION     2
+#define BENCH_OPEN_RUNS          5
+#define BENCH_SEEK_RUNS          10
+#define BENCH_GAPLESS_TRACKS     4
+#define BENCH_CPU_SECONDS        5
+#define BENCH_TOGGLE_SECONDS     2
+#define BENCH_DSP_SECONDS        60
+#define BENCH_DISCOVERY_REPEATS  20
+
+typedef struct {
+    const gchar *name;
+    const gchar *extension;
+    const gchar *encoder;
+} BenchFormat;
+
+typedef struct {
+    gchar *name;
+    gdouble value;
+    gboolean executed;
+    gchar *message;
+} BenchResult;
+
+static const BenchFormat bench_formats[] = {
+    { "Wav",    "wav",  "wavenc" },
+    { "Vorbis", "ogg",  "vorbisenc ! oggmux" },
+    { "Flac",   "flac", "flacenc" }
+};
+
+#define BENCH_N_FORMATS G_N_ELEMENTS (bench_formats)
+
+static gint bench_duration = 10;
+static gchar *bench_output = NULL;
+static gchar *bench_dir = NULL;
+static GPtrArray *bench_results = NULL;
+
+// Files generated for each format, NULL where the encoder is missing
+static gchar *bench_paths[BENCH_N_FORMATS];
+static gchar *bench_uris[BENCH_N_FORMATS];
+static gchar *bench_short_uris[BENCH_N_FORMATS];
+
+// ---------------------------------------------------------------------------
+// Results
+// ---------------------------------------------------------------------------
+
+static void
+bench_add_result (const gchar *group, const gchar *name, gdouble value, gboolean executed, const gchar *message)
+{
+    BenchResult *result = g_new0 (BenchResult, 1);
+
+    result->name = g_strdup_printf ("%s.%s.%s", BENCH_SUITE, group, name);
+    result->value = value;
+    result->executed = executed;
+    result->message = g_strdup (message);
+    g_ptr_array_add (bench_results, result);
+
+    if (executed) {
+        g_printerr ("  %-16s %-32s %12.3f\n", group, name, value);
+    } else {
+        g_printerr ("  %-16s %-32s      skipped (%s)\n", group, name, message);
+    }
+}
+
+static void
+bench_report (const gchar *group, const gchar *name, gdouble value)
+{
+    bench_add_result (group, name, value, TRUE, NULL);
+}
+
+static void
+bench_skip (const gchar *group, const gchar *name, const gchar *reason)
+{
+    bench_add_result (group, name, 0, FALSE, reason);
+}
+
+static gchar *
+bench_format_double (gdouble value)
+{
+    gchar buffer[G_ASCII_DTOSTR_BUF_SIZE];
+    return g_strdup (g_ascii_formatd (buffer, sizeof (buffer), "%.6f", value));
+}
+
+// Same layout as the nunit-console results test-perf collects, which is
+// all the analyzer reads: the test-case elements and their time
+static gboolean
+bench_write_results (const gchar *path)
+{
+    FILE *file = path != NULL ? g_fopen (path, "w") : stdout;
+    guint failures = 0, not_run = 0, i;
+    time_t now = time (NULL);
+    gchar date[32];
+
+    if (file == NULL) {
+        g_printerr ("Could not write %s\n", path);
+        return FALSE;
+    }
+
+    for (i = 0; i < bench_results->len; i++) {
+        BenchResult *result = g_ptr_array_index (bench_results, i);
+        not_run += result->executed ? 0 : 1;
+    }
+
+    strftime (date, sizeof (date), "date=\"%Y-%m-%d\" time=\"%H:%M:%S\"", localtime (&now));
+
+    fprintf (file, "<?xml version=\"1.0\" encoding=\"utf-8\" standalone=\"no\"?>\n");
+    fprintf (file, "<test-results name=\"banshee-benchmark\" total=\"%u\" failures=\"%u\" not-run=\"%u\" %s>\n",
+        bench_results->len, failures, not_run, date);
+    fprintf (file, "  <test-suite name=\"%s\" success=\"True\" time=\"0\" asserts=\"0\">\n", BENCH_SUITE);
+    fprintf (file, "    <results>\n");
+
+    for (i = 0; i < bench_results->len; i++) {
+        BenchResult *result = g_ptr_array_index (bench_results, i);
+        gchar *value = bench_format_double (result->value);
+
+        if (result->executed) {
+            fprintf (file, "      <test-case name=\"%s\" executed=\"True\" success=\"True\" time=\"%s\" asserts=\"0\" />\n",
+                result->name, value);
+        } else {
+            gchar *reason = g_markup_escape_text (result->message != NULL ? result->message : "", -1);
+            fprintf (file, "      <test-case name=\"%s\" executed=\"False\" success=\"False\" time=\"0\" asserts=\"0\">\n"
+                "        <reason><message><![CDATA[%s]]></message></reason>\n      </test-case>\n",
+                result->name, reason);
+            g_free (reason);
+        }
+
+        g_free (value);
+    }
+
+    fprintf (file, "    </results>\n  </test-suite>\n</test-results>\n");
+
+    return file == stdout ? TRUE : fclose (file) == 0;
+}
+
+// ---------------------------------------------------------------------------
+// Helpers
+// ---------------------------------------------------------------------------
+
+static gdouble
+bench_cpu_seconds (void)
+{
+    return (gdouble)clock () / CLOCKS_PER_SEC;
+}
+
+static gdouble
+bench_wall_seconds (void)
+{
+    return g_get_monotonic_time () / (gdouble)G_USEC_PER_SEC;
+}
+
+static gboolean
+bench_tick (gpointer data)
+{
+    return TRUE;
+}
+
+typedef gboolean (* BenchCondition) (gpointer data);
+
+// Runs the main loop until condition holds, or for timeout seconds when it
+// is NULL; the tick keeps the loop from sleeping past the deadline
+static gboolean
+bench_wait (BenchCondition condition, gpointer data, gdouble timeout)
+{
+    gdouble deadline = bench_wall_seconds () + timeout;
+    guint tick_id = g_timeout_add (20, bench_tick, NULL);
+    gboolean done = FALSE;
+
+    while (!(done = condition != NULL && condition (data)) && bench_wall_seconds () < deadline) {
+        g_main_context_iteration (NULL, TRUE);
+    }
+
+    g_source_remove (tick_id);
+    return done;
+}
+
+static gboolean
+bench_flag_set (gpointer data)
+{
+    return *(volatile gboolean *)data;
+}
+
+// Runs a gst-launch style pipeline to the end, on this thread
+static gboolean
+bench_run_pipeline (const gchar *description, gdouble *cpu_seconds, GError **error)
+{
+    GstElement *pipeline;
+    GstMessage *message;
+    GstBus *bus;
+    gdouble cpu_started;
+    gboolean success;
+
+    pipeline = gst_parse_launch (description, error);
+    if (pipeline == NULL) {
+        return FALSE;
+    }
+
+    bus = gst_element_get_bus (pipeline);
+    cpu_started = bench_cpu_seconds ();
+    gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+    message = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+    success = GST_MESSAGE_TYPE (message) == GST_MESSAGE_EOS;
+    if (!success) {
+        gst_message_parse_error (message, error, NULL);
+    }
+
+    if (cpu_seconds != NULL) {
+        *cpu_seconds = bench_cpu_seconds () - cpu_started;
+    }
+
+    gst_message_unref (message);
+    gst_element_set_state (pipeline, GST_STATE_NULL);
+    gst_object_unref (bus);
+    gst_object_unref (pipeline);
+
+    return success;
+}
+
+// ---------------------------------------------------------------------------
+// Synthetic Media
+// ---------------------------------------------------------------------------
+
+static gchar *
+bench_generate (const BenchFormat *format, const gchar *name, gint seconds)
+{
+    gchar *file = g_strdup_printf ("%s.%s", name, format->extension);
+    gchar *path = g_build_filename (bench_dir, file, NULL);
+    GError *error = NULL;
+    gchar *description;
+
+    // 100 buffers a second
+    description = g_strdup_printf (
+        "audiotestsrc num-buffers=%d samplesperbuffer=%d wave=sine ! "
+        "audio/x-raw,rate=%d,channels=2 ! audioconvert ! %s ! filesink location=\"%s\"",
+        seconds * 100, BENCH_RATE / 100, BENCH_RATE, format->encoder, path);
+
+    if (!bench_run_pipeline (description, NULL, &error)) {
+        g_printerr ("Could not generate %s: %s\n", path, error != NULL ? error->message : "unknown error");
+        if (error != NULL) {
+            g_error_free (error);
+        }
+        g_free (path);
+        path = NULL;
+    }
+
+    g_free (description);
+    g_free (file);
+    return path;
+}
+
+static gchar *
+bench_uri (const gchar *path)
+{
+    return path != NULL ? g_filename_to_uri (path, NULL, NULL) : NULL;
+}
+
+static void
+bench_generate_media (void)
+{
+    guint i;
+
+    for (i = 0; i < BENCH_N_FORMATS; i++) {
+        gchar *short_path;
+
+        bench_paths[i] = bench_generate (&bench_formats[i], "long", bench_duration);
+        short_path = bench_generate (&bench_formats[i], "short", BENCH_SHORT_DURATION);
+
+        bench_uris[i] = bench_uri (bench_paths[i]);
+        bench_short_uris[i] = bench_uri (short_path);
+        g_free (short_path);
+    }
+}
+
+// Mono float WAV with decaying noise, as a stand-in for a measured room
+static gchar *
+bench_write_impulse_response (guint taps)
+{
+    gchar *file = g_strdup_printf ("ir-%u.wav", taps);
+    gchar *path = g_build_filename (bench_dir, file, NULL);
+    guint32 data_size = taps * sizeof (gfloat), value32;
+    guint16 value16;
+    GRand *rand = g_rand_new_with_seed (taps);
+    FILE *out;
+    guint i;
+
+    g_free (file);
+
+    out = g_fopen (path, "wb");
+    if (out == NULL) {
+        g_rand_free (rand);
+        g_free (path);
+        return NULL;
+    }
+
+#define BENCH_PUT32(v) (value32 = GUINT32_TO_LE (v), fwrite (&value32, 4, 1, out))
+#define BENCH_PUT16(v) (value16 = GUINT16_TO_LE (v), fwrite (&value16, 2, 1, out))
+
+    fwrite ("RIFF", 4, 1, out);
+    BENCH_PUT32 (36 + data_size);
+    fwrite ("WAVEfmt ", 8, 1, out);
+    BENCH_PUT32 (16);
+    BENCH_PUT16 (3);
+    BENCH_PUT16 (1);
+    BENCH_PUT32 (BENCH_RATE);
+    BENCH_PUT32 (BENCH_RATE * sizeof (gfloat));
+    BENCH_PUT16 (sizeof (gfloat));
+    BENCH_PUT16 (32);
+    fwrite ("data", 4, 1, out);
+    BENCH_PUT32 (data_size);
+
+    for (i = 0; i < taps; i++) {
+        union { gfloat f; guint32 u; } sample;
+        sample.f = (gfloat)(g_rand_double_range (rand, -1.0, 1.0) * exp (-6.0 * i / taps));
+        BENCH_PUT32 (sample.u);
+    }
+
+#undef BENCH_PUT32
+#undef BENCH_PUT16
+
+    g_rand_free (rand);
+
+    if (fclose (out) != 0) {
+        g_free (path);
+        return NULL;
+    }
+
+    return path;
+}
+
+// ---------------------------------------------------------------------------
+// Player
+// ---------------------------------------------------------------------------
+
+static volatile gboolean bench_player_eos;
+static volatile gboolean bench_player_error;
+static volatile gint bench_next_tracks;
+static const gchar *bench_next_uri;
+
+static void
+bench_player_eos_cb (BansheePlayer *player)
+{
+    bench_player_eos = TRUE;
+}
+
+static void
+bench_player_error_cb (BansheePlayer *player, GQuark domain, gint code, const gchar *error, const gchar *debug)
+{
+    g_printerr ("Player error: %s\n", error);
+    bench_player_error = TRUE;
+}
+
+// Called on the streaming thread, like in the application
+static void
+bench_player_about_to_finish_cb (BansheePlayer *player)
+{
+    if (g_atomic_int_add (&bench_next_tracks, -1) > 0) {
+        bp_set_next_track (player, bench_next_uri, FALSE);
+    }
+}
+
+typedef struct {
+    BansheePlayer *player;
+    guint64 open_count;
+    guint64 seek_count;
+} BenchMetricsWait;
+
+static gboolean
+bench_metrics_reached (gpointer data)
+{
+    BenchMetricsWait *wait = (BenchMetricsWait *)data;
+    BpMetrics metrics;
+
+    if (bench_player_error) {
+        return TRUE;
+    }
+
+    bp_get_metrics (wait->player, &metrics);
+    return metrics.open_latency.count >= wait->open_count && metrics.seek_latency.count >= wait->seek_count;
+}
+
+static gboolean
+bench_player_wait (BansheePlayer *player, guint64 open_count, guint64 seek_count)
+{
+    BenchMetricsWait wait = { player, open_count, seek_count };
+    return bench_wait (bench_metrics_reached, &wait, 10) && !bench_player_error;
+}
+
+static BansheePlayer *
+bench_player_new (void)
+{
+    BansheePlayer *player = bp_new ();
+
+    bp_set_eos_callback (player, bench_player_eos_cb);
+    bp_set_error_callback (player, bench_player_error_cb);
+    bp_set_about_to_finish_callback (player, bench_player_about_to_finish_cb);
+
+    bench_player_eos = FALSE;
+    bench_player_error = FALSE;
+    bench_next_tracks = 0;
+
+    // Play as fast as a sound card would, without needing one
+    _bp_pipeline_set_audiosink (player, "fakesink sync=true");
+
+    if (!bp_initialize_pipeline (player)) {
+        bp_destroy (player);
+        return NULL;
+    }
+
+    return player;
+}
+
+static void
+bench_player (guint index)
+{
+    const gchar *group = bench_formats[index].name;
+    const gchar *uri = bench_uris[index];
+    gdouble cpu_started, wall_started, seconds;
+    BansheePlayer *player;
+    BpMetrics metrics;
+    gint i;
+
+    if (uri == NULL || (player = bench_player_new ()) == NULL) {
+        const gchar *reason = uri == NULL ? "no synthetic file" : "could not build the player pipeline";
+        bench_skip (group, "OpenLatencyMs", reason);
+        bench_skip (group, "SeekLatencyMs", reason);
+        bench_skip (group, "CpuPercent", reason);
+        bench_skip (group, "GaplessGapSamples", reason);
+        return;
+    }
+
+    // bp_open to the first buffer at the sink, from a stopped pipeline
+    bp_reset_metrics (player);
+    for (i = 1; i <= BENCH_OPEN_RUNS; i++) {
+        bp_open (player, uri, FALSE);
+        bp_play (player);
+        if (!bench_player_wait (player, i, 0)) {
+            break;
+        }
+        bp_stop (player, TRUE);
+    }
+
+    bp_get_metrics (player, &metrics);
+    if (metrics.open_latency.count == BENCH_OPEN_RUNS) {
+        bench_report (group, "OpenLatencyMs", metrics.open_latency.mean);
+        bench_report (group, "OpenLatencyMaxMs", metrics.open_latency.max);
+    } else {
+        bench_skip (group, "OpenLatencyMs", "playback did not start");
+    }
+
+    // Flushing seeks spread over the file while playing
+    bp_reset_metrics (player);
+    bp_open (player, uri, FALSE);
+    bp_play (player);
+    if (bench_player_wait (player, 1, 0)) {
+        for (i = 1; i <= BENCH_SEEK_RUNS; i++) {
+            guint64 position = (guint64)(i * 7919) % MAX (1, (bench_duration - 1) * 1000);
+            bp_set_position (player, position, FALSE);
+            if (!bench_player_wait (player, 1, i)) {
+                break;
+            }
+        }
+    }
+
+    bp_get_metrics (player, &metrics);
+    if (metrics.seek_latency.count == BENCH_SEEK_RUNS) {
+        bench_report (group, "SeekLatencyMs", metrics.seek_latency.mean);
+        bench_report (group, "SeekLatencyMaxMs", metrics.seek_latency.max);
+    } else {
+        bench_skip (group, "SeekLatencyMs", "seeks did not complete");
+    }
+
+    // Process CPU time while one stream plays in real time
+    bp_set_position (player, 0, FALSE);
+    if (bench_player_wait (player, 1, BENCH_SEEK_RUNS + 1)) {
+        seconds = MIN (BENCH_CPU_SECONDS, bench_duration - 1);
+        bp_reset_metrics (player);
+        cpu_started = bench_cpu_seconds ();
+        wall_started = bench_wall_seconds ();
+        bench_wait (NULL, NULL, seconds);
+        bench_report (group, "CpuPercent",
+            100 * (bench_cpu_seconds () - cpu_started) / (bench_wall_seconds () - wall_started));
+
+        bp_get_metrics (player, &metrics);
+        if (metrics.underruns > 0) {
+            g_printerr ("  %-16s %" G_GUINT64_FORMAT " underruns\n", group, metrics.underruns);
+        }
+    } else {
+        bench_skip (group, "CpuPercent", "playback did not start");
+    }
+
+    bp_stop (player, TRUE);
+
+    // The short file played back to back with itself
+    if (bench_short_uris[index] != NULL) {
+        bench_next_uri = bench_short_uris[index];
+        bench_next_tracks = BENCH_GAPLESS_TRACKS - 1;
+        bench_player_eos = FALSE;
+
+        bp_reset_metrics (player);
+        bp_open (player, bench_next_uri, FALSE);
+        bp_play (player);
+        bench_wait (bench_flag_set, (gpointer)&bench_player_eos, BENCH_GAPLESS_TRACKS * BENCH_SHORT_DURATION + 10);
+        bp_stop (player, TRUE);
+
+        bp_get_metrics (player, &metrics);
+        if (metrics.gapless_gap.count > 0) {
+            bench_report (group, "GaplessGapSamples", MAX (fabs (metrics.gapless_gap.min), fabs (metrics.gapless_gap.max)));
+        } else {
+            bench_skip (group, "GaplessGapSamples", "no gapless transition happened");
+        }
+    } else {
+        bench_skip (group, "GaplessGapSamples", "no synthetic file");
+    }
+
+    bp_destroy (player);
+}
+
+// Longest wait between buffers reaching the sink, which grows when the
+// streaming thread stalls
+static gint64 bench_last_buffer;
+static gint64 bench_max_interval;
+
+static GstPadProbeReturn
+bench_interval_probe_cb (GstPad *pad, GstPadProbeInfo *info, gpointer data)
+{
+    gint64 now = g_get_monotonic_time ();
+
+    if (bench_last_buffer != 0 && now - bench_last_buffer > bench_max_interval) {
+        bench_max_interval = now - bench_last_buffer;
+    }
+
+    bench_last_buffer = now;
+    return GST_PAD_PROBE_OK;
+}
+
+static gboolean
+bench_toggle_replaygain (gpointer data)
+{
+    static gboolean enabled = FALSE;
+
+    enabled = !enabled;
+    bp_replaygain_set_enabled ((BansheePlayer *)data, enabled);
+    return TRUE;
+}
+
+static void
+bench_replaygain_toggle (void)
+{
+    GstElement *playbin, *audiobin, *audiotee, *audiosink = NULL;
+    BansheePlayer *player;
+    GstPad *pad = NULL;
+    gdouble steady;
+    guint toggle_id;
+
+    if (bench_uris[0] == NULL || (player = bench_player_new ()) == NULL) {
+        bench_skip ("ReplayGain", "ToggleMaxIntervalMs", "no player");
+        return;
+    }
+
+    bp_get_pipeline_elements (player, &playbin, &audiobin, &audiotee);
+    if (audiobin != NULL) {
+        audiosink = gst_bin_get_by_name (GST_BIN (audiobin), "audiosink");
+    }
+    if (audiosink != NULL) {
+        pad = gst_element_get_static_pad (audiosink, "sink");
+        gst_object_unref (audiosink);
+    }
+
+    if (pad == NULL) {
+        bench_skip ("ReplayGain", "ToggleMaxIntervalMs", "no audio sink pad");
+        bp_destroy (player);
+        return;
+    }
+
+    gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, bench_interval_probe_cb, NULL, NULL);
+
+    bp_reset_metrics (player);
+    bp_open (player, bench_uris[0], FALSE);
+    bp_play (player);
+
+    if (!bench_player_wait (player, 1, 0)) {
+        bench_skip ("ReplayGain", "ToggleMaxIntervalMs", "playback did not start");
+    } else {
+        bench_wait (NULL, NULL, 0.5);
+
+        bench_max_interval = 0;
+        bench_wait (NULL, NULL, BENCH_TOGGLE_SECONDS);
+        steady = bench_max_interval / 1000.0;
+
+        bench_max_interval = 0;
+        toggle_id = g_timeout_add (50, bench_toggle_replaygain, player);
+        bench_wait (NULL, NULL, BENCH_TOGGLE_SECONDS);
+        g_source_remove (toggle_id);
+
+        bench_report ("ReplayGain", "SteadyMaxIntervalMs", steady);
+        bench_report ("ReplayGain", "ToggleMaxIntervalMs", bench_max_interval / 1000.0);
+    }
+
+    bp_stop (player, TRUE);
+    gst_object_unref (pad);
+    bp_destroy (player);
+}
+
+// ---------------------------------------------------------------------------
+// DSP Elements
+// ---------------------------------------------------------------------------
+
+// CPU time an element takes per second of stereo float audio, with the
+// cost of the source and sink measured through identity taken out
+static gboolean
+bench_element_cost (const gchar *element, gdouble baseline, gdouble *cost, GError **error)
+{
+    gint buffers = BENCH_DSP_SECONDS * BENCH_RATE / 1024;
+    gdouble cpu_seconds;
+    gchar *description;
+    gboolean success;
+
+    description = g_strdup_printf (
+        "audiotestsrc num-buffers=%d samplesperbuffer=1024 wave=white-noise ! "
+        "audio/x-raw,format=%s,rate=%d,channels=2,layout=interleaved ! %s ! fakesink",
+        buffers, GST_AUDIO_NE (F32), BENCH_RATE, element);
+
+    success = bench_run_pipeline (description, &cpu_seconds, error);
+    if (success) {
+        *cost = MAX (0, cpu_seconds * 1000 / (buffers * 1024.0 / BENCH_RATE) - baseline);
+    }
+
+    g_free (description);
+    return success;
+}
+
+static void
+bench_element (const gchar *name, const gchar *element, gdouble baseline)
+{
+    GError *error = NULL;
+    gdouble cost;
+
+    if (bench_element_cost (element, baseline, &cost, &error)) {
+        bench_report ("Dsp", name, cost);
+    } else {
+        bench_skip ("Dsp", name, error != NULL ? error->message : "pipeline failed");
+    }
+
+    if (error != NULL) {
+        g_error_free (error);
+    }
+}
+
+static void
+bench_dsp (void)
+{
+    static const guint taps[] = { 1024, 8192, 32768, 65536 };
+    const gchar *bands = "band0=4 band1=-3 band2=2 band3=-1 band4=3 band5=-2 band6=1 band7=-4 band8=2 band9=-1";
+    gdouble baseline = 0;
+    gchar *element;
+    guint i;
+
+    if (!bench_element_cost ("identity", 0, &baseline, NULL)) {
+        baseline = 0;
+    }
+
+    element = g_strdup_printf ("banshee-equalizer %s", bands);
+    bench_element ("EqualizerMsPerSecond", element, baseline);
+    g_free (element);
+
+    element = g_strdup_printf ("equalizer-10bands %s", bands);
+    bench_element ("Equalizer10BandsMsPerSecond", element, baseline);
+    g_free (element);
+
+    bench_element ("GainMsPerSecond", "banshee-gain volume=0.5", baseline);
+
+    for (i = 0; i < G_N_ELEMENTS (taps); i++) {
+        gchar *path = bench_write_impulse_response (taps[i]);
+        gchar *name = g_strdup_printf ("Convolver%uTapsMsPerSecond", taps[i]);
+
+        if (path != NULL) {
+            element = g_strdup_printf ("banshee-convolver location=\"%s\"", path);
+            bench_element (name, element, baseline);
+            g_free (element);
+            g_unlink (path);
+        } else {
+            bench_skip ("Dsp", name, "could not write the impulse response");
+        }
+
+        g_free (name);
+        g_free (path);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Transcoder, BPM Detector and Discoverer
+// ---------------------------------------------------------------------------
+
+static volatile gboolean bench_job_done;
+static gchar *bench_job_error;
+
+static void
+bench_transcoder_finished_cb (GstTranscoder *transcoder)
+{
+    bench_job_done = TRUE;
+}
+
+static void
+bench_transcoder_error_cb (GstTranscoder *transcoder, const gchar *error, const gchar *debug)
+{
+    g_free (bench_job_error);
+    bench_job_error = g_strdup (error);
+    bench_job_done = TRUE;
+}
+
+static void
+bench_bpm_finished_cb ()
+{
+    bench_job_done = TRUE;
+}
+
+static void
+bench_bpm_error_cb (const gchar *error, const gchar *debug)
+{
+    g_free (bench_job_error);
+    bench_job_error = g_strdup (error);
+    bench_job_done = TRUE;
+}
+
+static void
+bench_job_start (void)
+{
+    bench_job_done = FALSE;
+    g_free (bench_job_error);
+    bench_job_error = NULL;
+}
+
+// Reports wall time per second of audio of a job started just before
+static void
+bench_job_finish (const gchar *group, const gchar *name, gdouble started)
+{
+    if (!bench_wait (bench_flag_set, (gpointer)&bench_job_done, 60 + 10 * bench_duration)) {
+        bench_skip (group, name, "timed out");
+    } else if (bench_job_error != NULL) {
+        bench_skip (group, name, bench_job_error);
+    } else {
+        bench_report (group, name, (bench_wall_seconds () - started) * 1000 / bench_duration);
+    }
+}
+
+static void
+bench_transcoder (void)
+{
+    static const struct {
+        const gchar *name;
+        const gchar *extension;
+        const gchar *pipeline;
+    } targets[] = {
+        { "VorbisMsPerSecond", "ogg", "audioconvert ! vorbisenc ! oggmux" },
+        { "FlacMsPerSecond", "flac", "audioconvert ! flacenc" }
+    };
+    GstTranscoder *transcoder;
+    guint i;
+
+    if (bench_uris[0] == NULL) {
+        bench_skip ("Transcoder", targets[0].name, "no synthetic file");
+        return;
+    }
+
+    transcoder = gst_transcoder_new ();
+    gst_transcoder_set_finished_callback (transcoder, bench_transcoder_finished_cb);
+    gst_transcoder_set_error_callback (transcoder, bench_transcoder_error_cb);
+
+    for (i = 0; i < G_N_ELEMENTS (targets); i++) {
+        gchar *file = g_strdup_printf ("transcoded.%s", targets[i].extension);
+        gchar *path = g_build_filename (bench_dir, file, NULL);
+        gchar *uri = bench_uri (path);
+
+        bench_job_start ();
+        gst_transcoder_transcode (transcoder, bench_uris[0], uri, targets[i].pipeline);
+        bench_job_finish ("Transcoder", targets[i].name, bench_wall_seconds ());
+
+        g_unlink (path);
+        g_free (uri);
+        g_free (path);
+        g_free (file);
+    }
+
+    gst_transcoder_free (transcoder);
+}
+
+static void
+bench_bpm_detector (void)
+{
+    BansheeBpmDetector *detector;
+    gdouble started;
+
+    if (bench_paths[0] == NULL) {
+        bench_skip ("BpmDetector", "DetectMsPerSecond", "no synthetic file");
+        return;
+    }
+
+    detector = bbd_new ();
+    bbd_set_finished_callback (detector, bench_bpm_finished_cb);
+    bbd_set_error_callback (detector, bench_bpm_error_cb);
+
+    bench_job_start ();
+    started = bench_wall_seconds ();
+    if (bbd_process_file (detector, bench_paths[0])) {
+        bench_job_finish ("BpmDetector", "DetectMsPerSecond", started);
+    } else {
+        bench_skip ("BpmDetector", "DetectMsPerSecond", "could not build the pipeline");
+    }
+
+    bbd_destroy (detector);
+}
+
+static void
+bench_discoverer_finished_cb (BansheeDiscoverer *discoverer)
+{
+    bench_job_done = TRUE;
+}
+
+static void
+bench_discoverer (void)
+{
+    BansheeDiscoverer *discoverer;
+    GPtrArray *uris = g_ptr_array_new ();
+    gdouble started;
+    guint i, j;
+
+    for (i = 0; i < BENCH_DISCOVERY_REPEATS; i++) {
+        for (j = 0; j < BENCH_N_FORMATS; j++) {
+            if (bench_uris[j] != NULL) {
+                g_ptr_array_add (uris, bench_uris[j]);
+            }
+        }
+    }
+
+    if (uris->len == 0) {
+        bench_skip ("Discoverer", "MsPerFile", "no synthetic file");
+        g_ptr_array_free (uris, TRUE);
+        return;
+    }
+
+    discoverer = bdi_new (0, 10);
+    bdi_set_finished_callback (discoverer, bench_discoverer_finished_cb);
+
+    bench_job_start ();
+    started = bench_wall_seconds ();
+    bdi_add_uris (discoverer, (const gchar * const *)uris->pdata, (gint)uris->len);
+
+    if (bench_wait (bench_flag_set, (gpointer)&bench_job_done, 120)) {
+        bench_report ("Discoverer", "MsPerFile", (bench_wall_seconds () - started) * 1000 / uris->len);
+    } else {
+        bench_skip ("Discoverer", "MsPerFile", "timed out");
+    }
+
+    bdi_destroy (discoverer);
+    g_ptr_array_free (uris, TRUE);
+}
+
+// ---------------------------------------------------------------------------
+// Main
+// ---------------------------------------------------------------------------
+
+static void
+bench_log_handler (BansheeLogType type, const gchar *component, const gchar *message)
+{
+    if (type == BANSHEE_LOG_TYPE_WARNING || type == BANSHEE_LOG_TYPE_ERROR) {
+        g_printerr ("%s: %s\n", component, message);
+    }
+}
+
+static void
+bench_remove_dir (const gchar *path)
+{
+    const gchar *name;
+    GDir *dir = g_dir_open (path, 0, NULL);
+
+    if (dir != NULL) {
+        while ((name = g_dir_read_name (dir)) != NULL) {
+            gchar *child = g_build_filename (path, name, NULL);
+            g_unlink (child);
+            g_free (child);
+        }
+        g_dir_close (dir);
+    }
+
+    g_rmdir (path);
+}
+
+int
+main (int argc, char **argv)
+{
+    static GOptionEntry entries[] = {
+        { "output", 'o', 0, G_OPTION_ARG_FILENAME, &bench_output, "Write the results to FILE instead of stdout", "FILE" },
+        { "duration", 'd', 0, G_OPTION_ARG_INT, &bench_duration, "Length of the synthetic files, at least 2 seconds", "SECONDS" },
+        { NULL }
+    };
+    GOptionContext *context;
+    GError *error = NULL;
+    gboolean written;
+    guint i;
+
+    context = g_option_context_new ("- benchmark the native playback engine");
+    g_option_context_add_main_entries (context, entries, NULL);
+    g_option_context_add_group (context, gst_init_get_option_group ());
+    if (!g_option_context_parse (context, &argc, &argv, &error)) {
+        g_printerr ("%s\n", error->message);
+        g_error_free (error);
+        return 1;
+    }
+    g_option_context_free (context);
+
+    bench_duration = MAX (bench_duration, 2);
+
+    gstreamer_initialize (FALSE, bench_log_handler);
+
+    bench_dir = g_dir_make_tmp ("banshee-benchmark-XXXXXX", &error);
+    if (bench_dir == NULL) {
+        g_printerr ("%s\n", error->message);
+        g_error_free (error);
+        return 1;
+    }
+
+    bench_results = g_ptr_array_new ();
+
+    g_printerr ("Generating %d second files in %s\n", bench_duration, bench_dir);
+    bench_generate_media ();
+
+    for (i = 0; i < BENCH_N_FORMATS; i++) {
+        bench_player (i);
+    }
+
+    bench_replaygain_toggle ();
+    bench_dsp ();
+    bench_transcoder ();
+    bench_bpm_detector ();
+    bench_discoverer ();
+
+    written = bench_write_results (bench_output);
+
+    for (i = 0; i < BENCH_N_FORMATS; i++) {
+        g_free (bench_paths[i]);
+        g_free (bench_uris[i]);
+        g_free (bench_short_uris[i]);
+    }
+
+    for (i = 0; i < bench_results->len; i++) {
+        BenchResult *result = g_ptr_array_index (bench_results, i);
+        g_free (result->name);
+        g_free (result->message);
+        g_free (result);
+    }
+    g_ptr_array_free (bench_results, TRUE);
+
+    bench_remove_dir (bench_dir);
+    g_free (bench_dir);
+
+    banshee_log_flush ();
+
+    return written ? 0 : 1;
+}
@@ -139,11 +139,13 @@ bbd_pipeline_bus_callback (GstBus *bus, GstMessage *message, gpointer data)
             g_free (debug);
             
             detector->is_detecting = FALSE;
+            BANSHEE_TRACE_ASYNC_END ("bpm", "detect", detector);
             break;
         }
 
         case GST_MESSAGE_EOS: {
             detector->is_detecting = FALSE;
+            BANSHEE_TRACE_ASYNC_END ("bpm", "detect", detector);
             gst_element_set_state (GST_ELEMENT (detector->pipeline), GST_STATE_NULL);
 
             if (detector->finished_cb != NULL) {
@@ -325,6 +327,7 @@ bbd_process_file (BansheeBpmDetector *detector, const gchar *path)
         }
     }*/
 
+    BANSHEE_TRACE_ASYNC_BEGIN ("bpm", "detect", detector);
     gst_element_set_state (detector->pipeline, GST_STATE_PLAYING);
     return TRUE;
 }
@@ -0,0 +1,958 @@
+//
+// banshee-convolver.c
+//
+// Copyright (C) 2026 Banshee Project Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <math.h>
+#include <string.h>
+
+#include "banshee-convolver.h"
+
+// One partition is the latency of the stage: 512 frames are ~12 ms at
+// 44.1 kHz while keeping the number of partitions of long responses low
+#define BANSHEE_CONVOLVER_DEFAULT_PARTITION_SIZE 512
+#define BANSHEE_CONVOLVER_MIN_PARTITION_SIZE 64
+#define BANSHEE_CONVOLVER_MAX_PARTITION_SIZE 16384
+
+// Zero crossings on each side of the windowed sinc that resamples responses
+// recorded at another rate than the stream
+#define BANSHEE_CONVOLVER_SINC_ZEROS 16
+
+#define BANSHEE_CONVOLVER_WAVE_FORMAT_PCM        0x0001
+#define BANSHEE_CONVOLVER_WAVE_FORMAT_FLOAT      0x0003
+#define BANSHEE_CONVOLVER_WAVE_FORMAT_EXTENSIBLE 0xFFFE
+
+GST_DEBUG_CATEGORY_STATIC (banshee_convolver_debug);
+#define GST_CAT_DEFAULT banshee_convolver_debug
+
+enum {
+    PROP_0,
+    PROP_LOCATION,
+    PROP_PARTITION_SIZE
+};
+
+// A response resampled to one stream rate and transformed into partitions
+// of block frames, ready for the streaming thread to swap in
+struct _BansheeConvolverKernel {
+    guint rate;
+    guint block;
+    guint partitions;
+    guint channels;
+    GstFFTF32Complex *spectra;
+};
+
+typedef struct {
+    BansheeConvolver *convolver;
+    BansheeConvolverResponse *response;
+    guint rate;
+    guint block;
+    guint serial;
+} BansheeConvolverTask;
+
+// Kernels are prepared one at a time for all convolvers
+G_LOCK_DEFINE_STATIC (banshee_convolver_pool);
+static GThreadPool *banshee_convolver_pool = NULL;
+
+// Integer streams pass through untouched; with a response loaded the caps
+// are narrowed to float so upstream converts only while convolving
+#define BANSHEE_CONVOLVER_CAPS \
+    "audio/x-raw, " \
+    "format = (string) { " GST_AUDIO_NE (F32) ", " GST_AUDIO_NE (S16) " }, " \
+    "rate = (int) [ 1, MAX ], " \
+    "channels = (int) [ 1, MAX ], " \
+    "layout = (string) interleaved"
+
+#define BANSHEE_CONVOLVER_FLOAT_CAPS \
+    "audio/x-raw, format = (string) " GST_AUDIO_NE (F32)
+
+static GstStaticPadTemplate banshee_convolver_sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK, GST_PAD_ALWAYS, GST_STATIC_CAPS (BANSHEE_CONVOLVER_CAPS));
+
+static GstStaticPadTemplate banshee_convolver_src_template = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC, GST_PAD_ALWAYS, GST_STATIC_CAPS (BANSHEE_CONVOLVER_CAPS));
+
+G_DEFINE_TYPE_WITH_CODE (BansheeConvolver, banshee_convolver, GST_TYPE_BASE_TRANSFORM,
+    GST_DEBUG_CATEGORY_INIT (banshee_convolver_debug, "banshee-convolver", 0, "Banshee convolver"));
+
+// ---------------------------------------------------------------------------
+// Private Functions
+// ---------------------------------------------------------------------------
+
+static inline guint16
+banshee_convolver_read_le16 (const guchar *data)
+{
+    return data[0] | (data[1] << 8);
+}
+
+static inline guint32
+banshee_convolver_read_le32 (const guchar *data)
+{
+    return data[0] | (data[1] << 8) | (data[2] << 16) | ((guint32)data[3] << 24);
+}
+
+static gfloat
+banshee_convolver_read_sample (const guchar *data, guint format, guint bits)
+{
+    guint32 value;
+    gfloat sample;
+
+    switch (bits) {
+        case 16:
+            return (gint16)banshee_convolver_read_le16 (data) / 32768.0f;
+        case 24:
+            return ((gint32)(((guint32)data[0] << 8) | ((guint32)data[1] << 16) | ((guint32)data[2] << 24)) >> 8) / 8388608.0f;
+        default:
+            value = banshee_convolver_read_le32 (data);
+            if (format == BANSHEE_CONVOLVER_WAVE_FORMAT_FLOAT) {
+                memcpy (&sample, &value, sizeof (sample));
+                return sample;
+            }
+            return (gint32)value / 2147483648.0f;
+    }
+}
+
+static inline gdouble
+banshee_convolver_sinc (gdouble x)
+{
+    return x == 0.0 ? 1.0 : sin (G_PI * x) / (G_PI * x);
+}
+
+// Deinterleaves the response and converts it to the stream rate with a
+// Hann windowed sinc. Its cutoff is the lower of the two Nyquist rates, so
+// a response recorded at a higher rate is low-passed instead of folding
+// its top octave back into the audible band. The taps are scaled by the
+// rate ratio so the gain of the filter does not change with the number of
+// taps.
+static gfloat *
+banshee_convolver_resample (const BansheeConvolverResponse *response, guint rate, guint *frames)
+{
+    gdouble ratio = (gdouble)response->rate / rate;
+    gdouble cutoff = MIN (1.0, 1.0 / ratio);
+    gdouble half = BANSHEE_CONVOLVER_SINC_ZEROS / cutoff;
+    guint n = response->rate == rate ? response->frames : (guint)ceil (response->frames / ratio);
+    gfloat *taps = g_new (gfloat, n * response->channels);
+    guint c, i;
+
+    if (response->rate == rate) {
+        for (c = 0; c < response->channels; c++) {
+            for (i = 0; i < n; i++) {
+                taps[c * n + i] = response->samples[i * response->channels + c];
+            }
+        }
+
+        *frames = n;
+        return taps;
+    }
+
+    for (c = 0; c < response->channels; c++) {
+        for (i = 0; i < n; i++) {
+            gdouble t = i * ratio, sum = 0.0;
+            gint first = MAX (0, (gint)ceil (t - half));
+            gint last = MIN ((gint)response->frames - 1, (gint)floor (t + half));
+            gint j;
+
+            for (j = first; j <= last; j++) {
+                gdouble d = t - j;
+                gdouble window = 0.5 + 0.5 * cos (G_PI * d / half);
+
+                sum += response->samples[j * response->channels + c] * cutoff * banshee_convolver_sinc (cutoff * d) * window;
+            }
+
+            taps[c * n + i] = (gfloat)(ratio * sum);
+        }
+    }
+
+    *frames = n;
+    return taps;
+}
+
+static BansheeConvolverResponse *
+banshee_convolver_response_copy (const BansheeConvolverResponse *response)
+{
+    BansheeConvolverResponse *copy = g_new (BansheeConvolverResponse, 1);
+
+    *copy = *response;
+    copy->samples = g_memdup (response->samples, response->frames * response->channels * sizeof (gfloat));
+    return copy;
+}
+
+// Splits the resampled response into partitions and transforms them, zero
+// padded to twice the partition size. The inverse transform is not
+// normalized, so its 1 / N is folded into the kernel.
+static BansheeConvolverKernel *
+banshee_convolver_kernel_new (const BansheeConvolverResponse *response, guint rate, guint block)
+{
+    BansheeConvolverKernel *kernel = g_new0 (BansheeConvolverKernel, 1);
+    guint bins = block + 1, frames, c, p;
+    GstFFTF32 *fft = gst_fft_f32_new (2 * block, FALSE);
+    gfloat *scratch = g_new (gfloat, 2 * block);
+    gfloat *taps = banshee_convolver_resample (response, rate, &frames);
+
+    kernel->rate = rate;
+    kernel->block = block;
+    kernel->partitions = (frames + block - 1) / block;
+    kernel->channels = response->channels;
+    kernel->spectra = g_new (GstFFTF32Complex, kernel->channels * kernel->partitions * bins);
+
+    for (c = 0; c < kernel->channels; c++) {
+        for (p = 0; p < kernel->partitions; p++) {
+            guint n = MIN (block, frames - p * block), i;
+            const gfloat *partition = taps + c * frames + p * block;
+
+            memset (scratch, 0, 2 * block * sizeof (gfloat));
+            for (i = 0; i < n; i++) {
+                scratch[i] = partition[i] / (2 * block);
+            }
+
+            gst_fft_f32_fft (fft, scratch, kernel->spectra + (c * kernel->partitions + p) * bins);
+        }
+    }
+
+    gst_fft_f32_free (fft);
+    g_free (scratch);
+    g_free (taps);
+
+    return kernel;
+}
+
+static void
+banshee_convolver_kernel_free (BansheeConvolverKernel *kernel)
+{
+    if (kernel != NULL) {
+        g_free (kernel->spectra);
+        g_free (kernel);
+    }
+}
+
+static void
+banshee_convolver_run_task (gpointer data, gpointer user_data)
+{
+    BansheeConvolverTask *task = (BansheeConvolverTask *)data;
+    BansheeConvolver *self = task->convolver;
+    BansheeConvolverKernel *kernel = NULL;
+    gboolean current;
+
+    // Skip the work if another response or rate was asked for meanwhile
+    GST_OBJECT_LOCK (self);
+    current = task->serial == self->kernel_serial;
+    GST_OBJECT_UNLOCK (self);
+
+    if (current) {
+        kernel = banshee_convolver_kernel_new (task->response, task->rate, task->block);
+
+        GST_OBJECT_LOCK (self);
+        if (task->serial == self->kernel_serial) {
+            banshee_convolver_kernel_free (self->prepared);
+            self->prepared = kernel;
+            self->response_changed = TRUE;
+            kernel = NULL;
+        }
+        GST_OBJECT_UNLOCK (self);
+
+        GST_DEBUG_OBJECT (self, "Prepared a kernel of %u frame partitions at %u Hz", task->block, task->rate);
+    }
+
+    banshee_convolver_kernel_free (kernel);
+    banshee_convolver_response_free (task->response);
+    gst_object_unref (self);
+    g_free (task);
+}
+
+// Drops any kernel prepared for an earlier response, rate or partition
+// size and has the worker prepare one for the current ones. Called with
+// the object lock held.
+static void
+banshee_convolver_request_kernel (BansheeConvolver *self)
+{
+    guint rate = GST_AUDIO_INFO_RATE (&self->info);
+    BansheeConvolverTask *task;
+    GThreadPool *pool;
+
+    self->kernel_serial++;
+    banshee_convolver_kernel_free (self->prepared);
+    self->prepared = NULL;
+    self->response_changed = TRUE;
+
+    if (self->response == NULL || rate == 0 ||
+        GST_AUDIO_INFO_FORMAT (&self->info) != GST_AUDIO_FORMAT_F32) {
+        return;
+    }
+
+    G_LOCK (banshee_convolver_pool);
+    if (banshee_convolver_pool == NULL) {
+        banshee_convolver_pool = g_thread_pool_new (banshee_convolver_run_task, NULL, 1, FALSE, NULL);
+    }
+    pool = banshee_convolver_pool;
+    G_UNLOCK (banshee_convolver_pool);
+
+    if (pool == NULL) {
+        GST_WARNING_OBJECT (self, "Could not start the kernel worker");
+        return;
+    }
+
+    task = g_new0 (BansheeConvolverTask, 1);
+    task->convolver = gst_object_ref (self);
+    task->response = banshee_convolver_response_copy (self->response);
+    task->rate = rate;
+    task->block = self->partition_size;
+    task->serial = self->kernel_serial;
+
+    g_thread_pool_push (pool, task, NULL);
+}
+
+static void
+banshee_convolver_free_filter (BansheeConvolver *self)
+{
+    if (self->fft != NULL) {
+        gst_fft_f32_free (self->fft);
+        gst_fft_f32_free (self->ifft);
+    }
+
+    banshee_convolver_kernel_free (self->kernel);
+    g_free (self->spectra);
+    g_free (self->accumulator);
+    g_free (self->input);
+    g_free (self->output);
+    g_free (self->scratch);
+
+    self->kernel = NULL;
+    self->fft = self->ifft = NULL;
+    self->spectra = self->accumulator = NULL;
+    self->input = self->output = self->scratch = NULL;
+    self->channels = 0;
+    self->partitions = 0;
+    self->head = self->position = 0;
+}
+
+// Swaps in the kernel the worker prepared and sets up the delay lines for
+// it. Runs in the streaming thread whenever the response, partition size
+// or caps change. Until the kernel for a new response or partition size
+// arrives the current one keeps running, if it was made for this format.
+static void
+banshee_convolver_configure (BansheeConvolver *self)
+{
+    guint rate = GST_AUDIO_INFO_RATE (&self->info);
+    guint channels = GST_AUDIO_INFO_CHANNELS (&self->info);
+    gboolean usable = rate > 0 && channels > 0 && GST_AUDIO_INFO_FORMAT (&self->info) == GST_AUDIO_FORMAT_F32;
+    BansheeConvolverKernel *kernel;
+    GstClockTime latency = 0;
+    gboolean latency_changed, have_response;
+    guint bins;
+
+    GST_OBJECT_LOCK (self);
+    self->response_changed = FALSE;
+    kernel = self->prepared;
+    self->prepared = NULL;
+    have_response = self->response != NULL;
+    GST_OBJECT_UNLOCK (self);
+
+    if (kernel == NULL && have_response && usable && self->kernel != NULL &&
+        self->kernel->rate == rate && self->channels == channels) {
+        return;
+    }
+
+    banshee_convolver_free_filter (self);
+
+    if (kernel != NULL && (!have_response || !usable || kernel->rate != rate)) {
+        banshee_convolver_kernel_free (kernel);
+        kernel = NULL;
+    }
+
+    if (kernel != NULL) {
+        bins = kernel->block + 1;
+
+        self->kernel = kernel;
+        self->channels = channels;
+        self->block = kernel->block;
+        self->partitions = kernel->partitions;
+        self->fft = gst_fft_f32_new (2 * self->block, FALSE);
+        self->ifft = gst_fft_f32_new (2 * self->block, TRUE);
+        self->spectra = g_new0 (GstFFTF32Complex, channels * self->partitions * bins);
+        self->accumulator = g_new (GstFFTF32Complex, bins);
+        self->input = g_new0 (gfloat, channels * 2 * self->block);
+        self->output = g_new0 (gfloat, channels * self->block);
+        self->scratch = g_new (gfloat, 2 * self->block);
+
+        latency = gst_util_uint64_scale_int (self->block, GST_SECOND, rate);
+
+        GST_DEBUG_OBJECT (self, "Using %u partitions of %u frames", self->partitions, self->block);
+    }
+
+    GST_OBJECT_LOCK (self);
+    latency_changed = self->latency != latency;
+    self->latency = latency;
+    GST_OBJECT_UNLOCK (self);
+
+    if (latency_changed) {
+        gst_element_post_message (GST_ELEMENT (self), gst_message_new_latency (GST_OBJECT (self)));
+    }
+}
+
+static void
+banshee_convolver_reset (BansheeConvolver *self)
+{
+    guint channels = self->channels;
+
+    if (self->partitions == 0) {
+        return;
+    }
+
+    memset (self->spectra, 0, channels * self->partitions * (self->block + 1) * sizeof (GstFFTF32Complex));
+    memset (self->input, 0, channels * 2 * self->block * sizeof (gfloat));
+    memset (self->output, 0, channels * self->block * sizeof (gfloat));
+    self->head = self->position = 0;
+}
+
+// Convolves the block of input just completed: transform it into the delay
+// line, multiply-accumulate the delay line with the filter partitions
+// (newest block with the first partition) and transform back. The second
+// half of the result is the next block of output.
+static void
+banshee_convolver_process_block (BansheeConvolver *self)
+{
+    guint channels = GST_AUDIO_INFO_CHANNELS (&self->info);
+    guint block = self->block, bins = block + 1, partitions = self->partitions;
+    guint c, p, k;
+
+    for (c = 0; c < channels; c++) {
+        gfloat *input = self->input + c * 2 * block;
+        const GstFFTF32Complex *filter = self->kernel->spectra + (c % self->kernel->channels) * partitions * bins;
+        GstFFTF32Complex *spectra = self->spectra + c * partitions * bins;
+        GstFFTF32Complex *accumulator = self->accumulator;
+
+        gst_fft_f32_fft (self->fft, input, spectra + self->head * bins);
+
+        memset (accumulator, 0, bins * sizeof (GstFFTF32Complex));
+        for (p = 0; p < partitions; p++) {
+            const GstFFTF32Complex *x = spectra + ((self->head + partitions - p) % partitions) * bins;
+            const GstFFTF32Complex *h = filter + p * bins;
+
+            for (k = 0; k < bins; k++) {
+                accumulator[k].r += x[k].r * h[k].r - x[k].i * h[k].i;
+                accumulator[k].i += x[k].r * h[k].i + x[k].i * h[k].r;
+            }
+        }
+
+        gst_fft_f32_inverse_fft (self->ifft, accumulator, self->scratch);
+        memcpy (self->output + c * block, self->scratch + block, block * sizeof (gfloat));
+
+        // The new half becomes the old half of the next window
+        memcpy (input, input + block, block * sizeof (gfloat));
+    }
+
+    self->head = (self->head + 1) % partitions;
+}
+
+// Every sample goes into the current input block and is replaced by the
+// output of the previous block, which delays the stream by exactly one
+// partition however the buffers are sized
+static void
+banshee_convolver_filter (BansheeConvolver *self, gfloat *data, guint frames)
+{
+    guint channels = GST_AUDIO_INFO_CHANNELS (&self->info);
+    guint block = self->block;
+    guint n, i, c;
+
+    while (frames > 0) {
+        n = MIN (frames, block - self->position);
+
+        for (c = 0; c < channels; c++) {
+            gfloat *input = self->input + c * 2 * block + block + self->position;
+            const gfloat *output = self->output + c * block + self->position;
+            gfloat *sample = data + c;
+
+            for (i = 0; i < n; i++, sample += channels) {
+                input[i] = *sample;
+                *sample = output[i];
+            }
+        }
+
+        data += n * channels;
+        frames -= n;
+        self->position += n;
+
+        if (self->position == block) {
+            banshee_convolver_process_block (self);
+            self->position = 0;
+        }
+    }
+}
+
+// Runs silence through the filter at the end of the stream to push out the
+// partition of output still held back and the tail of the response. One
+// partition more than the response covers the last input sample wherever
+// it fell in its block.
+static GstFlowReturn
+banshee_convolver_drain (BansheeConvolver *self)
+{
+    GstBaseTransform *base = GST_BASE_TRANSFORM (self);
+    guint rate = GST_AUDIO_INFO_RATE (&self->info);
+    guint frames;
+    GstBuffer *buffer;
+    GstMapInfo map;
+
+    // Nothing to drain, or the caps changed and the kernel was not yet
+    // swapped for one that fits them
+    if (self->partitions == 0 || rate != self->kernel->rate ||
+        self->channels != GST_AUDIO_INFO_CHANNELS (&self->info)) {
+        return GST_FLOW_OK;
+    }
+
+    frames = (self->partitions + 1) * self->block;
+    buffer = gst_buffer_new_allocate (NULL, frames * GST_AUDIO_INFO_BPF (&self->info), NULL);
+    if (!gst_buffer_map (buffer, &map, GST_MAP_WRITE)) {
+        gst_buffer_unref (buffer);
+        return GST_FLOW_ERROR;
+    }
+
+    memset (map.data, 0, map.size);
+    banshee_convolver_filter (self, (gfloat *)map.data, frames);
+    gst_buffer_unmap (buffer, &map);
+
+    if (GST_CLOCK_TIME_IS_VALID (self->next_timestamp)) {
+        GST_BUFFER_PTS (buffer) = self->next_timestamp;
+        GST_BUFFER_DURATION (buffer) = gst_util_uint64_scale_int (frames, GST_SECOND, rate);
+    }
+
+    GST_DEBUG_OBJECT (self, "Draining %u frames", frames);
+    banshee_convolver_reset (self);
+    self->next_timestamp = GST_CLOCK_TIME_NONE;
+
+    return gst_pad_push (GST_BASE_TRANSFORM_SRC_PAD (base), buffer);
+}
+
+// ---------------------------------------------------------------------------
+// GstBaseTransform Implementation
+// ---------------------------------------------------------------------------
+
+static GstCaps *
+banshee_convolver_transform_caps (GstBaseTransform *base, GstPadDirection direction, GstCaps *caps, GstCaps *filter)
+{
+    BansheeConvolver *self = BANSHEE_CONVOLVER (base);
+    GstCaps *result, *float_caps, *narrowed;
+    gboolean convolving;
+
+    result = GST_BASE_TRANSFORM_CLASS (banshee_convolver_parent_class)->transform_caps (base, direction, caps, filter);
+
+    GST_OBJECT_LOCK (self);
+    convolving = self->response != NULL;
+    GST_OBJECT_UNLOCK (self);
+
+    if (!convolving) {
+        return result;
+    }
+
+    float_caps = gst_caps_from_string (BANSHEE_CONVOLVER_FLOAT_CAPS);
+    narrowed = gst_caps_intersect_full (result, float_caps, GST_CAPS_INTERSECT_FIRST);
+    gst_caps_unref (float_caps);
+    gst_caps_unref (result);
+    return narrowed;
+}
+
+static gboolean
+banshee_convolver_set_caps (GstBaseTransform *base, GstCaps *incaps, GstCaps *outcaps)
+{
+    BansheeConvolver *self = BANSHEE_CONVOLVER (base);
+    GstAudioInfo info;
+
+    if (!gst_audio_info_from_caps (&info, incaps)) {
+        GST_WARNING_OBJECT (self, "Could not parse caps %" GST_PTR_FORMAT, incaps);
+        return FALSE;
+    }
+
+    GST_OBJECT_LOCK (self);
+    self->info = info;
+    banshee_convolver_request_kernel (self);
+    GST_OBJECT_UNLOCK (self);
+
+    return TRUE;
+}
+
+static gboolean
+banshee_convolver_stop (GstBaseTransform *base)
+{
+    BansheeConvolver *self = BANSHEE_CONVOLVER (base);
+
+    banshee_convolver_free_filter (self);
+
+    GST_OBJECT_LOCK (self);
+    gst_audio_info_init (&self->info);
+    banshee_convolver_request_kernel (self);
+    GST_OBJECT_UNLOCK (self);
+
+    self->next_timestamp = GST_CLOCK_TIME_NONE;
+    return TRUE;
+}
+
+static gboolean
+banshee_convolver_sink_event (GstBaseTransform *base, GstEvent *event)
+{
+    BansheeConvolver *self = BANSHEE_CONVOLVER (base);
+
+    // Gapless track changes keep the tail of the previous track, but
+    // nothing before a flush may be heard after it
+    switch (GST_EVENT_TYPE (event)) {
+        case GST_EVENT_FLUSH_STOP:
+            banshee_convolver_reset (self);
+            self->next_timestamp = GST_CLOCK_TIME_NONE;
+            break;
+        case GST_EVENT_EOS:
+            banshee_convolver_drain (self);
+            break;
+        default:
+            break;
+    }
+
+    return GST_BASE_TRANSFORM_CLASS (banshee_convolver_parent_class)->sink_event (base, event);
+}
+
+static gboolean
+banshee_convolver_query (GstBaseTransform *base, GstPadDirection direction, GstQuery *query)
+{
+    BansheeConvolver *self = BANSHEE_CONVOLVER (base);
+    gboolean result;
+
+    result = GST_BASE_TRANSFORM_CLASS (banshee_convolver_parent_class)->query (base, direction, query);
+
+    if (result && direction == GST_PAD_SRC && GST_QUERY_TYPE (query) == GST_QUERY_LATENCY) {
+        GstClockTime min, max, latency;
+        gboolean live;
+
+        GST_OBJECT_LOCK (self);
+        latency = self->latency;
+        GST_OBJECT_UNLOCK (self);
+
+        gst_query_parse_latency (query, &live, &min, &max);
+        min += latency;
+        if (GST_CLOCK_TIME_IS_VALID (max)) {
+            max += latency;
+        }
+        gst_query_set_latency (query, live, min, max);
+    }
+
+    return result;
+}
+
+static void
+banshee_convolver_before_transform (GstBaseTransform *base, GstBuffer *buffer)
+{
+    BansheeConvolver *self = BANSHEE_CONVOLVER (base);
+    gboolean changed;
+
+    GST_OBJECT_LOCK (self);
+    changed = self->response_changed;
+    GST_OBJECT_UNLOCK (self);
+
+    if (changed) {
+        banshee_convolver_configure (self);
+    }
+
+    gst_base_transform_set_passthrough (base, self->partitions == 0);
+}
+
+static GstFlowReturn
+banshee_convolver_transform_ip (GstBaseTransform *base, GstBuffer *buffer)
+{
+    BansheeConvolver *self = BANSHEE_CONVOLVER (base);
+    GstMapInfo map;
+
+    if (self->partitions == 0) {
+        return GST_FLOW_OK;
+    }
+
+    if (!gst_buffer_map (buffer, &map, GST_MAP_READWRITE)) {
+        GST_ELEMENT_ERROR (self, STREAM, FAILED, (NULL), ("Could not map buffer"));
+        return GST_FLOW_ERROR;
+    }
+
+    banshee_convolver_filter (self, (gfloat *)map.data, map.size / GST_AUDIO_INFO_BPF (&self->info));
+    gst_buffer_unmap (buffer, &map);
+
+    if (GST_BUFFER_PTS_IS_VALID (buffer) && GST_BUFFER_DURATION_IS_VALID (buffer)) {
+        self->next_timestamp = GST_BUFFER_PTS (buffer) + GST_BUFFER_DURATION (buffer);
+    }
+
+    return GST_FLOW_OK;
+}
+
+// ---------------------------------------------------------------------------
+// GObject Implementation
+// ---------------------------------------------------------------------------
+
+static void
+banshee_convolver_set_property (GObject *object, guint prop_id, const GValue *value, GParamSpec *pspec)
+{
+    BansheeConvolver *self = BANSHEE_CONVOLVER (object);
+
+    switch (prop_id) {
+        case PROP_LOCATION: {
+            GError *error = NULL;
+            if (!banshee_convolver_set_location (self, g_value_get_string (value), &error)) {
+                GST_WARNING_OBJECT (self, "Could not load impulse response: %s", error->message);
+                g_error_free (error);
+            }
+            break;
+        }
+        case PROP_PARTITION_SIZE: {
+            // Power of two lengths keep the transforms fast
+            guint size = 1 << g_bit_storage (g_value_get_uint (value) - 1);
+
+            GST_OBJECT_LOCK (self);
+            self->partition_size = size;
+            banshee_convolver_request_kernel (self);
+            GST_OBJECT_UNLOCK (self);
+            break;
+        }
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+            break;
+    }
+}
+
+static void
+banshee_convolver_get_property (GObject *object, guint prop_id, GValue *value, GParamSpec *pspec)
+{
+    BansheeConvolver *self = BANSHEE_CONVOLVER (object);
+
+    GST_OBJECT_LOCK (self);
+
+    switch (prop_id) {
+        case PROP_LOCATION:
+            g_value_set_string (value, self->location);
+            break;
+        case PROP_PARTITION_SIZE:
+            g_value_set_uint (value, self->partition_size);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+            break;
+    }
+
+    GST_OBJECT_UNLOCK (self);
+}
+
+static void
+banshee_convolver_finalize (GObject *object)
+{
+    BansheeConvolver *self = BANSHEE_CONVOLVER (object);
+
+    banshee_convolver_free_filter (self);
+    banshee_convolver_kernel_free (self->prepared);
+    banshee_convolver_response_free (self->response);
+    g_free (self->location);
+
+    G_OBJECT_CLASS (banshee_convolver_parent_class)->finalize (object);
+}
+
+static void
+banshee_convolver_class_init (BansheeConvolverClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS (klass);
+    GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+    GstBaseTransformClass *transform_class = GST_BASE_TRANSFORM_CLASS (klass);
+
+    object_class->set_property = banshee_convolver_set_property;
+    object_class->get_property = banshee_convolver_get_property;
+    object_class->finalize = banshee_convolver_finalize;
+
+    g_object_class_install_property (object_class, PROP_LOCATION,
+        g_param_spec_string ("location", "Location", "WAV file with the impulse response",
+            NULL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property (object_class, PROP_PARTITION_SIZE,
+        g_param_spec_uint ("partition-size", "Partition size", "Frames per partition, which is also the latency",
+            BANSHEE_CONVOLVER_MIN_PARTITION_SIZE, BANSHEE_CONVOLVER_MAX_PARTITION_SIZE,
+            BANSHEE_CONVOLVER_DEFAULT_PARTITION_SIZE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    gst_element_class_add_pad_template (element_class,
+        gst_static_pad_template_get (&banshee_convolver_sink_template));
+    gst_element_class_add_pad_template (element_class,
+        gst_static_pad_template_get (&banshee_convolver_src_template));
+
+    gst_element_class_set_static_metadata (element_class, "Banshee convolver", "Filter/Effect/Audio",
+        "Partitioned FFT convolution with an impulse response", "Banshee Project");
+
+    transform_class->transform_caps = GST_DEBUG_FUNCPTR (banshee_convolver_transform_caps);
+    transform_class->set_caps = GST_DEBUG_FUNCPTR (banshee_convolver_set_caps);
+    transform_class->stop = GST_DEBUG_FUNCPTR (banshee_convolver_stop);
+    transform_class->sink_event = GST_DEBUG_FUNCPTR (banshee_convolver_sink_event);
+    transform_class->query = GST_DEBUG_FUNCPTR (banshee_convolver_query);
+    transform_class->before_transform = GST_DEBUG_FUNCPTR (banshee_convolver_before_transform);
+    transform_class->transform_ip = GST_DEBUG_FUNCPTR (banshee_convolver_transform_ip);
+    transform_class->transform_ip_on_passthrough = FALSE;
+}
+
+static void
+banshee_convolver_init (BansheeConvolver *self)
+{
+    gst_base_transform_set_in_place (GST_BASE_TRANSFORM (self), TRUE);
+
+    // Nothing to convolve with until a response is loaded
+    gst_base_transform_set_passthrough (GST_BASE_TRANSFORM (self), TRUE);
+
+    gst_audio_info_init (&self->info);
+    self->partition_size = BANSHEE_CONVOLVER_DEFAULT_PARTITION_SIZE;
+    self->next_timestamp = GST_CLOCK_TIME_NONE;
+}
+
+// ---------------------------------------------------------------------------
+// Public Functions
+// ---------------------------------------------------------------------------
+
+// Reads an impulse response from a RIFF WAVE file with 16, 24 or 32 bit
+// integer or 32 bit float samples
+BansheeConvolverResponse *
+banshee_convolver_response_load (const gchar *path, GError **error)
+{
+    BansheeConvolverResponse *response;
+    const guchar *data, *format_chunk = NULL, *sample_chunk = NULL;
+    guint32 format_size = 0, sample_size = 0;
+    guint format, channels, rate, block_align, bits, i;
+    gsize length, offset;
+    gchar *contents;
+
+    g_return_val_if_fail (path != NULL, NULL);
+
+    if (!g_file_get_contents (path, &contents, &length, error)) {
+        return NULL;
+    }
+
+    data = (const guchar *)contents;
+    if (length < 12 || memcmp (data, "RIFF", 4) != 0 || memcmp (data + 8, "WAVE", 4) != 0) {
+        g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "%s is not a WAV file", path);
+        g_free (contents);
+        return NULL;
+    }
+
+    for (offset = 12; offset + 8 <= length; ) {
+        guint32 size = banshee_convolver_read_le32 (data + offset + 4);
+
+        // Tolerate a truncated last chunk
+        size = MIN (size, length - offset - 8);
+
+        if (memcmp (data + offset, "fmt ", 4) == 0) {
+            format_chunk = data + offset + 8;
+            format_size = size;
+        } else if (memcmp (data + offset, "data", 4) == 0) {
+            sample_chunk = data + offset + 8;
+            sample_size = size;
+        }
+
+        offset += 8 + size + (size & 1);
+    }
+
+    if (format_chunk == NULL || format_size < 16 || sample_chunk == NULL) {
+        g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "%s has no format or data chunk", path);
+        g_free (contents);
+        return NULL;
+    }
+
+    format = banshee_convolver_read_le16 (format_chunk);
+    channels = banshee_convolver_read_le16 (format_chunk + 2);
+    rate = banshee_convolver_read_le32 (format_chunk + 4);
+    block_align = banshee_convolver_read_le16 (format_chunk + 12);
+    bits = banshee_convolver_read_le16 (format_chunk + 14);
+
+    if (format == BANSHEE_CONVOLVER_WAVE_FORMAT_EXTENSIBLE && format_size >= 26) {
+        format = banshee_convolver_read_le16 (format_chunk + 24);
+    }
+
+    if (channels == 0 || rate == 0 || block_align != channels * (bits / 8) ||
+        !((format == BANSHEE_CONVOLVER_WAVE_FORMAT_PCM && (bits == 16 || bits == 24 || bits == 32)) ||
+          (format == BANSHEE_CONVOLVER_WAVE_FORMAT_FLOAT && bits == 32))) {
+        g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "%s has an unsupported sample format", path);
+        g_free (contents);
+        return NULL;
+    }
+
+    if (sample_size / block_align == 0) {
+        g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "%s contains no samples", path);
+        g_free (contents);
+        return NULL;
+    }
+
+    response = g_new0 (BansheeConvolverResponse, 1);
+    response->channels = channels;
+    response->rate = rate;
+    response->frames = sample_size / block_align;
+    response->samples = g_new (gfloat, response->frames * channels);
+
+    for (i = 0; i < response->frames * channels; i++) {
+        response->samples[i] = banshee_convolver_read_sample (sample_chunk + i * (bits / 8), format, bits);
+    }
+
+    g_free (contents);
+    return response;
+}
+
+void
+banshee_convolver_response_free (BansheeConvolverResponse *response)
+{
+    if (response != NULL) {
+        g_free (response->samples);
+        g_free (response);
+    }
+}
+
+// Loads the response and has it prepared for the stream on a worker; the
+// streaming thread switches to it before the first buffer after that is
+// done. NULL or an empty path removes the response.
+// Loading the first response or removing the last one renegotiates, so the
+// stream is converted to float only while there is something to convolve.
+gboolean
+banshee_convolver_set_location (BansheeConvolver *convolver, const gchar *path, GError **error)
+{
+    BansheeConvolverResponse *response = NULL, *old;
+    gboolean renegotiate;
+
+    g_return_val_if_fail (BANSHEE_IS_CONVOLVER (convolver), FALSE);
+
+    if (path != NULL && path[0] != '\0') {
+        response = banshee_convolver_response_load (path, error);
+        if (response == NULL) {
+            return FALSE;
+        }
+    }
+
+    GST_OBJECT_LOCK (convolver);
+    old = convolver->response;
+    renegotiate = (old == NULL) != (response == NULL);
+    convolver->response = response;
+    banshee_convolver_request_kernel (convolver);
+    g_free (convolver->location);
+    convolver->location = response != NULL ? g_strdup (path) : NULL;
+    GST_OBJECT_UNLOCK (convolver);
+
+    banshee_convolver_response_free (old);
+
+    if (renegotiate) {
+        gst_pad_push_event (GST_BASE_TRANSFORM_SINK_PAD (convolver), gst_event_new_reconfigure ());
+    }
+
+    return TRUE;
+}
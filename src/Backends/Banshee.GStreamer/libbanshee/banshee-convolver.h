@@ -0,0 +1,108 @@
+//
+// banshee-convolver.h
+//
+// Copyright (C) 2026 Banshee Project Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#ifndef _BANSHEE_CONVOLVER_H
+#define _BANSHEE_CONVOLVER_H
+
+#include <gst/gst.h>
+#include <gst/base/gstbasetransform.h>
+#include <gst/audio/audio.h>
+#include <gst/fft/gstfftf32.h>
+
+G_BEGIN_DECLS
+
+#define BANSHEE_TYPE_CONVOLVER            (banshee_convolver_get_type ())
+#define BANSHEE_CONVOLVER(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), BANSHEE_TYPE_CONVOLVER, BansheeConvolver))
+#define BANSHEE_IS_CONVOLVER(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), BANSHEE_TYPE_CONVOLVER))
+
+typedef struct _BansheeConvolver       BansheeConvolver;
+typedef struct _BansheeConvolverClass  BansheeConvolverClass;
+typedef struct _BansheeConvolverKernel BansheeConvolverKernel;
+
+// Impulse response as loaded from a WAV file, interleaved float samples
+typedef struct {
+    gfloat *samples;
+    guint channels;
+    guint rate;
+    guint frames;
+} BansheeConvolverResponse;
+
+// FIR stage for room correction. The impulse response is split into
+// partitions of partition-size frames and convolved in the frequency
+// domain (uniformly partitioned overlap-save), so the latency is one
+// partition regardless of the length of the response. A mono response is
+// applied to every channel, otherwise channel n uses response channel n.
+// Without a response, or on integer samples, the element is a passthrough.
+// At the end of the stream the output still held back and the tail of the
+// response are pushed before the EOS. Resampling and transforming the
+// response into a kernel happens on a worker thread.
+struct _BansheeConvolver {
+    GstBaseTransform parent;
+
+    GstAudioInfo info;
+
+    // Protected by the object lock
+    gchar *location;
+    guint partition_size;
+    BansheeConvolverResponse *response;
+    BansheeConvolverKernel *prepared;
+    guint kernel_serial;
+    gboolean response_changed;
+    GstClockTime latency;
+
+    // Streaming thread only. Spectra are block + 1 bins long; the kernel
+    // holds the transformed partitions of each response channel and the
+    // spectra the delay line of transformed input blocks of each channel.
+    BansheeConvolverKernel *kernel;
+    guint channels;
+    guint block;
+    guint partitions;
+    GstFFTF32 *fft;
+    GstFFTF32 *ifft;
+    GstFFTF32Complex *spectra;
+    GstFFTF32Complex *accumulator;
+    gfloat *input;
+    gfloat *output;
+    gfloat *scratch;
+    guint head;
+    guint position;
+    GstClockTime next_timestamp;
+};
+
+struct _BansheeConvolverClass {
+    GstBaseTransformClass parent_class;
+};
+
+GType banshee_convolver_get_type (void);
+
+BansheeConvolverResponse * banshee_convolver_response_load (const gchar *path, GError **error);
+void banshee_convolver_response_free (BansheeConvolverResponse *response);
+
+gboolean banshee_convolver_set_location (BansheeConvolver *convolver, const gchar *path, GError **error);
+
+G_END_DECLS
+
+#endif /* _BANSHEE_CONVOLVER_H */
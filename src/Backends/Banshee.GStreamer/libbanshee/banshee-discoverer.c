@@ -0,0 +1,351 @@
+//
+// banshee-discoverer.c
+//
+// Copyright (C) 2026 Banshee Project Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <math.h>
+#include <gst/pbutils/pbutils.h>
+
+#include "banshee-gst.h"
+#include "banshee-batch-pool.h"
+#include "banshee-discoverer.h"
+
+#define BDI_DEFAULT_TIMEOUT     10
+#define BDI_DEFAULT_BATCH_SIZE 256
+
+struct BansheeDiscoverer {
+    GstClockTime timeout;
+
+    // Each job takes a GstDiscoverer from here for its URI and puts it
+    // back after, so there are never more of them than workers
+    BansheeBatchPool *pool;
+    GAsyncQueue *discoverers;
+
+    BansheeDiscovererRecordsCallback records_cb;
+    BansheeDiscovererFinishedCallback finished_cb;
+};
+
+// ---------------------------------------------------------------------------
+// Private Functions
+// ---------------------------------------------------------------------------
+
+static void
+bdi_record_clear (BansheeDiscovererRecord *record)
+{
+    g_free ((gchar *)record->uri);
+    g_free ((gchar *)record->mime_type);
+    g_free ((gchar *)record->caps);
+    g_free ((gchar *)record->title);
+    g_free ((gchar *)record->artist);
+    g_free ((gchar *)record->album);
+    g_free ((gchar *)record->album_artist);
+    g_free ((gchar *)record->genre);
+    g_free ((gchar *)record->composer);
+    g_free ((gchar *)record->comment);
+}
+
+static const gchar *
+bdi_tag_string (const GstTagList *tags, const gchar *tag)
+{
+    gchar *value = NULL;
+
+    if (!gst_tag_list_get_string (tags, tag, &value) || value == NULL) {
+        return NULL;
+    }
+
+    if (value[0] == '\0') {
+        g_free (value);
+        return NULL;
+    }
+
+    return value;
+}
+
+static gint
+bdi_tag_uint (const GstTagList *tags, const gchar *tag)
+{
+    guint value = 0;
+    gst_tag_list_get_uint (tags, tag, &value);
+    return (gint)value;
+}
+
+static void
+bdi_record_fill_tags (BansheeDiscovererRecord *record, const GstTagList *tags)
+{
+    GstDateTime *date_time = NULL;
+    GDate *date = NULL;
+    gdouble bpm;
+
+    record->title = bdi_tag_string (tags, GST_TAG_TITLE);
+    record->artist = bdi_tag_string (tags, GST_TAG_ARTIST);
+    record->album = bdi_tag_string (tags, GST_TAG_ALBUM);
+    record->album_artist = bdi_tag_string (tags, GST_TAG_ALBUM_ARTIST);
+    record->genre = bdi_tag_string (tags, GST_TAG_GENRE);
+    record->composer = bdi_tag_string (tags, GST_TAG_COMPOSER);
+    record->comment = bdi_tag_string (tags, GST_TAG_COMMENT);
+
+    record->track_number = bdi_tag_uint (tags, GST_TAG_TRACK_NUMBER);
+    record->track_count = bdi_tag_uint (tags, GST_TAG_TRACK_COUNT);
+    record->disc_number = bdi_tag_uint (tags, GST_TAG_ALBUM_VOLUME_NUMBER);
+    record->disc_count = bdi_tag_uint (tags, GST_TAG_ALBUM_VOLUME_COUNT);
+
+    if (gst_tag_list_get_date_time (tags, GST_TAG_DATE_TIME, &date_time) && date_time != NULL) {
+        if (gst_date_time_has_year (date_time)) {
+            record->year = gst_date_time_get_year (date_time);
+        }
+        gst_date_time_unref (date_time);
+    } else if (gst_tag_list_get_date (tags, GST_TAG_DATE, &date) && date != NULL) {
+        if (g_date_valid (date)) {
+            record->year = g_date_get_year (date);
+        }
+        g_date_free (date);
+    }
+
+    if (gst_tag_list_get_double (tags, GST_TAG_BEATS_PER_MINUTE, &bpm)) {
+        record->bpm = (gint)floor (bpm + 0.5);
+    }
+
+    if (record->bitrate == 0) {
+        guint bitrate = bdi_tag_uint (tags, GST_TAG_BITRATE);
+        record->bitrate = bitrate != 0 ? bitrate : (guint)bdi_tag_uint (tags, GST_TAG_NOMINAL_BITRATE);
+    }
+}
+
+static void
+bdi_record_fill (BansheeDiscovererRecord *record, GstDiscovererInfo *info)
+{
+    GstDiscovererStreamInfo *stream;
+    const GstTagList *tags;
+    GList *streams;
+
+    record->result = gst_discoverer_info_get_result (info);
+    record->duration = gst_discoverer_info_get_duration (info);
+
+    stream = gst_discoverer_info_get_stream_info (info);
+    if (stream != NULL) {
+        GstCaps *caps = gst_discoverer_stream_info_get_caps (stream);
+
+        if (caps != NULL) {
+            if (gst_caps_get_size (caps) > 0) {
+                record->mime_type = g_strdup (gst_structure_get_name (gst_caps_get_structure (caps, 0)));
+            }
+            record->caps = gst_caps_to_string (caps);
+            gst_caps_unref (caps);
+        }
+
+        gst_discoverer_stream_info_unref (stream);
+    }
+
+    streams = gst_discoverer_info_get_audio_streams (info);
+    if (streams != NULL) {
+        GstDiscovererAudioInfo *audio = (GstDiscovererAudioInfo *)streams->data;
+
+        record->has_audio = TRUE;
+        record->bitrate = gst_discoverer_audio_info_get_bitrate (audio);
+        if (record->bitrate == 0) {
+            record->bitrate = gst_discoverer_audio_info_get_max_bitrate (audio);
+        }
+        record->sample_rate = gst_discoverer_audio_info_get_sample_rate (audio);
+        record->channels = gst_discoverer_audio_info_get_channels (audio);
+
+        gst_discoverer_stream_info_list_free (streams);
+    }
+
+    streams = gst_discoverer_info_get_video_streams (info);
+    if (streams != NULL) {
+        record->has_video = TRUE;
+        gst_discoverer_stream_info_list_free (streams);
+    }
+
+    tags = gst_discoverer_info_get_tags (info);
+    if (tags != NULL) {
+        bdi_record_fill_tags (record, tags);
+    }
+}
+
+// Discovers the URI of a job on a worker thread
+static void
+bdi_run (gpointer job, gpointer data, gpointer user_data)
+{
+    BansheeDiscoverer *discoverer = (BansheeDiscoverer *)user_data;
+    BansheeDiscovererRecord *record = (BansheeDiscovererRecord *)data;
+    GstDiscoverer *worker;
+    GstDiscovererInfo *info;
+    GError *error = NULL;
+
+    record->uri = g_strdup ((const gchar *)job);
+    record->result = GST_DISCOVERER_ERROR;
+
+    worker = g_async_queue_try_pop (discoverer->discoverers);
+    if (worker == NULL) {
+        worker = gst_discoverer_new (discoverer->timeout, &error);
+    }
+
+    if (worker != NULL) {
+        info = gst_discoverer_discover_uri (worker, record->uri, &error);
+        if (info != NULL) {
+            bdi_record_fill (record, info);
+            gst_discoverer_info_unref (info);
+        }
+        g_async_queue_push (discoverer->discoverers, worker);
+    }
+
+    if (error != NULL) {
+        banshee_log_debug ("discoverer", "Could not discover %s: %s", record->uri, error->message);
+        g_error_free (error);
+    }
+}
+
+static void
+bdi_records (gconstpointer records, gint count, gpointer user_data)
+{
+    BansheeDiscoverer *discoverer = (BansheeDiscoverer *)user_data;
+
+    if (discoverer->records_cb != NULL) {
+        discoverer->records_cb (discoverer, (const BansheeDiscovererRecord *)records, count);
+    }
+}
+
+static void
+bdi_finished (gpointer user_data)
+{
+    BansheeDiscoverer *discoverer = (BansheeDiscoverer *)user_data;
+
+    if (discoverer->finished_cb != NULL) {
+        discoverer->finished_cb (discoverer);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Internal Functions
+// ---------------------------------------------------------------------------
+
+BansheeDiscoverer *
+bdi_new (gint max_workers, gint timeout_seconds)
+{
+    BansheeDiscoverer *discoverer;
+    GError *error = NULL;
+
+    discoverer = g_new0 (BansheeDiscoverer, 1);
+    discoverer->timeout = (timeout_seconds > 0 ? timeout_seconds : BDI_DEFAULT_TIMEOUT) * GST_SECOND;
+    discoverer->discoverers = g_async_queue_new_full ((GDestroyNotify)g_object_unref);
+
+    discoverer->pool = bbp_new (max_workers, sizeof (BansheeDiscovererRecord), BDI_DEFAULT_BATCH_SIZE,
+        bdi_run, g_free, (BansheeBatchPoolClearFunc)bdi_record_clear,
+        bdi_records, bdi_finished, discoverer, &error);
+    if (discoverer->pool == NULL) {
+        banshee_log_debug ("discoverer", "Could not create worker pool: %s", error->message);
+        g_error_free (error);
+        bdi_destroy (discoverer);
+        return NULL;
+    }
+
+    return discoverer;
+}
+
+void
+bdi_destroy (BansheeDiscoverer *discoverer)
+{
+    GstDiscoverer *worker;
+
+    g_return_if_fail (discoverer != NULL);
+
+    if (discoverer->pool != NULL) {
+        bbp_free (discoverer->pool);
+    }
+
+    while ((worker = g_async_queue_try_pop (discoverer->discoverers)) != NULL) {
+        g_object_unref (worker);
+    }
+    g_async_queue_unref (discoverer->discoverers);
+
+    g_free (discoverer);
+}
+
+// Queues count URIs (or up to a NULL entry if count is negative) for
+// discovery
+gboolean
+bdi_add_uris (BansheeDiscoverer *discoverer, const gchar * const *uris, gint count)
+{
+    gpointer *jobs;
+    gboolean result;
+    gint i;
+
+    g_return_val_if_fail (discoverer != NULL, FALSE);
+    g_return_val_if_fail (uris != NULL, FALSE);
+
+    if (count < 0) {
+        count = g_strv_length ((gchar **)uris);
+    }
+
+    jobs = g_new (gpointer, MAX (count, 1));
+    for (i = 0; i < count; i++) {
+        jobs[i] = g_strdup (uris[i]);
+    }
+
+    result = bbp_push (discoverer->pool, jobs, count);
+    g_free (jobs);
+    return result;
+}
+
+// URIs added so far that are not reported yet are dropped, including
+// those still being discovered; URIs added later are discovered as usual.
+// finished is still called once the workers are done.
+void
+bdi_cancel (BansheeDiscoverer *discoverer)
+{
+    g_return_if_fail (discoverer != NULL);
+    bbp_cancel (discoverer->pool);
+}
+
+gboolean
+bdi_get_is_discovering (BansheeDiscoverer *discoverer)
+{
+    g_return_val_if_fail (discoverer != NULL, FALSE);
+    return bbp_get_is_running (discoverer->pool);
+}
+
+void
+bdi_set_batch_size (BansheeDiscoverer *discoverer, gint batch_size)
+{
+    g_return_if_fail (discoverer != NULL);
+    bbp_set_batch_size (discoverer->pool, batch_size > 0 ? batch_size : BDI_DEFAULT_BATCH_SIZE);
+}
+
+void
+bdi_set_records_callback (BansheeDiscoverer *discoverer, BansheeDiscovererRecordsCallback cb)
+{
+    g_return_if_fail (discoverer != NULL);
+    discoverer->records_cb = cb;
+}
+
+void
+bdi_set_finished_callback (BansheeDiscoverer *discoverer, BansheeDiscovererFinishedCallback cb)
+{
+    g_return_if_fail (discoverer != NULL);
+    discoverer->finished_cb = cb;
+}
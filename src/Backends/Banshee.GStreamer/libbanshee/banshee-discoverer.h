@@ -0,0 +1,85 @@
+//
+// banshee-discoverer.h
+//
+// Copyright (C) 2026 Banshee Project Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef _BANSHEE_DISCOVERER_H
+#define _BANSHEE_DISCOVERER_H
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+typedef struct BansheeDiscoverer BansheeDiscoverer;
+
+// What discovery found out about one URI, flattened so a whole batch can
+// be handed over and read in one go. Strings are NULL when unknown and,
+// like the record, only valid during the records callback. result is a
+// GstDiscovererResult.
+typedef struct {
+    const gchar *uri;
+    gint result;
+    guint64 duration;
+    const gchar *mime_type;
+    const gchar *caps;
+    guint bitrate;
+    gint sample_rate;
+    gint channels;
+    gboolean has_audio;
+    gboolean has_video;
+
+    const gchar *title;
+    const gchar *artist;
+    const gchar *album;
+    const gchar *album_artist;
+    const gchar *genre;
+    const gchar *composer;
+    const gchar *comment;
+    gint track_number;
+    gint track_count;
+    gint disc_number;
+    gint disc_count;
+    gint year;
+    gint bpm;
+} BansheeDiscovererRecord;
+
+typedef void (* BansheeDiscovererRecordsCallback)  (BansheeDiscoverer *discoverer,
+                                                    const BansheeDiscovererRecord *records, gint count);
+typedef void (* BansheeDiscovererFinishedCallback) (BansheeDiscoverer *discoverer);
+
+// Runs GstDiscoverer on up to max_workers URIs at once (0 for one per
+// processor) and reports the results on the main loop in batches of at
+// most batch_size records, in no particular order. finished is called each
+// time every URI added so far has been reported.
+BansheeDiscoverer *bdi_new                   (gint max_workers, gint timeout_seconds);
+void               bdi_destroy               (BansheeDiscoverer *discoverer);
+gboolean           bdi_add_uris              (BansheeDiscoverer *discoverer, const gchar * const *uris, gint count);
+void               bdi_cancel                (BansheeDiscoverer *discoverer);
+gboolean           bdi_get_is_discovering    (BansheeDiscoverer *discoverer);
+void               bdi_set_batch_size        (BansheeDiscoverer *discoverer, gint batch_size);
+void               bdi_set_records_callback  (BansheeDiscoverer *discoverer, BansheeDiscovererRecordsCallback cb);
+void               bdi_set_finished_callback (BansheeDiscoverer *discoverer, BansheeDiscovererFinishedCallback cb);
+
+G_END_DECLS
+
+#endif /* _BANSHEE_DISCOVERER_H */
@@ -0,0 +1,723 @@
+//
+// banshee-equalizer.c
+//
+// Copyright (C) 2026 Banshee Project Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <math.h>
+#include <string.h>
+
+#include "banshee-equalizer.h"
+
+// Same range and centre frequencies as equalizer-10bands, so presets made
+// with either element sound the same
+#define BANSHEE_EQUALIZER_MIN_GAIN -24.0
+#define BANSHEE_EQUALIZER_MAX_GAIN 12.0
+
+// Length of the crossfade from the old to the new response
+#define BANSHEE_EQUALIZER_RAMP_MSEC 20
+
+// Filter state values below this are flushed to zero so decaying tails
+// never turn into denormals
+#define BANSHEE_EQUALIZER_DENORMAL 1e-20f
+
+static const gdouble banshee_equalizer_frequencies[BANSHEE_EQUALIZER_NBANDS] = {
+    29.0, 59.0, 119.0, 237.0, 474.0, 947.0, 1889.0, 3770.0, 7523.0, 15011.0
+};
+
+GST_DEBUG_CATEGORY_STATIC (banshee_equalizer_debug);
+#define GST_CAT_DEFAULT banshee_equalizer_debug
+
+enum {
+    PROP_0,
+    PROP_BAND0
+};
+
+enum {
+    BAND_PROP_0,
+    BAND_PROP_GAIN,
+    BAND_PROP_FREQ
+};
+
+// Filtering needs float; integer streams are only accepted while flat,
+// when the element is bypassed
+#define BANSHEE_EQUALIZER_CAPS \
+    "audio/x-raw, " \
+    "format = (string) { " GST_AUDIO_NE (F32) ", " GST_AUDIO_NE (S16) " }, " \
+    "rate = (int) [ 1, MAX ], " \
+    "channels = (int) [ 1, MAX ], " \
+    "layout = (string) interleaved"
+
+static GstStaticPadTemplate banshee_equalizer_sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK, GST_PAD_ALWAYS, GST_STATIC_CAPS (BANSHEE_EQUALIZER_CAPS));
+
+static GstStaticPadTemplate banshee_equalizer_src_template = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC, GST_PAD_ALWAYS, GST_STATIC_CAPS (BANSHEE_EQUALIZER_CAPS));
+
+#if defined(__GNUC__)
+// One lane per channel, so four channels are filtered in every step
+typedef gfloat BansheeEqualizerVector __attribute__ ((vector_size (16)));
+#define BANSHEE_EQUALIZER_LANES 4
+#else
+#define BANSHEE_EQUALIZER_LANES 1
+#endif
+
+static void banshee_equalizer_child_proxy_init (gpointer g_iface, gpointer iface_data);
+
+G_DEFINE_TYPE (BansheeEqualizerBand, banshee_equalizer_band, GST_TYPE_OBJECT);
+
+G_DEFINE_TYPE_WITH_CODE (BansheeEqualizer, banshee_equalizer, GST_TYPE_BASE_TRANSFORM,
+    G_IMPLEMENT_INTERFACE (GST_TYPE_CHILD_PROXY, banshee_equalizer_child_proxy_init);
+    GST_DEBUG_CATEGORY_INIT (banshee_equalizer_debug, "banshee-equalizer", 0, "Banshee equalizer"));
+
+// ---------------------------------------------------------------------------
+// Private Functions
+// ---------------------------------------------------------------------------
+
+// Computes the biquad of one band from the RBJ audio EQ cookbook: a low
+// shelf for the first band, a high shelf for the last and one octave
+// peaking filters in between. Must be called with the object lock held.
+static void
+banshee_equalizer_compute_coefficients (BansheeEqualizer *self, guint band)
+{
+    BansheeEqualizerCoefficients *c = &self->coefficients[band];
+    gint rate = GST_AUDIO_INFO_RATE (&self->info);
+    gdouble freq = banshee_equalizer_frequencies[band];
+    gdouble A, w0, cosw, sinw, alpha, sqrtA;
+    gdouble b0, b1, b2, a0, a1, a2;
+
+    if (rate <= 0 || freq >= rate / 2.0 || self->gains[band] == 0.0) {
+        c->b0 = 1.0f;
+        c->b1 = c->b2 = c->a1 = c->a2 = 0.0f;
+        return;
+    }
+
+    A = pow (10.0, self->gains[band] / 40.0);
+    w0 = 2.0 * G_PI * freq / rate;
+    cosw = cos (w0);
+    sinw = sin (w0);
+
+    if (band == 0 || band == BANSHEE_EQUALIZER_NBANDS - 1) {
+        gboolean low = band == 0;
+
+        // Shelf slope S = 1
+        alpha = sinw / 2.0 * G_SQRT2;
+        sqrtA = sqrt (A);
+
+        b0 =        A * ((A + 1) + (low ? -1 : 1) * (A - 1) * cosw + 2 * sqrtA * alpha);
+        b1 = (low ? 2 : -2) * A * ((A - 1) + (low ? -1 : 1) * (A + 1) * cosw);
+        b2 =        A * ((A + 1) + (low ? -1 : 1) * (A - 1) * cosw - 2 * sqrtA * alpha);
+        a0 =             (A + 1) + (low ? 1 : -1) * (A - 1) * cosw + 2 * sqrtA * alpha;
+        a1 = (low ? -2 : 2) * ((A - 1) + (low ? 1 : -1) * (A + 1) * cosw);
+        a2 =             (A + 1) + (low ? 1 : -1) * (A - 1) * cosw - 2 * sqrtA * alpha;
+    } else {
+        // One octave bandwidth
+        alpha = sinw * sinh (G_LN2 / 2.0 * w0 / sinw);
+
+        b0 = 1 + alpha * A;
+        b1 = -2 * cosw;
+        b2 = 1 - alpha * A;
+        a0 = 1 + alpha / A;
+        a1 = -2 * cosw;
+        a2 = 1 - alpha / A;
+    }
+
+    c->b0 = (gfloat)(b0 / a0);
+    c->b1 = (gfloat)(b1 / a0);
+    c->b2 = (gfloat)(b2 / a0);
+    c->a1 = (gfloat)(a1 / a0);
+    c->a2 = (gfloat)(a2 / a0);
+}
+
+static inline guint
+banshee_equalizer_band_history_size (BansheeEqualizer *self)
+{
+    guint channels = GST_AUDIO_INFO_CHANNELS (&self->info);
+    return ((channels + BANSHEE_EQUALIZER_LANES - 1) / BANSHEE_EQUALIZER_LANES) * 2 * BANSHEE_EQUALIZER_LANES;
+}
+
+static gboolean
+banshee_equalizer_is_flat (const gdouble *gains)
+{
+    guint band;
+
+    for (band = 0; band < BANSHEE_EQUALIZER_NBANDS; band++) {
+        if (gains[band] != 0.0) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static void
+banshee_equalizer_set_band_gain (BansheeEqualizer *self, guint band, gdouble gain)
+{
+    g_return_if_fail (band < BANSHEE_EQUALIZER_NBANDS);
+
+    GST_OBJECT_LOCK (self);
+    self->gains[band] = gain;
+    banshee_equalizer_compute_coefficients (self, band);
+    self->coefficients_changed = TRUE;
+    GST_OBJECT_UNLOCK (self);
+}
+
+static gdouble
+banshee_equalizer_get_band_gain (BansheeEqualizer *self, guint band)
+{
+    gdouble gain;
+
+    g_return_val_if_fail (band < BANSHEE_EQUALIZER_NBANDS, 0.0);
+
+    GST_OBJECT_LOCK (self);
+    gain = self->gains[band];
+    GST_OBJECT_UNLOCK (self);
+
+    return gain;
+}
+
+static inline void
+banshee_equalizer_flush_denormals (gfloat *state, guint n)
+{
+    guint i;
+
+    for (i = 0; i < n; i++) {
+        if (fabsf (state[i]) < BANSHEE_EQUALIZER_DENORMAL) {
+            state[i] = 0.0f;
+        }
+    }
+}
+
+#if defined(__GNUC__)
+
+// Runs one band over up to four interleaved channels starting at data.
+// Inlined with constant lanes so the loads and stores become plain moves.
+static inline void
+banshee_equalizer_run_band (const BansheeEqualizerCoefficients *c, gfloat *state,
+    gfloat *data, guint frames, guint channels, guint lanes)
+{
+    BansheeEqualizerVector b0 = { c->b0, c->b0, c->b0, c->b0 };
+    BansheeEqualizerVector b1 = { c->b1, c->b1, c->b1, c->b1 };
+    BansheeEqualizerVector b2 = { c->b2, c->b2, c->b2, c->b2 };
+    BansheeEqualizerVector a1 = { c->a1, c->a1, c->a1, c->a1 };
+    BansheeEqualizerVector a2 = { c->a2, c->a2, c->a2, c->a2 };
+    BansheeEqualizerVector x = { 0, 0, 0, 0 }, y, z1, z2;
+    guint i;
+
+    memcpy (&z1, state, sizeof (z1));
+    memcpy (&z2, state + 4, sizeof (z2));
+
+    for (i = 0; i < frames; i++, data += channels) {
+        memcpy (&x, data, lanes * sizeof (gfloat));
+        y = b0 * x + z1;
+        z1 = b1 * x - a1 * y + z2;
+        z2 = b2 * x - a2 * y;
+        memcpy (data, &y, lanes * sizeof (gfloat));
+    }
+
+    memcpy (state, &z1, sizeof (z1));
+    memcpy (state + 4, &z2, sizeof (z2));
+}
+
+#else
+
+static void
+banshee_equalizer_run_band (const BansheeEqualizerCoefficients *c, gfloat *state,
+    gfloat *data, guint frames, guint channels, guint lanes)
+{
+    gfloat z1 = state[0], z2 = state[1], x, y;
+    guint i;
+
+    for (i = 0; i < frames; i++, data += channels) {
+        x = *data;
+        y = c->b0 * x + z1;
+        z1 = c->b1 * x - c->a1 * y + z2;
+        z2 = c->b2 * x - c->a2 * y;
+        *data = y;
+    }
+
+    state[0] = z1;
+    state[1] = z2;
+}
+
+#endif
+
+static void
+banshee_equalizer_process (BansheeEqualizer *self, const BansheeEqualizerCoefficients *coefficients,
+    const gdouble *gains, gfloat *history, gfloat *data, guint frames)
+{
+    guint channels = GST_AUDIO_INFO_CHANNELS (&self->info);
+    guint groups = (channels + BANSHEE_EQUALIZER_LANES - 1) / BANSHEE_EQUALIZER_LANES;
+    guint group, band;
+
+    for (group = 0; group < groups; group++) {
+        guint lanes = MIN (BANSHEE_EQUALIZER_LANES, channels - group * BANSHEE_EQUALIZER_LANES);
+        gfloat *start = data + group * BANSHEE_EQUALIZER_LANES;
+
+        for (band = 0; band < BANSHEE_EQUALIZER_NBANDS; band++) {
+            const BansheeEqualizerCoefficients *c = &coefficients[band];
+            gfloat *state = history + (band * groups + group) * 2 * BANSHEE_EQUALIZER_LANES;
+
+            // A flat band is an identity filter
+            if (gains[band] == 0.0) {
+                continue;
+            }
+
+            switch (lanes) {
+                case 4:  banshee_equalizer_run_band (c, state, start, frames, channels, 4); break;
+                case 2:  banshee_equalizer_run_band (c, state, start, frames, channels, 2); break;
+                case 1:  banshee_equalizer_run_band (c, state, start, frames, channels, 1); break;
+                default: banshee_equalizer_run_band (c, state, start, frames, channels, lanes); break;
+            }
+
+            banshee_equalizer_flush_denormals (state, 2 * BANSHEE_EQUALIZER_LANES);
+        }
+    }
+}
+
+// Picks up coefficients computed by the setters. The swap happens between
+// buffers, so a preset always takes effect as a whole; the previous
+// response keeps running for the length of the ramp and is faded out.
+static void
+banshee_equalizer_swap_response (BansheeEqualizer *self)
+{
+    guint size = banshee_equalizer_band_history_size (self);
+    guint band;
+
+    GST_OBJECT_LOCK (self);
+
+    if (!self->coefficients_changed) {
+        GST_OBJECT_UNLOCK (self);
+        return;
+    }
+
+    memcpy (self->previous, self->active, sizeof (self->active));
+    memcpy (self->previous_gains, self->active_gains, sizeof (self->active_gains));
+    memcpy (self->active, self->coefficients, sizeof (self->active));
+    memcpy (self->active_gains, self->gains, sizeof (self->active_gains));
+    self->coefficients_changed = FALSE;
+
+    GST_OBJECT_UNLOCK (self);
+
+    if (self->history != NULL) {
+        memcpy (self->previous_history, self->history, BANSHEE_EQUALIZER_NBANDS * size * sizeof (gfloat));
+
+        // A band skipped while flat resumes from silence rather than stale state
+        for (band = 0; band < BANSHEE_EQUALIZER_NBANDS; band++) {
+            if (self->previous_gains[band] == 0.0 && self->active_gains[band] != 0.0) {
+                memset (self->history + band * size, 0, size * sizeof (gfloat));
+            }
+        }
+    }
+
+    self->fade = 0.0f;
+    self->ramp_remaining = self->ramp_frames;
+    self->fade_step = self->ramp_frames > 0 ? 1.0f / self->ramp_frames : 1.0f;
+}
+
+// Blends the output of the new response in data with the output of the
+// previous response while the ramp is running
+static void
+banshee_equalizer_crossfade (BansheeEqualizer *self, gfloat *data, const gfloat *previous, guint frames)
+{
+    guint channels = GST_AUDIO_INFO_CHANNELS (&self->info);
+    gfloat fade = self->fade;
+    guint i, c, n;
+
+    n = MIN (frames, self->ramp_remaining);
+    for (i = 0; i < n; i++) {
+        fade += self->fade_step;
+        for (c = 0; c < channels; c++, data++, previous++) {
+            *data = *previous + fade * (*data - *previous);
+        }
+    }
+
+    self->ramp_remaining -= n;
+    self->fade = self->ramp_remaining == 0 ? 1.0f : fade;
+}
+
+// ---------------------------------------------------------------------------
+// GstBaseTransform Implementation
+// ---------------------------------------------------------------------------
+
+static gboolean
+banshee_equalizer_set_caps (GstBaseTransform *base, GstCaps *incaps, GstCaps *outcaps)
+{
+    BansheeEqualizer *self = BANSHEE_EQUALIZER (base);
+    GstAudioInfo info;
+    gboolean was_dry;
+    guint band, size;
+
+    if (!gst_audio_info_from_caps (&info, incaps)) {
+        GST_WARNING_OBJECT (self, "Could not parse caps %" GST_PTR_FORMAT, incaps);
+        return FALSE;
+    }
+
+    // New format: start the current response from scratch. Coming from
+    // integer samples, which were passed through, the output so far was
+    // dry, so the response is faded in from the identity instead.
+    GST_OBJECT_LOCK (self);
+
+    was_dry = GST_AUDIO_INFO_FORMAT (&self->info) != GST_AUDIO_FORMAT_F32;
+    self->info = info;
+    self->ramp_frames = GST_AUDIO_INFO_RATE (&info) * BANSHEE_EQUALIZER_RAMP_MSEC / 1000;
+    for (band = 0; band < BANSHEE_EQUALIZER_NBANDS; band++) {
+        banshee_equalizer_compute_coefficients (self, band);
+    }
+
+    memcpy (self->active, self->coefficients, sizeof (self->active));
+    memcpy (self->active_gains, self->gains, sizeof (self->active_gains));
+    self->coefficients_changed = FALSE;
+
+    GST_OBJECT_UNLOCK (self);
+
+    size = BANSHEE_EQUALIZER_NBANDS * banshee_equalizer_band_history_size (self);
+
+    g_free (self->history);
+    g_free (self->previous_history);
+    self->history = g_new0 (gfloat, size);
+    self->previous_history = g_new0 (gfloat, size);
+    self->ramp_remaining = 0;
+
+    if (was_dry && GST_AUDIO_INFO_FORMAT (&info) == GST_AUDIO_FORMAT_F32 &&
+        !banshee_equalizer_is_flat (self->active_gains)) {
+        // All flat bands make the previous response an identity filter
+        memset (self->previous_gains, 0, sizeof (self->previous_gains));
+        self->fade = 0.0f;
+        self->ramp_remaining = self->ramp_frames;
+        self->fade_step = self->ramp_frames > 0 ? 1.0f / self->ramp_frames : 1.0f;
+    }
+
+    return TRUE;
+}
+
+static gboolean
+banshee_equalizer_stop (GstBaseTransform *base)
+{
+    BansheeEqualizer *self = BANSHEE_EQUALIZER (base);
+
+    GST_OBJECT_LOCK (self);
+    gst_audio_info_init (&self->info);
+    GST_OBJECT_UNLOCK (self);
+
+    g_free (self->history);
+    g_free (self->previous_history);
+    g_free (self->scratch);
+    self->history = NULL;
+    self->previous_history = NULL;
+    self->scratch = NULL;
+    self->scratch_size = 0;
+    self->ramp_remaining = 0;
+
+    return TRUE;
+}
+
+static void
+banshee_equalizer_before_transform (GstBaseTransform *base, GstBuffer *buffer)
+{
+    BansheeEqualizer *self = BANSHEE_EQUALIZER (base);
+
+    banshee_equalizer_swap_response (self);
+
+    // Flat and not fading: hand buffers through untouched. Integer samples
+    // pass through until upstream switches to float.
+    gst_base_transform_set_passthrough (base,
+        GST_AUDIO_INFO_FORMAT (&self->info) != GST_AUDIO_FORMAT_F32 ||
+        (self->ramp_remaining == 0 && banshee_equalizer_is_flat (self->active_gains)));
+}
+
+static GstFlowReturn
+banshee_equalizer_transform_ip (GstBaseTransform *base, GstBuffer *buffer)
+{
+    BansheeEqualizer *self = BANSHEE_EQUALIZER (base);
+    GstMapInfo map;
+    guint frames;
+
+    if (GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_GAP)) {
+        return GST_FLOW_OK;
+    }
+
+    if (self->history == NULL || GST_AUDIO_INFO_BPF (&self->info) == 0) {
+        return GST_FLOW_NOT_NEGOTIATED;
+    }
+
+    if (!gst_buffer_map (buffer, &map, GST_MAP_READWRITE)) {
+        GST_ELEMENT_ERROR (self, STREAM, FAILED, (NULL), ("Could not map buffer"));
+        return GST_FLOW_ERROR;
+    }
+
+    frames = map.size / GST_AUDIO_INFO_BPF (&self->info);
+
+    if (self->ramp_remaining > 0) {
+        if (self->scratch_size < map.size) {
+            self->scratch = g_realloc (self->scratch, map.size);
+            self->scratch_size = map.size;
+        }
+
+        memcpy (self->scratch, map.data, map.size);
+        banshee_equalizer_process (self, self->previous, self->previous_gains,
+            self->previous_history, self->scratch, frames);
+    }
+
+    banshee_equalizer_process (self, self->active, self->active_gains,
+        self->history, (gfloat *)map.data, frames);
+
+    if (self->ramp_remaining > 0) {
+        banshee_equalizer_crossfade (self, (gfloat *)map.data, self->scratch, frames);
+    }
+
+    gst_buffer_unmap (buffer, &map);
+    return GST_FLOW_OK;
+}
+
+// ---------------------------------------------------------------------------
+// GstChildProxy Implementation
+// ---------------------------------------------------------------------------
+
+static GObject *
+banshee_equalizer_child_proxy_get_child_by_index (GstChildProxy *proxy, guint index)
+{
+    BansheeEqualizer *self = BANSHEE_EQUALIZER (proxy);
+
+    g_return_val_if_fail (index < BANSHEE_EQUALIZER_NBANDS, NULL);
+
+    return G_OBJECT (gst_object_ref (self->bands[index]));
+}
+
+static guint
+banshee_equalizer_child_proxy_get_children_count (GstChildProxy *proxy)
+{
+    return BANSHEE_EQUALIZER_NBANDS;
+}
+
+static void
+banshee_equalizer_child_proxy_init (gpointer g_iface, gpointer iface_data)
+{
+    GstChildProxyInterface *iface = g_iface;
+
+    iface->get_child_by_index = banshee_equalizer_child_proxy_get_child_by_index;
+    iface->get_children_count = banshee_equalizer_child_proxy_get_children_count;
+}
+
+// ---------------------------------------------------------------------------
+// BansheeEqualizerBand Implementation
+// ---------------------------------------------------------------------------
+
+static void
+banshee_equalizer_band_set_property (GObject *object, guint prop_id, const GValue *value, GParamSpec *pspec)
+{
+    BansheeEqualizerBand *band = BANSHEE_EQUALIZER_BAND (object);
+
+    switch (prop_id) {
+        case BAND_PROP_GAIN:
+            banshee_equalizer_set_band_gain (band->equalizer, band->index, g_value_get_double (value));
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+            break;
+    }
+}
+
+static void
+banshee_equalizer_band_get_property (GObject *object, guint prop_id, GValue *value, GParamSpec *pspec)
+{
+    BansheeEqualizerBand *band = BANSHEE_EQUALIZER_BAND (object);
+
+    switch (prop_id) {
+        case BAND_PROP_GAIN:
+            g_value_set_double (value, banshee_equalizer_get_band_gain (band->equalizer, band->index));
+            break;
+        case BAND_PROP_FREQ:
+            g_value_set_double (value, banshee_equalizer_frequencies[band->index]);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+            break;
+    }
+}
+
+static void
+banshee_equalizer_band_class_init (BansheeEqualizerBandClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+    object_class->set_property = banshee_equalizer_band_set_property;
+    object_class->get_property = banshee_equalizer_band_get_property;
+
+    g_object_class_install_property (object_class, BAND_PROP_GAIN,
+        g_param_spec_double ("gain", "Gain", "Gain of the band [dB]",
+            BANSHEE_EQUALIZER_MIN_GAIN, BANSHEE_EQUALIZER_MAX_GAIN, 0.0,
+            G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property (object_class, BAND_PROP_FREQ,
+        g_param_spec_double ("freq", "Frequency", "Centre frequency of the band [Hz]",
+            0.0, 100000.0, 0.0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+}
+
+static void
+banshee_equalizer_band_init (BansheeEqualizerBand *band)
+{
+}
+
+// ---------------------------------------------------------------------------
+// GObject Implementation
+// ---------------------------------------------------------------------------
+
+static void
+banshee_equalizer_set_property (GObject *object, guint prop_id, const GValue *value, GParamSpec *pspec)
+{
+    BansheeEqualizer *self = BANSHEE_EQUALIZER (object);
+
+    if (prop_id >= PROP_BAND0 && prop_id < PROP_BAND0 + BANSHEE_EQUALIZER_NBANDS) {
+        banshee_equalizer_set_band_gain (self, prop_id - PROP_BAND0, g_value_get_double (value));
+    } else {
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+banshee_equalizer_get_property (GObject *object, guint prop_id, GValue *value, GParamSpec *pspec)
+{
+    BansheeEqualizer *self = BANSHEE_EQUALIZER (object);
+
+    if (prop_id >= PROP_BAND0 && prop_id < PROP_BAND0 + BANSHEE_EQUALIZER_NBANDS) {
+        g_value_set_double (value, banshee_equalizer_get_band_gain (self, prop_id - PROP_BAND0));
+    } else {
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+banshee_equalizer_finalize (GObject *object)
+{
+    BansheeEqualizer *self = BANSHEE_EQUALIZER (object);
+    guint band;
+
+    for (band = 0; band < BANSHEE_EQUALIZER_NBANDS; band++) {
+        gst_object_unparent (GST_OBJECT (self->bands[band]));
+    }
+
+    g_free (self->history);
+    g_free (self->previous_history);
+    g_free (self->scratch);
+
+    G_OBJECT_CLASS (banshee_equalizer_parent_class)->finalize (object);
+}
+
+static void
+banshee_equalizer_class_init (BansheeEqualizerClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS (klass);
+    GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+    GstBaseTransformClass *transform_class = GST_BASE_TRANSFORM_CLASS (klass);
+    guint band;
+
+    object_class->set_property = banshee_equalizer_set_property;
+    object_class->get_property = banshee_equalizer_get_property;
+    object_class->finalize = banshee_equalizer_finalize;
+
+    for (band = 0; band < BANSHEE_EQUALIZER_NBANDS; band++) {
+        gchar *name = g_strdup_printf ("band%u", band);
+        gchar *blurb = g_strdup_printf ("Gain of the %.0f Hz band [dB]", banshee_equalizer_frequencies[band]);
+
+        g_object_class_install_property (object_class, PROP_BAND0 + band,
+            g_param_spec_double (name, name, blurb,
+                BANSHEE_EQUALIZER_MIN_GAIN, BANSHEE_EQUALIZER_MAX_GAIN, 0.0,
+                G_PARAM_READWRITE));
+
+        g_free (name);
+        g_free (blurb);
+    }
+
+    gst_element_class_add_pad_template (element_class,
+        gst_static_pad_template_get (&banshee_equalizer_sink_template));
+    gst_element_class_add_pad_template (element_class,
+        gst_static_pad_template_get (&banshee_equalizer_src_template));
+
+    gst_element_class_set_static_metadata (element_class, "Banshee equalizer", "Filter/Effect/Audio",
+        "Ten band biquad equalizer on float samples", "Banshee Project");
+
+    transform_class->set_caps = GST_DEBUG_FUNCPTR (banshee_equalizer_set_caps);
+    transform_class->stop = GST_DEBUG_FUNCPTR (banshee_equalizer_stop);
+    transform_class->before_transform = GST_DEBUG_FUNCPTR (banshee_equalizer_before_transform);
+    transform_class->transform_ip = GST_DEBUG_FUNCPTR (banshee_equalizer_transform_ip);
+    transform_class->transform_ip_on_passthrough = FALSE;
+}
+
+static void
+banshee_equalizer_init (BansheeEqualizer *self)
+{
+    guint band;
+
+    gst_base_transform_set_in_place (GST_BASE_TRANSFORM (self), TRUE);
+    gst_base_transform_set_gap_aware (GST_BASE_TRANSFORM (self), TRUE);
+
+    // All bands start flat, so start out bypassed
+    gst_base_transform_set_passthrough (GST_BASE_TRANSFORM (self), TRUE);
+
+    gst_audio_info_init (&self->info);
+
+    for (band = 0; band < BANSHEE_EQUALIZER_NBANDS; band++) {
+        gchar *name = g_strdup_printf ("band%u", band);
+
+        self->bands[band] = g_object_new (BANSHEE_TYPE_EQUALIZER_BAND, NULL);
+        self->bands[band]->equalizer = self;
+        self->bands[band]->index = band;
+
+        gst_object_set_name (GST_OBJECT (self->bands[band]), name);
+        gst_object_set_parent (GST_OBJECT (self->bands[band]), GST_OBJECT (self));
+
+        self->gains[band] = 0.0;
+        banshee_equalizer_compute_coefficients (self, band);
+
+        g_free (name);
+    }
+
+    memcpy (self->active, self->coefficients, sizeof (self->active));
+}
+
+// ---------------------------------------------------------------------------
+// Public Functions
+// ---------------------------------------------------------------------------
+
+void
+banshee_equalizer_set_gains (BansheeEqualizer *equalizer, const gdouble *gains, guint n)
+{
+    guint band;
+
+    g_return_if_fail (BANSHEE_IS_EQUALIZER (equalizer));
+    g_return_if_fail (gains != NULL || n == 0);
+
+    GST_OBJECT_LOCK (equalizer);
+
+    for (band = 0; band < MIN (n, BANSHEE_EQUALIZER_NBANDS); band++) {
+        equalizer->gains[band] = CLAMP (gains[band], BANSHEE_EQUALIZER_MIN_GAIN, BANSHEE_EQUALIZER_MAX_GAIN);
+        banshee_equalizer_compute_coefficients (equalizer, band);
+    }
+    equalizer->coefficients_changed = TRUE;
+
+    GST_OBJECT_UNLOCK (equalizer);
+}
@@ -0,0 +1,111 @@
+//
+// banshee-equalizer.h
+//
+// Copyright (C) 2026 Banshee Project Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef _BANSHEE_EQUALIZER_H
+#define _BANSHEE_EQUALIZER_H
+
+#include <gst/gst.h>
+#include <gst/base/gstbasetransform.h>
+#include <gst/audio/audio.h>
+
+G_BEGIN_DECLS
+
+#define BANSHEE_EQUALIZER_NBANDS 10
+
+#define BANSHEE_TYPE_EQUALIZER            (banshee_equalizer_get_type ())
+#define BANSHEE_EQUALIZER(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), BANSHEE_TYPE_EQUALIZER, BansheeEqualizer))
+#define BANSHEE_IS_EQUALIZER(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), BANSHEE_TYPE_EQUALIZER))
+
+#define BANSHEE_TYPE_EQUALIZER_BAND       (banshee_equalizer_band_get_type ())
+#define BANSHEE_EQUALIZER_BAND(obj)       (G_TYPE_CHECK_INSTANCE_CAST ((obj), BANSHEE_TYPE_EQUALIZER_BAND, BansheeEqualizerBand))
+#define BANSHEE_IS_EQUALIZER_BAND(obj)    (G_TYPE_CHECK_INSTANCE_TYPE ((obj), BANSHEE_TYPE_EQUALIZER_BAND))
+
+typedef struct _BansheeEqualizer          BansheeEqualizer;
+typedef struct _BansheeEqualizerClass     BansheeEqualizerClass;
+typedef struct _BansheeEqualizerBand      BansheeEqualizerBand;
+typedef struct _BansheeEqualizerBandClass BansheeEqualizerBandClass;
+
+typedef struct {
+    gfloat b0, b1, b2, a1, a2;
+} BansheeEqualizerCoefficients;
+
+// Ten band equalizer running a cascade of biquads on interleaved F32
+// samples. It exposes the same band0..band9 properties and child proxy
+// bands ("gain", "freq") as equalizer-10bands, so the player can drive
+// either element the same way. Flat bands are skipped and with all bands
+// flat the element is a passthrough. Every change of the response, from a
+// single band or a whole preset, is crossfaded from the old response.
+struct _BansheeEqualizer {
+    GstBaseTransform parent;
+
+    GstAudioInfo info;
+
+    // Requested response, protected by the object lock
+    BansheeEqualizerBand *bands[BANSHEE_EQUALIZER_NBANDS];
+    gdouble gains[BANSHEE_EQUALIZER_NBANDS];
+    BansheeEqualizerCoefficients coefficients[BANSHEE_EQUALIZER_NBANDS];
+    gboolean coefficients_changed;
+
+    // Response being applied and the one being faded out after a change,
+    // each with its filter state (two values per band and channel);
+    // streaming thread only
+    gdouble active_gains[BANSHEE_EQUALIZER_NBANDS];
+    BansheeEqualizerCoefficients active[BANSHEE_EQUALIZER_NBANDS];
+    gdouble previous_gains[BANSHEE_EQUALIZER_NBANDS];
+    BansheeEqualizerCoefficients previous[BANSHEE_EQUALIZER_NBANDS];
+    gfloat *history;
+    gfloat *previous_history;
+
+    gfloat fade;
+    gfloat fade_step;
+    guint ramp_frames;
+    guint ramp_remaining;
+    gfloat *scratch;
+    gsize scratch_size;
+};
+
+struct _BansheeEqualizerClass {
+    GstBaseTransformClass parent_class;
+};
+
+struct _BansheeEqualizerBand {
+    GstObject parent;
+
+    BansheeEqualizer *equalizer;
+    guint index;
+};
+
+struct _BansheeEqualizerBandClass {
+    GstObjectClass parent_class;
+};
+
+GType banshee_equalizer_get_type (void);
+GType banshee_equalizer_band_get_type (void);
+
+void  banshee_equalizer_set_gains (BansheeEqualizer *equalizer, const gdouble *gains, guint n);
+
+G_END_DECLS
+
+#endif /* _BANSHEE_EQUALIZER_H */
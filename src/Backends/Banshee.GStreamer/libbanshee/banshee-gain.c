@@ -0,0 +1,569 @@
+//
+// banshee-gain.c
+//
+// Copyright (C) 2026 Banshee Project Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <math.h>
+#include <string.h>
+
+#include "banshee-gain.h"
+
+// Reference level of the ReplayGain 1.0 specification, in dB SPL
+#define BANSHEE_GAIN_REFERENCE_LEVEL 89.0
+
+// Length of the gain ramp applied whenever the effective gain changes
+#define BANSHEE_GAIN_RAMP_MSEC 50
+
+GST_DEBUG_CATEGORY_STATIC (banshee_gain_debug);
+#define GST_CAT_DEFAULT banshee_gain_debug
+
+enum {
+    PROP_0,
+    PROP_ENABLED,
+    PROP_ALBUM_MODE,
+    PROP_PRE_AMP,
+    PROP_FALLBACK_GAIN,
+    PROP_HEADROOM,
+    PROP_EQ_PREAMP,
+    PROP_VOLUME,
+    PROP_TARGET_GAIN,
+    PROP_RESULT_GAIN
+};
+
+#define BANSHEE_GAIN_CAPS \
+    "audio/x-raw, " \
+    "format = (string) { " GST_AUDIO_NE (F32) ", " GST_AUDIO_NE (S16) " }, " \
+    "rate = (int) [ 1, MAX ], " \
+    "channels = (int) [ 1, MAX ], " \
+    "layout = (string) interleaved"
+
+static GstStaticPadTemplate banshee_gain_sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK, GST_PAD_ALWAYS, GST_STATIC_CAPS (BANSHEE_GAIN_CAPS));
+
+static GstStaticPadTemplate banshee_gain_src_template = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC, GST_PAD_ALWAYS, GST_STATIC_CAPS (BANSHEE_GAIN_CAPS));
+
+#if defined(__GNUC__)
+typedef gfloat BansheeGainVector __attribute__ ((vector_size (16)));
+#endif
+
+G_DEFINE_TYPE_WITH_CODE (BansheeGain, banshee_gain, GST_TYPE_BASE_TRANSFORM,
+    GST_DEBUG_CATEGORY_INIT (banshee_gain_debug, "banshee-gain", 0, "Banshee gain stage"));
+
+// ---------------------------------------------------------------------------
+// Private Functions
+// ---------------------------------------------------------------------------
+
+// Recomputes the applicable gain from the current tags and properties.
+// Must be called with the object lock held; returns TRUE if target-gain
+// or result-gain changed.
+static gboolean
+banshee_gain_update_gain (BansheeGain *self)
+{
+    gdouble previous_target = self->target_gain;
+    gdouble previous_result = self->result_gain;
+    gboolean have_tag_gain = TRUE;
+    gboolean have_peak = FALSE;
+    gdouble gain, peak = 0.0;
+
+    if (self->has_album_gain && (self->album_mode || !self->has_track_gain)) {
+        gain = self->album_gain;
+        have_peak = self->has_album_peak;
+        peak = self->album_peak;
+    } else if (self->has_track_gain) {
+        gain = self->track_gain;
+        have_peak = self->has_track_peak;
+        peak = self->track_peak;
+    } else {
+        gain = self->fallback_gain;
+        have_tag_gain = FALSE;
+    }
+
+    if (have_tag_gain && self->has_reference_level) {
+        gain += BANSHEE_GAIN_REFERENCE_LEVEL - self->reference_level;
+    }
+
+    self->target_gain = gain + self->pre_amp;
+    self->result_gain = self->target_gain;
+
+    // Never amplify past the headroom above the known peak
+    if (have_peak && peak > 0.0) {
+        gdouble max_gain = self->headroom - 20.0 * log10 (peak);
+        if (self->result_gain > max_gain) {
+            self->result_gain = max_gain;
+        }
+    }
+
+    self->target_scale = (gfloat)(self->eq_preamp * self->volume);
+    if (self->enabled) {
+        self->target_scale *= (gfloat)pow (10.0, self->result_gain / 20.0);
+    }
+
+    return previous_target != self->target_gain || previous_result != self->result_gain;
+}
+
+static void
+banshee_gain_reset_tags (BansheeGain *self)
+{
+    self->has_track_gain = FALSE;
+    self->has_track_peak = FALSE;
+    self->has_album_gain = FALSE;
+    self->has_album_peak = FALSE;
+    self->has_reference_level = FALSE;
+}
+
+static gboolean
+banshee_gain_read_tags (BansheeGain *self, const GstTagList *tags)
+{
+    gboolean found = FALSE;
+    gdouble value;
+
+    if (gst_tag_list_get_double (tags, GST_TAG_TRACK_GAIN, &value)) {
+        self->has_track_gain = found = TRUE;
+        self->track_gain = value;
+    }
+
+    if (gst_tag_list_get_double (tags, GST_TAG_TRACK_PEAK, &value)) {
+        self->has_track_peak = found = TRUE;
+        self->track_peak = value;
+    }
+
+    if (gst_tag_list_get_double (tags, GST_TAG_ALBUM_GAIN, &value)) {
+        self->has_album_gain = found = TRUE;
+        self->album_gain = value;
+    }
+
+    if (gst_tag_list_get_double (tags, GST_TAG_ALBUM_PEAK, &value)) {
+        self->has_album_peak = found = TRUE;
+        self->album_peak = value;
+    }
+
+    if (gst_tag_list_get_double (tags, GST_TAG_REFERENCE_LEVEL, &value)) {
+        self->has_reference_level = found = TRUE;
+        self->reference_level = value;
+    }
+
+    return found && banshee_gain_update_gain (self);
+}
+
+static void
+banshee_gain_start_ramp (BansheeGain *self, gfloat target)
+{
+    self->ramp_target = target;
+
+    if (self->ramp_frames == 0) {
+        self->current_scale = target;
+        self->ramp_remaining = 0;
+        return;
+    }
+
+    self->ramp_remaining = self->ramp_frames;
+    self->ramp_step = (target - self->current_scale) / self->ramp_frames;
+}
+
+static inline gint16
+banshee_gain_clamp_s16 (gfloat value)
+{
+    if (value >= 32767.0f) {
+        return G_MAXINT16;
+    } else if (value <= -32768.0f) {
+        return G_MININT16;
+    }
+
+    return (gint16)lrintf (value);
+}
+
+// Applies a constant scale; written with generic vectors so it maps onto
+// SSE or NEON without depending on either
+static void
+banshee_gain_scale_f32 (gfloat *data, guint n, gfloat scale)
+{
+    guint i = 0;
+
+#if defined(__GNUC__)
+    BansheeGainVector v, s = { scale, scale, scale, scale };
+
+    for (; i + 4 <= n; i += 4) {
+        memcpy (&v, data + i, sizeof (v));
+        v *= s;
+        memcpy (data + i, &v, sizeof (v));
+    }
+#endif
+
+    for (; i < n; i++) {
+        data[i] *= scale;
+    }
+}
+
+static void
+banshee_gain_process_f32 (BansheeGain *self, gfloat *data, guint frames)
+{
+    guint channels = GST_AUDIO_INFO_CHANNELS (&self->info);
+    gfloat scale = self->current_scale;
+    guint i, c, n;
+
+    // Ramp one step per frame so all channels move together
+    n = MIN (frames, self->ramp_remaining);
+    for (i = 0; i < n; i++) {
+        scale += self->ramp_step;
+        for (c = 0; c < channels; c++) {
+            *data++ *= scale;
+        }
+    }
+
+    self->ramp_remaining -= n;
+    if (self->ramp_remaining == 0) {
+        scale = self->ramp_target;
+    }
+    self->current_scale = scale;
+
+    if (scale == 1.0f) {
+        return;
+    }
+
+    banshee_gain_scale_f32 (data, (frames - n) * channels, scale);
+}
+
+static void
+banshee_gain_process_s16 (BansheeGain *self, gint16 *data, guint frames)
+{
+    guint channels = GST_AUDIO_INFO_CHANNELS (&self->info);
+    gfloat scale = self->current_scale;
+    guint i, c, n;
+
+    n = MIN (frames, self->ramp_remaining);
+    for (i = 0; i < n; i++) {
+        scale += self->ramp_step;
+        for (c = 0; c < channels; c++, data++) {
+            *data = banshee_gain_clamp_s16 (*data * scale);
+        }
+    }
+
+    self->ramp_remaining -= n;
+    if (self->ramp_remaining == 0) {
+        scale = self->ramp_target;
+    }
+    self->current_scale = scale;
+
+    if (scale == 1.0f) {
+        return;
+    }
+
+    n = (frames - n) * channels;
+    for (i = 0; i < n; i++) {
+        data[i] = banshee_gain_clamp_s16 (data[i] * scale);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// GstBaseTransform Implementation
+// ---------------------------------------------------------------------------
+
+static gboolean
+banshee_gain_set_caps (GstBaseTransform *base, GstCaps *incaps, GstCaps *outcaps)
+{
+    BansheeGain *self = BANSHEE_GAIN (base);
+
+    if (!gst_audio_info_from_caps (&self->info, incaps)) {
+        GST_WARNING_OBJECT (self, "Could not parse caps %" GST_PTR_FORMAT, incaps);
+        return FALSE;
+    }
+
+    self->ramp_frames = GST_AUDIO_INFO_RATE (&self->info) * BANSHEE_GAIN_RAMP_MSEC / 1000;
+    return TRUE;
+}
+
+static gboolean
+banshee_gain_start (GstBaseTransform *base)
+{
+    BansheeGain *self = BANSHEE_GAIN (base);
+
+    GST_OBJECT_LOCK (self);
+    self->current_scale = self->ramp_target = self->target_scale;
+    self->ramp_remaining = 0;
+    GST_OBJECT_UNLOCK (self);
+
+    return TRUE;
+}
+
+static gboolean
+banshee_gain_sink_event (GstBaseTransform *base, GstEvent *event)
+{
+    BansheeGain *self = BANSHEE_GAIN (base);
+    gboolean notify = FALSE;
+
+    switch (GST_EVENT_TYPE (event)) {
+        case GST_EVENT_STREAM_START:
+            GST_OBJECT_LOCK (self);
+            banshee_gain_reset_tags (self);
+            banshee_gain_update_gain (self);
+            GST_OBJECT_UNLOCK (self);
+            break;
+        case GST_EVENT_TAG: {
+            GstTagList *tags;
+            gst_event_parse_tag (event, &tags);
+
+            GST_OBJECT_LOCK (self);
+            notify = banshee_gain_read_tags (self, tags);
+            GST_OBJECT_UNLOCK (self);
+            break;
+        }
+        case GST_EVENT_FLUSH_STOP:
+            // Nothing is audible across a flush, so there is nothing to ramp
+            GST_OBJECT_LOCK (self);
+            self->current_scale = self->ramp_target = self->target_scale;
+            self->ramp_remaining = 0;
+            GST_OBJECT_UNLOCK (self);
+            break;
+        default:
+            break;
+    }
+
+    if (notify) {
+        g_object_notify (G_OBJECT (self), "target-gain");
+        g_object_notify (G_OBJECT (self), "result-gain");
+    }
+
+    return GST_BASE_TRANSFORM_CLASS (banshee_gain_parent_class)->sink_event (base, event);
+}
+
+static void
+banshee_gain_before_transform (GstBaseTransform *base, GstBuffer *buffer)
+{
+    BansheeGain *self = BANSHEE_GAIN (base);
+    gfloat target;
+
+    GST_OBJECT_LOCK (self);
+    target = self->target_scale;
+    GST_OBJECT_UNLOCK (self);
+
+    if (target != self->ramp_target) {
+        banshee_gain_start_ramp (self, target);
+    }
+
+    // Settled at unity gain: pass buffers through untouched, which also
+    // avoids copying buffers that are shared with other tee branches
+    gst_base_transform_set_passthrough (base, self->ramp_remaining == 0 && self->current_scale == 1.0f);
+}
+
+static GstFlowReturn
+banshee_gain_transform_ip (GstBaseTransform *base, GstBuffer *buffer)
+{
+    BansheeGain *self = BANSHEE_GAIN (base);
+    GstMapInfo map;
+    guint frames;
+
+    if (GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_GAP)) {
+        return GST_FLOW_OK;
+    }
+
+    if (GST_AUDIO_INFO_BPF (&self->info) == 0) {
+        return GST_FLOW_NOT_NEGOTIATED;
+    }
+
+    if (!gst_buffer_map (buffer, &map, GST_MAP_READWRITE)) {
+        GST_ELEMENT_ERROR (self, STREAM, FAILED, (NULL), ("Could not map buffer"));
+        return GST_FLOW_ERROR;
+    }
+
+    frames = map.size / GST_AUDIO_INFO_BPF (&self->info);
+
+    if (GST_AUDIO_INFO_FORMAT (&self->info) == GST_AUDIO_FORMAT_F32) {
+        banshee_gain_process_f32 (self, (gfloat *)map.data, frames);
+    } else {
+        banshee_gain_process_s16 (self, (gint16 *)map.data, frames);
+    }
+
+    gst_buffer_unmap (buffer, &map);
+    return GST_FLOW_OK;
+}
+
+// ---------------------------------------------------------------------------
+// GObject Implementation
+// ---------------------------------------------------------------------------
+
+static void
+banshee_gain_set_property (GObject *object, guint prop_id, const GValue *value, GParamSpec *pspec)
+{
+    BansheeGain *self = BANSHEE_GAIN (object);
+
+    GST_OBJECT_LOCK (self);
+
+    switch (prop_id) {
+        case PROP_ENABLED:
+            self->enabled = g_value_get_boolean (value);
+            break;
+        case PROP_ALBUM_MODE:
+            self->album_mode = g_value_get_boolean (value);
+            break;
+        case PROP_PRE_AMP:
+            self->pre_amp = g_value_get_double (value);
+            break;
+        case PROP_FALLBACK_GAIN:
+            self->fallback_gain = g_value_get_double (value);
+            break;
+        case PROP_HEADROOM:
+            self->headroom = g_value_get_double (value);
+            break;
+        case PROP_EQ_PREAMP:
+            self->eq_preamp = g_value_get_double (value);
+            break;
+        case PROP_VOLUME:
+            self->volume = g_value_get_double (value);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+            break;
+    }
+
+    banshee_gain_update_gain (self);
+
+    GST_OBJECT_UNLOCK (self);
+}
+
+static void
+banshee_gain_get_property (GObject *object, guint prop_id, GValue *value, GParamSpec *pspec)
+{
+    BansheeGain *self = BANSHEE_GAIN (object);
+
+    GST_OBJECT_LOCK (self);
+
+    switch (prop_id) {
+        case PROP_ENABLED:
+            g_value_set_boolean (value, self->enabled);
+            break;
+        case PROP_ALBUM_MODE:
+            g_value_set_boolean (value, self->album_mode);
+            break;
+        case PROP_PRE_AMP:
+            g_value_set_double (value, self->pre_amp);
+            break;
+        case PROP_FALLBACK_GAIN:
+            g_value_set_double (value, self->fallback_gain);
+            break;
+        case PROP_HEADROOM:
+            g_value_set_double (value, self->headroom);
+            break;
+        case PROP_EQ_PREAMP:
+            g_value_set_double (value, self->eq_preamp);
+            break;
+        case PROP_VOLUME:
+            g_value_set_double (value, self->volume);
+            break;
+        case PROP_TARGET_GAIN:
+            g_value_set_double (value, self->target_gain);
+            break;
+        case PROP_RESULT_GAIN:
+            g_value_set_double (value, self->result_gain);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+            break;
+    }
+
+    GST_OBJECT_UNLOCK (self);
+}
+
+static void
+banshee_gain_class_init (BansheeGainClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS (klass);
+    GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+    GstBaseTransformClass *transform_class = GST_BASE_TRANSFORM_CLASS (klass);
+
+    object_class->set_property = banshee_gain_set_property;
+    object_class->get_property = banshee_gain_get_property;
+
+    g_object_class_install_property (object_class, PROP_ENABLED,
+        g_param_spec_boolean ("enabled", "Enabled", "Apply ReplayGain (otherwise unity gain)",
+            FALSE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property (object_class, PROP_ALBUM_MODE,
+        g_param_spec_boolean ("album-mode", "Album mode", "Prefer album gain over track gain",
+            TRUE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property (object_class, PROP_PRE_AMP,
+        g_param_spec_double ("pre-amp", "Pre-amp", "Extra gain applied to the ReplayGain value [dB]",
+            -60.0, 60.0, 0.0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property (object_class, PROP_FALLBACK_GAIN,
+        g_param_spec_double ("fallback-gain", "Fallback gain", "Gain for streams without ReplayGain tags [dB]",
+            -60.0, 60.0, 0.0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property (object_class, PROP_HEADROOM,
+        g_param_spec_double ("headroom", "Headroom", "Allowed amplification above the stream peak [dB]",
+            0.0, 60.0, 0.0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property (object_class, PROP_EQ_PREAMP,
+        g_param_spec_double ("eq-preamp", "Equalizer preamp", "Equalizer preamp level (linear)",
+            0.0, 10.0, 1.0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property (object_class, PROP_VOLUME,
+        g_param_spec_double ("volume", "Volume", "User volume (linear)",
+            0.0, 10.0, 1.0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property (object_class, PROP_TARGET_GAIN,
+        g_param_spec_double ("target-gain", "Target gain", "Gain requested by the stream and pre-amp [dB]",
+            -G_MAXDOUBLE, G_MAXDOUBLE, 0.0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property (object_class, PROP_RESULT_GAIN,
+        g_param_spec_double ("result-gain", "Result gain", "Gain after clipping prevention [dB]",
+            -G_MAXDOUBLE, G_MAXDOUBLE, 0.0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+    gst_element_class_add_pad_template (element_class,
+        gst_static_pad_template_get (&banshee_gain_sink_template));
+    gst_element_class_add_pad_template (element_class,
+        gst_static_pad_template_get (&banshee_gain_src_template));
+
+    gst_element_class_set_static_metadata (element_class, "Banshee gain", "Filter/Effect/Audio",
+        "Applies preamp, ReplayGain and volume in a single click-free pass", "Banshee Project");
+
+    transform_class->set_caps = GST_DEBUG_FUNCPTR (banshee_gain_set_caps);
+    transform_class->start = GST_DEBUG_FUNCPTR (banshee_gain_start);
+    transform_class->sink_event = GST_DEBUG_FUNCPTR (banshee_gain_sink_event);
+    transform_class->before_transform = GST_DEBUG_FUNCPTR (banshee_gain_before_transform);
+    transform_class->transform_ip = GST_DEBUG_FUNCPTR (banshee_gain_transform_ip);
+    transform_class->transform_ip_on_passthrough = FALSE;
+}
+
+static void
+banshee_gain_init (BansheeGain *self)
+{
+    gst_base_transform_set_in_place (GST_BASE_TRANSFORM (self), TRUE);
+    gst_base_transform_set_gap_aware (GST_BASE_TRANSFORM (self), TRUE);
+    gst_base_transform_set_passthrough (GST_BASE_TRANSFORM (self), TRUE);
+
+    gst_audio_info_init (&self->info);
+
+    self->enabled = FALSE;
+    self->album_mode = TRUE;
+    self->eq_preamp = 1.0;
+    self->volume = 1.0;
+    self->current_scale = self->ramp_target = self->target_scale = 1.0f;
+
+    banshee_gain_update_gain (self);
+}
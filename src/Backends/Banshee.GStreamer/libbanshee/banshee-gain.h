@@ -0,0 +1,94 @@
+//
+// banshee-gain.h
+//
+// Copyright (C) 2026 Banshee Project Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef _BANSHEE_GAIN_H
+#define _BANSHEE_GAIN_H
+
+#include <gst/gst.h>
+#include <gst/base/gstbasetransform.h>
+#include <gst/audio/audio.h>
+
+G_BEGIN_DECLS
+
+#define BANSHEE_TYPE_GAIN            (banshee_gain_get_type ())
+#define BANSHEE_GAIN(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), BANSHEE_TYPE_GAIN, BansheeGain))
+#define BANSHEE_GAIN_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), BANSHEE_TYPE_GAIN, BansheeGainClass))
+#define BANSHEE_IS_GAIN(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), BANSHEE_TYPE_GAIN))
+#define BANSHEE_IS_GAIN_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), BANSHEE_TYPE_GAIN))
+
+typedef struct _BansheeGain      BansheeGain;
+typedef struct _BansheeGainClass BansheeGainClass;
+
+// In-place gain stage that stays linked for the lifetime of the pipeline.
+// It applies the equalizer preamp, ReplayGain and the user volume as one
+// combined scale factor. Changes are ramped instead of applied abruptly,
+// and buffers at unity gain are passed through untouched.
+struct _BansheeGain {
+    GstBaseTransform parent;
+
+    GstAudioInfo info;
+
+    // Properties, protected by the object lock
+    gboolean enabled;
+    gboolean album_mode;
+    gdouble pre_amp;
+    gdouble fallback_gain;
+    gdouble headroom;
+    gdouble eq_preamp;
+    gdouble volume;
+
+    // ReplayGain tags of the current stream
+    gboolean has_track_gain;
+    gboolean has_track_peak;
+    gboolean has_album_gain;
+    gboolean has_album_peak;
+    gboolean has_reference_level;
+    gdouble track_gain;
+    gdouble track_peak;
+    gdouble album_gain;
+    gdouble album_peak;
+    gdouble reference_level;
+
+    gdouble target_gain;
+    gdouble result_gain;
+    gfloat target_scale;
+
+    // Ramp state, only touched from the streaming thread
+    gfloat current_scale;
+    gfloat ramp_target;
+    gfloat ramp_step;
+    guint ramp_frames;
+    guint ramp_remaining;
+};
+
+struct _BansheeGainClass {
+    GstBaseTransformClass parent_class;
+};
+
+GType banshee_gain_get_type (void);
+
+G_END_DECLS
+
+#endif /* _BANSHEE_GAIN_H */
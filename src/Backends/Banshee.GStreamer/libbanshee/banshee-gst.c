@@ -35,16 +35,51 @@
 #include <string.h>
 #include <stdarg.h>
 
+#include <glib/gstdio.h>
 #include <gst/gst.h>
 #include <gst/pbutils/pbutils.h>
 
+#if defined(G_OS_UNIX) && GLIB_CHECK_VERSION(2,30,0)
+#include <signal.h>
+#include <glib-unix.h>
+#endif
+
 #include "banshee-gst.h"
+#include "banshee-convolver.h"
+#include "banshee-gain.h"
+#include "banshee-equalizer.h"
+
+#define BANSHEE_PROGRESS_PROBE_INTERVAL_USEC (100 * G_TIME_SPAN_MILLISECOND)
+
+struct BansheeProgressProbe {
+    GstPad *pad;
+    gulong probe_id;
+    BansheeProgressProbeCallback callback;
+    gpointer user_data;
+
+    // Streaming thread only, apart from step
+    gdouble step;
+    GstSegment segment;
+    GstFormat duration_format;
+    GstClockTime duration;
+    GstClockTime reported;
+    gint64 last_report;
+
+    // Latest report waiting for the main loop, protected by the lock
+    GMutex *lock;
+    GstClockTime position;
+    GstClockTime report_duration;
+    guint idle_id;
+};
 
 static gboolean gstreamer_initialized = FALSE;
 static gboolean banshee_debugging;
 static BansheeLogHandler banshee_log_handler = NULL;
 static gint banshee_version = -1;
 
+static void banshee_log_init (gboolean debugging);
+static void banshee_trace_init (void);
+
 MYEXPORT void
 gstreamer_initialize (gboolean debugging, BansheeLogHandler log_handler)
 {
@@ -54,10 +89,18 @@ gstreamer_initialize (gboolean debugging, BansheeLogHandler log_handler)
     
     banshee_debugging = debugging;
     banshee_log_handler = log_handler;
+    banshee_log_init (debugging);
+    banshee_trace_init ();
 
     gst_init (NULL, NULL);
     
     gst_pb_utils_init ();
+
+    // Register the elements built into libbanshee so the pipelines can
+    // create them by name like any other element
+    gst_element_register (NULL, "banshee-gain", GST_RANK_NONE, BANSHEE_TYPE_GAIN);
+    gst_element_register (NULL, "banshee-equalizer", GST_RANK_NONE, BANSHEE_TYPE_EQUALIZER);
+    gst_element_register (NULL, "banshee-convolver", GST_RANK_NONE, BANSHEE_TYPE_CONVOLVER);
     
     gstreamer_initialized = TRUE;
 }
@@ -111,6 +154,327 @@ banshee_get_version_number ()
     return (guint)banshee_version;
 }
 
+// ---------------------------------------------------------------------------
+// Logging
+// ---------------------------------------------------------------------------
+
+// Messages are captured into fixed size records in a lock-free ring and
+// formatted and handed to the log handler later by a drain thread, so
+// logging from a streaming thread never allocates, formats or waits on the
+// handler. A record keeps the format string, which is always a literal, and
+// the raw arguments it consumes; strings are copied into the record.
+// Messages whose strings don't fit are formatted right away instead, and
+// kept out of line when even the formatted text doesn't fit. Messages are
+// filtered per component before anything is captured.
+
+#define BANSHEE_LOG_RING_SIZE       1024    // power of two
+#define BANSHEE_LOG_MAX_ARGS          12
+#define BANSHEE_LOG_TEXT_SIZE        160
+#define BANSHEE_LOG_MAX_COMPONENTS    64
+#define BANSHEE_LOG_DRAIN_INTERVAL (20 * G_TIME_SPAN_MILLISECOND)
+
+typedef enum {
+    BANSHEE_LOG_ARG_NONE,
+    BANSHEE_LOG_ARG_INT,
+    BANSHEE_LOG_ARG_LONG,
+    BANSHEE_LOG_ARG_LONG_LONG,
+    BANSHEE_LOG_ARG_SIZE,
+    BANSHEE_LOG_ARG_DOUBLE,
+    BANSHEE_LOG_ARG_STRING,
+    BANSHEE_LOG_ARG_POINTER,
+    BANSHEE_LOG_ARG_UNSUPPORTED
+} BansheeLogArgType;
+
+// One conversion of a format string, e.g. "%-*.3ld"
+typedef struct {
+    const gchar *start;
+    const gchar *end;
+    gint stars;
+    BansheeLogArgType type;
+} BansheeLogSpec;
+
+typedef union {
+    gint64 i;
+    gdouble d;
+    gpointer p;
+} BansheeLogArg;
+
+typedef struct {
+    volatile gint sequence;
+    gint64 time;
+    gpointer thread;
+    const gchar *format;
+    guint8 component;
+    guint8 type;
+    guint8 formatted;   // text, or long_text, holds the whole message
+    guint8 n_args;
+    guint16 text_length;
+    gchar *long_text;
+    BansheeLogArg args[BANSHEE_LOG_MAX_ARGS];
+    gchar text[BANSHEE_LOG_TEXT_SIZE];
+} BansheeLogRecord;
+
+typedef struct {
+    const gchar *name;
+    volatile gint level;
+} BansheeLogComponent;
+
+static BansheeLogComponent banshee_log_components[BANSHEE_LOG_MAX_COMPONENTS];
+static volatile gint banshee_log_component_count = 0;
+static volatile gint banshee_log_default_level = BANSHEE_LOG_LEVEL_NONE;
+G_LOCK_DEFINE_STATIC (banshee_log_components);
+
+static BansheeLogRecord *banshee_log_ring = NULL;
+static volatile gint banshee_log_head = 0;
+static guint banshee_log_tail = 0;
+static volatile gint banshee_log_dropped = 0;
+static gint64 banshee_log_start = 0;
+static gboolean banshee_log_timestamps = FALSE;
+static GThread *banshee_log_thread = NULL;
+static volatile gint banshee_log_stopping = 0;
+G_LOCK_DEFINE_STATIC (banshee_log_drain);
+
+static gint
+banshee_log_type_level (BansheeLogType type)
+{
+    switch (type) {
+        case BANSHEE_LOG_TYPE_DEBUG:       return BANSHEE_LOG_LEVEL_DEBUG;
+        case BANSHEE_LOG_TYPE_INFORMATION: return BANSHEE_LOG_LEVEL_INFORMATION;
+        case BANSHEE_LOG_TYPE_WARNING:     return BANSHEE_LOG_LEVEL_WARNING;
+        default:                           return BANSHEE_LOG_LEVEL_ERROR;
+    }
+}
+
+// Index of the component, registering it if needed. Components are only
+// ever appended and lookups don't take the lock; a component is visible
+// once the count covering it is.
+static gint
+banshee_log_component_id (const gchar *name)
+{
+    gint count = g_atomic_int_get (&banshee_log_component_count);
+    gint i;
+
+    for (i = 0; i < count; i++) {
+        if (banshee_log_components[i].name == name) {
+            return i;
+        }
+    }
+
+    for (i = 0; i < count; i++) {
+        if (strcmp (banshee_log_components[i].name, name) == 0) {
+            return i;
+        }
+    }
+
+    G_LOCK (banshee_log_components);
+
+    count = g_atomic_int_get (&banshee_log_component_count);
+    for (i = 0; i < count; i++) {
+        if (strcmp (banshee_log_components[i].name, name) == 0) {
+            break;
+        }
+    }
+
+    if (i == count && count < BANSHEE_LOG_MAX_COMPONENTS) {
+        banshee_log_components[i].name = g_intern_string (name);
+        banshee_log_components[i].level = g_atomic_int_get (&banshee_log_default_level);
+        g_atomic_int_set (&banshee_log_component_count, count + 1);
+    } else if (i == count) {
+        i = -1;
+    }
+
+    G_UNLOCK (banshee_log_components);
+
+    return i;
+}
+
+static const gchar *
+banshee_log_parse_spec (const gchar *format, BansheeLogSpec *spec)
+{
+    const gchar *p = format + 1;
+    gint longs = 0;
+
+    spec->start = format;
+    spec->stars = 0;
+    spec->type = BANSHEE_LOG_ARG_UNSUPPORTED;
+
+    while (*p != '\0' && strchr ("-+ #0'", *p) != NULL) {
+        p++;
+    }
+
+    if (*p == '*') {
+        spec->stars++;
+        p++;
+    } else {
+        while (g_ascii_isdigit (*p)) {
+            p++;
+        }
+    }
+
+    if (*p == '.') {
+        p++;
+        if (*p == '*') {
+            spec->stars++;
+            p++;
+        } else {
+            while (g_ascii_isdigit (*p)) {
+                p++;
+            }
+        }
+    }
+
+    for (;; p++) {
+        if (*p == 'l') {
+            longs++;
+        } else if (*p == 'q' || *p == 'j') {
+            longs = 2;
+        } else if (*p == 'z' || *p == 't') {
+            longs = -1;
+        } else if (*p != 'h') {
+            break;
+        }
+    }
+
+    switch (*p) {
+        case 'd': case 'i': case 'o': case 'u': case 'x': case 'X': case 'c':
+            spec->type = longs < 0 ? BANSHEE_LOG_ARG_SIZE
+                : longs == 0 ? BANSHEE_LOG_ARG_INT
+                : longs == 1 ? BANSHEE_LOG_ARG_LONG
+                : BANSHEE_LOG_ARG_LONG_LONG;
+            break;
+        case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+            spec->type = BANSHEE_LOG_ARG_DOUBLE;
+            break;
+        case 's':
+            spec->type = BANSHEE_LOG_ARG_STRING;
+            break;
+        case 'p':
+            spec->type = BANSHEE_LOG_ARG_POINTER;
+            break;
+        case '%':
+            spec->type = BANSHEE_LOG_ARG_NONE;
+            break;
+        default:
+            break;
+    }
+
+    spec->end = *p != '\0' ? p + 1 : p;
+    return spec->end;
+}
+
+// Pulls the arguments of format out of args into the record; returns FALSE
+// for formats the record can't hold, which are then formatted right away
+static gboolean
+banshee_log_capture (BansheeLogRecord *record, const gchar *format, va_list args)
+{
+    const gchar *p = format;
+    guint n = 0, text = 0;
+    BansheeLogSpec spec;
+    gint i;
+
+    while ((p = strchr (p, '%')) != NULL) {
+        p = banshee_log_parse_spec (p, &spec);
+
+        if (spec.type == BANSHEE_LOG_ARG_NONE) {
+            continue;
+        } else if (spec.type == BANSHEE_LOG_ARG_UNSUPPORTED || n + spec.stars + 1 > BANSHEE_LOG_MAX_ARGS) {
+            return FALSE;
+        }
+
+        for (i = 0; i < spec.stars; i++) {
+            record->args[n++].i = va_arg (args, gint);
+        }
+
+        switch (spec.type) {
+            case BANSHEE_LOG_ARG_INT:       record->args[n].i = va_arg (args, gint); break;
+            case BANSHEE_LOG_ARG_LONG:      record->args[n].i = va_arg (args, glong); break;
+            case BANSHEE_LOG_ARG_LONG_LONG: record->args[n].i = va_arg (args, gint64); break;
+            case BANSHEE_LOG_ARG_SIZE:      record->args[n].i = va_arg (args, gsize); break;
+            case BANSHEE_LOG_ARG_DOUBLE:    record->args[n].d = va_arg (args, gdouble); break;
+            case BANSHEE_LOG_ARG_POINTER:   record->args[n].p = va_arg (args, gpointer); break;
+            case BANSHEE_LOG_ARG_STRING: {
+                const gchar *str = va_arg (args, const gchar *);
+                gsize length;
+
+                if (str == NULL) {
+                    record->args[n].i = -1;
+                    break;
+                }
+
+                length = strlen (str);
+                if (text + length + 1 > BANSHEE_LOG_TEXT_SIZE) {
+                    return FALSE;
+                }
+
+                memcpy (record->text + text, str, length + 1);
+                record->args[n].i = text;
+                text += length + 1;
+                break;
+            }
+            default: break;
+        }
+
+        n++;
+    }
+
+    record->n_args = n;
+    return TRUE;
+}
+
+static void
+banshee_log_format (BansheeLogRecord *record, GString *message)
+{
+    const gchar *p = record->format;
+    const gchar *percent;
+    BansheeLogSpec spec;
+    gchar conversion[32];
+    guint n = 0;
+    gint stars[2];
+    gint i;
+
+    while ((percent = strchr (p, '%')) != NULL) {
+        g_string_append_len (message, p, percent - p);
+        p = banshee_log_parse_spec (percent, &spec);
+
+        if (spec.type == BANSHEE_LOG_ARG_NONE) {
+            g_string_append_c (message, '%');
+            continue;
+        }
+
+        g_strlcpy (conversion, spec.start, MIN (sizeof (conversion), (gsize)(spec.end - spec.start + 1)));
+
+        for (i = 0; i < spec.stars; i++) {
+            stars[i] = (gint)record->args[n++].i;
+        }
+
+#define BANSHEE_LOG_APPEND(value) \
+        switch (spec.stars) { \
+            case 0: g_string_append_printf (message, conversion, value); break; \
+            case 1: g_string_append_printf (message, conversion, stars[0], value); break; \
+            default: g_string_append_printf (message, conversion, stars[0], stars[1], value); break; \
+        }
+
+        switch (spec.type) {
+            case BANSHEE_LOG_ARG_INT:       BANSHEE_LOG_APPEND ((gint)record->args[n].i); break;
+            case BANSHEE_LOG_ARG_LONG:      BANSHEE_LOG_APPEND ((glong)record->args[n].i); break;
+            case BANSHEE_LOG_ARG_LONG_LONG: BANSHEE_LOG_APPEND ((gint64)record->args[n].i); break;
+            case BANSHEE_LOG_ARG_SIZE:      BANSHEE_LOG_APPEND ((gsize)record->args[n].i); break;
+            case BANSHEE_LOG_ARG_DOUBLE:    BANSHEE_LOG_APPEND (record->args[n].d); break;
+            case BANSHEE_LOG_ARG_POINTER:   BANSHEE_LOG_APPEND (record->args[n].p); break;
+            case BANSHEE_LOG_ARG_STRING:
+                BANSHEE_LOG_APPEND (record->args[n].i < 0 ? "(null)" : record->text + record->args[n].i);
+                break;
+            default: break;
+        }
+
+#undef BANSHEE_LOG_APPEND
+
+        n++;
+    }
+
+    g_string_append (message, p);
+}
+
 static void
 banshee_log (BansheeLogType type, const gchar *component, const gchar *message)
 {
@@ -126,21 +490,1162 @@ banshee_log (BansheeLogType type, const gchar *component, const gchar *message)
     (banshee_log_handler) (type, component, message);
 }
 
+// Hands every complete record to the log handler, in the order they were
+// claimed; a record still being written stops the drain until next time
+static void
+banshee_log_drain (void)
+{
+    GString *message;
+    gint dropped;
+
+    G_LOCK (banshee_log_drain);
+
+    if (banshee_log_ring == NULL) {
+        G_UNLOCK (banshee_log_drain);
+        return;
+    }
+
+    message = g_string_sized_new (256);
+
+    for (;;) {
+        BansheeLogRecord *record = &banshee_log_ring[banshee_log_tail & (BANSHEE_LOG_RING_SIZE - 1)];
+        gint sequence = g_atomic_int_get (&record->sequence);
+
+        if ((gint)((guint)sequence - (banshee_log_tail + 1)) != 0) {
+            break;
+        }
+
+        g_string_truncate (message, 0);
+        if (banshee_log_timestamps) {
+            g_string_append_printf (message, "[%.6f %p] ",
+                (record->time - banshee_log_start) / (gdouble)G_USEC_PER_SEC, record->thread);
+        }
+
+        if (record->long_text != NULL) {
+            g_string_append (message, record->long_text);
+            g_free (record->long_text);
+            record->long_text = NULL;
+        } else if (record->formatted) {
+            g_string_append_len (message, record->text, record->text_length);
+        } else {
+            banshee_log_format (record, message);
+        }
+
+        banshee_log (record->type, banshee_log_components[record->component].name, message->str);
+
+        g_atomic_int_set (&record->sequence, banshee_log_tail + BANSHEE_LOG_RING_SIZE);
+        banshee_log_tail++;
+    }
+
+    dropped = g_atomic_int_get (&banshee_log_dropped);
+    if (dropped > 0) {
+        g_atomic_int_add (&banshee_log_dropped, -dropped);
+        g_string_printf (message, "%d messages dropped, the log ring was full", dropped);
+        banshee_log (BANSHEE_LOG_TYPE_WARNING, "log", message->str);
+    }
+
+    g_string_free (message, TRUE);
+
+    G_UNLOCK (banshee_log_drain);
+}
+
+static gpointer
+banshee_log_drain_thread (gpointer data)
+{
+    while (!g_atomic_int_get (&banshee_log_stopping)) {
+        g_usleep (BANSHEE_LOG_DRAIN_INTERVAL);
+        banshee_log_drain ();
+    }
+
+    return NULL;
+}
+
+// Claims the next free record, or NULL when the ring is full; the
+// record is published by storing the sequence after it is written
+static BansheeLogRecord *
+banshee_log_claim (guint *position)
+{
+    guint head = (guint)g_atomic_int_get (&banshee_log_head);
+
+    for (;;) {
+        BansheeLogRecord *record = &banshee_log_ring[head & (BANSHEE_LOG_RING_SIZE - 1)];
+        gint diff = (gint)((guint)g_atomic_int_get (&record->sequence) - head);
+
+        if (diff == 0) {
+            if (g_atomic_int_compare_and_exchange (&banshee_log_head, (gint)head, (gint)(head + 1))) {
+                *position = head;
+                return record;
+            }
+        } else if (diff < 0) {
+            return NULL;
+        }
+
+        head = (guint)g_atomic_int_get (&banshee_log_head);
+    }
+}
+
+static void
+banshee_log_start_drain (void)
+{
+    guint i;
+
+    banshee_log_ring = g_new0 (BansheeLogRecord, BANSHEE_LOG_RING_SIZE);
+    for (i = 0; i < BANSHEE_LOG_RING_SIZE; i++) {
+        banshee_log_ring[i].sequence = i;
+    }
+
+    banshee_log_start = g_get_monotonic_time ();
+    g_atomic_int_set (&banshee_log_stopping, FALSE);
+
+#if GLIB_CHECK_VERSION(2,32,0)
+    banshee_log_thread = g_thread_new ("banshee-log", banshee_log_drain_thread, NULL);
+#else
+    banshee_log_thread = g_thread_create (banshee_log_drain_thread, NULL, TRUE, NULL);
+#endif
+}
+
+static void
+banshee_log_valist (BansheeLogType type, const gchar *component, const gchar *format, va_list args)
+{
+    BansheeLogRecord *record;
+    guint position;
+    gint id = banshee_log_component_id (component);
+    va_list capture_args;
+
+    if (id < 0 || banshee_log_type_level (type) < g_atomic_int_get (&banshee_log_components[id].level)) {
+        return;
+    }
+
+    // Before initialization and after shutdown there's no drain thread, so
+    // format right away
+    if (g_atomic_pointer_get (&banshee_log_thread) == NULL) {
+        gchar *message = g_strdup_vprintf (format, args);
+        banshee_log (type, component, message);
+        g_free (message);
+        return;
+    }
+
+    record = banshee_log_claim (&position);
+    if (record == NULL) {
+        g_atomic_int_inc (&banshee_log_dropped);
+        return;
+    }
+
+    record->time = g_get_monotonic_time ();
+    record->thread = g_thread_self ();
+    record->format = format;
+    record->component = (guint8)id;
+    record->type = (guint8)type;
+
+    G_VA_COPY (capture_args, args);
+    record->formatted = !banshee_log_capture (record, format, capture_args);
+    va_end (capture_args);
+
+    if (record->formatted) {
+        gint length;
+
+        G_VA_COPY (capture_args, args);
+        length = g_vsnprintf (record->text, sizeof (record->text), format, capture_args);
+        va_end (capture_args);
+
+        record->text_length = (guint16)CLAMP (length, 0, (gint)sizeof (record->text) - 1);
+        if (length >= (gint)sizeof (record->text)) {
+            record->long_text = g_strdup_vprintf (format, args);
+        }
+    }
+
+    g_atomic_int_set (&record->sequence, position + 1);
+}
+
+static void
+banshee_log_init (gboolean debugging)
+{
+    const gchar *levels = g_getenv ("BANSHEE_LOG_LEVELS");
+
+    g_atomic_int_set (&banshee_log_default_level,
+        debugging ? BANSHEE_LOG_LEVEL_DEBUG : BANSHEE_LOG_LEVEL_NONE);
+
+    if (levels != NULL) {
+        banshee_log_set_levels (levels);
+    }
+
+    // Messages are logged as they were before they went through the ring,
+    // unless the time and thread of each are asked for
+    banshee_log_timestamps = g_getenv ("BANSHEE_LOG_TIMESTAMPS") != NULL;
+
+    banshee_log_start_drain ();
+}
+
 void
 banshee_log_debug (const gchar *component, const gchar *format, ...)
 {
     va_list args;
-    gchar *message;
-    
-    if (!banshee_debugging) {
-        return;
-    }
-    
+
     va_start (args, format);
-    message = g_strdup_vprintf (format, args);
+    banshee_log_valist (BANSHEE_LOG_TYPE_DEBUG, component, format, args);
     va_end (args);
-    
-    banshee_log (BANSHEE_LOG_TYPE_DEBUG, component, message);
-    
-    g_free (message);
+}
+
+// Minimum level of the messages logged for component, or for every
+// component with "*"; takes effect immediately, from any thread
+MYEXPORT void
+banshee_log_set_level (const gchar *component, BansheeLogLevel level)
+{
+    gint count, i;
+
+    g_return_if_fail (component != NULL);
+
+    if (strcmp (component, "*") != 0) {
+        gint id = banshee_log_component_id (component);
+        if (id >= 0) {
+            g_atomic_int_set (&banshee_log_components[id].level, level);
+        }
+        return;
+    }
+
+    G_LOCK (banshee_log_components);
+
+    g_atomic_int_set (&banshee_log_default_level, level);
+
+    count = g_atomic_int_get (&banshee_log_component_count);
+    for (i = 0; i < count; i++) {
+        g_atomic_int_set (&banshee_log_components[i].level, level);
+    }
+
+    G_UNLOCK (banshee_log_components);
+}
+
+// Levels from a list like "*:warning,player:debug,ripper:none", applied in
+// order; also read from BANSHEE_LOG_LEVELS at initialization
+MYEXPORT void
+banshee_log_set_levels (const gchar *levels)
+{
+    static const gchar *names[] = { "debug", "information", "warning", "error", "none" };
+    gchar **entries;
+    gint i, j;
+
+    g_return_if_fail (levels != NULL);
+
+    entries = g_strsplit (levels, ",", -1);
+
+    for (i = 0; entries[i] != NULL; i++) {
+        gchar **pair = g_strsplit (entries[i], ":", 2);
+
+        if (pair[0] != NULL && pair[1] != NULL) {
+            g_strstrip (pair[0]);
+            g_strstrip (pair[1]);
+
+            for (j = 0; j < G_N_ELEMENTS (names); j++) {
+                if (g_ascii_strcasecmp (pair[1], names[j]) == 0) {
+                    banshee_log_set_level (pair[0], (BansheeLogLevel)j);
+                    break;
+                }
+            }
+        }
+
+        g_strfreev (pair);
+    }
+
+    g_strfreev (entries);
+}
+
+// Logs everything captured so far before returning
+MYEXPORT void
+banshee_log_flush (void)
+{
+    banshee_log_drain ();
+}
+
+// Stops the drain thread and logs what is left in the ring; messages
+// logged afterwards are formatted and handed over right away
+MYEXPORT void
+banshee_log_shutdown (void)
+{
+    GThread *thread = g_atomic_pointer_get (&banshee_log_thread);
+
+    if (thread == NULL) {
+        return;
+    }
+
+    g_atomic_pointer_set (&banshee_log_thread, NULL);
+    g_atomic_int_set (&banshee_log_stopping, TRUE);
+    g_thread_join (thread);
+
+    banshee_log_drain ();
+}
+
+// ---------------------------------------------------------------------------
+// Tracing
+// ---------------------------------------------------------------------------
+
+// Events go into a buffer of the thread recording them, so recording takes
+// no lock; each buffer stops at BANSHEE_TRACE_BUFFER_SIZE events. Enabling
+// tracing starts a new generation, and buffers of an older one are reset by
+// their thread on its next event and are left out of dumps. Buffers of
+// threads that exited are only freed when a new generation starts.
+
+#define BANSHEE_TRACE_BUFFER_SIZE 8192
+
+typedef struct {
+    gint64 time;
+    const gchar *category;
+    const gchar *name;
+    guint64 id;
+    gint64 value;
+    gchar phase;
+} BansheeTraceEvent;
+
+typedef struct {
+    guint thread_number;
+    gint generation;
+    volatile gint count;
+    volatile gint exited;
+    guint dropped;
+    BansheeTraceEvent events[BANSHEE_TRACE_BUFFER_SIZE];
+} BansheeTraceBuffer;
+
+volatile gint banshee_trace_enabled = 0;
+static volatile gint banshee_trace_generation = 0;
+static gint64 banshee_trace_start = 0;
+static guint banshee_trace_threads = 0;
+static GList *banshee_trace_buffers = NULL;
+G_LOCK_DEFINE_STATIC (banshee_trace_buffers);
+
+static void
+banshee_trace_buffer_release (gpointer data)
+{
+    g_atomic_int_set (&((BansheeTraceBuffer *)data)->exited, 1);
+}
+
+#if GLIB_CHECK_VERSION(2,32,0)
+static GPrivate banshee_trace_key = G_PRIVATE_INIT (banshee_trace_buffer_release);
+#define banshee_trace_get_private()    g_private_get (&banshee_trace_key)
+#define banshee_trace_set_private(b)   g_private_set (&banshee_trace_key, (b))
+#else
+static GPrivate *banshee_trace_key = NULL;
+#define banshee_trace_get_private()    g_private_get (banshee_trace_key)
+#define banshee_trace_set_private(b)   g_private_set (banshee_trace_key, (b))
+#endif
+
+static BansheeTraceBuffer *
+banshee_trace_get_buffer (void)
+{
+    BansheeTraceBuffer *buffer = banshee_trace_get_private ();
+
+    if (buffer == NULL) {
+        buffer = g_new0 (BansheeTraceBuffer, 1);
+
+        G_LOCK (banshee_trace_buffers);
+        buffer->thread_number = ++banshee_trace_threads;
+        buffer->generation = g_atomic_int_get (&banshee_trace_generation);
+        banshee_trace_buffers = g_list_prepend (banshee_trace_buffers, buffer);
+        G_UNLOCK (banshee_trace_buffers);
+
+        banshee_trace_set_private (buffer);
+    }
+
+    return buffer;
+}
+
+// Use the BANSHEE_TRACE_* macros, which skip this while tracing is off.
+// category and name have to be string literals.
+void
+banshee_trace_event (gchar phase, const gchar *category, const gchar *name, guint64 id, gint64 value)
+{
+    BansheeTraceBuffer *buffer = banshee_trace_get_buffer ();
+    gint generation = g_atomic_int_get (&banshee_trace_generation);
+    BansheeTraceEvent *event;
+    gint count;
+
+    if (buffer->generation != generation) {
+        buffer->generation = generation;
+        buffer->dropped = 0;
+        g_atomic_int_set (&buffer->count, 0);
+    }
+
+    count = buffer->count;
+    if (count >= BANSHEE_TRACE_BUFFER_SIZE) {
+        buffer->dropped++;
+        return;
+    }
+
+    event = &buffer->events[count];
+    event->time = g_get_monotonic_time ();
+    event->category = category;
+    event->name = name;
+    event->id = id;
+    event->value = value;
+    event->phase = phase;
+
+    g_atomic_int_set (&buffer->count, count + 1);
+}
+
+// Starts a new trace, dropping the events recorded so far, or stops
+// recording; a stopped trace can still be dumped
+MYEXPORT void
+banshee_trace_set_enabled (gboolean enabled)
+{
+    GList *node, *next;
+
+    if (enabled && !g_atomic_int_get (&banshee_trace_enabled)) {
+        G_LOCK (banshee_trace_buffers);
+
+        for (node = banshee_trace_buffers; node != NULL; node = next) {
+            next = node->next;
+            if (g_atomic_int_get (&((BansheeTraceBuffer *)node->data)->exited)) {
+                g_free (node->data);
+                banshee_trace_buffers = g_list_delete_link (banshee_trace_buffers, node);
+            }
+        }
+
+        banshee_trace_start = g_get_monotonic_time ();
+        g_atomic_int_inc (&banshee_trace_generation);
+
+        G_UNLOCK (banshee_trace_buffers);
+    }
+
+    g_atomic_int_set (&banshee_trace_enabled, enabled ? 1 : 0);
+}
+
+// Writes the events of the current trace in the Chrome trace event format,
+// which chrome://tracing and Perfetto load
+MYEXPORT gboolean
+banshee_trace_dump (const gchar *path)
+{
+    gint generation = g_atomic_int_get (&banshee_trace_generation);
+    const gchar *separator = "";
+    guint dropped = 0;
+    GList *node;
+    FILE *file;
+
+    g_return_val_if_fail (path != NULL, FALSE);
+
+    file = g_fopen (path, "w");
+    if (file == NULL) {
+        return FALSE;
+    }
+
+    fprintf (file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+    G_LOCK (banshee_trace_buffers);
+
+    for (node = banshee_trace_buffers; node != NULL; node = node->next) {
+        BansheeTraceBuffer *buffer = (BansheeTraceBuffer *)node->data;
+        gint count = g_atomic_int_get (&buffer->count);
+        gint i;
+
+        if (buffer->generation != generation || count == 0) {
+            continue;
+        }
+
+        fprintf (file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+            "\"args\":{\"name\":\"thread %u\"}}", separator, buffer->thread_number, buffer->thread_number);
+        separator = ",";
+        dropped += buffer->dropped;
+
+        for (i = 0; i < count; i++) {
+            BansheeTraceEvent *event = &buffer->events[i];
+
+            fprintf (file, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\",\"ts\":%" G_GINT64_FORMAT
+                ",\"pid\":1,\"tid\":%u", event->name, event->category, event->phase,
+                event->time - banshee_trace_start, buffer->thread_number);
+
+            switch (event->phase) {
+                case 'b': case 'e':
+                    fprintf (file, ",\"id\":\"0x%" G_GINT64_MODIFIER "x\"", event->id);
+                    break;
+                case 'C':
+                    fprintf (file, ",\"args\":{\"value\":%" G_GINT64_FORMAT "}", event->value);
+                    break;
+                case 'i':
+                    fprintf (file, ",\"s\":\"t\"");
+                    break;
+                default:
+                    break;
+            }
+
+            fprintf (file, "}");
+        }
+    }
+
+    G_UNLOCK (banshee_trace_buffers);
+
+    fprintf (file, "\n]}\n");
+
+    if (fclose (file) != 0) {
+        return FALSE;
+    }
+
+    if (dropped > 0) {
+        banshee_log_debug ("trace", "Dropped %u events, thread buffers were full", dropped);
+    }
+
+    return TRUE;
+}
+
+#if defined(G_OS_UNIX) && GLIB_CHECK_VERSION(2,30,0)
+// SIGUSR2 dumps the trace to BANSHEE_TRACE_FILE, or to a file in the
+// temporary directory, so a running instance can be profiled as it is
+static gboolean
+banshee_trace_signal_cb (gpointer data)
+{
+    const gchar *path = g_getenv ("BANSHEE_TRACE_FILE");
+    gchar *default_path = NULL;
+
+    if (path == NULL) {
+        gchar *name = g_strdup_printf ("banshee-trace-%" G_GINT64_FORMAT ".json", g_get_real_time () / G_USEC_PER_SEC);
+        default_path = g_build_filename (g_get_tmp_dir (), name, NULL);
+        path = default_path;
+        g_free (name);
+    }
+
+    if (banshee_trace_dump (path)) {
+        g_message ("Wrote trace to %s", path);
+    } else {
+        g_warning ("Could not write trace to %s", path);
+    }
+
+    g_free (default_path);
+    return TRUE;
+}
+#endif
+
+// Tracing starts at once when BANSHEE_TRACE is set. SIGUSR2 is only taken
+// over when tracing is asked for, otherwise it keeps its default action.
+static void
+banshee_trace_init (void)
+{
+#if !GLIB_CHECK_VERSION(2,32,0)
+    banshee_trace_key = g_private_new (banshee_trace_buffer_release);
+#endif
+
+#if defined(G_OS_UNIX) && GLIB_CHECK_VERSION(2,30,0)
+    if (g_getenv ("BANSHEE_TRACE") != NULL || g_getenv ("BANSHEE_TRACE_FILE") != NULL) {
+        g_unix_signal_add (SIGUSR2, banshee_trace_signal_cb, NULL);
+    }
+#endif
+
+    if (g_getenv ("BANSHEE_TRACE") != NULL) {
+        banshee_trace_set_enabled (TRUE);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Progress Probe
+// ---------------------------------------------------------------------------
+
+static gboolean
+banshee_progress_probe_dispatch (BansheeProgressProbe *probe)
+{
+    GstClockTime position, duration;
+
+    g_mutex_lock (probe->lock);
+    position = probe->position;
+    duration = probe->report_duration;
+    probe->idle_id = 0;
+    g_mutex_unlock (probe->lock);
+
+    probe->callback (position, duration, probe->user_data);
+    return FALSE;
+}
+
+static GstPadProbeReturn
+banshee_progress_probe_cb (GstPad *pad, GstPadProbeInfo *info, gpointer data)
+{
+    BansheeProgressProbe *probe = (BansheeProgressProbe *)data;
+    GstClockTime position, step;
+    GstBuffer *buffer;
+    gint64 now;
+
+    if (info->type & GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM) {
+        GstEvent *event = GST_PAD_PROBE_INFO_EVENT (info);
+        if (GST_EVENT_TYPE (event) == GST_EVENT_SEGMENT) {
+            gst_event_copy_segment (event, &probe->segment);
+            probe->reported = GST_CLOCK_TIME_NONE;
+
+            // A duration in another format doesn't apply to this segment
+            if (probe->segment.format != probe->duration_format) {
+                probe->duration_format = probe->segment.format;
+                probe->duration = GST_CLOCK_TIME_NONE;
+            }
+        }
+        return GST_PAD_PROBE_OK;
+    }
+
+    buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+    if (probe->segment.format == GST_FORMAT_TIME) {
+        if (!GST_BUFFER_PTS_IS_VALID (buffer)) {
+            return GST_PAD_PROBE_OK;
+        }
+    } else if (probe->segment.format != GST_FORMAT_BYTES || !GST_BUFFER_OFFSET_IS_VALID (buffer)) {
+        return GST_PAD_PROBE_OK;
+    }
+
+    now = g_get_monotonic_time ();
+    if (now - probe->last_report < BANSHEE_PROGRESS_PROBE_INTERVAL_USEC) {
+        return GST_PAD_PROBE_OK;
+    }
+
+    if (probe->segment.format == GST_FORMAT_TIME) {
+        position = gst_segment_to_running_time (&probe->segment, GST_FORMAT_TIME, GST_BUFFER_PTS (buffer));
+        if (!GST_CLOCK_TIME_IS_VALID (position)) {
+            return GST_PAD_PROBE_OK;
+        }
+        if (GST_BUFFER_DURATION_IS_VALID (buffer)) {
+            position += GST_BUFFER_DURATION (buffer);
+        }
+    } else {
+        position = GST_BUFFER_OFFSET (buffer) + gst_buffer_get_size (buffer);
+    }
+
+    // Asked upstream once, not on every tick like polling the pipeline
+    if (!GST_CLOCK_TIME_IS_VALID (probe->duration)) {
+        gint64 duration;
+        if (gst_pad_peer_query_duration (pad, probe->segment.format, &duration) && duration > 0) {
+            probe->duration = duration;
+        }
+    }
+
+    // Without the size of a byte stream there is nothing to measure against
+    if (!GST_CLOCK_TIME_IS_VALID (probe->duration) && probe->segment.format == GST_FORMAT_BYTES) {
+        return GST_PAD_PROBE_OK;
+    }
+
+    step = GST_CLOCK_TIME_IS_VALID (probe->duration)
+        ? (GstClockTime)(probe->duration * probe->step)
+        : GST_SECOND;
+    if (GST_CLOCK_TIME_IS_VALID (probe->reported) && position < probe->reported + step) {
+        return GST_PAD_PROBE_OK;
+    }
+
+    probe->reported = position;
+    probe->last_report = now;
+
+    g_mutex_lock (probe->lock);
+    probe->position = position;
+    probe->report_duration = probe->duration;
+    if (probe->idle_id == 0) {
+        probe->idle_id = g_idle_add ((GSourceFunc)banshee_progress_probe_dispatch, probe);
+    }
+    g_mutex_unlock (probe->lock);
+
+    return GST_PAD_PROBE_OK;
+}
+
+BansheeProgressProbe *
+banshee_progress_probe_new (GstPad *pad, gdouble step, BansheeProgressProbeCallback callback, gpointer user_data)
+{
+    BansheeProgressProbe *probe;
+
+    g_return_val_if_fail (GST_IS_PAD (pad), NULL);
+    g_return_val_if_fail (callback != NULL, NULL);
+
+    probe = g_new0 (BansheeProgressProbe, 1);
+    probe->pad = gst_object_ref (pad);
+    probe->callback = callback;
+    probe->user_data = user_data;
+    probe->step = CLAMP (step, 0.0, 1.0);
+    probe->duration_format = GST_FORMAT_TIME;
+    probe->duration = GST_CLOCK_TIME_NONE;
+    probe->reported = GST_CLOCK_TIME_NONE;
+    probe->lock = g_mutex_new ();
+    gst_segment_init (&probe->segment, GST_FORMAT_UNDEFINED);
+
+    probe->probe_id = gst_pad_add_probe (pad,
+        GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM,
+        banshee_progress_probe_cb, probe, NULL);
+
+    return probe;
+}
+
+void
+banshee_progress_probe_set_step (BansheeProgressProbe *probe, gdouble step)
+{
+    g_return_if_fail (probe != NULL);
+    probe->step = CLAMP (step, 0.0, 1.0);
+}
+
+// For streams whose upstream duration is not the one to report progress
+// against; only to be called from the streaming thread
+void
+banshee_progress_probe_set_duration (BansheeProgressProbe *probe, GstClockTime duration)
+{
+    g_return_if_fail (probe != NULL);
+    probe->duration_format = GST_FORMAT_TIME;
+    probe->duration = duration;
+}
+
+// The pipeline must no longer be streaming
+void
+banshee_progress_probe_free (BansheeProgressProbe *probe)
+{
+    if (probe == NULL) {
+        return;
+    }
+
+    gst_pad_remove_probe (probe->pad, probe->probe_id);
+    gst_object_unref (probe->pad);
+
+    if (probe->idle_id != 0) {
+        g_source_remove (probe->idle_id);
+    }
+
+    g_mutex_free (probe->lock);
+    g_free (probe);
+}
+
+// ---------------------------------------------------------------------------
+// Encoder Bin Cache
+// ---------------------------------------------------------------------------
+
+// Profiles in use at once are few; past this the cache just starts over
+#define BANSHEE_ENCODER_BIN_CACHE_MAX_TEMPLATES 32
+
+typedef struct {
+    GstElementFactory *factory;
+    gchar *name;
+    guint n_properties;
+    gchar **property_names;
+    GValue *property_values;
+} BansheeEncoderBinElement;
+
+// What parsing a description produced, for descriptions that are a plain
+// chain of elements. Other descriptions (branches, nested bins, sometimes
+// pads) keep a template without elements and are parsed every time.
+typedef struct {
+    GPtrArray *elements;
+    gboolean has_src;
+} BansheeEncoderBinTemplate;
+
+G_LOCK_DEFINE_STATIC (encoder_bin_cache);
+static GHashTable *encoder_bin_templates = NULL;
+static guint encoder_bin_hits = 0;
+static guint encoder_bin_misses = 0;
+static gint64 encoder_bin_hit_usec = 0;
+static gint64 encoder_bin_miss_usec = 0;
+
+static void
+banshee_encoder_bin_element_free (BansheeEncoderBinElement *element)
+{
+    guint i;
+
+    for (i = 0; i < element->n_properties; i++) {
+        g_value_unset (&element->property_values[i]);
+    }
+
+    g_free (element->property_values);
+    g_strfreev (element->property_names);
+    g_free (element->name);
+    gst_object_unref (element->factory);
+    g_free (element);
+}
+
+static void
+banshee_encoder_bin_template_free (BansheeEncoderBinTemplate *template)
+{
+    if (template->elements != NULL) {
+        g_ptr_array_foreach (template->elements, (GFunc)banshee_encoder_bin_element_free, NULL);
+        g_ptr_array_free (template->elements, TRUE);
+    }
+
+    g_free (template);
+}
+
+// Splits a chain description at the links and each element at the
+// whitespace between its properties, leaving quoted text whole. Returns
+// a NULL terminated token vector per element, empty for an empty element.
+static GPtrArray *
+banshee_encoder_bin_description_split (const gchar *description)
+{
+    GPtrArray *segments = g_ptr_array_new ();
+    GPtrArray *tokens = g_ptr_array_new ();
+    GString *token = g_string_new (NULL);
+    gchar quote = 0;
+    const gchar *p;
+
+    for (p = description; ; p++) {
+        if (*p == '\\' && p[1] != '\0') {
+            g_string_append_c (token, *p++);
+            g_string_append_c (token, *p);
+            continue;
+        }
+
+        if (quote != 0 && *p != '\0') {
+            if (*p == quote) {
+                quote = 0;
+            }
+            g_string_append_c (token, *p);
+            continue;
+        }
+
+        if (*p == '"' || *p == '\'') {
+            quote = *p;
+            g_string_append_c (token, *p);
+        } else if (*p != '\0' && *p != '!' && !g_ascii_isspace (*p)) {
+            g_string_append_c (token, *p);
+        } else if (token->len > 0) {
+            g_ptr_array_add (tokens, g_string_free (token, FALSE));
+            token = g_string_new (NULL);
+        }
+
+        if (*p == '\0' || *p == '!') {
+            g_ptr_array_add (tokens, NULL);
+            g_ptr_array_add (segments, g_ptr_array_free (tokens, FALSE));
+            if (*p == '\0') {
+                break;
+            }
+            tokens = g_ptr_array_new ();
+        }
+    }
+
+    g_string_free (token, TRUE);
+    return segments;
+}
+
+static void
+banshee_encoder_bin_description_free (GPtrArray *segments)
+{
+    g_ptr_array_foreach (segments, (GFunc)g_strfreev, NULL);
+    g_ptr_array_free (segments, TRUE);
+}
+
+// Names of the properties an element's tokens set, in the order they are
+// set, or NULL when the tokens are more than an element and its properties.
+// A caps token stands for the capsfilter parsing puts in its place.
+static gchar **
+banshee_encoder_bin_description_properties (gchar **tokens)
+{
+    static const gchar *caps_names[] = { "caps", NULL };
+    GPtrArray *names;
+    guint i;
+
+    if (tokens[0] == NULL) {
+        return NULL;
+    }
+
+    if (strchr (tokens[0], '/') != NULL) {
+        return tokens[1] == NULL ? g_strdupv ((gchar **)caps_names) : NULL;
+    }
+
+    // References to other elements and pads
+    if (strchr (tokens[0], '=') != NULL || strchr (tokens[0], '.') != NULL) {
+        return NULL;
+    }
+
+    names = g_ptr_array_new ();
+
+    for (i = 1; tokens[i] != NULL; i++) {
+        const gchar *equals = strchr (tokens[i], '=');
+        const gchar *colon = strchr (tokens[i], ':');
+        gboolean seen = FALSE;
+        gchar *name;
+        guint j;
+
+        // Child properties and pad references are left to the parser
+        if (equals == NULL || equals == tokens[i] || (colon != NULL && colon < equals)) {
+            g_ptr_array_foreach (names, (GFunc)g_free, NULL);
+            g_ptr_array_free (names, TRUE);
+            return NULL;
+        }
+
+        name = g_strndup (tokens[i], equals - tokens[i]);
+
+        // The name is kept with the element; setting a property twice
+        // leaves the last value, which is read back once
+        for (j = 0; j < names->len && !seen; j++) {
+            seen = strcmp (name, g_ptr_array_index (names, j)) == 0;
+        }
+
+        if (seen || strcmp (name, "name") == 0) {
+            g_free (name);
+            continue;
+        }
+
+        g_ptr_array_add (names, name);
+    }
+
+    g_ptr_array_add (names, NULL);
+    return (gchar **)g_ptr_array_free (names, FALSE);
+}
+
+// Records the factory of element and the values of the properties the
+// description set on it, in that order, whether or not they are defaults
+static BansheeEncoderBinElement *
+banshee_encoder_bin_element_new (GstElement *element, gchar **property_names)
+{
+    BansheeEncoderBinElement *result;
+    guint i;
+
+    result = g_new0 (BansheeEncoderBinElement, 1);
+    result->factory = gst_object_ref (gst_element_get_factory (element));
+    result->name = gst_object_get_name (GST_OBJECT (element));
+    result->n_properties = g_strv_length (property_names);
+    result->property_names = g_strdupv (property_names);
+    result->property_values = g_new0 (GValue, result->n_properties);
+
+    for (i = 0; i < result->n_properties; i++) {
+        GParamSpec *spec = g_object_class_find_property (G_OBJECT_GET_CLASS (element), property_names[i]);
+
+        if (spec == NULL || (spec->flags & G_PARAM_READWRITE) != G_PARAM_READWRITE ||
+            (spec->flags & G_PARAM_CONSTRUCT_ONLY) != 0) {
+            result->n_properties = i;
+            banshee_encoder_bin_element_free (result);
+            return NULL;
+        }
+
+        g_value_init (&result->property_values[i], spec->value_type);
+        g_object_get_property (G_OBJECT (element), spec->name, &result->property_values[i]);
+    }
+
+    return result;
+}
+
+static GstElement *
+banshee_encoder_bin_element_instantiate (BansheeEncoderBinElement *element)
+{
+    GstElement *result;
+    guint i;
+
+    result = gst_element_factory_create (element->factory, element->name);
+    if (result == NULL) {
+        return NULL;
+    }
+
+    for (i = 0; i < element->n_properties; i++) {
+        g_object_set_property (G_OBJECT (result), element->property_names[i], &element->property_values[i]);
+    }
+
+    return result;
+}
+
+// Follows the links from the element behind the bin's sink pad, which for
+// a chain meets the elements in description order. The template has no
+// elements unless that visits every child, each has one always src pad and
+// the description sets nothing but their properties.
+static BansheeEncoderBinTemplate *
+banshee_encoder_bin_template_new (GstElement *bin, const gchar *description)
+{
+    BansheeEncoderBinTemplate *template = g_new0 (BansheeEncoderBinTemplate, 1);
+    GstPad *sink, *target = NULL, *src;
+    GstElement *element = NULL;
+    GPtrArray *segments;
+    gboolean linear = TRUE;
+
+    sink = gst_element_get_static_pad (bin, "sink");
+    if (sink != NULL && GST_IS_GHOST_PAD (sink)) {
+        target = gst_ghost_pad_get_target (GST_GHOST_PAD (sink));
+    }
+    if (target != NULL) {
+        element = gst_pad_get_parent_element (target);
+        linear = GST_PAD_PAD_TEMPLATE (target) != NULL &&
+            GST_PAD_TEMPLATE_PRESENCE (GST_PAD_PAD_TEMPLATE (target)) == GST_PAD_ALWAYS;
+        gst_object_unref (target);
+    }
+    if (sink != NULL) {
+        gst_object_unref (sink);
+    }
+
+    template->elements = g_ptr_array_new ();
+    segments = banshee_encoder_bin_description_split (description);
+
+    while (element != NULL && linear) {
+        BansheeEncoderBinElement *recorded = NULL;
+        GstElement *next = NULL;
+        gchar **names = NULL;
+        GstPad *peer;
+
+        if (template->elements->len < segments->len) {
+            names = banshee_encoder_bin_description_properties (
+                g_ptr_array_index (segments, template->elements->len));
+        }
+
+        if (names != NULL && !GST_IS_BIN (element) && gst_element_get_factory (element) != NULL) {
+            recorded = banshee_encoder_bin_element_new (element, names);
+        }
+        g_strfreev (names);
+
+        if (recorded == NULL) {
+            linear = FALSE;
+            gst_object_unref (element);
+            element = NULL;
+            break;
+        }
+
+        g_ptr_array_add (template->elements, recorded);
+
+        src = gst_element_get_static_pad (element, "src");
+        if (element->numsrcpads > 1 || (element->numsrcpads == 1 && src == NULL)) {
+            linear = FALSE;
+        } else if (src != NULL) {
+            peer = gst_pad_get_peer (src);
+            if (peer != NULL) {
+                next = gst_pad_get_parent_element (peer);
+                gst_object_unref (peer);
+            } else {
+                template->has_src = TRUE;
+            }
+        }
+
+        if (src != NULL) {
+            gst_object_unref (src);
+        }
+        gst_object_unref (element);
+        element = next;
+    }
+
+    if (element != NULL) {
+        gst_object_unref (element);
+    }
+
+    if (!linear || template->elements->len == 0 ||
+        template->elements->len != segments->len ||
+        template->elements->len != (guint)GST_BIN (bin)->numchildren) {
+        g_ptr_array_foreach (template->elements, (GFunc)banshee_encoder_bin_element_free, NULL);
+        g_ptr_array_free (template->elements, TRUE);
+        template->elements = NULL;
+    }
+
+    banshee_encoder_bin_description_free (segments);
+    return template;
+}
+
+static GstElement *
+banshee_encoder_bin_template_instantiate (BansheeEncoderBinTemplate *template)
+{
+    GstElement *bin, *element, *previous = NULL;
+    GstPad *pad;
+    guint i;
+
+    bin = gst_bin_new (NULL);
+
+    for (i = 0; i < template->elements->len; i++) {
+        element = banshee_encoder_bin_element_instantiate (g_ptr_array_index (template->elements, i));
+        if (element == NULL) {
+            gst_object_unref (bin);
+            return NULL;
+        }
+
+        gst_bin_add (GST_BIN (bin), element);
+
+        if (previous == NULL) {
+            pad = gst_element_get_static_pad (element, "sink");
+            gst_element_add_pad (bin, gst_ghost_pad_new ("sink", pad));
+            gst_object_unref (pad);
+        } else if (!gst_element_link (previous, element)) {
+            gst_object_unref (bin);
+            return NULL;
+        }
+
+        previous = element;
+    }
+
+    if (template->has_src) {
+        pad = gst_element_get_static_pad (previous, "src");
+        gst_element_add_pad (bin, gst_ghost_pad_new ("src", pad));
+        gst_object_unref (pad);
+    }
+
+    return bin;
+}
+
+// Drop-in for gst_parse_bin_from_description (description, TRUE, error).
+// The first bin built from a description is parsed; later ones are
+// instantiated from the factories and properties it turned out to use,
+// which skips parsing and the registry lookups.
+GstElement *
+banshee_encoder_bin_new (const gchar *description, GError **error)
+{
+    BansheeEncoderBinTemplate *template;
+    GstElement *bin = NULL;
+    gint64 start;
+
+    g_return_val_if_fail (description != NULL, NULL);
+
+    start = g_get_monotonic_time ();
+
+    G_LOCK (encoder_bin_cache);
+    if (encoder_bin_templates == NULL) {
+        encoder_bin_templates = g_hash_table_new_full (g_str_hash, g_str_equal,
+            g_free, (GDestroyNotify)banshee_encoder_bin_template_free);
+    }
+
+    template = g_hash_table_lookup (encoder_bin_templates, description);
+    if (template != NULL && template->elements != NULL) {
+        bin = banshee_encoder_bin_template_instantiate (template);
+    }
+
+    if (bin != NULL) {
+        encoder_bin_hits++;
+        encoder_bin_hit_usec += g_get_monotonic_time () - start;
+        G_UNLOCK (encoder_bin_cache);
+        return bin;
+    }
+    G_UNLOCK (encoder_bin_cache);
+
+    bin = gst_parse_bin_from_description (description, TRUE, error);
+    if (bin == NULL || (error != NULL && *error != NULL)) {
+        return bin;
+    }
+
+    // Only a description that parsed cleanly becomes a template
+    if (template == NULL) {
+        template = banshee_encoder_bin_template_new (bin, description);
+
+        G_LOCK (encoder_bin_cache);
+        if (g_hash_table_size (encoder_bin_templates) >= BANSHEE_ENCODER_BIN_CACHE_MAX_TEMPLATES) {
+            g_hash_table_remove_all (encoder_bin_templates);
+        }
+        if (g_hash_table_lookup (encoder_bin_templates, description) == NULL) {
+            g_hash_table_insert (encoder_bin_templates, g_strdup (description), template);
+            banshee_log_debug ("encoder-cache", "%s encoder bin %s",
+                template->elements != NULL ? "Compiled" : "Cannot compile", description);
+        } else {
+            banshee_encoder_bin_template_free (template);
+        }
+        G_UNLOCK (encoder_bin_cache);
+    }
+
+    G_LOCK (encoder_bin_cache);
+    encoder_bin_misses++;
+    encoder_bin_miss_usec += g_get_monotonic_time () - start;
+    G_UNLOCK (encoder_bin_cache);
+
+    return bin;
+}
+
+// Bins built from the cache and parsed, and the mean time in microseconds
+// each took to build
+MYEXPORT void
+banshee_encoder_bin_cache_get_stats (guint *hits, guint *misses, gdouble *hit_usec, gdouble *miss_usec)
+{
+    G_LOCK (encoder_bin_cache);
+    if (hits != NULL) {
+        *hits = encoder_bin_hits;
+    }
+    if (misses != NULL) {
+        *misses = encoder_bin_misses;
+    }
+    if (hit_usec != NULL) {
+        *hit_usec = encoder_bin_hits > 0 ? (gdouble)encoder_bin_hit_usec / encoder_bin_hits : 0.0;
+    }
+    if (miss_usec != NULL) {
+        *miss_usec = encoder_bin_misses > 0 ? (gdouble)encoder_bin_miss_usec / encoder_bin_misses : 0.0;
+    }
+    G_UNLOCK (encoder_bin_cache);
+}
+
+void
+banshee_encoder_bin_cache_log_stats (const gchar *component)
+{
+    guint hits, misses;
+    gdouble hit_usec, miss_usec;
+
+    banshee_encoder_bin_cache_get_stats (&hits, &misses, &hit_usec, &miss_usec);
+    if (hits + misses == 0) {
+        return;
+    }
+
+    banshee_log_debug (component, "Encoder bins: %u cached, %u parsed (%.0f%% hit rate), "
+        "%.0f us from cache, %.0f us parsed", hits, misses, 100.0 * hits / (hits + misses),
+        hit_usec, miss_usec);
 }
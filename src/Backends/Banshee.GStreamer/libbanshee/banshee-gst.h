@@ -30,6 +30,7 @@
 #define _BANSHEE_GST_H
 
 #include <glib.h>
+#include <gst/gst.h>
 
 #ifdef WIN32
 #define MYEXPORT __declspec(dllexport)
@@ -64,11 +65,75 @@ typedef enum {
 
 typedef void (* BansheeLogHandler) (BansheeLogType type, const gchar *component, const gchar *message);
 
+// Minimum level of the messages logged for a component
+typedef enum {
+    BANSHEE_LOG_LEVEL_DEBUG,
+    BANSHEE_LOG_LEVEL_INFORMATION,
+    BANSHEE_LOG_LEVEL_WARNING,
+    BANSHEE_LOG_LEVEL_ERROR,
+    BANSHEE_LOG_LEVEL_NONE
+} BansheeLogLevel;
+
+// Follows the running time of the buffers passing a pad and reports it on
+// the main loop, at most every 100 ms and only after it advanced by step
+// (a fraction of the duration, or one second while the duration is unknown).
+// Byte streams, like copies that are not decoded, report the byte offset
+// against the upstream size instead, and nothing while the size is unknown.
+typedef struct BansheeProgressProbe BansheeProgressProbe;
+
+typedef void (* BansheeProgressProbeCallback) (GstClockTime position, GstClockTime duration, gpointer user_data);
+
 MYEXPORT void
 gstreamer_initialize (gboolean debugging, BansheeLogHandler log_handler);
 gboolean  banshee_is_debugging ();
 guint     banshee_get_version_number ();
 
-void      banshee_log_debug (const gchar *component, const gchar *format, ...);
+// The format has to be a string literal: it is only formatted later, on
+// the log's own thread
+void      banshee_log_debug (const gchar *component, const gchar *format, ...) G_GNUC_PRINTF (2, 3);
+MYEXPORT void
+banshee_log_set_level (const gchar *component, BansheeLogLevel level);
+MYEXPORT void
+banshee_log_set_levels (const gchar *levels);
+MYEXPORT void
+banshee_log_flush (void);
+MYEXPORT void
+banshee_log_shutdown (void);
+
+BansheeProgressProbe *
+          banshee_progress_probe_new (GstPad *pad, gdouble step,
+              BansheeProgressProbeCallback callback, gpointer user_data);
+void      banshee_progress_probe_set_step (BansheeProgressProbe *probe, gdouble step);
+void      banshee_progress_probe_set_duration (BansheeProgressProbe *probe, GstClockTime duration);
+void      banshee_progress_probe_free (BansheeProgressProbe *probe);
+
+// Trace events, recorded only while tracing is on; category and name have
+// to be string literals. Async spans may end on another thread than they
+// began and are matched by id.
+extern volatile gint banshee_trace_enabled;
+
+#define BANSHEE_TRACE(phase,category,name,id,value) G_STMT_START { \
+    if (G_UNLIKELY (banshee_trace_enabled)) \
+        banshee_trace_event ((phase), (category), (name), (guint64)(gsize)(id), (gint64)(value)); \
+} G_STMT_END
+
+#define BANSHEE_TRACE_BEGIN(category,name)            BANSHEE_TRACE ('B', category, name, 0, 0)
+#define BANSHEE_TRACE_END(category,name)              BANSHEE_TRACE ('E', category, name, 0, 0)
+#define BANSHEE_TRACE_ASYNC_BEGIN(category,name,id)   BANSHEE_TRACE ('b', category, name, id, 0)
+#define BANSHEE_TRACE_ASYNC_END(category,name,id)     BANSHEE_TRACE ('e', category, name, id, 0)
+#define BANSHEE_TRACE_INSTANT(category,name)          BANSHEE_TRACE ('i', category, name, 0, 0)
+#define BANSHEE_TRACE_COUNTER(category,name,value)    BANSHEE_TRACE ('C', category, name, 0, value)
+
+void      banshee_trace_event (gchar phase, const gchar *category, const gchar *name, guint64 id, gint64 value);
+MYEXPORT void
+banshee_trace_set_enabled (gboolean enabled);
+MYEXPORT gboolean
+banshee_trace_dump (const gchar *path);
+
+GstElement *
+          banshee_encoder_bin_new (const gchar *description, GError **error);
+MYEXPORT void
+banshee_encoder_bin_cache_get_stats (guint *hits, guint *misses, gdouble *hit_usec, gdouble *miss_usec);
+void      banshee_encoder_bin_cache_log_stats (const gchar *component);
 
 #endif /* _BANSHEE_GST_H */
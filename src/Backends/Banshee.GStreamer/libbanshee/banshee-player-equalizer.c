@@ -31,6 +31,8 @@
 //
 
 #include "banshee-player-private.h"
+#include "banshee-convolver.h"
+#include "banshee-equalizer.h"
 
 enum _BpEqStatus {
     BP_EQ_STATUS_UNCHECKED,
@@ -39,6 +41,56 @@ enum _BpEqStatus {
     BP_EQ_STATUS_USE_SYSTEM
 };
 
+// ---------------------------------------------------------------------------
+// Private Functions
+// ---------------------------------------------------------------------------
+
+// The preamp is applied after the equalizer by the gain stage, so band
+// boosts have to run in float where they cannot clip. A flat equalizer
+// changes nothing, so the stream keeps its native format until a band is
+// boosted or cut, sparing integer streams two conversions.
+//
+// Switching the format renegotiates the running stream, which resets the
+// equalizer and may drop a buffer. Entering the float path is worth that,
+// and the equalizer fades in from the dry signal once it sees float, but
+// going flat must not cut the fade-out short, so the float path is only
+// left when release is set: from bp_open and bp_stop, where the stream is
+// being restarted anyway.
+static void
+bp_equalizer_update_float_path (BansheePlayer *player, gboolean release)
+{
+    gboolean engaged = FALSE;
+    GstCaps *caps;
+    guint i, count;
+
+    if (player->equalizer == NULL || player->eq_capsfilter == NULL) {
+        return;
+    }
+
+    count = gst_child_proxy_get_children_count (GST_CHILD_PROXY (player->equalizer));
+    for (i = 0; i < count && !engaged; i++) {
+        GObject *band = gst_child_proxy_get_child_by_index (GST_CHILD_PROXY (player->equalizer), i);
+        gdouble gain;
+
+        g_object_get (band, "gain", &gain, NULL);
+        engaged = gain != 0.0;
+        g_object_unref (band);
+    }
+
+    if (engaged == player->eq_float_path || (!engaged && !release)) {
+        return;
+    }
+
+    bp_debug3 ("Equalizer %s, %s float conversion", engaged ? "engaged" : "flat", engaged ? "forcing" : "dropping");
+    player->eq_float_path = engaged;
+
+    caps = engaged
+        ? gst_caps_new_simple ("audio/x-raw", "format", G_TYPE_STRING, GST_AUDIO_NE (F32), NULL)
+        : gst_caps_new_any ();
+    g_object_set (G_OBJECT (player->eq_capsfilter), "caps", caps, NULL);
+    gst_caps_unref (caps);
+}
+
 // ---------------------------------------------------------------------------
 // Internal Functions
 // ---------------------------------------------------------------------------
@@ -95,6 +147,14 @@ _bp_equalizer_new (BansheePlayer *player)
     return NULL;
 }
 
+// Drops the float path kept after the equalizer went flat; called while
+// the stream is restarted so the format change costs nothing audible
+void
+_bp_equalizer_release_float_path (BansheePlayer *player)
+{
+    bp_equalizer_update_float_path (player, TRUE);
+}
+
 
 // ---------------------------------------------------------------------------
 // Public Functions
@@ -103,7 +163,7 @@ _bp_equalizer_new (BansheePlayer *player)
 P_INVOKE gboolean
 bp_equalizer_is_supported (BansheePlayer *player)
 {
-    return player != NULL && player->equalizer != NULL && player->preamp != NULL;
+    return player != NULL && player->equalizer != NULL && player->gain != NULL;
 }
 
 P_INVOKE void
@@ -111,8 +171,8 @@ bp_equalizer_set_preamp_level (BansheePlayer *player, gdouble level)
 {
     g_return_if_fail (IS_BANSHEE_PLAYER (player));
 
-    if (player->equalizer != NULL && player->preamp != NULL) {
-        g_object_set (player->preamp, "volume", level, NULL);
+    if (player->equalizer != NULL && player->gain != NULL) {
+        g_object_set (player->gain, "eq-preamp", level, NULL);
     }
 }
 
@@ -129,9 +189,40 @@ bp_equalizer_set_gain (BansheePlayer *player, guint bandnum, gdouble gain)
         band = gst_child_proxy_get_child_by_index (GST_CHILD_PROXY (player->equalizer), bandnum);
         g_object_set (band, "gain", gain, NULL);
         g_object_unref (band);
+
+        bp_equalizer_update_float_path (player, FALSE);
     }
 }
 
+// Applies a whole preset at once. The built-in equalizer computes all
+// bands under one lock and crossfades to the new response; the system
+// element only gets its bands set one after another.
+P_INVOKE void
+bp_equalizer_set_gains (BansheePlayer *player, const gdouble *gains, guint n, gdouble preamp)
+{
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+
+    if (player->equalizer == NULL || player->gain == NULL) {
+        return;
+    }
+
+    if (BANSHEE_IS_EQUALIZER (player->equalizer)) {
+        banshee_equalizer_set_gains (BANSHEE_EQUALIZER (player->equalizer), gains, n);
+    } else {
+        guint i, count;
+
+        count = MIN (n, gst_child_proxy_get_children_count (GST_CHILD_PROXY (player->equalizer)));
+        for (i = 0; i < count; i++) {
+            GObject *band = gst_child_proxy_get_child_by_index (GST_CHILD_PROXY (player->equalizer), i);
+            g_object_set (band, "gain", gains[i], NULL);
+            g_object_unref (band);
+        }
+    }
+
+    g_object_set (player->gain, "eq-preamp", preamp, NULL);
+    bp_equalizer_update_float_path (player, FALSE);
+}
+
 P_INVOKE void
 bp_equalizer_get_bandrange (BansheePlayer *player, gint *min, gint *max)
 {    
@@ -195,3 +286,25 @@ bp_equalizer_get_frequencies (BansheePlayer *player, gdouble **freq)
         g_object_unref (band);
     }
 }
+
+// Loads a room correction impulse response from a WAV file into the FIR
+// stage ahead of the gain stage; NULL or an empty path removes it
+P_INVOKE gboolean
+bp_equalizer_set_impulse_response (BansheePlayer *player, const gchar *path)
+{
+    GError *error = NULL;
+
+    g_return_val_if_fail (IS_BANSHEE_PLAYER (player), FALSE);
+
+    if (player->convolver == NULL) {
+        return FALSE;
+    }
+
+    if (!banshee_convolver_set_location (BANSHEE_CONVOLVER (player->convolver), path, &error)) {
+        bp_debug ("Could not load impulse response: %s", error->message);
+        g_error_free (error);
+        return FALSE;
+    }
+
+    return TRUE;
+}
@@ -32,5 +32,6 @@
 #include "banshee-player-private.h"
 
 GstElement * _bp_equalizer_new (BansheePlayer *player);
+void         _bp_equalizer_release_float_path (BansheePlayer *player);
 
 #endif /* _BANSHEE_PLAYER_EQUALIZER_H */
@@ -0,0 +1,556 @@
+//
+// banshee-player-metrics.c
+//
+// Copyright (C) 2026 Banshee Project Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <math.h>
+
+#include "banshee-player-metrics.h"
+
+// Values kept for the percentiles of each histogram
+#define BP_METRICS_WINDOW 256
+
+typedef struct {
+    guint64 count;
+    gdouble sum;
+    gdouble min;
+    gdouble max;
+    guint64 buckets[BP_METRICS_BUCKETS];
+    gdouble window[BP_METRICS_WINDOW];
+} BpMetricsSeries;
+
+struct BpMetricsState {
+    GMutex *mutex;
+
+    BpMetricsSeries open_latency;
+    BpMetricsSeries seek_latency;
+    BpMetricsSeries gapless_gap;
+    BpMetricsSeries underrun_lateness;
+    guint64 underruns;
+    guint64 video_frames;
+    guint64 video_frames_dropped;
+    BpMetricsSeries video_lateness;
+
+    // Pending measurements, started from the main thread and finished by
+    // the first buffer that follows on the streaming thread
+    gint64 open_started;
+    gint64 seek_started;
+    gboolean seek_flushed;
+
+    // Where the stream at the sink is, streaming thread only apart from the
+    // resets done with the pipeline stopped
+    GstPad *pad;
+    gulong probe_id;
+    GstSegment segment;
+    gint rate;
+    gboolean have_end;
+    GstClockTime end;
+    gboolean stream_started;
+    gboolean starving;
+
+    // The same for the video sink, whose QoS messages count its drops
+    GstElement *video_sink;
+    GstPad *video_pad;
+    gulong video_probe_id;
+    GstSegment video_segment;
+};
+
+// ---------------------------------------------------------------------------
+// Private Functions
+// ---------------------------------------------------------------------------
+
+static void
+bp_metrics_series_add (BpMetricsSeries *series, gdouble value)
+{
+    gdouble magnitude = fabs (value);
+    gint bucket = 0;
+
+    if (series->count == 0 || value < series->min) {
+        series->min = value;
+    }
+    if (series->count == 0 || value > series->max) {
+        series->max = value;
+    }
+
+    series->window[series->count % BP_METRICS_WINDOW] = value;
+    series->count++;
+    series->sum += value;
+
+    while (magnitude >= 1.0 && bucket < BP_METRICS_BUCKETS - 1) {
+        magnitude /= 2.0;
+        bucket++;
+    }
+    series->buckets[bucket]++;
+}
+
+static int
+bp_metrics_compare (const void *a, const void *b)
+{
+    gdouble x = *(const gdouble *)a, y = *(const gdouble *)b;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static void
+bp_metrics_series_get (const BpMetricsSeries *series, BpMetricsHistogram *out)
+{
+    gdouble sorted[BP_METRICS_WINDOW];
+    guint n = MIN (series->count, BP_METRICS_WINDOW);
+
+    memset (out, 0, sizeof (BpMetricsHistogram));
+    memcpy (out->buckets, series->buckets, sizeof (out->buckets));
+
+    out->count = series->count;
+    if (n == 0) {
+        return;
+    }
+
+    out->mean = series->sum / series->count;
+    out->min = series->min;
+    out->max = series->max;
+
+    memcpy (sorted, series->window, n * sizeof (gdouble));
+    qsort (sorted, n, sizeof (gdouble), bp_metrics_compare);
+
+    out->p50 = sorted[(n - 1) * 50 / 100];
+    out->p90 = sorted[(n - 1) * 90 / 100];
+    out->p99 = sorted[(n - 1) * 99 / 100];
+}
+
+static gdouble
+bp_metrics_elapsed_ms (gint64 started)
+{
+    return (g_get_monotonic_time () - started) / 1000.0;
+}
+
+// Buffers reaching the sink while it plays should be ahead of its clock;
+// one that is already late means the ring buffer ran dry
+static void
+bp_metrics_check_underrun (BansheePlayer *player, BpMetricsState *metrics, GstClockTime end)
+{
+    GstClock *clock;
+    GstClockTime now;
+
+    if (GST_STATE (player->audiosink) != GST_STATE_PLAYING ||
+        (clock = gst_element_get_clock (player->audiosink)) == NULL) {
+        metrics->starving = FALSE;
+        return;
+    }
+
+    now = gst_clock_get_time (clock) - gst_element_get_base_time (player->audiosink);
+    gst_object_unref (clock);
+
+    if (end >= now) {
+        metrics->starving = FALSE;
+    } else if (!metrics->starving) {
+        metrics->starving = TRUE;
+        metrics->underruns++;
+        bp_metrics_series_add (&metrics->underrun_lateness, (now - end) / (gdouble)GST_MSECOND);
+        BANSHEE_TRACE_INSTANT ("player", "underrun");
+    }
+}
+
+static void
+bp_metrics_process_buffer (BansheePlayer *player, BpMetricsState *metrics, GstBuffer *buffer)
+{
+    GstClockTime start = GST_CLOCK_TIME_NONE, end = GST_CLOCK_TIME_NONE;
+    gboolean fresh = FALSE;
+
+    if (GST_BUFFER_PTS_IS_VALID (buffer) && metrics->segment.format == GST_FORMAT_TIME) {
+        start = gst_segment_to_running_time (&metrics->segment, GST_FORMAT_TIME, GST_BUFFER_PTS (buffer));
+        if (GST_CLOCK_TIME_IS_VALID (start) && GST_BUFFER_DURATION_IS_VALID (buffer)) {
+            end = start + GST_BUFFER_DURATION (buffer);
+        }
+    }
+
+    g_mutex_lock (metrics->mutex);
+
+    if (metrics->open_started != 0) {
+        bp_metrics_series_add (&metrics->open_latency, bp_metrics_elapsed_ms (metrics->open_started));
+        metrics->open_started = 0;
+        fresh = TRUE;
+        BANSHEE_TRACE_INSTANT ("player", "first-buffer");
+    }
+
+    if (metrics->seek_started != 0 && metrics->seek_flushed) {
+        bp_metrics_series_add (&metrics->seek_latency, bp_metrics_elapsed_ms (metrics->seek_started));
+        metrics->seek_started = 0;
+        fresh = TRUE;
+        BANSHEE_TRACE_INSTANT ("player", "first-seek-buffer");
+    }
+
+    // The first buffer after a stream start that followed another stream
+    // without a flush is the far side of a gapless transition
+    if (metrics->stream_started) {
+        metrics->stream_started = FALSE;
+        if (metrics->have_end && GST_CLOCK_TIME_IS_VALID (start) && metrics->rate > 0) {
+            gdouble gap = start >= metrics->end
+                ? (gdouble)gst_util_uint64_scale_round (start - metrics->end, metrics->rate, GST_SECOND)
+                : -(gdouble)gst_util_uint64_scale_round (metrics->end - start, metrics->rate, GST_SECOND);
+            bp_metrics_series_add (&metrics->gapless_gap, gap);
+            BANSHEE_TRACE_COUNTER ("player", "gapless-gap", (gint64)gap);
+        }
+        fresh = TRUE;
+    }
+
+    if (!fresh && GST_CLOCK_TIME_IS_VALID (end)) {
+        bp_metrics_check_underrun (player, metrics, end);
+    }
+
+    g_mutex_unlock (metrics->mutex);
+
+    metrics->have_end = GST_CLOCK_TIME_IS_VALID (end);
+    metrics->end = end;
+}
+
+static GstPadProbeReturn
+bp_metrics_probe_cb (GstPad *pad, GstPadProbeInfo *info, gpointer data)
+{
+    BansheePlayer *player = (BansheePlayer *)data;
+    BpMetricsState *metrics = player->metrics;
+
+    if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER) {
+        bp_metrics_process_buffer (player, metrics, GST_PAD_PROBE_INFO_BUFFER (info));
+        return GST_PAD_PROBE_OK;
+    }
+
+    switch (GST_EVENT_TYPE (GST_PAD_PROBE_INFO_EVENT (info))) {
+        case GST_EVENT_CAPS: {
+            GstCaps *caps;
+            GstAudioInfo audio_info;
+
+            gst_event_parse_caps (GST_PAD_PROBE_INFO_EVENT (info), &caps);
+            metrics->rate = gst_audio_info_from_caps (&audio_info, caps) ? GST_AUDIO_INFO_RATE (&audio_info) : 0;
+            break;
+        }
+
+        case GST_EVENT_SEGMENT:
+            gst_event_copy_segment (GST_PAD_PROBE_INFO_EVENT (info), &metrics->segment);
+            break;
+
+        case GST_EVENT_STREAM_START:
+            metrics->stream_started = TRUE;
+            break;
+
+        case GST_EVENT_FLUSH_STOP:
+            metrics->have_end = FALSE;
+            metrics->starving = FALSE;
+            g_mutex_lock (metrics->mutex);
+            metrics->seek_flushed = metrics->seek_started != 0;
+            g_mutex_unlock (metrics->mutex);
+            break;
+
+        default:
+            break;
+    }
+
+    return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn
+bp_metrics_video_probe_cb (GstPad *pad, GstPadProbeInfo *info, gpointer data)
+{
+    BansheePlayer *player = (BansheePlayer *)data;
+    BpMetricsState *metrics = player->metrics;
+    GstClockTime start = GST_CLOCK_TIME_NONE, now = GST_CLOCK_TIME_NONE;
+    GstBuffer *buffer;
+    GstClock *clock;
+
+    if (!(GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER)) {
+        if (GST_EVENT_TYPE (GST_PAD_PROBE_INFO_EVENT (info)) == GST_EVENT_SEGMENT) {
+            gst_event_copy_segment (GST_PAD_PROBE_INFO_EVENT (info), &metrics->video_segment);
+        }
+        return GST_PAD_PROBE_OK;
+    }
+
+    buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+    if (GST_BUFFER_PTS_IS_VALID (buffer) && metrics->video_segment.format == GST_FORMAT_TIME) {
+        start = gst_segment_to_running_time (&metrics->video_segment, GST_FORMAT_TIME, GST_BUFFER_PTS (buffer));
+    }
+
+    // Frames prerolled while paused are not due at any time yet
+    if (GST_CLOCK_TIME_IS_VALID (start) && GST_STATE (metrics->video_sink) == GST_STATE_PLAYING &&
+        (clock = gst_element_get_clock (metrics->video_sink)) != NULL) {
+        now = gst_clock_get_time (clock) - gst_element_get_base_time (metrics->video_sink);
+        gst_object_unref (clock);
+    }
+
+    g_mutex_lock (metrics->mutex);
+    metrics->video_frames++;
+    if (GST_CLOCK_TIME_IS_VALID (now)) {
+        bp_metrics_series_add (&metrics->video_lateness, GST_CLOCK_DIFF (start, now) / (gdouble)GST_MSECOND);
+    }
+    g_mutex_unlock (metrics->mutex);
+
+    return GST_PAD_PROBE_OK;
+}
+
+// ---------------------------------------------------------------------------
+// Internal Functions
+// ---------------------------------------------------------------------------
+
+BpMetricsState *
+_bp_metrics_new (void)
+{
+    BpMetricsState *metrics = g_new0 (BpMetricsState, 1);
+
+    metrics->mutex = g_mutex_new ();
+    gst_segment_init (&metrics->segment, GST_FORMAT_UNDEFINED);
+
+    return metrics;
+}
+
+void
+_bp_metrics_free (BpMetricsState *metrics)
+{
+    if (metrics == NULL) {
+        return;
+    }
+
+    g_mutex_free (metrics->mutex);
+    g_free (metrics);
+}
+
+// Watches what reaches the audio sink; with a bin like autoaudiosink this
+// is its ghost pad, which sees the same buffers as the real sink
+void
+_bp_metrics_pipeline_setup (BansheePlayer *player)
+{
+    BpMetricsState *metrics;
+
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    g_return_if_fail (player->metrics != NULL);
+
+    metrics = player->metrics;
+    if (player->audiosink == NULL || metrics->pad != NULL) {
+        return;
+    }
+
+    metrics->pad = gst_element_get_static_pad (player->audiosink, "sink");
+    if (metrics->pad == NULL) {
+        bp_debug ("Audio sink has no sink pad, latency metrics are disabled");
+        return;
+    }
+
+    metrics->probe_id = gst_pad_add_probe (metrics->pad,
+        GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM | GST_PAD_PROBE_TYPE_EVENT_FLUSH,
+        bp_metrics_probe_cb, player, NULL);
+}
+
+void
+_bp_metrics_pipeline_destroy (BansheePlayer *player)
+{
+    BpMetricsState *metrics;
+
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+
+    metrics = player->metrics;
+    if (metrics == NULL) {
+        return;
+    }
+
+    if (metrics->video_pad != NULL) {
+        gst_pad_remove_probe (metrics->video_pad, metrics->video_probe_id);
+        gst_object_unref (metrics->video_pad);
+        metrics->video_pad = NULL;
+        metrics->video_probe_id = 0;
+    }
+
+    if (metrics->video_sink != NULL) {
+        gst_object_unref (metrics->video_sink);
+        metrics->video_sink = NULL;
+    }
+
+    if (metrics->pad == NULL) {
+        return;
+    }
+
+    gst_pad_remove_probe (metrics->pad, metrics->probe_id);
+    gst_object_unref (metrics->pad);
+    metrics->pad = NULL;
+    metrics->probe_id = 0;
+
+    g_mutex_lock (metrics->mutex);
+    metrics->open_started = 0;
+    metrics->seek_started = 0;
+    g_mutex_unlock (metrics->mutex);
+}
+
+// Watches whichever video sink playbin was given, custom ones included;
+// called once the video pipeline is set up
+void
+_bp_metrics_video_setup (BansheePlayer *player)
+{
+    BpMetricsState *metrics;
+
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    g_return_if_fail (player->metrics != NULL);
+
+    metrics = player->metrics;
+    if (metrics->video_sink != NULL) {
+        return;
+    }
+
+    g_object_get (player->playbin, "video-sink", &metrics->video_sink, NULL);
+    if (metrics->video_sink == NULL) {
+        return;
+    }
+
+    gst_segment_init (&metrics->video_segment, GST_FORMAT_UNDEFINED);
+    metrics->video_pad = gst_element_get_static_pad (metrics->video_sink, "sink");
+    if (metrics->video_pad == NULL) {
+        bp_debug ("Video sink has no sink pad, video frame metrics are disabled");
+        return;
+    }
+
+    metrics->video_probe_id = gst_pad_add_probe (metrics->video_pad,
+        GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM,
+        bp_metrics_video_probe_cb, player, NULL);
+}
+
+// A sink posts a QoS message in buffers for every buffer it drops as too
+// late; those from the video sink, or a sink inside it, are its drops
+void
+_bp_metrics_process_qos (BansheePlayer *player, GstMessage *message)
+{
+    BpMetricsState *metrics;
+    GstObject *source;
+    GstFormat format;
+
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+
+    metrics = player->metrics;
+    source = GST_MESSAGE_SRC (message);
+    if (metrics->video_sink == NULL || source == NULL) {
+        return;
+    }
+
+#if GST_CHECK_VERSION(1,6,0)
+    if (source != GST_OBJECT (metrics->video_sink) &&
+        !gst_object_has_as_ancestor (source, GST_OBJECT (metrics->video_sink))) {
+#else
+    if (source != GST_OBJECT (metrics->video_sink) &&
+        !gst_object_has_ancestor (source, GST_OBJECT (metrics->video_sink))) {
+#endif
+        return;
+    }
+
+    gst_message_parse_qos_stats (message, &format, NULL, NULL);
+    if (format != GST_FORMAT_BUFFERS) {
+        return;
+    }
+
+    g_mutex_lock (metrics->mutex);
+    metrics->video_frames_dropped++;
+    g_mutex_unlock (metrics->mutex);
+}
+
+// Called with the pipeline stopped, so the new stream does not count as a
+// gapless transition
+void
+_bp_metrics_open (BansheePlayer *player, gint64 started)
+{
+    BpMetricsState *metrics = player->metrics;
+
+    g_mutex_lock (metrics->mutex);
+    metrics->open_started = started;
+    metrics->seek_started = 0;
+    metrics->have_end = FALSE;
+    metrics->stream_started = FALSE;
+    metrics->starving = FALSE;
+    g_mutex_unlock (metrics->mutex);
+}
+
+// Called before the seek is sent, as its flush reaches the sink before the
+// seek returns
+void
+_bp_metrics_seek (BansheePlayer *player, gint64 started)
+{
+    BpMetricsState *metrics = player->metrics;
+
+    g_mutex_lock (metrics->mutex);
+    metrics->seek_started = started;
+    metrics->seek_flushed = FALSE;
+    g_mutex_unlock (metrics->mutex);
+}
+
+void
+_bp_metrics_seek_failed (BansheePlayer *player)
+{
+    BpMetricsState *metrics = player->metrics;
+
+    g_mutex_lock (metrics->mutex);
+    metrics->seek_started = 0;
+    g_mutex_unlock (metrics->mutex);
+}
+
+// ---------------------------------------------------------------------------
+// Public Functions
+// ---------------------------------------------------------------------------
+
+P_INVOKE void
+bp_get_metrics (BansheePlayer *player, BpMetrics *out)
+{
+    BpMetricsState *metrics;
+
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    g_return_if_fail (out != NULL);
+
+    metrics = player->metrics;
+
+    g_mutex_lock (metrics->mutex);
+    bp_metrics_series_get (&metrics->open_latency, &out->open_latency);
+    bp_metrics_series_get (&metrics->seek_latency, &out->seek_latency);
+    bp_metrics_series_get (&metrics->gapless_gap, &out->gapless_gap);
+    bp_metrics_series_get (&metrics->underrun_lateness, &out->underrun_lateness);
+    out->underruns = metrics->underruns;
+    out->video_frames = metrics->video_frames;
+    out->video_frames_dropped = metrics->video_frames_dropped;
+    bp_metrics_series_get (&metrics->video_lateness, &out->video_lateness);
+    g_mutex_unlock (metrics->mutex);
+}
+
+P_INVOKE void
+bp_reset_metrics (BansheePlayer *player)
+{
+    BpMetricsState *metrics;
+
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+
+    metrics = player->metrics;
+
+    g_mutex_lock (metrics->mutex);
+    memset (&metrics->open_latency, 0, sizeof (BpMetricsSeries));
+    memset (&metrics->seek_latency, 0, sizeof (BpMetricsSeries));
+    memset (&metrics->gapless_gap, 0, sizeof (BpMetricsSeries));
+    memset (&metrics->underrun_lateness, 0, sizeof (BpMetricsSeries));
+    metrics->underruns = 0;
+    metrics->video_frames = 0;
+    metrics->video_frames_dropped = 0;
+    memset (&metrics->video_lateness, 0, sizeof (BpMetricsSeries));
+    g_mutex_unlock (metrics->mutex);
+}
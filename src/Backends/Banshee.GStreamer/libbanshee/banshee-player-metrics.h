@@ -0,0 +1,84 @@
+//
+// banshee-player-metrics.h
+//
+// Copyright (C) 2026 Banshee Project Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef _BANSHEE_PLAYER_METRICS_H
+#define _BANSHEE_PLAYER_METRICS_H
+
+#include "banshee-player-private.h"
+
+#define BP_METRICS_BUCKETS 16
+
+// Bucket 0 counts values below 1, bucket i values in [2^(i-1), 2^i) and
+// the last bucket everything above. Percentiles are exact over the most
+// recent values only; count, mean, min, max and the buckets cover every
+// value since the player was created or the metrics were reset.
+typedef struct {
+    guint64 count;
+    gdouble mean;
+    gdouble min;
+    gdouble max;
+    gdouble p50;
+    gdouble p90;
+    gdouble p99;
+    guint64 buckets[BP_METRICS_BUCKETS];
+} BpMetricsHistogram;
+
+typedef struct {
+    // bp_open to the first buffer reaching the audio sink, in ms
+    BpMetricsHistogram open_latency;
+    // bp_set_position to the first buffer after the flush, in ms
+    BpMetricsHistogram seek_latency;
+    // Running time between the last sample of a stream and the first of
+    // the next at a gapless transition, in samples; negative for overlap
+    BpMetricsHistogram gapless_gap;
+    // How late the buffer that ended each underrun was, in ms
+    BpMetricsHistogram underrun_lateness;
+    guint64 underruns;
+    // Buffers that reached the video sink, and those it dropped as too
+    // late to show
+    guint64 video_frames;
+    guint64 video_frames_dropped;
+    // How late each frame reached the video sink against the time it is
+    // due, in ms; negative while frames arrive ahead of time
+    BpMetricsHistogram video_lateness;
+} BpMetrics;
+
+BpMetricsState *
+     _bp_metrics_new              (void);
+void _bp_metrics_free             (BpMetricsState *metrics);
+void _bp_metrics_pipeline_setup   (BansheePlayer *player);
+void _bp_metrics_pipeline_destroy (BansheePlayer *player);
+void _bp_metrics_video_setup      (BansheePlayer *player);
+void _bp_metrics_process_qos      (BansheePlayer *player, GstMessage *message);
+void _bp_metrics_open             (BansheePlayer *player, gint64 started);
+void _bp_metrics_seek             (BansheePlayer *player, gint64 started);
+void _bp_metrics_seek_failed      (BansheePlayer *player);
+
+P_INVOKE void
+     bp_get_metrics               (BansheePlayer *player, BpMetrics *out);
+P_INVOKE void
+     bp_reset_metrics             (BansheePlayer *player);
+
+#endif /* _BANSHEE_PLAYER_METRICS_H */
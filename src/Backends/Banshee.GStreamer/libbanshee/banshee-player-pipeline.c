@@ -33,6 +33,7 @@
 #include "banshee-player-dvd.h"
 #include "banshee-player-video.h"
 #include "banshee-player-equalizer.h"
+#include "banshee-player-metrics.h"
 #include "banshee-player-missing-elements.h"
 #include "banshee-player-replaygain.h"
 #include "banshee-player-vis.h"
@@ -139,6 +140,10 @@ bp_pipeline_bus_callback (GstBus *bus, GstMessage *message, gpointer userdata)
 
             _bp_missing_elements_handle_state_changed (player, old, new);
 
+            if (GST_MESSAGE_SRC (message) == GST_OBJECT (player->playbin)) {
+                BANSHEE_TRACE ('i', "player", gst_element_state_get_name (new), 0, 0);
+            }
+
             if (player->state_changed_cb != NULL && GST_MESSAGE_SRC (message) == GST_OBJECT (player->playbin)) {
                 player->state_changed_cb (player, old, new, pending);
             }
@@ -214,10 +219,26 @@ bp_pipeline_bus_callback (GstBus *bus, GstMessage *message, gpointer userdata)
         }
 
         case GST_MESSAGE_STREAM_START: {
+            BANSHEE_TRACE_ASYNC_END ("player", "open", player);
+            BANSHEE_TRACE_INSTANT ("player", "stream-start");
             bp_next_track_starting (player);
             break;
         }
 
+        case GST_MESSAGE_ASYNC_DONE: {
+            // Prerolling after an open or a state change is async too
+            if (player->seek_pending) {
+                player->seek_pending = FALSE;
+                BANSHEE_TRACE_ASYNC_END ("player", "seek", player);
+            }
+            break;
+        }
+
+        case GST_MESSAGE_QOS: {
+            _bp_metrics_process_qos (player, message);
+            break;
+        }
+
         case GST_MESSAGE_APPLICATION: {
             const gchar * name;
             const GstStructure * s = gst_message_get_structure (message);
@@ -239,6 +260,8 @@ static void bp_about_to_finish_callback (GstElement *playbin, BansheePlayer *pla
     g_return_if_fail (IS_BANSHEE_PLAYER (player));
     g_return_if_fail (GST_IS_ELEMENT (playbin));
 
+    BANSHEE_TRACE_INSTANT ("player", "about-to-finish");
+
     if (bp_stream_has_video (playbin)) {
         bp_debug ("[Gapless]: Not attempting gapless transition from stream with video");
         return;
@@ -272,6 +295,48 @@ static void bp_volume_changed_callback (GstElement *playbin, GParamSpec *spec, B
 // Internal Functions
 // ---------------------------------------------------------------------------
 
+static GstElement *
+bp_pipeline_audiosink_override (BansheePlayer *player)
+{
+    const gchar *description = player->audiosink_description;
+    GError *error = NULL;
+    GstElement *audiosink;
+
+    if (description == NULL) {
+        return NULL;
+    }
+
+    audiosink = gst_parse_bin_from_description (description, TRUE, &error);
+    if (audiosink == NULL) {
+        g_warning ("Could not create audio sink \"%s\": %s", description, error != NULL ? error->message : "");
+        if (error != NULL) {
+            g_error_free (error);
+        }
+        return NULL;
+    }
+
+    if (error != NULL) {
+        g_error_free (error);
+    }
+
+    gst_object_set_name (GST_OBJECT (audiosink), "audiosink");
+    return audiosink;
+}
+
+// Replaces the audio sink with a bin description, for example "fakesink
+// sync=true" to play without a sound card. Only the benchmark uses this;
+// it has to be set before the pipeline is built.
+void
+_bp_pipeline_set_audiosink (BansheePlayer *player, const gchar *description)
+{
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+
+    g_free (player->audiosink_description);
+    player->audiosink_description = description != NULL && description[0] != '\0'
+        ? g_strdup (description)
+        : NULL;
+}
+
 gboolean 
 _bp_pipeline_construct (BansheePlayer *player)
 {
@@ -298,13 +363,16 @@ _bp_pipeline_construct (BansheePlayer *player)
     g_signal_connect (player->playbin, "audio-changed", G_CALLBACK (playbin_stream_changed_cb), player);
     g_signal_connect (player->playbin, "text-changed", G_CALLBACK (playbin_stream_changed_cb), player);
 
-    audiosink = gst_element_factory_make ("directsoundsink", "audiosink");
-    if (audiosink != NULL) {
-        g_object_set (G_OBJECT (audiosink), "volume", 1.0, NULL);
-    } else {
-        audiosink = gst_element_factory_make ("autoaudiosink", "audiosink");
-        if (audiosink == NULL) {
-            audiosink = gst_element_factory_make ("alsasink", "audiosink");
+    audiosink = bp_pipeline_audiosink_override (player);
+    if (audiosink == NULL) {
+        audiosink = gst_element_factory_make ("directsoundsink", "audiosink");
+        if (audiosink != NULL) {
+            g_object_set (G_OBJECT (audiosink), "volume", 1.0, NULL);
+        } else {
+            audiosink = gst_element_factory_make ("autoaudiosink", "audiosink");
+            if (audiosink == NULL) {
+                audiosink = gst_element_factory_make ("alsasink", "audiosink");
+            }
         }
     }
 
@@ -343,9 +411,10 @@ _bp_pipeline_construct (BansheePlayer *player)
     player->audiotee = gst_element_factory_make ("tee", "audiotee");
     g_return_val_if_fail (player->audiotee != NULL, FALSE);
 
-    // Create a volume control with low latency
-    player->volume = gst_element_factory_make ("volume", NULL);
-    g_return_val_if_fail (player->volume != NULL, FALSE);
+    // A single gain stage applies the equalizer preamp, ReplayGain and the
+    // user volume in one pass, with low latency
+    player->gain = gst_element_factory_make ("banshee-gain", "gain");
+    g_return_val_if_fail (player->gain != NULL, FALSE);
 
 // gstreamer on OS X does not call the callback upon initialization (see bgo#680917)
 #ifdef __APPLE__
@@ -358,18 +427,36 @@ _bp_pipeline_construct (BansheePlayer *player)
     g_return_val_if_fail (audiosinkqueue != NULL, FALSE);
 
     player->equalizer = _bp_equalizer_new (player);
-    player->preamp = NULL;
-    if (player->equalizer != NULL) {
+
+    // Room correction does not depend on the equalizer; it is a passthrough
+    // until an impulse response is loaded and converts to float only then
+    player->convolver = gst_element_factory_make ("banshee-convolver", "convolver");
+
+    if (player->equalizer != NULL || player->convolver != NULL) {
         eq_audioconvert = gst_element_factory_make ("audioconvert", "audioconvert");
         eq_audioconvert2 = gst_element_factory_make ("audioconvert", "audioconvert2");
-        player->preamp = gst_element_factory_make ("volume", "preamp");
+    }
+
+    if (player->equalizer != NULL) {
+        // Pins the equalizer to float from the first boosted or cut band
+        // until the stream restarts, see bp_equalizer_update_float_path
+        player->eq_capsfilter = gst_element_factory_make ("capsfilter", "eq_capsfilter");
+        player->eq_float_path = FALSE;
     }
 
     // Add elements to custom audio sink
-    gst_bin_add_many (GST_BIN (player->audiobin), player->audiotee, player->volume, audiosinkqueue, audiosink, NULL);
+    gst_bin_add_many (GST_BIN (player->audiobin), player->audiotee, player->gain, audiosinkqueue, audiosink, NULL);
+
+    if (eq_audioconvert != NULL) {
+        gst_bin_add_many (GST_BIN (player->audiobin), eq_audioconvert, eq_audioconvert2, NULL);
+    }
 
     if (player->equalizer != NULL) {
-        gst_bin_add_many (GST_BIN (player->audiobin), eq_audioconvert, eq_audioconvert2, player->equalizer, player->preamp, NULL);
+        gst_bin_add_many (GST_BIN (player->audiobin), player->eq_capsfilter, player->equalizer, NULL);
+    }
+
+    if (player->convolver != NULL) {
+        gst_bin_add (GST_BIN (player->audiobin), player->convolver);
     }
 
     // Ghost pad the audio bin so audio is passed from the bin into the tee
@@ -378,20 +465,29 @@ _bp_pipeline_construct (BansheePlayer *player)
     gst_object_unref (teepad);
 
     // Link the queue and the actual audio sink
-    if (player->equalizer != NULL) {
-        // link in equalizer, preamp and audioconvert.
-        gst_element_link_many (audiosinkqueue, eq_audioconvert, player->preamp, 
-            player->equalizer, eq_audioconvert2, player->volume, audiosink, NULL);
+    if (eq_audioconvert != NULL) {
+        GstElement *last = eq_audioconvert;
+
+        // link in equalizer, convolver, gain and audioconvert.
+        gst_element_link (audiosinkqueue, eq_audioconvert);
+        if (player->equalizer != NULL) {
+            gst_element_link_many (eq_audioconvert, player->eq_capsfilter, player->equalizer, NULL);
+            last = player->equalizer;
+        }
+        if (player->convolver != NULL) {
+            gst_element_link (last, player->convolver);
+            last = player->convolver;
+        }
+        gst_element_link_many (last, player->gain, eq_audioconvert2, audiosink, NULL);
     } else {
         // link the queue with the real audio sink
-        gst_element_link_many (audiosinkqueue, player->volume, audiosink, NULL);
+        gst_element_link_many (audiosinkqueue, player->gain, audiosink, NULL);
     }
-    player->before_rgvolume = player->volume;
-    player->after_rgvolume = player->audiosink = audiosink;
-    player->rgvolume_in_pipeline = FALSE;
-    _bp_replaygain_pipeline_rebuild (player);
+    player->audiosink = audiosink;
+    _bp_replaygain_pipeline_setup (player);
 
     _bp_vis_pipeline_setup (player);
+    _bp_metrics_pipeline_setup (player);
 
     // Now that our internal audio sink is constructed, tell playbin to use it
     g_object_set (G_OBJECT (player->playbin), "audio-sink", player->audiobin, NULL);
@@ -411,6 +507,7 @@ _bp_pipeline_construct (BansheePlayer *player)
     _bp_cdda_pipeline_setup (player);
     _bp_dvd_pipeline_setup (player);
     _bp_video_pipeline_setup (player, bus);
+    _bp_metrics_video_setup (player);
     _bp_dvd_find_navigation (player);
 
     return TRUE;
@@ -438,6 +535,7 @@ _bp_pipeline_destroy (BansheePlayer *player)
     }
 
     _bp_vis_pipeline_destroy (player);
+    _bp_metrics_pipeline_destroy (player);
 
     player->playbin = NULL;
 }
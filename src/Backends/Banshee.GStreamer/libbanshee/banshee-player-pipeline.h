@@ -34,5 +34,6 @@
 gboolean  _bp_pipeline_construct (BansheePlayer *player);
 void      _bp_pipeline_destroy   (BansheePlayer *player);
 void      _bp_pipeline_rebuild   (BansheePlayer* player);
+void      _bp_pipeline_set_audiosink (BansheePlayer *player, const gchar *description);
 
 #endif /* _BANSHEE_PLAYER_PIPELINE_H */
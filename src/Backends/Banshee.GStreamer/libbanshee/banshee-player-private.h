@@ -38,6 +38,7 @@
 #include <string.h>
 #include <gst/gst.h>
 #include <gst/base/gstadapter.h>
+#include <gst/audio/audio.h>
 #include <gdk/gdk.h>
 #include <gst/fft/gstfftf32.h>
 #include <gst/pbutils/pbutils.h>
@@ -86,6 +87,7 @@
 #endif
 
 typedef struct BansheePlayer BansheePlayer;
+typedef struct BpMetricsState BpMetricsState;
 
 typedef void (* BansheePlayerEosCallback)          (BansheePlayer *player);
 typedef void (* BansheePlayerErrorCallback)        (BansheePlayer *player, GQuark domain, gint code, 
@@ -130,16 +132,14 @@ struct BansheePlayer {
     GstElement *audiotee;
     GstElement *audiobin;
     GstElement *equalizer;
-    GstElement *preamp;
-    GstElement *volume;
-    GstElement *rgvolume;
+    GstElement *eq_capsfilter;
+    GstElement *convolver;
+    GstElement *gain;
     GstElement *audiosink;
-
-    GstElement *before_rgvolume;
-    GstElement *after_rgvolume;
-    gboolean   rgvolume_in_pipeline;
+    gchar *audiosink_description;
 
     gint equalizer_status;
+    gboolean eq_float_path;
     gdouble current_volume;
     
     // Pipeline/Playback State
@@ -151,6 +151,7 @@ struct BansheePlayer {
     gchar *dvd_device;
     gboolean in_gapless_transition;
     gboolean audiosink_has_volume;
+    gboolean seek_pending;
     
     // Video State
     BpVideoDisplayContextType video_display_context_type;
@@ -199,11 +200,18 @@ struct BansheePlayer {
     // http://replaygain.hydrogenaudio.org/player_scale.html
     gdouble rg_gain_history[10];
     gint history_size;
-    gulong rg_pad_block_id;
+
+    // Gain measured by the ReplayGain scanner for the current stream, if
+    // any; takes precedence over the history average as fallback gain.
+    gboolean rg_have_scanned_gain;
+    gdouble rg_scanned_gain;
 
     //dvd navigation
     GstNavigation *navigation;
     gboolean is_menu;
+
+    // Latency Metrics
+    BpMetricsState *metrics;
 };
 
 #endif /* _BANSHEE_PLAYER_PRIVATE_H */
@@ -31,6 +31,7 @@
 #include <math.h>
 #include "banshee-player-replaygain.h"
 #include "banshee-player-pipeline.h"
+#include "banshee-replaygain-scanner.h"
 
 // ---------------------------------------------------------------------------
 // Private Functions
@@ -64,106 +65,85 @@ static void bp_replaygain_update_history (BansheePlayer *player)
         player->history_size++;
     }
 
-    g_object_get (G_OBJECT (player->rgvolume), "target-gain", &gain, NULL);
+    g_object_get (G_OBJECT (player->gain), "target-gain", &gain, NULL);
     player->rg_gain_history[0] = gain;
     bp_debug2 ("[ReplayGain] Added gain: %.2f to history.", gain);
 
-    g_object_set (G_OBJECT (player->rgvolume), "fallback-gain", bp_rg_calc_history_avg (player), NULL);
+    if (!player->rg_have_scanned_gain) {
+        g_object_set (G_OBJECT (player->gain), "fallback-gain", bp_rg_calc_history_avg (player), NULL);
+    }
 }
 
-static void on_target_gain_changed (GstElement *rgvolume, GParamSpec *pspec, BansheePlayer *player)
+// Untagged tracks get their scanned gain, or the history average when the
+// scanner has not seen them, never the scanned gain of an earlier track
+static void
+bp_replaygain_apply_scanned_gain (BansheePlayer *player)
 {
-    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    if (player->gain == NULL) {
+        return;
+    }
 
-    bp_replaygain_update_history (player);
-    _bp_rgvolume_print_volume (player);
+    if (player->rg_have_scanned_gain) {
+        bp_debug2 ("[ReplayGain] Using scanned gain: %.2f", player->rg_scanned_gain);
+        g_object_set (G_OBJECT (player->gain), "fallback-gain", player->rg_scanned_gain, NULL);
+    } else {
+        g_object_set (G_OBJECT (player->gain), "fallback-gain", bp_rg_calc_history_avg (player), NULL);
+    }
 }
 
 static GstPadProbeReturn
-pad_block_cb (GstPad *srcPad, GstPadProbeInfo *info, gpointer user_data)
+bp_replaygain_stream_start_probe (GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
 {
-    BansheePlayer* player;
+    BansheePlayer *player = (BansheePlayer *) user_data;
+    GstEvent *event = GST_PAD_PROBE_INFO_EVENT (info);
+    gboolean album_mode = TRUE;
+    gchar *uri = NULL;
 
-    player = (BansheePlayer*) user_data;
     g_return_val_if_fail (IS_BANSHEE_PLAYER (player), GST_PAD_PROBE_OK);
 
-    // The pad_block_cb can get triggered multiple times, on different threads.
-    // Lock around the link/unlink code, so we don't end up going through here
-    // with inconsistent state.
-    g_mutex_lock (player->replaygain_mutex);
-
-    if ((player->replaygain_enabled && player->rgvolume_in_pipeline) ||
-        (!player->replaygain_enabled && !player->rgvolume_in_pipeline)) {
-        // The pipeline is already in the correct state.  Unblock the pad, and return.
-        player->rg_pad_block_id = 0;
-        g_mutex_unlock (player->replaygain_mutex);
-        return GST_PAD_PROBE_REMOVE;
+    if (GST_EVENT_TYPE (event) != GST_EVENT_STREAM_START) {
+        return GST_PAD_PROBE_OK;
     }
 
-    if (player->rgvolume_in_pipeline) {
-        gst_element_unlink (player->before_rgvolume, player->rgvolume);
-        gst_element_unlink (player->rgvolume, player->after_rgvolume);
-    } else {
-        gst_element_unlink (player->before_rgvolume, player->after_rgvolume);
-    }
+    // Look up the new stream in the scanner results before any of its
+    // samples reach the gain stage, so untagged tracks never need to fall back
+    // to the history average
+    g_object_get (G_OBJECT (player->playbin), "current-uri", &uri, NULL);
 
-    if (player->replaygain_enabled) {
-        player->rgvolume = _bp_rgvolume_new (player);
-        if (!GST_IS_ELEMENT (player->rgvolume)) {
-            player->replaygain_enabled = FALSE;
-        }
-    } else {
-        gst_element_set_state (player->rgvolume, GST_STATE_NULL);
-        gst_bin_remove (GST_BIN (player->audiobin), player->rgvolume);
-    }
-
-    if (player->replaygain_enabled && GST_IS_ELEMENT (player->rgvolume)) {
-        g_signal_connect (player->rgvolume, "notify::target-gain", G_CALLBACK (on_target_gain_changed), player);
-        gst_bin_add (GST_BIN (player->audiobin), player->rgvolume);
-        gst_element_sync_state_with_parent (player->rgvolume);
+    g_mutex_lock (player->replaygain_mutex);
 
-        // link in rgvolume and connect to the real audio sink
-        gst_element_link (player->before_rgvolume, player->rgvolume);
-        gst_element_link (player->rgvolume, player->after_rgvolume);
-        player->rgvolume_in_pipeline = TRUE;
-    } else {
-        // link the queue with the real audio sink
-        gst_element_link (player->before_rgvolume, player->after_rgvolume);
-        player->rgvolume_in_pipeline = FALSE;
+    if (player->gain != NULL) {
+        g_object_get (G_OBJECT (player->gain), "album-mode", &album_mode, NULL);
     }
 
-    // Our state is now consistent
-    player->rg_pad_block_id = 0;
+    player->rg_have_scanned_gain = brg_store_lookup (uri, album_mode, &player->rg_scanned_gain, NULL);
+    bp_replaygain_apply_scanned_gain (player);
+
     g_mutex_unlock (player->replaygain_mutex);
 
-    _bp_rgvolume_print_volume (player);
+    g_free (uri);
+    return GST_PAD_PROBE_OK;
+}
 
-    return GST_PAD_PROBE_REMOVE;
+static void on_target_gain_changed (GstElement *gain, GParamSpec *pspec, BansheePlayer *player)
+{
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+
+    bp_replaygain_update_history (player);
+    _bp_rgvolume_print_volume (player);
 }
 
 // ---------------------------------------------------------------------------
 // Internal Functions
 // ---------------------------------------------------------------------------
 
-
-GstElement* _bp_rgvolume_new (BansheePlayer *player)
-{
-    GstElement *rgvolume = gst_element_factory_make ("rgvolume", NULL);
-
-    if (rgvolume == NULL) {
-        bp_debug ("Loading ReplayGain plugin failed.");
-    }
-
-    return rgvolume;
-}
-
 void _bp_rgvolume_print_volume(BansheePlayer *player)
 {
     g_return_if_fail (IS_BANSHEE_PLAYER (player));
-    if (player->replaygain_enabled && (player->rgvolume != NULL)) {
+    if (player->replaygain_enabled && (player->gain != NULL)) {
         gdouble scale;
 
-        g_object_get (G_OBJECT (player->rgvolume), "result-gain", &scale, NULL);
+        g_object_get (G_OBJECT (player->gain), "result-gain", &scale, NULL);
 
         bp_debug4 ("scaled volume: %.2f (ReplayGain) * %.2f (User) = %.2f",
                   bp_replaygain_db_to_linear (scale), player->current_volume,
@@ -171,19 +151,23 @@ void _bp_rgvolume_print_volume(BansheePlayer *player)
     }
 }
 
-void _bp_replaygain_pipeline_rebuild (BansheePlayer* player)
+void _bp_replaygain_pipeline_setup (BansheePlayer *player)
 {
-    GstPad* srcPad;
+    GstPad *sinkPad;
 
     g_return_if_fail (IS_BANSHEE_PLAYER (player));
-    g_return_if_fail (GST_IS_ELEMENT (player->before_rgvolume));
-    srcPad = gst_element_get_static_pad (player->before_rgvolume, "src");
-
-    if (gst_pad_is_active (srcPad) && !gst_pad_is_blocked (srcPad)) {
-        player->rg_pad_block_id = gst_pad_add_probe (srcPad, GST_PAD_PROBE_TYPE_BLOCK_DOWNSTREAM, &pad_block_cb, player, NULL);
-    } else if (!player->rg_pad_block_id) {
-        pad_block_cb (srcPad, NULL, player);
-    }
+    g_return_if_fail (GST_IS_ELEMENT (player->gain));
+
+    // The gain stage stays linked for the lifetime of the pipeline; toggling
+    // ReplayGain only flips its "enabled" property, which ramps the gain in
+    // the streaming thread without blocking or relinking any pad.
+    g_object_set (G_OBJECT (player->gain), "enabled", player->replaygain_enabled, NULL);
+    g_signal_connect (player->gain, "notify::target-gain", G_CALLBACK (on_target_gain_changed), player);
+
+    sinkPad = gst_element_get_static_pad (player->gain, "sink");
+    gst_pad_add_probe (sinkPad, GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM,
+        bp_replaygain_stream_start_probe, player, NULL);
+    gst_object_unref (sinkPad);
 }
 
 // ---------------------------------------------------------------------------
@@ -196,7 +180,12 @@ bp_replaygain_set_enabled (BansheePlayer *player, gboolean enabled)
     g_return_if_fail (IS_BANSHEE_PLAYER (player));
     player->replaygain_enabled = enabled;
     bp_debug2 ("%s ReplayGain", enabled ? "Enabled" : "Disabled");
-    _bp_replaygain_pipeline_rebuild (player);
+
+    if (player->gain != NULL) {
+        g_object_set (G_OBJECT (player->gain), "enabled", enabled, NULL);
+    }
+
+    _bp_rgvolume_print_volume (player);
 }
 
 P_INVOKE gboolean
@@ -77,6 +77,8 @@ bp_vis_pcm_handoff (GstElement *sink, GstBuffer *buffer, GstPad *pad, gpointer u
     
     wanted_size = channels * SLICE_SIZE * sizeof (gfloat);
 
+    BANSHEE_TRACE_BEGIN ("vis", "pcm-handoff");
+
     gst_adapter_push (player->vis_buffer, gst_buffer_ref (buffer));
     
     while ((data = (gfloat *)gst_adapter_map (player->vis_buffer, wanted_size)) != NULL) {
@@ -130,6 +132,8 @@ bp_vis_pcm_handoff (GstElement *sink, GstBuffer *buffer, GstPad *pad, gpointer u
         gst_adapter_unmap (player->vis_buffer);
         gst_adapter_flush (player->vis_buffer, wanted_size);
     }
+
+    BANSHEE_TRACE_END ("vis", "pcm-handoff");
 }
 
 // ---------------------------------------------------------------------------
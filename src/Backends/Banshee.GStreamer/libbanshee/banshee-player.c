@@ -32,6 +32,8 @@
 #include "banshee-player-pipeline.h"
 #include "banshee-player-cdda.h"
 #include "banshee-player-dvd.h"
+#include "banshee-player-equalizer.h"
+#include "banshee-player-metrics.h"
 #include "banshee-player-missing-elements.h"
 #include "banshee-player-replaygain.h"
 
@@ -45,8 +47,10 @@ bp_pipeline_set_state (BansheePlayer *player, GstState state)
     g_return_if_fail (IS_BANSHEE_PLAYER (player));
     
     if (GST_IS_ELEMENT (player->playbin)) {
+        BANSHEE_TRACE_BEGIN ("player", "set-state");
         player->target_state = state;
         gst_element_set_state (player->playbin, state);
+        BANSHEE_TRACE_END ("player", "set-state");
     }
 }
 
@@ -115,9 +119,12 @@ bp_destroy (BansheePlayer *player)
     if (player->dvd_device != NULL) {
         g_free (player->dvd_device);
     }
+
+    g_free (player->audiosink_description);
     
     _bp_pipeline_destroy (player);
     _bp_missing_elements_destroy (player);
+    _bp_metrics_free (player->metrics);
     
     memset (player, 0, sizeof (BansheePlayer));
     
@@ -134,6 +141,7 @@ bp_new ()
     
     player->video_mutex = g_mutex_new ();
     player->replaygain_mutex = g_mutex_new ();
+    player->metrics = _bp_metrics_new ();
 
     return player;
 }
@@ -147,13 +155,22 @@ bp_initialize_pipeline (BansheePlayer *player)
 P_INVOKE gboolean
 bp_open (BansheePlayer *player, const gchar *uri, gboolean maybe_video)
 {
+    gint64 started = g_get_monotonic_time ();
     GstState state;
     
     g_return_val_if_fail (IS_BANSHEE_PLAYER (player), FALSE);
     
     // Build the pipeline if we need to
-    if (player->playbin == NULL && !_bp_pipeline_construct (player)) {
-        return FALSE;
+    if (player->playbin == NULL) {
+        gboolean constructed;
+
+        BANSHEE_TRACE_BEGIN ("player", "pipeline-construct");
+        constructed = _bp_pipeline_construct (player);
+        BANSHEE_TRACE_END ("player", "pipeline-construct");
+
+        if (!constructed) {
+            return FALSE;
+        }
     }
 
     // Give the CDDA code a chance to intercept the open request
@@ -165,6 +182,10 @@ bp_open (BansheePlayer *player, const gchar *uri, gboolean maybe_video)
     } else if (player->playbin == NULL) {
         return FALSE;
     }
+
+    // Ends when the stream starts, see bp_pipeline_bus_callback
+    BANSHEE_TRACE_ASYNC_BEGIN ("player", "open", player);
+    BANSHEE_TRACE_BEGIN ("player", "bp_open");
     
     // Set the pipeline to the proper state
     gst_element_get_state (player->playbin, &state, NULL, 0);
@@ -172,6 +193,9 @@ bp_open (BansheePlayer *player, const gchar *uri, gboolean maybe_video)
         player->target_state = GST_STATE_READY;
         gst_element_set_state (player->playbin, GST_STATE_READY);
     }
+
+    _bp_equalizer_release_float_path (player);
+    _bp_metrics_open (player, started);
     
     // Pass the request off to playbin
     g_object_set (G_OBJECT (player->playbin), "uri", uri, NULL);
@@ -182,6 +206,8 @@ bp_open (BansheePlayer *player, const gchar *uri, gboolean maybe_video)
     }
 
     player->in_gapless_transition = FALSE;
+
+    BANSHEE_TRACE_END ("player", "bp_open");
     
     return TRUE;
 }
@@ -202,8 +228,15 @@ bp_stop (BansheePlayer *player, gboolean nullstate)
         state == GST_STATE_NULL ? "GST_STATE_NULL" : "GST_STATE_PAUSED");
     
     player->in_gapless_transition = FALSE;
+
+    // A seek still in flight never completes
+    if (player->seek_pending) {
+        player->seek_pending = FALSE;
+        BANSHEE_TRACE_ASYNC_END ("player", "seek", player);
+    }
     
     bp_pipeline_set_state (player, state);
+    _bp_equalizer_release_float_path (player);
 }
 
 P_INVOKE void
@@ -241,13 +274,30 @@ bp_set_position (BansheePlayer *player, guint64 time_ms, gboolean accurate_seek)
         seek_flag |= GST_SEEK_FLAG_ACCURATE;
     }
 
-    if (player->playbin == NULL || !gst_element_seek (player->playbin, 1.0, 
+    if (player->playbin == NULL) {
+        g_warning ("Could not seek in stream");
+        return FALSE;
+    }
+
+    // Ends when the flushing seek completes, see bp_pipeline_bus_callback
+    player->seek_pending = TRUE;
+    BANSHEE_TRACE_ASYNC_BEGIN ("player", "seek", player);
+    BANSHEE_TRACE_BEGIN ("player", "bp_set_position");
+    _bp_metrics_seek (player, g_get_monotonic_time ());
+
+    if (!gst_element_seek (player->playbin, 1.0, 
         GST_FORMAT_TIME, seek_flag,
         GST_SEEK_TYPE_SET, time_ms * GST_MSECOND, 
         GST_SEEK_TYPE_NONE, GST_CLOCK_TIME_NONE)) {
+        BANSHEE_TRACE_END ("player", "bp_set_position");
+        BANSHEE_TRACE_ASYNC_END ("player", "seek", player);
+        player->seek_pending = FALSE;
+        _bp_metrics_seek_failed (player);
         g_warning ("Could not seek in stream");
         return FALSE;
     }
+
+    BANSHEE_TRACE_END ("player", "bp_set_position");
     
     return TRUE;
 }
@@ -335,7 +385,7 @@ bp_set_volume (BansheePlayer *player, gdouble volume)
     if (player->audiosink_has_volume) {
       v = player->playbin;
     } else {
-      v = player->volume;
+      v = player->gain;
     }
 
     g_return_if_fail (GST_IS_ELEMENT(v));
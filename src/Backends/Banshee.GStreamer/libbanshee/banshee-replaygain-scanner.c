@@ -0,0 +1,989 @@
+//
+// banshee-replaygain-scanner.c
+//
+// Copyright (C) 2026 Banshee Project Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <math.h>
+#include <string.h>
+#include <glib/gi18n.h>
+#include <glib/gstdio.h>
+#include <gst/gst.h>
+#include <gst/audio/audio.h>
+
+#include "banshee-gst.h"
+#include "banshee-replaygain-scanner.h"
+
+// Loudness is measured following EBU R128 / ITU-R BS.1770: K-weighted mean
+// square over 400 ms blocks overlapping by 75%, gated at -70 LUFS and then
+// at 10 LU below the ungated mean. Gated blocks are kept in a histogram so
+// album loudness can be computed exactly by merging the track histograms.
+#define BRG_ABSOLUTE_GATE       -70.0
+#define BRG_RELATIVE_GATE       -10.0
+#define BRG_REFERENCE_LOUDNESS  -18.0   // ReplayGain 2.0 reference level
+#define BRG_HISTOGRAM_STEP        0.1
+#define BRG_HISTOGRAM_BINS       1000   // -70 LUFS .. +30 LUFS
+#define BRG_SUB_BLOCKS            4     // 4 x 100 ms = one gating block
+#define BRG_MAX_CHANNELS          8
+
+typedef struct {
+    gdouble b0, b1, b2;
+    gdouble a1, a2;
+} BrgBiquad;
+
+typedef struct {
+    guint32 histogram[BRG_HISTOGRAM_BINS];
+    gdouble peak;
+} BrgLoudness;
+
+typedef struct {
+    gchar *key;
+    gint pending;
+    gboolean analyzed;
+    BrgLoudness loudness;
+    GSList *uris;
+} BrgAlbum;
+
+typedef struct {
+    BansheeReplayGainScanner *scanner;
+    gchar *uri;
+    BrgAlbum *album;
+    gint generation;
+
+    // Analysis state, only touched from the job's streaming thread
+    gint rate;
+    gint channels;
+    BrgBiquad shelf;
+    BrgBiquad highpass;
+    gdouble state[BRG_MAX_CHANNELS][4];
+    gdouble sub_blocks[BRG_SUB_BLOCKS];
+    guint sub_block_count;
+    guint sub_block_frames;
+    guint sub_block_position;
+    gdouble sub_block_sum;
+    BrgLoudness loudness;
+
+    gchar *error;
+    gchar *debug;
+} BrgJob;
+
+typedef enum {
+    BRG_EVENT_TRACK,
+    BRG_EVENT_ALBUM,
+    BRG_EVENT_ERROR,
+    BRG_EVENT_FINISHED
+} BrgEventType;
+
+typedef struct {
+    BrgEventType type;
+    gchar *name;
+    gdouble gain;
+    gdouble peak;
+    gchar *error;
+    gchar *debug;
+} BrgEvent;
+
+struct BansheeReplayGainScanner {
+    gint max_workers;
+
+    // Cancelling starts a new generation; jobs started in an older one
+    // bail out, while jobs started after the cancel run normally
+    volatile gint generation;
+
+    GThreadPool *pool;
+    GMutex *lock;
+    GSList *queued_jobs;
+    GHashTable *albums;
+    guint pending_jobs;
+    gboolean is_scanning;
+
+    GQueue *events;
+    guint event_source_id;
+
+    BansheeReplayGainScannerTrackCallback track_cb;
+    BansheeReplayGainScannerAlbumCallback album_cb;
+    BansheeReplayGainScannerFinishedCallback finished_cb;
+    BansheeReplayGainScannerErrorCallback error_cb;
+};
+
+typedef struct {
+    gdouble track_gain;
+    gdouble track_peak;
+    gdouble album_gain;
+    gdouble album_peak;
+    gboolean has_album;
+} BrgStoreEntry;
+
+static GstStaticCaps brg_analysis_caps = GST_STATIC_CAPS (
+    "audio/x-raw, "
+    "format = (string) " GST_AUDIO_NE(F32) ", "
+    "layout = (string) interleaved"
+);
+
+G_LOCK_DEFINE_STATIC (brg_store);
+static GHashTable *brg_store = NULL;
+
+// ---------------------------------------------------------------------------
+// Private Functions
+// ---------------------------------------------------------------------------
+
+static BrgStoreEntry *
+brg_store_get_entry (const gchar *uri)
+{
+    BrgStoreEntry *entry;
+
+    if (brg_store == NULL) {
+        brg_store = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+    }
+
+    entry = g_hash_table_lookup (brg_store, uri);
+    if (entry == NULL) {
+        entry = g_new0 (BrgStoreEntry, 1);
+        g_hash_table_insert (brg_store, g_strdup (uri), entry);
+    }
+
+    return entry;
+}
+
+static void
+brg_store_set_track (const gchar *uri, gdouble gain, gdouble peak)
+{
+    BrgStoreEntry *entry;
+
+    G_LOCK (brg_store);
+    entry = brg_store_get_entry (uri);
+    entry->track_gain = gain;
+    entry->track_peak = peak;
+    G_UNLOCK (brg_store);
+}
+
+static void
+brg_store_set_album (const gchar *uri, gdouble gain, gdouble peak)
+{
+    BrgStoreEntry *entry;
+
+    G_LOCK (brg_store);
+    entry = brg_store_get_entry (uri);
+    entry->album_gain = gain;
+    entry->album_peak = peak;
+    entry->has_album = TRUE;
+    G_UNLOCK (brg_store);
+}
+
+static gdouble
+brg_energy_to_loudness (gdouble energy)
+{
+    return -0.691 + 10.0 * log10 (energy);
+}
+
+static gdouble
+brg_histogram_bin_energy (gint bin)
+{
+    gdouble loudness = BRG_ABSOLUTE_GATE + (bin + 0.5) * BRG_HISTOGRAM_STEP;
+    return pow (10.0, (loudness + 0.691) / 10.0);
+}
+
+static void
+brg_loudness_add_block (BrgLoudness *loudness, gdouble energy)
+{
+    gdouble lufs;
+    gint bin;
+
+    if (energy <= 0.0) {
+        return;
+    }
+
+    lufs = brg_energy_to_loudness (energy);
+    if (lufs < BRG_ABSOLUTE_GATE) {
+        return;
+    }
+
+    bin = (gint)((lufs - BRG_ABSOLUTE_GATE) / BRG_HISTOGRAM_STEP);
+    loudness->histogram[MIN (bin, BRG_HISTOGRAM_BINS - 1)]++;
+}
+
+static void
+brg_loudness_merge (BrgLoudness *dest, const BrgLoudness *src)
+{
+    gint i;
+
+    for (i = 0; i < BRG_HISTOGRAM_BINS; i++) {
+        dest->histogram[i] += src->histogram[i];
+    }
+
+    dest->peak = MAX (dest->peak, src->peak);
+}
+
+static gboolean
+brg_loudness_get_integrated (const BrgLoudness *loudness, gdouble *lufs)
+{
+    gdouble sum = 0.0;
+    guint64 count = 0;
+    gdouble gate;
+    gint i, gate_bin;
+
+    for (i = 0; i < BRG_HISTOGRAM_BINS; i++) {
+        sum += loudness->histogram[i] * brg_histogram_bin_energy (i);
+        count += loudness->histogram[i];
+    }
+
+    if (count == 0) {
+        return FALSE;
+    }
+
+    gate = brg_energy_to_loudness (sum / count) + BRG_RELATIVE_GATE;
+    gate_bin = (gint)ceil ((gate - BRG_ABSOLUTE_GATE) / BRG_HISTOGRAM_STEP - 0.5);
+
+    sum = 0.0;
+    count = 0;
+    for (i = MAX (gate_bin, 0); i < BRG_HISTOGRAM_BINS; i++) {
+        sum += loudness->histogram[i] * brg_histogram_bin_energy (i);
+        count += loudness->histogram[i];
+    }
+
+    if (count == 0) {
+        return FALSE;
+    }
+
+    *lufs = brg_energy_to_loudness (sum / count);
+    return TRUE;
+}
+
+// K-weighting pre-filter (high shelf followed by a high pass), with the
+// BS.1770 coefficients re-derived for the stream's sample rate
+static void
+brg_job_setup_filters (BrgJob *job)
+{
+    gdouble f0, q, k, vh, vb, a0;
+
+    f0 = 1681.974450955533;
+    q = 0.7071752369554196;
+    k = tan (G_PI * f0 / job->rate);
+    vh = pow (10.0, 3.999843853973347 / 20.0);
+    vb = pow (vh, 0.4996667741545416);
+    a0 = 1.0 + k / q + k * k;
+
+    job->shelf.b0 = (vh + vb * k / q + k * k) / a0;
+    job->shelf.b1 = 2.0 * (k * k - vh) / a0;
+    job->shelf.b2 = (vh - vb * k / q + k * k) / a0;
+    job->shelf.a1 = 2.0 * (k * k - 1.0) / a0;
+    job->shelf.a2 = (1.0 - k / q + k * k) / a0;
+
+    f0 = 38.13547087602444;
+    q = 0.5003270373238773;
+    k = tan (G_PI * f0 / job->rate);
+    a0 = 1.0 + k / q + k * k;
+
+    job->highpass.b0 = 1.0;
+    job->highpass.b1 = -2.0;
+    job->highpass.b2 = 1.0;
+    job->highpass.a1 = 2.0 * (k * k - 1.0) / a0;
+    job->highpass.a2 = (1.0 - k / q + k * k) / a0;
+
+    memset (job->state, 0, sizeof (job->state));
+    memset (job->sub_blocks, 0, sizeof (job->sub_blocks));
+    job->sub_block_count = 0;
+    job->sub_block_position = 0;
+    job->sub_block_sum = 0.0;
+    job->sub_block_frames = MAX (job->rate / 10, 1);
+}
+
+static inline gdouble
+brg_biquad_process (const BrgBiquad *bq, gdouble *z, gdouble x)
+{
+    gdouble y = bq->b0 * x + z[0];
+    z[0] = bq->b1 * x - bq->a1 * y + z[1];
+    z[1] = bq->b2 * x - bq->a2 * y;
+    return y;
+}
+
+static void
+brg_job_push_sub_block (BrgJob *job)
+{
+    gdouble energy = 0.0;
+    gint i;
+
+    job->sub_blocks[job->sub_block_count % BRG_SUB_BLOCKS] = job->sub_block_sum / job->sub_block_frames;
+    job->sub_block_count++;
+    job->sub_block_sum = 0.0;
+    job->sub_block_position = 0;
+
+    if (job->sub_block_count < BRG_SUB_BLOCKS) {
+        return;
+    }
+
+    for (i = 0; i < BRG_SUB_BLOCKS; i++) {
+        energy += job->sub_blocks[i];
+    }
+
+    brg_loudness_add_block (&job->loudness, energy / BRG_SUB_BLOCKS);
+}
+
+static gboolean
+brg_job_is_cancelled (BrgJob *job)
+{
+    return job->generation != g_atomic_int_get (&job->scanner->generation);
+}
+
+static void
+brg_job_handoff (GstElement *sink, GstBuffer *buffer, GstPad *pad, gpointer userdata)
+{
+    BrgJob *job = (BrgJob *)userdata;
+    GstAudioInfo info;
+    GstCaps *caps;
+    GstMapInfo map;
+    const gfloat *data;
+    gsize i, frames;
+    gint c, channels;
+
+    if (brg_job_is_cancelled (job)) {
+        return;
+    }
+
+    caps = gst_pad_get_current_caps (pad);
+    if (caps == NULL) {
+        return;
+    }
+
+    if (!gst_audio_info_from_caps (&info, caps)) {
+        gst_caps_unref (caps);
+        return;
+    }
+    gst_caps_unref (caps);
+
+    if (GST_AUDIO_INFO_RATE (&info) != job->rate || GST_AUDIO_INFO_CHANNELS (&info) != job->channels) {
+        job->rate = GST_AUDIO_INFO_RATE (&info);
+        job->channels = GST_AUDIO_INFO_CHANNELS (&info);
+        brg_job_setup_filters (job);
+    }
+
+    if (!gst_buffer_map (buffer, &map, GST_MAP_READ)) {
+        return;
+    }
+
+    data = (const gfloat *)map.data;
+    channels = job->channels;
+    frames = map.size / (sizeof (gfloat) * channels);
+
+    for (i = 0; i < frames; i++) {
+        for (c = 0; c < channels; c++) {
+            gdouble sample = data[i * channels + c];
+            gdouble weighted;
+
+            job->loudness.peak = MAX (job->loudness.peak, fabs (sample));
+
+            // Every channel gets a weight of 1.0; BS.1770 weights the
+            // surround channels by 1.41, which only matters for 5.1 content
+            if (c < BRG_MAX_CHANNELS) {
+                weighted = brg_biquad_process (&job->shelf, &job->state[c][0], sample);
+                weighted = brg_biquad_process (&job->highpass, &job->state[c][2], weighted);
+                job->sub_block_sum += weighted * weighted;
+            }
+        }
+
+        if (++job->sub_block_position == job->sub_block_frames) {
+            brg_job_push_sub_block (job);
+        }
+    }
+
+    gst_buffer_unmap (buffer, &map);
+}
+
+static void
+brg_job_pad_added (GstElement *decodebin, GstPad *pad, gpointer data)
+{
+    GstElement *convert = (GstElement *)data;
+    GstCaps *caps;
+    GstStructure *str;
+    GstPad *audiopad;
+
+    audiopad = gst_element_get_static_pad (convert, "sink");
+
+    if (GST_PAD_IS_LINKED (audiopad)) {
+        gst_object_unref (audiopad);
+        return;
+    }
+
+    caps = gst_pad_query_caps (pad, NULL);
+    str = gst_caps_get_structure (caps, 0);
+
+    if (!g_str_has_prefix (gst_structure_get_name (str), "audio/")) {
+        gst_caps_unref (caps);
+        gst_object_unref (audiopad);
+        return;
+    }
+
+    gst_caps_unref (caps);
+    gst_pad_link (pad, audiopad);
+    gst_object_unref (audiopad);
+}
+
+static void
+brg_job_analyze (BrgJob *job)
+{
+    GstElement *pipeline, *decoder, *convert, *resample, *filter, *sink;
+    GstCaps *caps;
+    GstBus *bus;
+    gboolean done = FALSE;
+
+    pipeline = gst_pipeline_new ("rgscanner");
+    decoder = gst_element_factory_make ("uridecodebin", NULL);
+    convert = gst_element_factory_make ("audioconvert", NULL);
+    resample = gst_element_factory_make ("audioresample", NULL);
+    filter = gst_element_factory_make ("capsfilter", NULL);
+    sink = gst_element_factory_make ("fakesink", NULL);
+
+    if (pipeline == NULL || decoder == NULL || convert == NULL ||
+        resample == NULL || filter == NULL || sink == NULL) {
+        job->error = g_strdup (_("Could not create ReplayGain analysis pipeline"));
+        if (pipeline != NULL) gst_object_unref (pipeline);
+        if (decoder != NULL) gst_object_unref (decoder);
+        if (convert != NULL) gst_object_unref (convert);
+        if (resample != NULL) gst_object_unref (resample);
+        if (filter != NULL) gst_object_unref (filter);
+        if (sink != NULL) gst_object_unref (sink);
+        return;
+    }
+
+    caps = gst_static_caps_get (&brg_analysis_caps);
+    g_object_set (G_OBJECT (filter), "caps", caps, NULL);
+    gst_caps_unref (caps);
+
+    g_object_set (G_OBJECT (decoder), "uri", job->uri, NULL);
+    g_object_set (G_OBJECT (sink), "signal-handoffs", TRUE, "sync", FALSE, NULL);
+
+    gst_bin_add_many (GST_BIN (pipeline), decoder, convert, resample, filter, sink, NULL);
+    gst_element_link_many (convert, resample, filter, sink, NULL);
+
+    g_signal_connect (decoder, "pad-added", G_CALLBACK (brg_job_pad_added), convert);
+    g_signal_connect (sink, "handoff", G_CALLBACK (brg_job_handoff), job);
+
+    // Each worker drives its own pipeline synchronously, so no main loop is
+    // needed on the pool threads; poll the bus so cancellation is noticed
+    bus = gst_element_get_bus (pipeline);
+    gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+    while (!done) {
+        GstMessage *message = gst_bus_timed_pop_filtered (bus, 100 * GST_MSECOND,
+            GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+
+        if (message == NULL) {
+            if (brg_job_is_cancelled (job)) {
+                job->error = g_strdup (_("ReplayGain analysis was cancelled"));
+                done = TRUE;
+            }
+            continue;
+        }
+
+        if (GST_MESSAGE_TYPE (message) == GST_MESSAGE_ERROR) {
+            GError *error;
+            gst_message_parse_error (message, &error, &job->debug);
+            job->error = g_strdup (error->message);
+            g_error_free (error);
+        }
+
+        gst_message_unref (message);
+        done = TRUE;
+    }
+
+    gst_element_set_state (pipeline, GST_STATE_NULL);
+    gst_object_unref (bus);
+    gst_object_unref (pipeline);
+}
+
+static void
+brg_job_free (BrgJob *job)
+{
+    g_free (job->uri);
+    g_free (job->error);
+    g_free (job->debug);
+    g_free (job);
+}
+
+static void
+brg_album_free (BrgAlbum *album)
+{
+    g_free (album->key);
+    g_slist_foreach (album->uris, (GFunc)g_free, NULL);
+    g_slist_free (album->uris);
+    g_free (album);
+}
+
+static void
+brg_event_free (BrgEvent *event)
+{
+    g_free (event->name);
+    g_free (event->error);
+    g_free (event->debug);
+    g_free (event);
+}
+
+static gboolean
+brg_scanner_dispatch_events (gpointer data)
+{
+    BansheeReplayGainScanner *scanner = (BansheeReplayGainScanner *)data;
+    BrgEvent *event;
+
+    g_mutex_lock (scanner->lock);
+    scanner->event_source_id = 0;
+
+    // Tracks started after the finished event was posted keep it scanning
+    scanner->is_scanning = scanner->pending_jobs > 0;
+
+    while ((event = g_queue_pop_head (scanner->events)) != NULL) {
+        g_mutex_unlock (scanner->lock);
+
+        switch (event->type) {
+            case BRG_EVENT_TRACK:
+                if (scanner->track_cb != NULL) {
+                    scanner->track_cb (scanner, event->name, event->gain, event->peak);
+                }
+                break;
+            case BRG_EVENT_ALBUM:
+                if (scanner->album_cb != NULL) {
+                    scanner->album_cb (scanner, event->name, event->gain, event->peak);
+                }
+                break;
+            case BRG_EVENT_ERROR:
+                if (scanner->error_cb != NULL) {
+                    scanner->error_cb (scanner, event->name, event->error, event->debug);
+                }
+                break;
+            case BRG_EVENT_FINISHED:
+                if (scanner->finished_cb != NULL) {
+                    scanner->finished_cb (scanner);
+                }
+                break;
+        }
+
+        brg_event_free (event);
+        g_mutex_lock (scanner->lock);
+    }
+
+    g_mutex_unlock (scanner->lock);
+    return FALSE;
+}
+
+// Called with scanner->lock held; results are handed to the main loop so
+// callbacks run on the same thread as the rest of the libbanshee callbacks
+static void
+brg_scanner_post_event (BansheeReplayGainScanner *scanner, BrgEventType type, const gchar *name,
+    gdouble gain, gdouble peak, const gchar *error, const gchar *debug)
+{
+    BrgEvent *event = g_new0 (BrgEvent, 1);
+
+    event->type = type;
+    event->name = g_strdup (name);
+    event->gain = gain;
+    event->peak = peak;
+    event->error = g_strdup (error);
+    event->debug = g_strdup (debug);
+
+    g_queue_push_tail (scanner->events, event);
+
+    if (scanner->event_source_id == 0) {
+        scanner->event_source_id = g_idle_add (brg_scanner_dispatch_events, scanner);
+    }
+}
+
+static void
+brg_scanner_finish_job (BansheeReplayGainScanner *scanner, BrgJob *job)
+{
+    gdouble lufs;
+    gboolean analyzed = FALSE;
+
+    if (job->error == NULL) {
+        if (brg_loudness_get_integrated (&job->loudness, &lufs)) {
+            analyzed = TRUE;
+        } else {
+            job->error = g_strdup (_("Not enough audio to compute ReplayGain"));
+        }
+    }
+
+    g_mutex_lock (scanner->lock);
+
+    if (analyzed) {
+        gdouble gain = BRG_REFERENCE_LOUDNESS - lufs;
+
+        banshee_log_debug ("rgscanner", "%s: %.2f LUFS, gain %.2f dB, peak %.6f",
+            job->uri, lufs, gain, job->loudness.peak);
+
+        brg_store_set_track (job->uri, gain, job->loudness.peak);
+        brg_scanner_post_event (scanner, BRG_EVENT_TRACK, job->uri, gain, job->loudness.peak, NULL, NULL);
+    } else {
+        brg_scanner_post_event (scanner, BRG_EVENT_ERROR, job->uri, 0.0, 0.0, job->error, job->debug);
+    }
+
+    if (job->album != NULL) {
+        BrgAlbum *album = job->album;
+
+        if (analyzed) {
+            brg_loudness_merge (&album->loudness, &job->loudness);
+            album->uris = g_slist_prepend (album->uris, g_strdup (job->uri));
+            album->analyzed = TRUE;
+        }
+
+        if (--album->pending == 0) {
+            if (album->analyzed && brg_loudness_get_integrated (&album->loudness, &lufs)) {
+                gdouble gain = BRG_REFERENCE_LOUDNESS - lufs;
+                GSList *node;
+
+                for (node = album->uris; node != NULL; node = node->next) {
+                    brg_store_set_album ((const gchar *)node->data, gain, album->loudness.peak);
+                }
+
+                brg_scanner_post_event (scanner, BRG_EVENT_ALBUM, album->key, gain, album->loudness.peak, NULL, NULL);
+            }
+
+            g_hash_table_remove (scanner->albums, album->key);
+        }
+    }
+
+    if (--scanner->pending_jobs == 0) {
+        brg_scanner_post_event (scanner, BRG_EVENT_FINISHED, NULL, 0.0, 0.0, NULL, NULL);
+    }
+
+    g_mutex_unlock (scanner->lock);
+}
+
+static void
+brg_scanner_run_job (gpointer data, gpointer user_data)
+{
+    BansheeReplayGainScanner *scanner = (BansheeReplayGainScanner *)user_data;
+    BrgJob *job = (BrgJob *)data;
+
+    if (brg_job_is_cancelled (job)) {
+        job->error = g_strdup (_("ReplayGain analysis was cancelled"));
+    } else {
+        brg_job_analyze (job);
+    }
+
+    brg_scanner_finish_job (scanner, job);
+    brg_job_free (job);
+}
+
+// ---------------------------------------------------------------------------
+// Internal Functions
+// ---------------------------------------------------------------------------
+
+gboolean
+brg_store_lookup (const gchar *uri, gboolean album_mode, gdouble *gain, gdouble *peak)
+{
+    BrgStoreEntry *entry = NULL;
+    gboolean found = FALSE;
+
+    if (uri == NULL) {
+        return FALSE;
+    }
+
+    G_LOCK (brg_store);
+
+    if (brg_store != NULL) {
+        entry = g_hash_table_lookup (brg_store, uri);
+    }
+
+    if (entry != NULL) {
+        gboolean use_album = album_mode && entry->has_album;
+
+        if (gain != NULL) {
+            *gain = use_album ? entry->album_gain : entry->track_gain;
+        }
+
+        if (peak != NULL) {
+            *peak = use_album ? entry->album_peak : entry->track_peak;
+        }
+
+        found = TRUE;
+    }
+
+    G_UNLOCK (brg_store);
+
+    return found;
+}
+
+// ---------------------------------------------------------------------------
+// Public Functions
+// ---------------------------------------------------------------------------
+
+MYEXPORT gboolean
+brg_store_load (const gchar *path)
+{
+    GKeyFile *key_file;
+    gchar **groups;
+    gsize i, n_groups;
+
+    g_return_val_if_fail (path != NULL, FALSE);
+
+    key_file = g_key_file_new ();
+    if (!g_key_file_load_from_file (key_file, path, G_KEY_FILE_NONE, NULL)) {
+        g_key_file_free (key_file);
+        return FALSE;
+    }
+
+    groups = g_key_file_get_groups (key_file, &n_groups);
+
+    G_LOCK (brg_store);
+
+    for (i = 0; i < n_groups; i++) {
+        BrgStoreEntry *entry = brg_store_get_entry (groups[i]);
+
+        entry->track_gain = g_key_file_get_double (key_file, groups[i], "track-gain", NULL);
+        entry->track_peak = g_key_file_get_double (key_file, groups[i], "track-peak", NULL);
+        entry->has_album = g_key_file_has_key (key_file, groups[i], "album-gain", NULL);
+
+        if (entry->has_album) {
+            entry->album_gain = g_key_file_get_double (key_file, groups[i], "album-gain", NULL);
+            entry->album_peak = g_key_file_get_double (key_file, groups[i], "album-peak", NULL);
+        }
+    }
+
+    G_UNLOCK (brg_store);
+
+    g_strfreev (groups);
+    g_key_file_free (key_file);
+
+    return TRUE;
+}
+
+MYEXPORT gboolean
+brg_store_save (const gchar *path)
+{
+    GKeyFile *key_file;
+    GHashTableIter iter;
+    gpointer key, value;
+    gchar *data;
+    gsize length;
+    gboolean saved;
+
+    g_return_val_if_fail (path != NULL, FALSE);
+
+    key_file = g_key_file_new ();
+
+    G_LOCK (brg_store);
+
+    if (brg_store != NULL) {
+        g_hash_table_iter_init (&iter, brg_store);
+        while (g_hash_table_iter_next (&iter, &key, &value)) {
+            const gchar *uri = (const gchar *)key;
+            BrgStoreEntry *entry = (BrgStoreEntry *)value;
+
+            g_key_file_set_double (key_file, uri, "track-gain", entry->track_gain);
+            g_key_file_set_double (key_file, uri, "track-peak", entry->track_peak);
+
+            if (entry->has_album) {
+                g_key_file_set_double (key_file, uri, "album-gain", entry->album_gain);
+                g_key_file_set_double (key_file, uri, "album-peak", entry->album_peak);
+            }
+        }
+    }
+
+    G_UNLOCK (brg_store);
+
+    data = g_key_file_to_data (key_file, &length, NULL);
+    saved = g_file_set_contents (path, data, length, NULL);
+
+    g_free (data);
+    g_key_file_free (key_file);
+
+    return saved;
+}
+
+MYEXPORT BansheeReplayGainScanner *
+brg_scanner_new (gint max_workers)
+{
+    BansheeReplayGainScanner *scanner = g_new0 (BansheeReplayGainScanner, 1);
+
+    if (max_workers <= 0) {
+#if GLIB_CHECK_VERSION(2,36,0)
+        max_workers = g_get_num_processors ();
+#else
+        max_workers = 2;
+#endif
+    }
+
+    scanner->max_workers = max_workers;
+    scanner->lock = g_mutex_new ();
+    scanner->events = g_queue_new ();
+    scanner->albums = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, (GDestroyNotify)brg_album_free);
+
+    return scanner;
+}
+
+MYEXPORT void
+brg_scanner_add_track (BansheeReplayGainScanner *scanner, const gchar *uri, const gchar *album_key)
+{
+    BrgJob *job;
+
+    g_return_if_fail (scanner != NULL);
+    g_return_if_fail (uri != NULL);
+
+    job = g_new0 (BrgJob, 1);
+    job->scanner = scanner;
+    job->uri = g_strdup (uri);
+
+    g_mutex_lock (scanner->lock);
+
+    if (album_key != NULL && album_key[0] != '\0') {
+        BrgAlbum *album = g_hash_table_lookup (scanner->albums, album_key);
+
+        if (album == NULL) {
+            album = g_new0 (BrgAlbum, 1);
+            album->key = g_strdup (album_key);
+            g_hash_table_insert (scanner->albums, album->key, album);
+        }
+
+        album->pending++;
+        job->album = album;
+    }
+
+    scanner->queued_jobs = g_slist_prepend (scanner->queued_jobs, job);
+
+    g_mutex_unlock (scanner->lock);
+}
+
+// Jobs are only handed to the pool here, once every track of every album is
+// known, so an album can't be finalized before all of its tracks are queued
+MYEXPORT gboolean
+brg_scanner_start (BansheeReplayGainScanner *scanner)
+{
+    GSList *jobs, *node;
+    GError *error = NULL;
+
+    g_return_val_if_fail (scanner != NULL, FALSE);
+
+    if (scanner->pool == NULL) {
+        scanner->pool = g_thread_pool_new (brg_scanner_run_job, scanner,
+            scanner->max_workers, FALSE, &error);
+
+        if (scanner->pool == NULL) {
+            banshee_log_debug ("rgscanner", "Could not create worker pool: %s", error->message);
+            g_error_free (error);
+            return FALSE;
+        }
+    }
+
+    g_mutex_lock (scanner->lock);
+    jobs = g_slist_reverse (scanner->queued_jobs);
+    scanner->queued_jobs = NULL;
+    scanner->pending_jobs += g_slist_length (jobs);
+    if (jobs != NULL) {
+        scanner->is_scanning = TRUE;
+    }
+    g_mutex_unlock (scanner->lock);
+
+    for (node = jobs; node != NULL; node = node->next) {
+        ((BrgJob *)node->data)->generation = g_atomic_int_get (&scanner->generation);
+    }
+
+    for (node = jobs; node != NULL; node = node->next) {
+        g_thread_pool_push (scanner->pool, node->data, NULL);
+    }
+
+    g_slist_free (jobs);
+
+    return TRUE;
+}
+
+MYEXPORT void
+brg_scanner_cancel (BansheeReplayGainScanner *scanner)
+{
+    g_return_if_fail (scanner != NULL);
+
+    // Started jobs still run, but bail out immediately and report the
+    // cancellation, so album and job bookkeeping stays consistent
+    g_atomic_int_inc (&scanner->generation);
+}
+
+MYEXPORT void
+brg_scanner_destroy (BansheeReplayGainScanner *scanner)
+{
+    g_return_if_fail (scanner != NULL);
+
+    brg_scanner_cancel (scanner);
+
+    if (scanner->pool != NULL) {
+        g_thread_pool_free (scanner->pool, FALSE, TRUE);
+        scanner->pool = NULL;
+    }
+
+    if (scanner->event_source_id != 0) {
+        g_source_remove (scanner->event_source_id);
+        scanner->event_source_id = 0;
+    }
+
+    g_queue_foreach (scanner->events, (GFunc)brg_event_free, NULL);
+    g_queue_free (scanner->events);
+
+    g_slist_foreach (scanner->queued_jobs, (GFunc)brg_job_free, NULL);
+    g_slist_free (scanner->queued_jobs);
+
+    g_hash_table_destroy (scanner->albums);
+    g_mutex_free (scanner->lock);
+
+    g_free (scanner);
+}
+
+MYEXPORT void
+brg_scanner_set_track_callback (BansheeReplayGainScanner *scanner, BansheeReplayGainScannerTrackCallback cb)
+{
+    g_return_if_fail (scanner != NULL);
+    scanner->track_cb = cb;
+}
+
+MYEXPORT void
+brg_scanner_set_album_callback (BansheeReplayGainScanner *scanner, BansheeReplayGainScannerAlbumCallback cb)
+{
+    g_return_if_fail (scanner != NULL);
+    scanner->album_cb = cb;
+}
+
+MYEXPORT void
+brg_scanner_set_finished_callback (BansheeReplayGainScanner *scanner, BansheeReplayGainScannerFinishedCallback cb)
+{
+    g_return_if_fail (scanner != NULL);
+    scanner->finished_cb = cb;
+}
+
+MYEXPORT void
+brg_scanner_set_error_callback (BansheeReplayGainScanner *scanner, BansheeReplayGainScannerErrorCallback cb)
+{
+    g_return_if_fail (scanner != NULL);
+    scanner->error_cb = cb;
+}
+
+MYEXPORT gboolean
+brg_scanner_get_is_scanning (BansheeReplayGainScanner *scanner)
+{
+    gboolean is_scanning;
+
+    g_return_val_if_fail (scanner != NULL, FALSE);
+
+    g_mutex_lock (scanner->lock);
+    is_scanning = scanner->is_scanning;
+    g_mutex_unlock (scanner->lock);
+
+    return is_scanning;
+}
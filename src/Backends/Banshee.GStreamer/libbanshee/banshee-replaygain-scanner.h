@@ -0,0 +1,71 @@
+//
+// banshee-replaygain-scanner.h
+//
+// Copyright (C) 2026 Banshee Project Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef _BANSHEE_REPLAYGAIN_SCANNER_H
+#define _BANSHEE_REPLAYGAIN_SCANNER_H
+
+#include <glib.h>
+
+#include "banshee-gst.h"
+
+typedef struct BansheeReplayGainScanner BansheeReplayGainScanner;
+
+typedef void (* BansheeReplayGainScannerTrackCallback)    (BansheeReplayGainScanner *scanner, const gchar *uri,
+                                                            gdouble gain, gdouble peak);
+typedef void (* BansheeReplayGainScannerAlbumCallback)    (BansheeReplayGainScanner *scanner, const gchar *album,
+                                                            gdouble gain, gdouble peak);
+typedef void (* BansheeReplayGainScannerFinishedCallback) (BansheeReplayGainScanner *scanner);
+typedef void (* BansheeReplayGainScannerErrorCallback)    (BansheeReplayGainScanner *scanner, const gchar *uri,
+                                                            const gchar *error, const gchar *debug);
+
+gboolean brg_store_lookup (const gchar *uri, gboolean album_mode, gdouble *gain, gdouble *peak);
+
+MYEXPORT gboolean
+brg_store_load (const gchar *path);
+MYEXPORT gboolean
+brg_store_save (const gchar *path);
+
+MYEXPORT BansheeReplayGainScanner *
+brg_scanner_new (gint max_workers);
+MYEXPORT void
+brg_scanner_add_track (BansheeReplayGainScanner *scanner, const gchar *uri, const gchar *album_key);
+MYEXPORT gboolean
+brg_scanner_start (BansheeReplayGainScanner *scanner);
+MYEXPORT void
+brg_scanner_cancel (BansheeReplayGainScanner *scanner);
+MYEXPORT void
+brg_scanner_destroy (BansheeReplayGainScanner *scanner);
+MYEXPORT void
+brg_scanner_set_track_callback (BansheeReplayGainScanner *scanner, BansheeReplayGainScannerTrackCallback cb);
+MYEXPORT void
+brg_scanner_set_album_callback (BansheeReplayGainScanner *scanner, BansheeReplayGainScannerAlbumCallback cb);
+MYEXPORT void
+brg_scanner_set_finished_callback (BansheeReplayGainScanner *scanner, BansheeReplayGainScannerFinishedCallback cb);
+MYEXPORT void
+brg_scanner_set_error_callback (BansheeReplayGainScanner *scanner, BansheeReplayGainScannerErrorCallback cb);
+MYEXPORT gboolean
+brg_scanner_get_is_scanning (BansheeReplayGainScanner *scanner);
+
+#endif /* _BANSHEE_REPLAYGAIN_SCANNER_H */
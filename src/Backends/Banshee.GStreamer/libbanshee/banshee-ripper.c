@@ -32,34 +32,136 @@
 #  include "config.h"
 #endif
 
+#include <stdio.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <glib/gi18n.h>
+#include <glib/gstdio.h>
 
 #include "banshee-gst.h"
 #include "banshee-tagger.h"
 
 typedef struct BansheeRipper BansheeRipper;
 
-typedef void (* BansheeRipperFinishedCallback) (BansheeRipper *ripper);
+typedef void (* BansheeRipperFinishedCallback) (BansheeRipper *ripper, gint track_number);
 typedef void (* BansheeRipperMimeTypeCallback) (BansheeRipper *ripper, const gchar *mimetype);
-typedef void (* BansheeRipperProgressCallback) (BansheeRipper *ripper, gint msec, gpointer user_info);
+typedef void (* BansheeRipperProgressCallback) (BansheeRipper *ripper, gint msec, gint track_number);
 typedef void (* BansheeRipperErrorCallback)    (BansheeRipper *ripper, const gchar *error, const gchar *debug);
 
+// Default progress step, as a fraction of the track
+#define BR_PROGRESS_STEP 0.005
+
+// Upper bound on encoders running at once for spooled rips
+#define BR_MAX_ENCODERS 8
+
+// Bytes per second of CD audio, for the speed of spooled rips
+#define BR_CDDA_BYTE_RATE (44100 * 2 * 2)
+
+// Adaptive paranoia: the first read only verifies overlaps between reads
+// (cdparanoia's PARANOIA_MODE_OVERLAP), and sectors it reports as bad are
+// re-read with this many sectors around them
+#define BR_PARANOIA_FAST 0x04
+#define BR_REPAIR_MARGIN 16
+
+#define BR_CDDA_SECTOR_SIZE 2352
+#define BR_SECTOR_TIME(sectors) gst_util_uint64_scale_int ((sectors), GST_SECOND, 75)
+
+// Sectors [start, end) of the disc to read again
+typedef struct {
+    gint64 start;
+    gint64 end;
+} BansheeRipperRange;
+
+// A track of a spooled rip: read into spool_path, then encoded from there
+// into output_path by a pipeline of its own
+typedef struct {
+    BansheeRipper *ripper;
+    gint number;
+    gchar *output_path;
+    GstTagList *tags;
+    gchar *spool_path;
+    guint64 spool_size;
+    GstElement *pipeline;
+    GstElement *encoder;
+    guint bus_watch_id;
+
+    // Adaptive paranoia: the damaged ranges of the fast read, patched in
+    // place in the spool file (at data_offset for first_sector) by a
+    // paranoid read through pipeline before the track is encoded
+    gint64 first_sector;
+    GArray *damage;
+    guint damage_index;
+    gboolean repair_started;
+    FILE *repair_file;
+    glong data_offset;
+} BansheeRipperTrack;
+
 struct BansheeRipper {
     gboolean is_ripping;
-    guint iterate_timeout_id;
+    BansheeProgressProbe *progress_probe;
+    gdouble progress_step;
     
     gchar *device;
     gint paranoia_mode;
     const gchar *output_uri;
     gchar *encoder_pipeline;
+    gboolean whole_disc;
     
     GstElement *pipeline;
     GstElement *cddasrc;
+    GstElement *track_bin;
     GstElement *encoder;
     GstElement *filesink;
+    guint bus_watch_id;
     
     GstFormat track_format;
+    gint track_number;
+
+    // Whole disc rips: the queue's src pad the track bins are linked to and
+    // the probe splitting the stream there. The split state is only touched
+    // from the streaming thread while a track bin is linked, and from the
+    // main loop while the source is held.
+    GstPad *split_pad;
+    gulong split_probe_id;
+    gboolean split_linked;
+    gboolean split_new_track;
+    gboolean split_reached;
+    GstClockTime track_start;
+    GstClockTime track_end;
+
+    // Spooled rips: the drive is read into raw PCM files as fast as it
+    // goes, and up to max_encoders of those are encoded at once. Reading
+    // waits while the unencoded spool exceeds spool_limit bytes.
+    gchar *spool_dir;
+    guint64 spool_limit;
+    guint64 spool_size;
+    guint max_encoders;
+    GQueue *requested;
+    BansheeRipperTrack *reading;
+    GQueue *spooled;
+    GList *encoding;
+
+    gint64 read_started;
+    gint64 read_usec;
+    guint64 read_bytes;
+    gint64 encode_started;
+    gint64 encode_usec;
+    guint64 encoded_bytes;
+
+    // Adaptive paranoia: spooled rips read the disc in a fast mode and
+    // collect the sectors cdparanoia reports as bad from the streaming
+    // thread, under error_lock. Once the drive is done with the requested
+    // tracks, the damaged ones are re-read one at a time in paranoia_mode.
+    gboolean adaptive;
+    gboolean adaptive_active;
+    GMutex *error_lock;
+    GArray *error_sectors;
+    GstFormat sector_format;
+    gint64 track_first_sector;
+    gint64 track_end_sector;
+    GQueue *damaged;
+    BansheeRipperTrack *repairing;
+    guint64 repaired_sectors;
     
     BansheeRipperProgressCallback progress_cb;
     BansheeRipperMimeTypeCallback mimetype_cb;
@@ -82,53 +184,69 @@ br_raise_error (BansheeRipper *ripper, const gchar *error, const gchar *debug)
     }
 }
 
-static gboolean
-br_iterate_timeout (BansheeRipper *ripper)
+static void
+br_progress (GstClockTime position, GstClockTime duration, gpointer data)
 {
-    GstState state;
-    gint64 position;
-    
-    g_return_val_if_fail (ripper != NULL, FALSE);
-
-    gst_element_get_state (ripper->pipeline, &state, NULL, 0);
-    if (state != GST_STATE_PLAYING) {
-        return TRUE;
-    }
+    BansheeRipper *ripper = (BansheeRipper *)data;
 
-    if (!gst_element_query_position (ripper->cddasrc, GST_FORMAT_TIME, &position)) {
-        return TRUE;
-    }
-    
     if (ripper->progress_cb != NULL) {
-        ripper->progress_cb (ripper, (guint) (position / GST_MSECOND), NULL);
+        ripper->progress_cb (ripper, (guint) (position / GST_MSECOND), ripper->track_number);
     }
-
-    return TRUE;
 }
 
 static void
-br_start_iterate_timeout (BansheeRipper *ripper)
+br_track_bin_destroy (BansheeRipper *ripper)
 {
-    g_return_if_fail (ripper != NULL);
+    banshee_progress_probe_free (ripper->progress_probe);
+    ripper->progress_probe = NULL;
 
-    if (ripper->iterate_timeout_id != 0) {
-        return;
+    if (ripper->track_bin != NULL) {
+        gst_element_set_state (ripper->track_bin, GST_STATE_NULL);
+        if (ripper->pipeline != NULL) {
+            gst_bin_remove (GST_BIN (ripper->pipeline), ripper->track_bin);
+        }
+        ripper->track_bin = NULL;
     }
-    
-    ripper->iterate_timeout_id = g_timeout_add (200, (GSourceFunc)br_iterate_timeout, ripper);
+
+    ripper->encoder = NULL;
+    ripper->filesink = NULL;
 }
 
 static void
-br_stop_iterate_timeout (BansheeRipper *ripper)
+br_pipeline_destroy (BansheeRipper *ripper)
 {
-    g_return_if_fail (ripper != NULL);
-    
-    if (ripper->iterate_timeout_id == 0) {
-        return;
+    if (ripper->split_probe_id != 0) {
+        gst_pad_remove_probe (ripper->split_pad, ripper->split_probe_id);
+        ripper->split_probe_id = 0;
     }
-    
-    g_source_remove (ripper->iterate_timeout_id);
-    ripper->iterate_timeout_id = 0;
+
+    if (ripper->split_pad != NULL) {
+        gst_object_unref (ripper->split_pad);
+        ripper->split_pad = NULL;
+    }
+
+    if (ripper->pipeline != NULL && GST_IS_ELEMENT (ripper->pipeline)) {
+        gst_element_set_state (GST_ELEMENT (ripper->pipeline), GST_STATE_NULL);
+    }
+
+    banshee_progress_probe_free (ripper->progress_probe);
+    ripper->progress_probe = NULL;
+
+    if (ripper->pipeline != NULL && GST_IS_ELEMENT (ripper->pipeline)) {
+        gst_object_unref (GST_OBJECT (ripper->pipeline));
+    }
+
+    if (ripper->bus_watch_id != 0) {
+        g_source_remove (ripper->bus_watch_id);
+        ripper->bus_watch_id = 0;
+    }
+
+    ripper->pipeline = NULL;
+    ripper->track_bin = NULL;
+    ripper->encoder = NULL;
+    ripper->filesink = NULL;
+    ripper->track_number = 0;
+    ripper->split_reached = FALSE;
 }
 
 static const gchar *
@@ -178,6 +296,26 @@ br_encoder_probe_mime_type (GstBin *bin)
     return preferred_mimetype;
 }
 
+static void
+br_report_mime_type (BansheeRipper *ripper, GstElement *encoder)
+{
+    const gchar *mimetype;
+
+    if (encoder == NULL || !GST_IS_BIN (encoder)) {
+        return;
+    }
+
+    mimetype = br_encoder_probe_mime_type (GST_BIN (encoder));
+    if (mimetype != NULL) {
+        banshee_log_debug ("ripper", "Found Mime Type for encoded content: %s", mimetype);
+        if (ripper->mimetype_cb != NULL) {
+            ripper->mimetype_cb (ripper, mimetype);
+        }
+    }
+}
+
+static void br_spool_track_read (BansheeRipper *ripper);
+
 static gboolean
 br_pipeline_bus_callback (GstBus *bus, GstMessage *message, gpointer data)
 {
@@ -188,16 +326,15 @@ br_pipeline_bus_callback (GstBus *bus, GstMessage *message, gpointer data)
     switch (GST_MESSAGE_TYPE (message)) {
         case GST_MESSAGE_STATE_CHANGED: {
             GstState old, new, pending;
+
+            if (GST_MESSAGE_SRC (message) != GST_OBJECT (ripper->pipeline)) {
+                break;
+            }
+
             gst_message_parse_state_changed (message, &old, &new, &pending);
             
             if (old == GST_STATE_READY && new == GST_STATE_PAUSED && pending == GST_STATE_PLAYING) {
-                const gchar *mimetype = br_encoder_probe_mime_type (GST_BIN (ripper->encoder));
-                if (mimetype != NULL) {
-                    banshee_log_debug ("ripper", "Found Mime Type for encoded content: %s", mimetype);
-                    if (ripper->mimetype_cb != NULL) {
-                        ripper->mimetype_cb (ripper, mimetype);
-                    }
-                }
+                br_report_mime_type (ripper, ripper->encoder);
             }
             break;
         }
@@ -214,18 +351,34 @@ br_pipeline_bus_callback (GstBus *bus, GstMessage *message, gpointer data)
             }
             
             ripper->is_ripping = FALSE;
-            br_stop_iterate_timeout (ripper);
+            BANSHEE_TRACE_ASYNC_END ("ripper", "read", ripper);
             break;
         }
             
         case GST_MESSAGE_EOS: {
-            gst_element_set_state (GST_ELEMENT (ripper->pipeline), GST_STATE_NULL);
+            gint track_number = ripper->track_number;
+
+            BANSHEE_TRACE_ASYNC_END ("ripper", "read", ripper);
+
+            // The track's chain is done, but when the source is parked at the
+            // next track the pipeline is kept for br_rip_track to go on with
+            if (ripper->whole_disc && ripper->split_reached) {
+                br_report_mime_type (ripper, ripper->encoder);
+                br_track_bin_destroy (ripper);
+            } else {
+                gst_element_set_state (GST_ELEMENT (ripper->pipeline), GST_STATE_NULL);
+                ripper->track_number = 0;
+            }
+
+            if (ripper->spool_dir != NULL) {
+                br_spool_track_read (ripper);
+                break;
+            }
             
             ripper->is_ripping = FALSE;
-            br_stop_iterate_timeout (ripper);
             
             if (ripper->finished_cb != NULL) {
-                ripper->finished_cb (ripper);
+                ripper->finished_cb (ripper, track_number);
             }
             break;
         }
@@ -242,7 +395,7 @@ br_pipeline_build_encoder (const gchar *pipeline, GError **error_out)
     GstElement *encoder;
     GError *error = NULL;
    
-    encoder = gst_parse_bin_from_description (pipeline, TRUE, &error);
+    encoder = banshee_encoder_bin_new (pipeline, &error);
     
     if (error != NULL) {
         if (error_out != NULL) {
@@ -254,13 +407,245 @@ br_pipeline_build_encoder (const gchar *pipeline, GError **error_out)
     return encoder;
 }
 
+
+// Encoder and file sink for one track, in a bin of their own so whole disc
+// rips can swap them while the source keeps reading
+static gboolean
+br_track_bin_construct (BansheeRipper *ripper, const gchar *output_path)
+{
+    GstPad *encoder_pad;
+    GError *error = NULL;
+
+    ripper->track_bin = gst_bin_new (NULL);
+
+    // Spooled rips only write the PCM out, with a header for the encoders
+    // to read it back
+    if (ripper->spool_dir != NULL) {
+        ripper->encoder = gst_element_factory_make ("wavenc", "wavenc");
+    } else {
+        ripper->encoder = br_pipeline_build_encoder (ripper->encoder_pipeline, &error);
+    }
+
+    if (ripper->encoder == NULL) {
+        br_raise_error (ripper, _("Could not create encoder pipeline"), error != NULL ? error->message : NULL);
+        if (error != NULL) {
+            g_error_free (error);
+        }
+        gst_object_unref (ripper->track_bin);
+        ripper->track_bin = NULL;
+        return FALSE;
+    }
+    
+    ripper->filesink = gst_element_factory_make ("filesink", "filesink");
+    if (ripper->filesink == NULL) {
+        br_raise_error (ripper, _("Could not create filesink plugin"), NULL);
+        gst_object_unref (gst_object_ref_sink (ripper->encoder));
+        gst_object_unref (ripper->track_bin);
+        ripper->track_bin = NULL;
+        ripper->encoder = NULL;
+        return FALSE;
+    }
+
+    g_object_set (G_OBJECT (ripper->filesink), "location", output_path, NULL);
+
+    gst_bin_add_many (GST_BIN (ripper->track_bin), ripper->encoder, ripper->filesink, NULL);
+    if (!gst_element_link (ripper->encoder, ripper->filesink)) {
+        br_raise_error (ripper, _("Could not link pipeline elements"), NULL);
+    }
+
+    encoder_pad = gst_element_get_static_pad (ripper->encoder, "sink");
+    if (encoder_pad != NULL) {
+        gst_element_add_pad (ripper->track_bin, gst_ghost_pad_new ("sink", encoder_pad));
+
+        // Progress follows the buffers entering the encoder instead of
+        // polling the source
+        ripper->progress_probe = banshee_progress_probe_new (encoder_pad,
+            ripper->progress_step, br_progress, ripper);
+        gst_object_unref (encoder_pad);
+    }
+
+    return TRUE;
+}
+
+// Start and end of the current track in the source's time, from its track
+// format
+static void
+br_track_query_bounds (BansheeRipper *ripper, GstClockTime first_buffer)
+{
+    gint64 start, end;
+
+    if (gst_element_query_convert (ripper->cddasrc, ripper->track_format,
+        ripper->track_number - 1, GST_FORMAT_TIME, &start)) {
+        ripper->track_start = start;
+    } else {
+        ripper->track_start = first_buffer;
+    }
+
+    // Past the last track the conversion fails and the end of the disc
+    // ends the track
+    if (gst_element_query_convert (ripper->cddasrc, ripper->track_format,
+        ripper->track_number, GST_FORMAT_TIME, &end) && end > start) {
+        ripper->track_end = end;
+    } else {
+        ripper->track_end = GST_CLOCK_TIME_NONE;
+    }
+
+    // The same bounds in disc sectors, as reported by cdparanoia
+    if (ripper->sector_format == GST_FORMAT_UNDEFINED ||
+        !gst_element_query_convert (ripper->cddasrc, ripper->track_format,
+            ripper->track_number - 1, ripper->sector_format, &ripper->track_first_sector)) {
+        ripper->track_first_sector = -1;
+    }
+
+    if (ripper->sector_format == GST_FORMAT_UNDEFINED ||
+        !gst_element_query_convert (ripper->cddasrc, ripper->track_format,
+            ripper->track_number, ripper->sector_format, &ripper->track_end_sector)) {
+        ripper->track_end_sector = G_MAXINT64;
+    }
+}
+
+// Splits the continuous stream of a whole disc rip at track boundaries. The
+// first buffer of a track gets a segment starting at the track, so the
+// encoder and progress see the track from zero. The first buffer past the
+// end of the track ends its chain with EOS and is held, blocking the
+// source, until br_rip_track links the chain of the next track.
+static GstPadProbeReturn
+br_split_probe_cb (GstPad *pad, GstPadProbeInfo *info, gpointer data)
+{
+    BansheeRipper *ripper = (BansheeRipper *)data;
+    GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+    GstClockTime timestamp = GST_BUFFER_PTS (buffer);
+    GstPad *peer;
+
+    if (!ripper->split_linked) {
+        return GST_PAD_PROBE_OK;
+    }
+
+    if (ripper->split_new_track) {
+        GstSegment segment;
+
+        ripper->split_new_track = FALSE;
+        br_track_query_bounds (ripper, timestamp);
+
+        // The source's duration is the whole disc's
+        if (ripper->progress_probe != NULL && GST_CLOCK_TIME_IS_VALID (ripper->track_end)) {
+            banshee_progress_probe_set_duration (ripper->progress_probe,
+                ripper->track_end - ripper->track_start);
+        }
+
+        gst_segment_init (&segment, GST_FORMAT_TIME);
+        segment.start = ripper->track_start;
+        segment.time = 0;
+        gst_pad_push_event (pad, gst_event_new_segment (&segment));
+        return GST_PAD_PROBE_PASS;
+    }
+
+    if (!GST_CLOCK_TIME_IS_VALID (timestamp) || !GST_CLOCK_TIME_IS_VALID (ripper->track_end) ||
+        timestamp < ripper->track_end) {
+        return GST_PAD_PROBE_PASS;
+    }
+
+    ripper->split_linked = FALSE;
+    ripper->split_reached = TRUE;
+
+    peer = gst_pad_get_peer (pad);
+    if (peer != NULL) {
+        gst_pad_unlink (pad, peer);
+        gst_pad_send_event (peer, gst_event_new_eos ());
+        gst_object_unref (peer);
+    }
+
+    return GST_PAD_PROBE_OK;
+}
+
+// Links the current track bin after the source's queue and lets the
+// source go on if it was held at a track boundary
+static gboolean
+br_track_bin_link (BansheeRipper *ripper)
+{
+    GstPad *sink;
+    gulong held_probe_id = ripper->split_probe_id;
+    gboolean linked;
+
+    gst_bin_add (GST_BIN (ripper->pipeline), ripper->track_bin);
+
+    sink = gst_element_get_static_pad (ripper->track_bin, "sink");
+    linked = sink != NULL && GST_PAD_LINK_SUCCESSFUL (gst_pad_link (ripper->split_pad, sink));
+    if (sink != NULL) {
+        gst_object_unref (sink);
+    }
+
+    if (!linked) {
+        br_raise_error (ripper, _("Could not link pipeline elements"), NULL);
+        return FALSE;
+    }
+
+    if (!ripper->whole_disc) {
+        return TRUE;
+    }
+
+    gst_element_sync_state_with_parent (ripper->track_bin);
+
+    ripper->split_linked = TRUE;
+    ripper->split_new_track = TRUE;
+    ripper->split_reached = FALSE;
+
+    // The held buffer goes through the new probe once the old one is gone
+    ripper->split_probe_id = gst_pad_add_probe (ripper->split_pad,
+        GST_PAD_PROBE_TYPE_BLOCK | GST_PAD_PROBE_TYPE_BUFFER,
+        br_split_probe_cb, ripper, NULL);
+    if (held_probe_id != 0) {
+        gst_pad_remove_probe (ripper->split_pad, held_probe_id);
+    }
+
+    return TRUE;
+}
+
+// Called from the streaming thread for every sector cdparanoia could not
+// read or could not verify
+static void
+br_paranoia_error_cb (GstElement *source, gint sector, gpointer data)
+{
+    BansheeRipper *ripper = (BansheeRipper *)data;
+
+    g_mutex_lock (ripper->error_lock);
+    g_array_append_val (ripper->error_sectors, sector);
+    g_mutex_unlock (ripper->error_lock);
+}
+
+// Decides whether the read of a new source is a fast one, which needs
+// spooled whole disc rips and a source reporting its bad sectors, and
+// starts collecting those
+static void
+br_adaptive_reset (BansheeRipper *ripper)
+{
+    GType type = G_OBJECT_TYPE (ripper->cddasrc);
+
+    g_mutex_lock (ripper->error_lock);
+    g_array_set_size (ripper->error_sectors, 0);
+    g_mutex_unlock (ripper->error_lock);
+
+    ripper->adaptive_active = ripper->adaptive && ripper->paranoia_mode != 0 &&
+        ripper->spool_dir != NULL && ripper->whole_disc &&
+        ripper->sector_format != GST_FORMAT_UNDEFINED &&
+        g_signal_lookup ("transport-error", type) != 0 &&
+        g_signal_lookup ("uncorrected-error", type) != 0;
+
+    if (ripper->adaptive_active) {
+        g_signal_connect (ripper->cddasrc, "transport-error", G_CALLBACK (br_paranoia_error_cb), ripper);
+        g_signal_connect (ripper->cddasrc, "uncorrected-error", G_CALLBACK (br_paranoia_error_cb), ripper);
+    }
+}
+
 static gboolean
 br_pipeline_construct (BansheeRipper *ripper)
 {
     GstElement *queue;
-    GError *error = NULL;
+    GstBus *bus;
     
     g_return_val_if_fail (ripper != NULL, FALSE);
+
+    br_pipeline_destroy (ripper);
         
     ripper->pipeline = gst_pipeline_new ("pipeline");
     if (ripper->pipeline == NULL) {
@@ -275,17 +660,25 @@ br_pipeline_construct (BansheeRipper *ripper)
     }
   
     g_object_set (G_OBJECT (ripper->cddasrc), "device", ripper->device, NULL);
-    
-    if (g_object_class_find_property (G_OBJECT_GET_CLASS (ripper->cddasrc), "paranoia-mode")) {
-        g_object_set (G_OBJECT (ripper->cddasrc), "paranoia-mode", ripper->paranoia_mode, NULL);
+
+    // Read on across track boundaries instead of stopping at the end of
+    // the track; the split probe cuts the stream into tracks
+    if (ripper->whole_disc) {
+        if (g_object_class_find_property (G_OBJECT_GET_CLASS (ripper->cddasrc), "mode")) {
+            gst_util_set_object_arg (G_OBJECT (ripper->cddasrc), "mode", "continuous");
+        } else {
+            ripper->whole_disc = FALSE;
+        }
     }
     
     ripper->track_format = gst_format_get_by_nick ("track");
+    ripper->sector_format = gst_format_get_by_nick ("sector");
+
+    br_adaptive_reset (ripper);
     
-    ripper->encoder = br_pipeline_build_encoder (ripper->encoder_pipeline, &error);
-    if (ripper->encoder == NULL) {
-        br_raise_error (ripper, _("Could not create encoder pipeline"), error->message);
-        return FALSE;
+    if (g_object_class_find_property (G_OBJECT_GET_CLASS (ripper->cddasrc), "paranoia-mode")) {
+        g_object_set (G_OBJECT (ripper->cddasrc), "paranoia-mode", 
+            ripper->adaptive_active ? BR_PARANOIA_FAST : ripper->paranoia_mode, NULL);
     }
     
     queue = gst_element_factory_make ("queue", "queue");
@@ -296,94 +689,28 @@ br_pipeline_construct (BansheeRipper *ripper)
     
     g_object_set (G_OBJECT (queue), "max-size-time", 120 * GST_SECOND, NULL);
     
-    ripper->filesink = gst_element_factory_make ("filesink", "filesink");
-    if (ripper->filesink == NULL) {
-        br_raise_error (ripper, _("Could not create filesink plugin"), NULL);
-        return FALSE;
-    }
-    
-    gst_bin_add_many (GST_BIN (ripper->pipeline), ripper->cddasrc, queue, ripper->encoder, ripper->filesink, NULL);
+    gst_bin_add_many (GST_BIN (ripper->pipeline), ripper->cddasrc, queue, NULL);
         
-    if (!gst_element_link_many (ripper->cddasrc, queue, ripper->encoder, ripper->filesink, NULL)) {
+    if (!gst_element_link (ripper->cddasrc, queue)) {
         br_raise_error (ripper, _("Could not link pipeline elements"), NULL);
     }
-    
-    gst_bus_add_watch (gst_pipeline_get_bus (GST_PIPELINE (ripper->pipeline)), br_pipeline_bus_callback, ripper);
-
-    return TRUE;
-}
-
-// ---------------------------------------------------------------------------
-// Internal Functions
-// ---------------------------------------------------------------------------
-
-BansheeRipper *
-br_new (gchar *device, gint paranoia_mode, gchar *encoder_pipeline)
-{
-    BansheeRipper *ripper = g_new0 (BansheeRipper, 1);
-    
-    if (ripper == NULL) {
-        return NULL;
-    }
-        
-    ripper->device = g_strdup (device);
-    ripper->paranoia_mode = paranoia_mode;
-    ripper->encoder_pipeline = g_strdup (encoder_pipeline);
-
-    return ripper;
-}
 
-void 
-br_cancel (BansheeRipper *ripper)
-{
-    g_return_if_fail (ripper != NULL);
-    
-    br_stop_iterate_timeout (ripper);
+    ripper->split_pad = gst_element_get_static_pad (queue, "src");
     
-    if (ripper->pipeline != NULL && GST_IS_ELEMENT (ripper->pipeline)) {
-        gst_element_set_state (GST_ELEMENT (ripper->pipeline), GST_STATE_NULL);
-        gst_object_unref (GST_OBJECT (ripper->pipeline));
-        ripper->pipeline = NULL;
-    }
-}
+    bus = gst_pipeline_get_bus (GST_PIPELINE (ripper->pipeline));
+    ripper->bus_watch_id = gst_bus_add_watch (bus, br_pipeline_bus_callback, ripper);
+    gst_object_unref (bus);
 
-void
-br_destroy (BansheeRipper *ripper)
-{
-    g_return_if_fail (ripper != NULL);
-    
-    br_cancel (ripper);
-    
-    if (ripper->device != NULL) {
-        g_free (ripper->device);
-    }
-    
-    if (ripper->encoder_pipeline != NULL) {
-        g_free (ripper->encoder_pipeline);
-    }
-    
-    g_free (ripper);
-    ripper = NULL;
+    return TRUE;
 }
 
-gboolean
-br_rip_track (BansheeRipper *ripper, gint track_number, gchar *output_path, 
-    GstTagList *tags, gboolean *tagging_supported)
+static void
+br_encoder_set_tags (GstElement *encoder, GstTagList *tags, gboolean *tagging_supported)
 {
     GstIterator *iter;
 
-    g_return_val_if_fail (ripper != NULL, FALSE);
-
-    if (!br_pipeline_construct (ripper)) {
-        return FALSE;
-    }
-    
-    // initialize the pipeline, set the sink output location
-    gst_element_set_state (ripper->filesink, GST_STATE_NULL);
-    g_object_set (G_OBJECT (ripper->filesink), "location", output_path, NULL);
-    
     // find an element to do the tagging and set tag data
-    iter = gst_bin_iterate_all_by_interface (GST_BIN (ripper->encoder), GST_TYPE_TAG_SETTER);
+    iter = gst_bin_iterate_all_by_interface (GST_BIN (encoder), GST_TYPE_TAG_SETTER);
     BANSHEE_GST_ITERATOR_ITERATE (iter, GstElement *, element, TRUE, {
         GstTagSetter *tag_setter = GST_TAG_SETTER (element);
         if (tag_setter != NULL) {
@@ -404,20 +731,895 @@ br_rip_track (BansheeRipper *ripper, gint track_number, gchar *output_path,
             *tagging_supported = TRUE;
         }
     });
-    
-    // Begin the rip
-    g_object_set (G_OBJECT (ripper->cddasrc), "track", track_number, NULL);
-    gst_element_set_state (ripper->pipeline, GST_STATE_PLAYING);
-    br_start_iterate_timeout (ripper);
-    
-    return TRUE;
 }
 
-void
-br_set_progress_callback (BansheeRipper *ripper, BansheeRipperProgressCallback cb)
+// Reads track_number of the disc through a new track bin writing to
+// output_path. In whole disc mode this carries on from where the source
+// was held if it is the next track; anything else reads from a new
+// pipeline.
+static gboolean
+br_read_track (BansheeRipper *ripper, gint track_number, const gchar *output_path,
+    GstTagList *tags, gboolean *tagging_supported)
 {
-    g_return_if_fail (ripper != NULL);
-    ripper->progress_cb = cb;
+    gboolean resume;
+
+    resume = ripper->whole_disc && ripper->pipeline != NULL && ripper->split_reached &&
+        ripper->track_bin == NULL && track_number == ripper->track_number + 1;
+
+    if (!resume && !br_pipeline_construct (ripper)) {
+        return FALSE;
+    }
+
+    if (!br_track_bin_construct (ripper, output_path)) {
+        return FALSE;
+    }
+
+    if (ripper->spool_dir == NULL) {
+        br_encoder_set_tags (ripper->encoder, tags, tagging_supported);
+    }
+
+    ripper->track_number = track_number;
+    ripper->is_ripping = TRUE;
+
+    if (!br_track_bin_link (ripper)) {
+        return FALSE;
+    }
+
+    BANSHEE_TRACE_ASYNC_BEGIN ("ripper", "read", ripper);
+
+    if (resume) {
+        banshee_log_debug ("ripper", "Continuing the disc read with track %d", track_number);
+        return TRUE;
+    }
+    
+    // Begin the rip
+    g_object_set (G_OBJECT (ripper->cddasrc), "track", track_number, NULL);
+    gst_element_set_state (ripper->pipeline, GST_STATE_PLAYING);
+    
+    return TRUE;
+}
+
+// ---------------------------------------------------------------------------
+// Spooled Rips
+// ---------------------------------------------------------------------------
+
+static void
+br_spool_track_free (BansheeRipperTrack *track)
+{
+    if (track->bus_watch_id != 0) {
+        g_source_remove (track->bus_watch_id);
+    }
+
+    if (track->pipeline != NULL) {
+        gst_element_set_state (track->pipeline, GST_STATE_NULL);
+        gst_object_unref (track->pipeline);
+    }
+
+    if (track->spool_path != NULL) {
+        g_unlink (track->spool_path);
+        g_free (track->spool_path);
+    }
+
+    if (track->tags != NULL) {
+        gst_tag_list_unref (track->tags);
+    }
+
+    if (track->repair_file != NULL) {
+        fclose (track->repair_file);
+    }
+
+    if (track->damage != NULL) {
+        g_array_free (track->damage, TRUE);
+    }
+
+    g_free (track->output_path);
+    g_free (track);
+}
+
+static void
+br_spool_clear (BansheeRipper *ripper)
+{
+    BansheeRipperTrack *track;
+
+    if (ripper->reading != NULL) {
+        br_spool_track_free (ripper->reading);
+        ripper->reading = NULL;
+    }
+
+    if (ripper->requested != NULL) {
+        while ((track = g_queue_pop_head (ripper->requested)) != NULL) {
+            br_spool_track_free (track);
+        }
+    }
+
+    if (ripper->spooled != NULL) {
+        while ((track = g_queue_pop_head (ripper->spooled)) != NULL) {
+            br_spool_track_free (track);
+        }
+    }
+
+    if (ripper->repairing != NULL) {
+        br_spool_track_free (ripper->repairing);
+        ripper->repairing = NULL;
+    }
+
+    if (ripper->damaged != NULL) {
+        while ((track = g_queue_pop_head (ripper->damaged)) != NULL) {
+            br_spool_track_free (track);
+        }
+    }
+
+    g_list_foreach (ripper->encoding, (GFunc)br_spool_track_free, NULL);
+    g_list_free (ripper->encoding);
+    ripper->encoding = NULL;
+    ripper->spool_size = 0;
+}
+
+// Spool files of a rip that never finished, say because Banshee crashed,
+// are not reused and would otherwise pile up in the spool directory
+static void
+br_spool_remove_leftovers (const gchar *directory)
+{
+    const gchar *name;
+    GDir *dir;
+
+    if ((dir = g_dir_open (directory, 0, NULL)) == NULL) {
+        return;
+    }
+
+    while ((name = g_dir_read_name (dir)) != NULL) {
+        gchar *path;
+
+        if (!g_str_has_suffix (name, ".wav")) {
+            continue;
+        }
+
+        path = g_build_filename (directory, name, NULL);
+        g_unlink (path);
+        g_free (path);
+    }
+
+    g_dir_close (dir);
+}
+
+static void
+br_spool_pad_added (GstElement *parser, GstPad *pad, gpointer data)
+{
+    BansheeRipperTrack *track = (BansheeRipperTrack *)data;
+    GstPad *sink = gst_element_get_static_pad (track->encoder, "sink");
+
+    if (sink != NULL && !gst_pad_is_linked (sink)) {
+        gst_pad_link (pad, sink);
+    }
+
+    if (sink != NULL) {
+        gst_object_unref (sink);
+    }
+}
+
+static void br_spool_encode_next (BansheeRipper *ripper);
+static void br_spool_read_next (BansheeRipper *ripper);
+static gboolean br_repair_collect (BansheeRipper *ripper, BansheeRipperTrack *track);
+static void br_repair_next (BansheeRipper *ripper);
+
+static gboolean
+br_spool_bus_callback (GstBus *bus, GstMessage *message, gpointer data)
+{
+    BansheeRipperTrack *track = (BansheeRipperTrack *)data;
+    BansheeRipper *ripper = track->ripper;
+    gint number = track->number;
+
+    switch (GST_MESSAGE_TYPE (message)) {
+        case GST_MESSAGE_ERROR: {
+            GError *error;
+            gchar *debug;
+
+            BANSHEE_TRACE_ASYNC_END ("ripper", "encode", track);
+
+            ripper->encoding = g_list_remove (ripper->encoding, track);
+            ripper->spool_size -= MIN (ripper->spool_size, track->spool_size);
+            BANSHEE_TRACE_COUNTER ("ripper", "spool-bytes", ripper->spool_size);
+
+            track->bus_watch_id = 0;
+            br_spool_track_free (track);
+            ripper->is_ripping = FALSE;
+
+            gst_message_parse_error (message, &error, &debug);
+            br_raise_error (ripper, error->message, debug);
+            g_error_free (error);
+            g_free (debug);
+            return FALSE;
+        }
+
+        case GST_MESSAGE_EOS: {
+            gint64 now = g_get_monotonic_time ();
+
+            BANSHEE_TRACE_ASYNC_END ("ripper", "encode", track);
+            br_report_mime_type (ripper, track->encoder);
+
+            ripper->encoding = g_list_remove (ripper->encoding, track);
+            ripper->encoded_bytes += track->spool_size;
+            ripper->spool_size -= MIN (ripper->spool_size, track->spool_size);
+            if (ripper->encoding == NULL) {
+                ripper->encode_usec += now - ripper->encode_started;
+            }
+            BANSHEE_TRACE_COUNTER ("ripper", "spool-bytes", ripper->spool_size);
+
+            track->bus_watch_id = 0;
+            br_spool_track_free (track);
+
+            br_spool_encode_next (ripper);
+            br_spool_read_next (ripper);
+
+            ripper->is_ripping = ripper->reading != NULL || ripper->encoding != NULL ||
+                ripper->repairing != NULL || !g_queue_is_empty (ripper->damaged) ||
+                !g_queue_is_empty (ripper->requested) || !g_queue_is_empty (ripper->spooled);
+
+            // The ripper may be gone once this returns
+            if (ripper->finished_cb != NULL) {
+                ripper->finished_cb (ripper, number);
+            }
+            return FALSE;
+        }
+
+        default: break;
+    }
+
+    return TRUE;
+}
+
+static gboolean
+br_spool_encode_start (BansheeRipper *ripper, BansheeRipperTrack *track)
+{
+    GstElement *source, *parser, *sink;
+    GError *error = NULL;
+    gboolean tagging_supported;
+    GstBus *bus;
+
+    track->encoder = br_pipeline_build_encoder (ripper->encoder_pipeline, &error);
+    if (track->encoder == NULL) {
+        br_raise_error (ripper, _("Could not create encoder pipeline"), error != NULL ? error->message : NULL);
+        if (error != NULL) {
+            g_error_free (error);
+        }
+        return FALSE;
+    }
+
+    source = gst_element_factory_make ("filesrc", "filesrc");
+    parser = gst_element_factory_make ("wavparse", "wavparse");
+    sink = gst_element_factory_make ("filesink", "filesink");
+    if (source == NULL || parser == NULL || sink == NULL) {
+        br_raise_error (ripper, _("Could not create encoding pipeline"), NULL);
+        gst_object_unref (gst_object_ref_sink (track->encoder));
+        track->encoder = NULL;
+        if (source != NULL) {
+            gst_object_unref (gst_object_ref_sink (source));
+        }
+        if (parser != NULL) {
+            gst_object_unref (gst_object_ref_sink (parser));
+        }
+        if (sink != NULL) {
+            gst_object_unref (gst_object_ref_sink (sink));
+        }
+        return FALSE;
+    }
+
+    g_object_set (G_OBJECT (source), "location", track->spool_path, NULL);
+    g_object_set (G_OBJECT (sink), "location", track->output_path, NULL);
+    br_encoder_set_tags (track->encoder, track->tags, &tagging_supported);
+
+    track->pipeline = gst_pipeline_new (NULL);
+    gst_bin_add_many (GST_BIN (track->pipeline), source, parser, track->encoder, sink, NULL);
+    if (!gst_element_link (source, parser) || !gst_element_link (track->encoder, sink)) {
+        // The pipeline owns the elements now and goes with the track
+        br_raise_error (ripper, _("Could not link pipeline elements"), NULL);
+        return FALSE;
+    }
+
+    g_signal_connect (parser, "pad-added", G_CALLBACK (br_spool_pad_added), track);
+
+    bus = gst_pipeline_get_bus (GST_PIPELINE (track->pipeline));
+    track->bus_watch_id = gst_bus_add_watch (bus, br_spool_bus_callback, track);
+    gst_object_unref (bus);
+
+    BANSHEE_TRACE_ASYNC_BEGIN ("ripper", "encode", track);
+    gst_element_set_state (track->pipeline, GST_STATE_PLAYING);
+    return TRUE;
+}
+
+static void
+br_spool_encode_next (BansheeRipper *ripper)
+{
+    BansheeRipperTrack *track;
+
+    while (g_list_length (ripper->encoding) < ripper->max_encoders &&
+        (track = g_queue_pop_head (ripper->spooled)) != NULL) {
+        if (ripper->encoding == NULL) {
+            ripper->encode_started = g_get_monotonic_time ();
+        }
+
+        ripper->encoding = g_list_append (ripper->encoding, track);
+        if (!br_spool_encode_start (ripper, track)) {
+            return;
+        }
+    }
+}
+
+// Starts reading the next requested track unless the drive is busy or the
+// spool is full; a full spool holds the source at the track boundary
+static void
+br_spool_read_next (BansheeRipper *ripper)
+{
+    BansheeRipperTrack *track;
+    gchar *name;
+
+    if (ripper->reading != NULL || ripper->repairing != NULL || g_queue_is_empty (ripper->requested)) {
+        return;
+    }
+
+    if (ripper->spool_size >= ripper->spool_limit && ripper->encoding != NULL) {
+        return;
+    }
+
+    track = g_queue_pop_head (ripper->requested);
+    name = g_strdup_printf ("%p-%02d.wav", ripper, track->number);
+    track->spool_path = g_build_filename (ripper->spool_dir, name, NULL);
+    g_free (name);
+
+    ripper->reading = track;
+    ripper->read_started = g_get_monotonic_time ();
+
+    br_read_track (ripper, track->number, track->spool_path, NULL, NULL);
+}
+
+// Called when the drive finished reading a track into the spool
+static void
+br_spool_track_read (BansheeRipper *ripper)
+{
+    BansheeRipperTrack *track = ripper->reading;
+    struct stat info;
+
+    if (track == NULL) {
+        return;
+    }
+
+    ripper->reading = NULL;
+    ripper->read_usec += g_get_monotonic_time () - ripper->read_started;
+
+    if (g_stat (track->spool_path, &info) == 0) {
+        track->spool_size = info.st_size;
+        ripper->spool_size += track->spool_size;
+        ripper->read_bytes += track->spool_size;
+    }
+    BANSHEE_TRACE_COUNTER ("ripper", "spool-bytes", ripper->spool_size);
+
+    if (br_repair_collect (ripper, track)) {
+        g_queue_push_tail (ripper->damaged, track);
+    } else {
+        g_queue_push_tail (ripper->spooled, track);
+    }
+
+    br_spool_encode_next (ripper);
+    br_spool_read_next (ripper);
+    br_repair_next (ripper);
+}
+
+// ---------------------------------------------------------------------------
+// Adaptive Paranoia
+// ---------------------------------------------------------------------------
+
+static gint
+br_sector_compare (gconstpointer a, gconstpointer b)
+{
+    return *(const gint *)a - *(const gint *)b;
+}
+
+// Takes the bad sectors of the fast read that fall into the track just
+// read and merges them, with a margin around each, into the track's damaged
+// ranges. Sectors past the track belong to the one the drive went on with.
+// Returns whether the track needs repairing.
+static gboolean
+br_repair_collect (BansheeRipper *ripper, BansheeRipperTrack *track)
+{
+    gint64 first = ripper->track_first_sector;
+    gint64 end = ripper->track_end_sector;
+    guint i;
+
+    if (!ripper->adaptive_active) {
+        return FALSE;
+    }
+
+    g_mutex_lock (ripper->error_lock);
+    g_array_sort (ripper->error_sectors, br_sector_compare);
+
+    for (i = 0; i < ripper->error_sectors->len; i++) {
+        gint64 sector = g_array_index (ripper->error_sectors, gint, i);
+        BansheeRipperRange range;
+
+        if (sector >= end) {
+            break;
+        } else if (first < 0 || sector < first) {
+            continue;
+        }
+
+        range.start = MAX (first, sector - BR_REPAIR_MARGIN);
+        range.end = MIN (end, sector + 1 + BR_REPAIR_MARGIN);
+
+        if (track->damage == NULL) {
+            track->damage = g_array_new (FALSE, FALSE, sizeof (BansheeRipperRange));
+        } else if (track->damage->len > 0) {
+            BansheeRipperRange *last = &g_array_index (track->damage, BansheeRipperRange,
+                track->damage->len - 1);
+            if (range.start <= last->end) {
+                last->end = MAX (last->end, range.end);
+                continue;
+            }
+        }
+
+        g_array_append_val (track->damage, range);
+    }
+
+    g_array_remove_range (ripper->error_sectors, 0, i);
+    g_mutex_unlock (ripper->error_lock);
+
+    track->first_sector = first;
+
+    if (track->damage == NULL) {
+        return FALSE;
+    }
+
+    banshee_log_debug ("ripper", "Track %d has %u damaged ranges, re-reading them after the disc",
+        track->number, track->damage->len);
+    return TRUE;
+}
+
+// Offset of the samples in a WAV file, or -1 if it has no data chunk
+static glong
+br_wav_data_offset (FILE *file)
+{
+    guint8 header[12];
+    guint8 chunk[8];
+
+    if (fseek (file, 0, SEEK_SET) != 0 || fread (header, 1, sizeof (header), file) != sizeof (header) ||
+        memcmp (header, "RIFF", 4) != 0 || memcmp (header + 8, "WAVE", 4) != 0) {
+        return -1;
+    }
+
+    while (fread (chunk, 1, sizeof (chunk), file) == sizeof (chunk)) {
+        guint32 size = GST_READ_UINT32_LE (chunk + 4);
+
+        if (memcmp (chunk, "data", 4) == 0) {
+            return ftell (file);
+        }
+
+        if (fseek (file, size + (size & 1), SEEK_CUR) != 0) {
+            break;
+        }
+    }
+
+    return -1;
+}
+
+// Writes the paranoid read over the spooled samples at the same position;
+// called from the streaming thread
+static void
+br_repair_handoff_cb (GstElement *sink, GstBuffer *buffer, GstPad *pad, gpointer data)
+{
+    BansheeRipperTrack *track = (BansheeRipperTrack *)data;
+    GstClockTime timestamp = GST_BUFFER_PTS (buffer);
+    GstMapInfo map;
+    glong offset;
+
+    if (!GST_CLOCK_TIME_IS_VALID (timestamp) || !gst_buffer_map (buffer, &map, GST_MAP_READ)) {
+        return;
+    }
+
+    offset = track->data_offset + gst_util_uint64_scale_int_round (timestamp, 44100, GST_SECOND) * 4;
+    if (fseek (track->repair_file, offset, SEEK_SET) == 0) {
+        fwrite (map.data, 1, map.size, track->repair_file);
+    }
+
+    gst_buffer_unmap (buffer, &map);
+}
+
+static gboolean
+br_repair_seek (BansheeRipperTrack *track)
+{
+    BansheeRipperRange *range = &g_array_index (track->damage, BansheeRipperRange, track->damage_index);
+
+    return gst_element_seek (track->pipeline, 1.0, GST_FORMAT_TIME,
+        GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_ACCURATE,
+        GST_SEEK_TYPE_SET, BR_SECTOR_TIME (range->start - track->first_sector),
+        GST_SEEK_TYPE_SET, BR_SECTOR_TIME (range->end - track->first_sector));
+}
+
+static void
+br_repair_release (BansheeRipperTrack *track)
+{
+    if (track->bus_watch_id != 0) {
+        g_source_remove (track->bus_watch_id);
+        track->bus_watch_id = 0;
+    }
+
+    if (track->pipeline != NULL) {
+        gst_element_set_state (track->pipeline, GST_STATE_NULL);
+        gst_object_unref (track->pipeline);
+        track->pipeline = NULL;
+    }
+
+    if (track->repair_file != NULL) {
+        fclose (track->repair_file);
+        track->repair_file = NULL;
+    }
+}
+
+// Done with the repairs of a track, whether they all went through or not;
+// the fast read is kept wherever they did not
+static void
+br_repair_finish (BansheeRipper *ripper, BansheeRipperTrack *track)
+{
+    BANSHEE_TRACE_ASYNC_END ("ripper", "repair", track);
+    br_repair_release (track);
+
+    ripper->repairing = NULL;
+    g_queue_push_tail (ripper->spooled, track);
+
+    br_spool_encode_next (ripper);
+    br_spool_read_next (ripper);
+    br_repair_next (ripper);
+}
+
+static gboolean
+br_repair_bus_callback (GstBus *bus, GstMessage *message, gpointer data)
+{
+    BansheeRipperTrack *track = (BansheeRipperTrack *)data;
+    BansheeRipper *ripper = track->ripper;
+
+    switch (GST_MESSAGE_TYPE (message)) {
+        case GST_MESSAGE_ASYNC_DONE:
+            // Prerolled at the start of the track, go to the first range
+            if (!track->repair_started) {
+                track->repair_started = TRUE;
+                if (!br_repair_seek (track)) {
+                    break;
+                }
+                gst_element_set_state (track->pipeline, GST_STATE_PLAYING);
+            }
+            return TRUE;
+
+        case GST_MESSAGE_EOS:
+            // Each range ends in EOS at its stop position
+            if (++track->damage_index < track->damage->len && br_repair_seek (track)) {
+                return TRUE;
+            }
+            break;
+
+        case GST_MESSAGE_ERROR: {
+            GError *error;
+            gchar *debug;
+
+            gst_message_parse_error (message, &error, &debug);
+            banshee_log_debug ("ripper", "Could not repair track %d: %s", track->number, error->message);
+            g_error_free (error);
+            g_free (debug);
+            break;
+        }
+
+        default:
+            return TRUE;
+    }
+
+    track->bus_watch_id = 0;
+    br_repair_finish (ripper, track);
+    return FALSE;
+}
+
+static gboolean
+br_repair_start (BansheeRipper *ripper, BansheeRipperTrack *track)
+{
+    GstElement *source, *sink;
+    gchar *uri;
+    GstBus *bus;
+    guint i;
+
+    track->repair_file = g_fopen (track->spool_path, "r+b");
+    if (track->repair_file == NULL || (track->data_offset = br_wav_data_offset (track->repair_file)) < 0) {
+        return FALSE;
+    }
+
+    uri = g_strdup_printf ("cdda://%d", track->number);
+    source = gst_element_make_from_uri (GST_URI_SRC, uri, NULL, NULL);
+    g_free (uri);
+
+    sink = gst_element_factory_make ("fakesink", NULL);
+    if (source == NULL || sink == NULL) {
+        if (source != NULL) {
+            gst_object_unref (gst_object_ref_sink (source));
+        }
+        if (sink != NULL) {
+            gst_object_unref (gst_object_ref_sink (sink));
+        }
+        return FALSE;
+    }
+
+    g_object_set (G_OBJECT (source), "device", ripper->device, "paranoia-mode", ripper->paranoia_mode, NULL);
+    g_object_set (G_OBJECT (sink), "signal-handoffs", TRUE, "sync", FALSE, NULL);
+    g_signal_connect (sink, "handoff", G_CALLBACK (br_repair_handoff_cb), track);
+
+    track->pipeline = gst_pipeline_new (NULL);
+    gst_bin_add_many (GST_BIN (track->pipeline), source, sink, NULL);
+    if (!gst_element_link (source, sink)) {
+        return FALSE;
+    }
+
+    bus = gst_pipeline_get_bus (GST_PIPELINE (track->pipeline));
+    track->bus_watch_id = gst_bus_add_watch (bus, br_repair_bus_callback, track);
+    gst_object_unref (bus);
+
+    for (i = 0; i < track->damage->len; i++) {
+        BansheeRipperRange *range = &g_array_index (track->damage, BansheeRipperRange, i);
+        ripper->repaired_sectors += range->end - range->start;
+    }
+
+    track->damage_index = 0;
+    track->repair_started = FALSE;
+    if (gst_element_set_state (track->pipeline, GST_STATE_PAUSED) == GST_STATE_CHANGE_FAILURE) {
+        return FALSE;
+    }
+
+    BANSHEE_TRACE_ASYNC_BEGIN ("ripper", "repair", track);
+    return TRUE;
+}
+
+// Re-reads the damaged tracks once the drive is free, letting go of the
+// fast read's pipeline first
+static void
+br_repair_next (BansheeRipper *ripper)
+{
+    BansheeRipperTrack *track;
+
+    if (ripper->repairing != NULL || ripper->reading != NULL || !g_queue_is_empty (ripper->requested)) {
+        return;
+    }
+
+    while ((track = g_queue_pop_head (ripper->damaged)) != NULL) {
+        br_pipeline_destroy (ripper);
+
+        ripper->repairing = track;
+        if (br_repair_start (ripper, track)) {
+            return;
+        }
+
+        banshee_log_debug ("ripper", "Could not repair track %d, keeping the fast read", track->number);
+        br_repair_release (track);
+
+        ripper->repairing = NULL;
+        g_queue_push_tail (ripper->spooled, track);
+        br_spool_encode_next (ripper);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Internal Functions
+// ---------------------------------------------------------------------------
+
+void br_get_spool_stats (BansheeRipper *ripper, gdouble *read_speed, gdouble *encode_speed);
+
+BansheeRipper *
+br_new (gchar *device, gint paranoia_mode, gchar *encoder_pipeline)
+{
+    BansheeRipper *ripper = g_new0 (BansheeRipper, 1);
+    
+    if (ripper == NULL) {
+        return NULL;
+    }
+        
+    ripper->device = g_strdup (device);
+    ripper->paranoia_mode = paranoia_mode;
+    ripper->encoder_pipeline = g_strdup (encoder_pipeline);
+    ripper->progress_step = BR_PROGRESS_STEP;
+    ripper->requested = g_queue_new ();
+    ripper->spooled = g_queue_new ();
+    ripper->damaged = g_queue_new ();
+    ripper->error_lock = g_mutex_new ();
+    ripper->error_sectors = g_array_new (FALSE, FALSE, sizeof (gint));
+
+    return ripper;
+}
+
+void 
+br_cancel (BansheeRipper *ripper)
+{
+    g_return_if_fail (ripper != NULL);
+    
+    br_pipeline_destroy (ripper);
+    br_spool_clear (ripper);
+    ripper->is_ripping = FALSE;
+}
+
+void
+br_destroy (BansheeRipper *ripper)
+{
+    g_return_if_fail (ripper != NULL);
+    
+    br_cancel (ripper);
+    banshee_encoder_bin_cache_log_stats ("ripper");
+
+    if (ripper->spool_dir != NULL) {
+        gdouble read_speed, encode_speed;
+        br_get_spool_stats (ripper, &read_speed, &encode_speed);
+        banshee_log_debug ("ripper", "Read the disc at %.1fx, encoded at %.1fx", read_speed, encode_speed);
+        g_free (ripper->spool_dir);
+    }
+
+    if (ripper->repaired_sectors > 0) {
+        banshee_log_debug ("ripper", "Re-read %" G_GUINT64_FORMAT " damaged sectors in paranoid mode",
+            ripper->repaired_sectors);
+    }
+
+    g_queue_free (ripper->requested);
+    g_queue_free (ripper->spooled);
+    g_queue_free (ripper->damaged);
+    g_mutex_free (ripper->error_lock);
+    g_array_free (ripper->error_sectors, TRUE);
+    
+    if (ripper->device != NULL) {
+        g_free (ripper->device);
+    }
+    
+    if (ripper->encoder_pipeline != NULL) {
+        g_free (ripper->encoder_pipeline);
+    }
+    
+    g_free (ripper);
+    ripper = NULL;
+}
+
+gboolean
+br_rip_track (BansheeRipper *ripper, gint track_number, gchar *output_path, 
+    GstTagList *tags, gboolean *tagging_supported)
+{
+    BansheeRipperTrack *track;
+    GstElement *encoder;
+
+    g_return_val_if_fail (ripper != NULL, FALSE);
+
+    if (ripper->spool_dir == NULL) {
+        return br_read_track (ripper, track_number, output_path, tags, tagging_supported);
+    }
+
+    // Spooled tracks are only encoded later, so whether they can be tagged
+    // is answered from an encoder built for the purpose
+    encoder = br_pipeline_build_encoder (ripper->encoder_pipeline, NULL);
+    if (encoder != NULL) {
+        gst_object_ref_sink (encoder);
+        br_encoder_set_tags (encoder, NULL, tagging_supported);
+        gst_object_unref (encoder);
+    }
+
+    track = g_new0 (BansheeRipperTrack, 1);
+    track->ripper = ripper;
+    track->number = track_number;
+    track->output_path = g_strdup (output_path);
+    track->tags = tags != NULL ? gst_tag_list_ref (tags) : NULL;
+
+    g_queue_push_tail (ripper->requested, track);
+    ripper->is_ripping = TRUE;
+    br_spool_read_next (ripper);
+
+    return TRUE;
+}
+
+// Reads the disc in one pipeline as long as tracks are ripped in order,
+// rather than setting up the drive again for every track
+void
+br_set_whole_disc (BansheeRipper *ripper, gboolean whole_disc)
+{
+    g_return_if_fail (ripper != NULL);
+
+    if (ripper->whole_disc != whole_disc) {
+        br_pipeline_destroy (ripper);
+        ripper->whole_disc = whole_disc;
+    }
+}
+
+// Reads tracks into raw PCM files under directory and encodes them from
+// there on up to max_encoders cores (0 for one per processor), so the drive
+// is never waiting for an encoder. Reading pauses while more than
+// spool_limit bytes wait to be encoded. A NULL directory turns this off.
+// Spooled rips take every track to rip upfront and report them finished as
+// their encoding completes, not necessarily in order. Returns whether
+// rips are spooled.
+gboolean
+br_set_spool (BansheeRipper *ripper, const gchar *directory, guint64 spool_limit, gint max_encoders)
+{
+    g_return_val_if_fail (ripper != NULL, FALSE);
+
+    br_cancel (ripper);
+    g_free (ripper->spool_dir);
+    ripper->spool_dir = NULL;
+
+    if (directory == NULL || g_mkdir_with_parents (directory, 0755) != 0) {
+        return FALSE;
+    }
+
+    if (max_encoders <= 0) {
+#if GLIB_CHECK_VERSION(2,36,0)
+        max_encoders = MIN (g_get_num_processors (), BR_MAX_ENCODERS);
+#else
+        max_encoders = 2;
+#endif
+    }
+
+    br_spool_remove_leftovers (directory);
+
+    ripper->spool_dir = g_strdup (directory);
+    ripper->spool_limit = spool_limit;
+    ripper->max_encoders = max_encoders;
+
+    return TRUE;
+}
+
+// Reads spooled whole disc rips in a fast paranoia mode first and re-reads
+// only the sectors cdparanoia reported as bad, in the ripper's paranoia
+// mode, before their tracks are encoded. Sources not reporting bad sectors
+// always read in the ripper's paranoia mode.
+void
+br_set_adaptive_paranoia (BansheeRipper *ripper, gboolean adaptive)
+{
+    g_return_if_fail (ripper != NULL);
+
+    if (ripper->adaptive != adaptive) {
+        br_pipeline_destroy (ripper);
+        ripper->adaptive = adaptive;
+    }
+}
+
+// Speeds of the drive reads and of the encoders so far, as multiples of
+// real time
+void
+br_get_spool_stats (BansheeRipper *ripper, gdouble *read_speed, gdouble *encode_speed)
+{
+    gint64 encode_usec;
+
+    g_return_if_fail (ripper != NULL);
+
+    encode_usec = ripper->encode_usec;
+    if (ripper->encoding != NULL) {
+        encode_usec += g_get_monotonic_time () - ripper->encode_started;
+    }
+
+    if (read_speed != NULL) {
+        *read_speed = ripper->read_usec > 0
+            ? ((gdouble)ripper->read_bytes / BR_CDDA_BYTE_RATE) / (ripper->read_usec / (gdouble)G_USEC_PER_SEC)
+            : 0.0;
+    }
+
+    if (encode_speed != NULL) {
+        *encode_speed = encode_usec > 0
+            ? ((gdouble)ripper->encoded_bytes / BR_CDDA_BYTE_RATE) / (encode_usec / (gdouble)G_USEC_PER_SEC)
+            : 0.0;
+    }
+}
+
+void
+br_set_progress_callback (BansheeRipper *ripper, BansheeRipperProgressCallback cb)
+{
+    g_return_if_fail (ripper != NULL);
+    ripper->progress_cb = cb;
+}
+
+// Minimum change of progress, as a fraction of the track, between two
+// progress callbacks
+void
+br_set_progress_step (BansheeRipper *ripper, gdouble step)
+{
+    g_return_if_fail (ripper != NULL);
+    ripper->progress_step = step;
+
+    if (ripper->progress_probe != NULL) {
+        banshee_progress_probe_set_step (ripper->progress_probe, step);
+    }
 }
 
 void
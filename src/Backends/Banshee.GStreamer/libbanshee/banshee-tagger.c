@@ -30,10 +30,34 @@
 #  include "config.h"
 #endif
 
+#include <string.h>
 #include <glib/gstdio.h>
 
 #include "banshee-tagger.h"
 
+typedef enum {
+    BT_TAG_TYPE_STRING,
+    BT_TAG_TYPE_UINT,
+    BT_TAG_TYPE_DATE
+} BansheeTagType;
+
+// One value for bt_tag_list_add_entries: tag is an id from bt_tag_intern,
+// and the value is read from the field matching type. Strings are passed
+// as the offset of a NUL terminated UTF-8 string in the strings block.
+typedef struct {
+    gint tag;
+    gint type;
+    gint string_offset;
+    guint number;
+    gint year;
+    gint month;
+    gint day;
+} BansheeTagEntry;
+
+// Interned tag names, indexed by the ids handed out by bt_tag_intern
+G_LOCK_DEFINE_STATIC (bt_tags);
+static GPtrArray *bt_tags = NULL;
+
 // ---------------------------------------------------------------------------
 // Private Functions
 // ---------------------------------------------------------------------------
@@ -84,20 +108,101 @@ bt_tag_list_add_value (GstTagList *list, const gchar *tag_name, const GValue *va
     gst_tag_list_add_values (list, GST_TAG_MERGE_REPLACE, tag_name, value, NULL);
 }
 
+// Id of tag_name for bt_tag_list_add_entries, the same for every call with
+// the same name
+gint
+bt_tag_intern (const gchar *tag_name)
+{
+    const gchar *tag;
+    guint i;
+
+    g_return_val_if_fail (tag_name != NULL, -1);
+
+    tag = g_intern_string (tag_name);
+
+    G_LOCK (bt_tags);
+
+    if (bt_tags == NULL) {
+        bt_tags = g_ptr_array_new ();
+    }
+
+    for (i = 0; i < bt_tags->len; i++) {
+        if (g_ptr_array_index (bt_tags, i) == tag) {
+            break;
+        }
+    }
+
+    if (i == bt_tags->len) {
+        g_ptr_array_add (bt_tags, (gpointer)tag);
+    }
+
+    G_UNLOCK (bt_tags);
+
+    return (gint)i;
+}
+
+// Adds count values in one go, replacing earlier values of the same tags;
+// entries with an unknown tag id, an invalid date or a string outside the
+// strings block are skipped
 void
-bt_tag_list_add_date (GstTagList *list, gint year, gint month, gint day)
+bt_tag_list_add_entries (GstTagList *list, const BansheeTagEntry *entries, gint count,
+    const gchar *strings, gint strings_length)
 {
-    GDate *date;
-    
-    if (!g_date_valid_dmy (day, month, year)) {
-        return;
+    gint i;
+
+    g_return_if_fail (list != NULL);
+    g_return_if_fail (entries != NULL || count == 0);
+    g_return_if_fail (strings != NULL || strings_length == 0);
+
+    G_LOCK (bt_tags);
+
+    for (i = 0; i < count; i++) {
+        const BansheeTagEntry *entry = &entries[i];
+        GValue value = { 0, };
+
+        if (bt_tags == NULL || entry->tag < 0 || (guint)entry->tag >= bt_tags->len) {
+            continue;
+        }
+
+        switch (entry->type) {
+            case BT_TAG_TYPE_STRING:
+                if (entry->string_offset < 0 || entry->string_offset >= strings_length ||
+                    memchr (strings + entry->string_offset, '\0',
+                        strings_length - entry->string_offset) == NULL) {
+                    continue;
+                }
+                g_value_init (&value, G_TYPE_STRING);
+                g_value_set_string (&value, strings + entry->string_offset);
+                break;
+
+            case BT_TAG_TYPE_UINT:
+                g_value_init (&value, G_TYPE_UINT);
+                g_value_set_uint (&value, entry->number);
+                break;
+
+            case BT_TAG_TYPE_DATE: {
+                GDate *date;
+
+                if (!g_date_valid_dmy (entry->day, entry->month, entry->year)) {
+                    continue;
+                }
+
+                date = g_date_new_dmy (entry->day, entry->month, entry->year);
+                g_value_init (&value, G_TYPE_DATE);
+                g_value_take_boxed (&value, date);
+                break;
+            }
+
+            default:
+                continue;
+        }
+
+        gst_tag_list_add_value (list, GST_TAG_MERGE_REPLACE,
+            (const gchar *)g_ptr_array_index (bt_tags, entry->tag), &value);
+        g_value_unset (&value);
     }
-    
-    date = g_date_new ();
-    g_date_clear (date, 1);
-    g_date_set_dmy (date, day, month, year);
-    
-    gst_tag_list_add (list, GST_TAG_MERGE_REPLACE, GST_TAG_DATE, date, NULL);
+
+    G_UNLOCK (bt_tags);
 }
 
 void
@@ -0,0 +1,555 @@
+//
+// banshee-thumbnailer.c
+//
+// Copyright (C) 2026 Banshee Project Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <glib/gstdio.h>
+#include <gst/video/video.h>
+
+#include "banshee-gst.h"
+#include "banshee-batch-pool.h"
+#include "banshee-thumbnailer.h"
+
+#define BTH_DEFAULT_WIDTH      160
+#define BTH_DEFAULT_BATCH_SIZE  64
+
+// How long opening, seeking or converting one frame may take
+#define BTH_TIMEOUT            (10 * GST_SECOND)
+
+#define BTH_PLAY_FLAG_VIDEO    (1 << 0)
+
+// One URI and the settings it was added with
+typedef struct {
+    gchar *uri;
+    BansheeThumbnailerFormat format;
+    gint width;
+    gint n_positions;
+    gdouble positions[BTH_MAX_POSITIONS];
+} BthJob;
+
+// A playbin that only decodes video, kept between URIs; it is left in
+// READY or NULL after each one
+typedef struct {
+    GstElement *playbin;
+    GstBus *bus;
+} BthWorker;
+
+struct BansheeThumbnailer {
+    gchar *directory;
+
+    BansheeThumbnailerFormat format;
+    gint width;
+    gint n_positions;
+    gdouble positions[BTH_MAX_POSITIONS];
+
+    // Playbins are kept here between jobs; there are never more of them
+    // than threads in the pool
+    BansheeBatchPool *pool;
+    GAsyncQueue *workers;
+
+    BansheeThumbnailerRecordsCallback records_cb;
+    BansheeThumbnailerFinishedCallback finished_cb;
+};
+
+// ---------------------------------------------------------------------------
+// Private Functions
+// ---------------------------------------------------------------------------
+
+static void
+bth_job_free (BthJob *job)
+{
+    g_free (job->uri);
+    g_free (job);
+}
+
+static void
+bth_record_clear (BansheeThumbnailerRecord *record)
+{
+    g_free ((gchar *)record->uri);
+    g_strfreev ((gchar **)record->paths);
+}
+
+static gint
+bth_position_compare (gconstpointer a, gconstpointer b)
+{
+    gdouble a_position = *(const gdouble *)a;
+    gdouble b_position = *(const gdouble *)b;
+    return a_position < b_position ? -1 : (a_position > b_position ? 1 : 0);
+}
+
+// Names the images of a job after its URI, the size and modification time
+// of the file behind it (when it is local) and the settings, so they go
+// stale when any of those change
+static gchar **
+bth_job_paths (BansheeThumbnailer *thumbnailer, BthJob *job)
+{
+    GChecksum *checksum;
+    struct stat info;
+    gint64 size = 0, mtime = 0;
+    gchar *path, **paths;
+    gint i;
+
+    path = g_filename_from_uri (job->uri, NULL, NULL);
+    if (path != NULL && g_stat (path, &info) == 0) {
+        size = info.st_size;
+        mtime = info.st_mtime;
+    }
+    g_free (path);
+
+    checksum = g_checksum_new (G_CHECKSUM_SHA1);
+    g_checksum_update (checksum, (const guchar *)job->uri, -1);
+    g_checksum_update (checksum, (const guchar *)&size, sizeof (size));
+    g_checksum_update (checksum, (const guchar *)&mtime, sizeof (mtime));
+    g_checksum_update (checksum, (const guchar *)&job->format, sizeof (job->format));
+    g_checksum_update (checksum, (const guchar *)&job->width, sizeof (job->width));
+    g_checksum_update (checksum, (const guchar *)job->positions, job->n_positions * sizeof (gdouble));
+
+    paths = g_new0 (gchar *, job->n_positions + 1);
+    for (i = 0; i < job->n_positions; i++) {
+        gchar *name = g_strdup_printf ("%s-%d.%s", g_checksum_get_string (checksum), i,
+            job->format == BTH_FORMAT_PNG ? "png" : "jpg");
+        paths[i] = g_build_filename (thumbnailer->directory, name, NULL);
+        g_free (name);
+    }
+
+    g_checksum_free (checksum);
+    return paths;
+}
+
+static gboolean
+bth_paths_exist (gchar **paths)
+{
+    gint i;
+
+    for (i = 0; paths[i] != NULL; i++) {
+        if (!g_file_test (paths[i], G_FILE_TEST_IS_REGULAR)) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static BthWorker *
+bth_worker_new (void)
+{
+    BthWorker *worker;
+    GstElement *playbin, *video_sink;
+
+    playbin = gst_element_factory_make ("playbin", NULL);
+    video_sink = gst_element_factory_make ("fakesink", NULL);
+
+    if (playbin == NULL || video_sink == NULL) {
+        if (playbin != NULL) {
+            gst_object_unref (playbin);
+        }
+        if (video_sink != NULL) {
+            gst_object_unref (video_sink);
+        }
+        return NULL;
+    }
+
+    // The frames are taken from the last sample of the sink
+    g_object_set (video_sink, "sync", FALSE, "enable-last-sample", TRUE, NULL);
+    g_object_set (playbin, "video-sink", video_sink, "flags", BTH_PLAY_FLAG_VIDEO, NULL);
+
+    worker = g_new0 (BthWorker, 1);
+    worker->playbin = playbin;
+    worker->bus = gst_element_get_bus (playbin);
+    return worker;
+}
+
+static void
+bth_worker_free (BthWorker *worker)
+{
+    gst_element_set_state (worker->playbin, GST_STATE_NULL);
+    gst_object_unref (worker->bus);
+    gst_object_unref (worker->playbin);
+    g_free (worker);
+}
+
+// Waits for the playbin to preroll after a state change or a seek
+static gboolean
+bth_worker_wait (BthWorker *worker)
+{
+    GstMessage *message;
+    gboolean result;
+
+    message = gst_bus_timed_pop_filtered (worker->bus, BTH_TIMEOUT,
+        GST_MESSAGE_ASYNC_DONE | GST_MESSAGE_ERROR);
+    if (message == NULL) {
+        return FALSE;
+    }
+
+    if (GST_MESSAGE_TYPE (message) == GST_MESSAGE_ERROR) {
+        GError *error = NULL;
+        gst_message_parse_error (message, &error, NULL);
+        banshee_log_debug ("thumbnailer", "%s", error->message);
+        g_error_free (error);
+    }
+
+    result = GST_MESSAGE_TYPE (message) == GST_MESSAGE_ASYNC_DONE;
+    gst_message_unref (message);
+    return result;
+}
+
+// Scales the frame the playbin prerolled to the job's width, keeping its
+// display aspect ratio, and saves it encoded at path
+static gboolean
+bth_worker_save_frame (BthWorker *worker, BthJob *job, const gchar *path)
+{
+    GstSample *sample = NULL, *image;
+    GstStructure *structure;
+    GstCaps *caps;
+    GError *error = NULL;
+    gint width, height, par_n = 1, par_d = 1;
+    gboolean result = FALSE;
+
+    g_object_get (worker->playbin, "sample", &sample, NULL);
+    if (sample == NULL) {
+        return FALSE;
+    }
+
+    caps = gst_sample_get_caps (sample);
+    structure = caps != NULL ? gst_caps_get_structure (caps, 0) : NULL;
+    if (structure == NULL ||
+        !gst_structure_get_int (structure, "width", &width) ||
+        !gst_structure_get_int (structure, "height", &height) ||
+        width <= 0 || height <= 0) {
+        gst_sample_unref (sample);
+        return FALSE;
+    }
+    gst_structure_get_fraction (structure, "pixel-aspect-ratio", &par_n, &par_d);
+
+    height = MAX (1, (gint)gst_util_uint64_scale_int (job->width, height * par_d, width * par_n));
+
+    caps = gst_caps_new_simple (job->format == BTH_FORMAT_PNG ? "image/png" : "image/jpeg",
+        "width", G_TYPE_INT, job->width,
+        "height", G_TYPE_INT, height,
+        "pixel-aspect-ratio", GST_TYPE_FRACTION, 1, 1,
+        NULL);
+
+    image = gst_video_convert_sample (sample, caps, BTH_TIMEOUT, &error);
+    gst_caps_unref (caps);
+    gst_sample_unref (sample);
+
+    if (image != NULL) {
+        GstBuffer *buffer = gst_sample_get_buffer (image);
+        GstMapInfo map;
+
+        if (buffer != NULL && gst_buffer_map (buffer, &map, GST_MAP_READ)) {
+            result = g_file_set_contents (path, (const gchar *)map.data, map.size, &error);
+            gst_buffer_unmap (buffer, &map);
+        }
+
+        gst_sample_unref (image);
+    }
+
+    if (error != NULL) {
+        banshee_log_debug ("thumbnailer", "Could not save a frame of %s: %s", job->uri, error->message);
+        g_error_free (error);
+    }
+
+    return result;
+}
+
+// Prerolls the URI and saves a frame at each position. Only the frame at
+// the start and the keyframes the seeks land on get decoded.
+static gboolean
+bth_worker_run (BthWorker *worker, BthJob *job, gchar **paths)
+{
+    gint64 duration = -1;
+    gboolean result;
+    gint i;
+
+    g_object_set (worker->playbin, "uri", job->uri, NULL);
+    result = gst_element_set_state (worker->playbin, GST_STATE_PAUSED) != GST_STATE_CHANGE_FAILURE &&
+        bth_worker_wait (worker);
+
+    if (result && !gst_element_query_duration (worker->playbin, GST_FORMAT_TIME, &duration)) {
+        duration = -1;
+    }
+
+    // Positions are sorted, so only the first one can be the start
+    for (i = 0; result && i < job->n_positions; i++) {
+        GstClockTime position = duration > 0 ? (GstClockTime)(job->positions[i] * duration) : 0;
+
+        if (position > 0) {
+            result = gst_element_seek_simple (worker->playbin, GST_FORMAT_TIME,
+                    GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_KEY_UNIT, position) &&
+                bth_worker_wait (worker);
+        }
+
+        result = result && bth_worker_save_frame (worker, job, paths[i]);
+    }
+
+    // Close the file and drop whatever was posted on the way
+    gst_bus_set_flushing (worker->bus, TRUE);
+    gst_element_set_state (worker->playbin, result ? GST_STATE_READY : GST_STATE_NULL);
+    gst_bus_set_flushing (worker->bus, FALSE);
+
+    if (!result) {
+        for (i = 0; paths[i] != NULL; i++) {
+            g_unlink (paths[i]);
+        }
+    }
+
+    return result;
+}
+
+// Thumbnails the URI of a job on a worker thread, unless its images are
+// cached already
+static void
+bth_run (gpointer data, gpointer record_data, gpointer user_data)
+{
+    BansheeThumbnailer *thumbnailer = (BansheeThumbnailer *)user_data;
+    BansheeThumbnailerRecord *record = (BansheeThumbnailerRecord *)record_data;
+    BthJob *job = (BthJob *)data;
+    gchar **paths = bth_job_paths (thumbnailer, job);
+
+    record->uri = g_strdup (job->uri);
+
+    if (bth_paths_exist (paths)) {
+        record->success = TRUE;
+        record->cached = TRUE;
+    } else {
+        BthWorker *worker = g_async_queue_try_pop (thumbnailer->workers);
+
+        if (worker == NULL) {
+            worker = bth_worker_new ();
+        }
+
+        if (worker != NULL) {
+            BANSHEE_TRACE_BEGIN ("thumbnailer", "thumbnail");
+            record->success = bth_worker_run (worker, job, paths);
+            BANSHEE_TRACE_END ("thumbnailer", "thumbnail");
+            g_async_queue_push (thumbnailer->workers, worker);
+        } else {
+            banshee_log_debug ("thumbnailer", "Could not create a playbin");
+        }
+    }
+
+    if (record->success) {
+        record->count = job->n_positions;
+        record->paths = (const gchar * const *)paths;
+    } else {
+        g_strfreev (paths);
+    }
+}
+
+static void
+bth_records (gconstpointer records, gint count, gpointer user_data)
+{
+    BansheeThumbnailer *thumbnailer = (BansheeThumbnailer *)user_data;
+
+    if (thumbnailer->records_cb != NULL) {
+        thumbnailer->records_cb (thumbnailer, (const BansheeThumbnailerRecord *)records, count);
+    }
+}
+
+static void
+bth_finished (gpointer user_data)
+{
+    BansheeThumbnailer *thumbnailer = (BansheeThumbnailer *)user_data;
+
+    if (thumbnailer->finished_cb != NULL) {
+        thumbnailer->finished_cb (thumbnailer);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Internal Functions
+// ---------------------------------------------------------------------------
+
+BansheeThumbnailer *
+bth_new (const gchar *cache_directory, gint max_workers)
+{
+    BansheeThumbnailer *thumbnailer;
+    GError *error = NULL;
+
+    g_return_val_if_fail (cache_directory != NULL, NULL);
+
+    if (g_mkdir_with_parents (cache_directory, 0755) != 0) {
+        banshee_log_debug ("thumbnailer", "Could not create thumbnail cache %s: %s",
+            cache_directory, g_strerror (errno));
+        return NULL;
+    }
+
+    thumbnailer = g_new0 (BansheeThumbnailer, 1);
+    thumbnailer->directory = g_strdup (cache_directory);
+    thumbnailer->format = BTH_FORMAT_JPEG;
+    thumbnailer->width = BTH_DEFAULT_WIDTH;
+    thumbnailer->n_positions = 1;
+    thumbnailer->positions[0] = 1.0 / 3.0;
+    thumbnailer->workers = g_async_queue_new_full ((GDestroyNotify)bth_worker_free);
+
+    thumbnailer->pool = bbp_new (max_workers, sizeof (BansheeThumbnailerRecord), BTH_DEFAULT_BATCH_SIZE,
+        bth_run, (GDestroyNotify)bth_job_free, (BansheeBatchPoolClearFunc)bth_record_clear,
+        bth_records, bth_finished, thumbnailer, &error);
+    if (thumbnailer->pool == NULL) {
+        banshee_log_debug ("thumbnailer", "Could not create worker pool: %s", error->message);
+        g_error_free (error);
+        bth_destroy (thumbnailer);
+        return NULL;
+    }
+
+    return thumbnailer;
+}
+
+void
+bth_destroy (BansheeThumbnailer *thumbnailer)
+{
+    BthWorker *worker;
+
+    g_return_if_fail (thumbnailer != NULL);
+
+    if (thumbnailer->pool != NULL) {
+        bbp_free (thumbnailer->pool);
+    }
+
+    while ((worker = g_async_queue_try_pop (thumbnailer->workers)) != NULL) {
+        bth_worker_free (worker);
+    }
+    g_async_queue_unref (thumbnailer->workers);
+
+    g_free (thumbnailer->directory);
+    g_free (thumbnailer);
+}
+
+// Queues count URIs (or up to a NULL entry if count is negative) with the
+// current settings
+gboolean
+bth_add_uris (BansheeThumbnailer *thumbnailer, const gchar * const *uris, gint count)
+{
+    gpointer *jobs;
+    gboolean result;
+    gint i;
+
+    g_return_val_if_fail (thumbnailer != NULL, FALSE);
+    g_return_val_if_fail (uris != NULL, FALSE);
+
+    if (count < 0) {
+        count = g_strv_length ((gchar **)uris);
+    }
+
+    jobs = g_new (gpointer, MAX (count, 1));
+    for (i = 0; i < count; i++) {
+        BthJob *job = g_new0 (BthJob, 1);
+
+        job->uri = g_strdup (uris[i]);
+        job->format = thumbnailer->format;
+        job->width = thumbnailer->width;
+        job->n_positions = thumbnailer->n_positions;
+        memcpy (job->positions, thumbnailer->positions, sizeof (job->positions));
+        jobs[i] = job;
+    }
+
+    result = bbp_push (thumbnailer->pool, jobs, count);
+    g_free (jobs);
+    return result;
+}
+
+// URIs added so far that are not reported yet are dropped, including
+// those being thumbnailed; URIs added later are thumbnailed as usual.
+// finished is still called once the workers are done.
+void
+bth_cancel (BansheeThumbnailer *thumbnailer)
+{
+    g_return_if_fail (thumbnailer != NULL);
+    bbp_cancel (thumbnailer->pool);
+}
+
+gboolean
+bth_get_is_running (BansheeThumbnailer *thumbnailer)
+{
+    g_return_val_if_fail (thumbnailer != NULL, FALSE);
+    return bbp_get_is_running (thumbnailer->pool);
+}
+
+// Positions are fractions of the duration; they are clamped to [0, 1] and
+// sorted. Videos of unknown duration get every frame from the start. With
+// no positions, a single one a third into the video is used.
+void
+bth_set_positions (BansheeThumbnailer *thumbnailer, const gdouble *positions, gint count)
+{
+    gint i;
+
+    g_return_if_fail (thumbnailer != NULL);
+
+    if (positions == NULL || count <= 0) {
+        thumbnailer->n_positions = 1;
+        thumbnailer->positions[0] = 1.0 / 3.0;
+        return;
+    }
+
+    thumbnailer->n_positions = MIN (count, BTH_MAX_POSITIONS);
+    for (i = 0; i < thumbnailer->n_positions; i++) {
+        thumbnailer->positions[i] = CLAMP (positions[i], 0.0, 1.0);
+    }
+
+    qsort (thumbnailer->positions, thumbnailer->n_positions, sizeof (gdouble), bth_position_compare);
+}
+
+void
+bth_set_width (BansheeThumbnailer *thumbnailer, gint width)
+{
+    g_return_if_fail (thumbnailer != NULL);
+    thumbnailer->width = width > 0 ? width : BTH_DEFAULT_WIDTH;
+}
+
+void
+bth_set_format (BansheeThumbnailer *thumbnailer, BansheeThumbnailerFormat format)
+{
+    g_return_if_fail (thumbnailer != NULL);
+    thumbnailer->format = format;
+}
+
+void
+bth_set_batch_size (BansheeThumbnailer *thumbnailer, gint batch_size)
+{
+    g_return_if_fail (thumbnailer != NULL);
+    bbp_set_batch_size (thumbnailer->pool, batch_size > 0 ? batch_size : BTH_DEFAULT_BATCH_SIZE);
+}
+
+void
+bth_set_records_callback (BansheeThumbnailer *thumbnailer, BansheeThumbnailerRecordsCallback cb)
+{
+    g_return_if_fail (thumbnailer != NULL);
+    thumbnailer->records_cb = cb;
+}
+
+void
+bth_set_finished_callback (BansheeThumbnailer *thumbnailer, BansheeThumbnailerFinishedCallback cb)
+{
+    g_return_if_fail (thumbnailer != NULL);
+    thumbnailer->finished_cb = cb;
+}
@@ -0,0 +1,80 @@
+//
+// banshee-thumbnailer.h
+//
+// Copyright (C) 2026 Banshee Project Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef _BANSHEE_THUMBNAILER_H
+#define _BANSHEE_THUMBNAILER_H
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+#define BTH_MAX_POSITIONS 32
+
+typedef struct BansheeThumbnailer BansheeThumbnailer;
+
+typedef enum {
+    BTH_FORMAT_JPEG,
+    BTH_FORMAT_PNG
+} BansheeThumbnailerFormat;
+
+// The images made for one URI, one per position in position order, or
+// none when the URI could not be thumbnailed. The paths point into the
+// cache directory and stay there; the record itself is only valid during
+// the records callback.
+typedef struct {
+    const gchar *uri;
+    gboolean success;
+    gboolean cached;
+    gint count;
+    const gchar * const *paths;
+} BansheeThumbnailerRecord;
+
+typedef void (* BansheeThumbnailerRecordsCallback)  (BansheeThumbnailer *thumbnailer,
+                                                     const BansheeThumbnailerRecord *records, gint count);
+typedef void (* BansheeThumbnailerFinishedCallback) (BansheeThumbnailer *thumbnailer);
+
+// Grabs frames of up to max_workers videos at once (0 for one per
+// processor), at the keyframes nearest to a set of positions given as
+// fractions of the duration, and stores them scaled to a fixed width in
+// cache_directory. Images already cached for the same URI, modification
+// time and settings are reported without opening the video. Results come
+// on the main loop in batches, in no particular order; finished is called
+// each time every URI added so far has been reported. The settings apply
+// to URIs added after they are changed.
+BansheeThumbnailer *bth_new                   (const gchar *cache_directory, gint max_workers);
+void                bth_destroy               (BansheeThumbnailer *thumbnailer);
+gboolean            bth_add_uris              (BansheeThumbnailer *thumbnailer, const gchar * const *uris, gint count);
+void                bth_cancel                (BansheeThumbnailer *thumbnailer);
+gboolean            bth_get_is_running        (BansheeThumbnailer *thumbnailer);
+void                bth_set_positions         (BansheeThumbnailer *thumbnailer, const gdouble *positions, gint count);
+void                bth_set_width             (BansheeThumbnailer *thumbnailer, gint width);
+void                bth_set_format            (BansheeThumbnailer *thumbnailer, BansheeThumbnailerFormat format);
+void                bth_set_batch_size        (BansheeThumbnailer *thumbnailer, gint batch_size);
+void                bth_set_records_callback  (BansheeThumbnailer *thumbnailer, BansheeThumbnailerRecordsCallback cb);
+void                bth_set_finished_callback (BansheeThumbnailer *thumbnailer, BansheeThumbnailerFinishedCallback cb);
+
+G_END_DECLS
+
+#endif /* _BANSHEE_THUMBNAILER_H */
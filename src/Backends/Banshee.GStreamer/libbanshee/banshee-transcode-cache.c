@@ -0,0 +1,399 @@
+//
+// banshee-transcode-cache.c
+//
+// Copyright (C) 2026 Banshee Project Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <utime.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <glib/gstdio.h>
+
+#include "banshee-gst.h"
+#include "banshee-transcode-cache.h"
+
+// The content part of a key hashes the head and tail of the source; with
+// its size and modification time that tells files apart without reading
+// whole albums on every sync
+#define BANSHEE_TRANSCODE_CACHE_SAMPLE_SIZE (64 * 1024)
+
+#define BANSHEE_TRANSCODE_CACHE_COPY_SIZE (256 * 1024)
+
+typedef struct {
+    gchar *key;
+    guint64 size;
+    gint64 last_used;
+} BansheeTranscodeCacheEntry;
+
+struct BansheeTranscodeCache {
+    gchar *directory;
+    guint64 max_size;
+    guint64 size;
+    GHashTable *entries;
+};
+
+// ---------------------------------------------------------------------------
+// Private Functions
+// ---------------------------------------------------------------------------
+
+static void
+banshee_transcode_cache_entry_free (BansheeTranscodeCacheEntry *entry)
+{
+    g_free (entry->key);
+    g_free (entry);
+}
+
+static gchar *
+banshee_transcode_cache_entry_path (BansheeTranscodeCache *cache, const gchar *key)
+{
+    return g_build_filename (cache->directory, key, NULL);
+}
+
+static gboolean
+banshee_transcode_cache_hash_sample (GChecksum *checksum, int fd, off_t offset, gsize length)
+{
+    guchar *buffer = g_malloc (length);
+    ssize_t count;
+    gboolean result;
+
+    count = pread (fd, buffer, length, offset);
+    result = count == (ssize_t)length;
+    if (result) {
+        g_checksum_update (checksum, buffer, count);
+    }
+
+    g_free (buffer);
+    return result;
+}
+
+static gboolean
+banshee_transcode_cache_copy_file (const gchar *from, const gchar *to)
+{
+    guchar *buffer;
+    ssize_t count = 0;
+    gboolean result = TRUE;
+    int in, out;
+
+    in = g_open (from, O_RDONLY, 0);
+    if (in < 0) {
+        return FALSE;
+    }
+
+    out = g_open (to, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out < 0) {
+        close (in);
+        return FALSE;
+    }
+
+    buffer = g_malloc (BANSHEE_TRANSCODE_CACHE_COPY_SIZE);
+    while (result && (count = read (in, buffer, BANSHEE_TRANSCODE_CACHE_COPY_SIZE)) > 0) {
+        result = write (out, buffer, count) == count;
+    }
+    g_free (buffer);
+
+    result = result && count == 0;
+    close (in);
+    if (close (out) != 0) {
+        result = FALSE;
+    }
+
+    if (!result) {
+        g_unlink (to);
+    }
+
+    return result;
+}
+
+// Puts a copy of from at to, replacing anything there
+static gboolean
+banshee_transcode_cache_link_or_copy (const gchar *from, const gchar *to)
+{
+    g_unlink (to);
+
+    if (link (from, to) == 0) {
+        return TRUE;
+    }
+
+    return banshee_transcode_cache_copy_file (from, to);
+}
+
+static gint
+banshee_transcode_cache_entry_compare (gconstpointer a, gconstpointer b)
+{
+    gint64 a_used = ((const BansheeTranscodeCacheEntry *)a)->last_used;
+    gint64 b_used = ((const BansheeTranscodeCacheEntry *)b)->last_used;
+    return a_used < b_used ? -1 : (a_used > b_used ? 1 : 0);
+}
+
+static void
+banshee_transcode_cache_evict (BansheeTranscodeCache *cache)
+{
+    GList *entries, *node;
+
+    if (cache->size <= cache->max_size) {
+        return;
+    }
+
+    entries = g_list_sort (g_hash_table_get_values (cache->entries),
+        banshee_transcode_cache_entry_compare);
+
+    for (node = entries; node != NULL && cache->size > cache->max_size; node = node->next) {
+        BansheeTranscodeCacheEntry *entry = (BansheeTranscodeCacheEntry *)node->data;
+        gchar *path = banshee_transcode_cache_entry_path (cache, entry->key);
+
+        g_unlink (path);
+        g_free (path);
+
+        cache->size -= entry->size;
+        g_hash_table_remove (cache->entries, entry->key);
+    }
+
+    g_list_free (entries);
+}
+
+static void
+banshee_transcode_cache_scan (BansheeTranscodeCache *cache)
+{
+    const gchar *name;
+    GDir *dir;
+
+    dir = g_dir_open (cache->directory, 0, NULL);
+    if (dir == NULL) {
+        return;
+    }
+
+    while ((name = g_dir_read_name (dir)) != NULL) {
+        gchar *path = g_build_filename (cache->directory, name, NULL);
+        struct stat info;
+
+        // Left over from an interrupted store
+        if (g_str_has_suffix (name, ".tmp")) {
+            g_unlink (path);
+        } else if (g_stat (path, &info) == 0 && S_ISREG (info.st_mode)) {
+            BansheeTranscodeCacheEntry *entry = g_new0 (BansheeTranscodeCacheEntry, 1);
+            entry->key = g_strdup (name);
+            entry->size = info.st_size;
+            entry->last_used = info.st_mtime;
+            g_hash_table_insert (cache->entries, entry->key, entry);
+            cache->size += entry->size;
+        }
+
+        g_free (path);
+    }
+
+    g_dir_close (dir);
+}
+
+// ---------------------------------------------------------------------------
+// Public Functions
+// ---------------------------------------------------------------------------
+
+BansheeTranscodeCache *
+banshee_transcode_cache_new (const gchar *directory, guint64 max_size)
+{
+    BansheeTranscodeCache *cache;
+
+    g_return_val_if_fail (directory != NULL, NULL);
+
+    if (g_mkdir_with_parents (directory, 0755) != 0) {
+        banshee_log_debug ("transcoder", "Could not create transcode cache %s: %s",
+            directory, g_strerror (errno));
+        return NULL;
+    }
+
+    cache = g_new0 (BansheeTranscodeCache, 1);
+    cache->directory = g_strdup (directory);
+    cache->max_size = max_size;
+    cache->entries = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+        (GDestroyNotify)banshee_transcode_cache_entry_free);
+
+    banshee_transcode_cache_scan (cache);
+    banshee_transcode_cache_evict (cache);
+
+    return cache;
+}
+
+void
+banshee_transcode_cache_free (BansheeTranscodeCache *cache)
+{
+    g_return_if_fail (cache != NULL);
+
+    g_hash_table_destroy (cache->entries);
+    g_free (cache->directory);
+    g_free (cache);
+}
+
+void
+banshee_transcode_cache_set_max_size (BansheeTranscodeCache *cache, guint64 max_size)
+{
+    g_return_if_fail (cache != NULL);
+
+    cache->max_size = max_size;
+    banshee_transcode_cache_evict (cache);
+}
+
+guint64
+banshee_transcode_cache_get_size (BansheeTranscodeCache *cache)
+{
+    g_return_val_if_fail (cache != NULL, 0);
+    return cache->size;
+}
+
+// Identifies the output of encoder_pipeline for the source at input_uri.
+// Returns NULL for sources that are not local files.
+gchar *
+banshee_transcode_cache_get_key (const gchar *input_uri, const gchar *encoder_pipeline)
+{
+    GChecksum *checksum;
+    struct stat info;
+    gchar *path, *key = NULL;
+    gsize sample;
+    int fd;
+
+    g_return_val_if_fail (input_uri != NULL && encoder_pipeline != NULL, NULL);
+
+    path = g_filename_from_uri (input_uri, NULL, NULL);
+    if (path == NULL) {
+        return NULL;
+    }
+
+    fd = g_open (path, O_RDONLY, 0);
+    g_free (path);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    if (fstat (fd, &info) == 0) {
+        checksum = g_checksum_new (G_CHECKSUM_SHA1);
+        g_checksum_update (checksum, (const guchar *)encoder_pipeline, -1);
+        g_checksum_update (checksum, (const guchar *)&info.st_size, sizeof (info.st_size));
+        g_checksum_update (checksum, (const guchar *)&info.st_mtime, sizeof (info.st_mtime));
+
+        sample = MIN ((guint64)info.st_size, BANSHEE_TRANSCODE_CACHE_SAMPLE_SIZE);
+        if (banshee_transcode_cache_hash_sample (checksum, fd, 0, sample) &&
+            banshee_transcode_cache_hash_sample (checksum, fd, info.st_size - sample, sample)) {
+            key = g_strdup (g_checksum_get_string (checksum));
+        }
+
+        g_checksum_free (checksum);
+    }
+
+    close (fd);
+    return key;
+}
+
+// Puts the cached output for key at output_uri. Returns FALSE, leaving
+// output_uri alone, when there is no such entry.
+gboolean
+banshee_transcode_cache_fetch (BansheeTranscodeCache *cache, const gchar *key, const gchar *output_uri)
+{
+    BansheeTranscodeCacheEntry *entry;
+    gchar *path, *output_path;
+    gboolean result = FALSE;
+
+    g_return_val_if_fail (cache != NULL && key != NULL && output_uri != NULL, FALSE);
+
+    entry = (BansheeTranscodeCacheEntry *)g_hash_table_lookup (cache->entries, key);
+    if (entry == NULL) {
+        return FALSE;
+    }
+
+    output_path = g_filename_from_uri (output_uri, NULL, NULL);
+    if (output_path == NULL) {
+        return FALSE;
+    }
+
+    path = banshee_transcode_cache_entry_path (cache, key);
+
+    if (banshee_transcode_cache_link_or_copy (path, output_path)) {
+        entry->last_used = time (NULL);
+        utime (path, NULL);
+        result = TRUE;
+    } else if (!g_file_test (path, G_FILE_TEST_EXISTS)) {
+        // Removed behind our back
+        cache->size -= entry->size;
+        g_hash_table_remove (cache->entries, key);
+    }
+
+    g_free (path);
+    g_free (output_path);
+    return result;
+}
+
+// Adds the finished output at output_uri as the entry for key
+void
+banshee_transcode_cache_store (BansheeTranscodeCache *cache, const gchar *key, const gchar *output_uri)
+{
+    BansheeTranscodeCacheEntry *entry;
+    gchar *path, *temp_path, *output_path;
+    struct stat info;
+
+    g_return_if_fail (cache != NULL && key != NULL && output_uri != NULL);
+
+    if (cache->max_size == 0 || g_hash_table_lookup (cache->entries, key) != NULL) {
+        return;
+    }
+
+    output_path = g_filename_from_uri (output_uri, NULL, NULL);
+    if (output_path == NULL) {
+        return;
+    }
+
+    if (g_stat (output_path, &info) != 0 || (guint64)info.st_size > cache->max_size) {
+        g_free (output_path);
+        return;
+    }
+
+    // Entries only appear complete, under their final name
+    path = banshee_transcode_cache_entry_path (cache, key);
+    temp_path = g_strconcat (path, ".tmp", NULL);
+
+    if (banshee_transcode_cache_link_or_copy (output_path, temp_path)) {
+        if (g_rename (temp_path, path) == 0) {
+            utime (path, NULL);
+
+            entry = g_new0 (BansheeTranscodeCacheEntry, 1);
+            entry->key = g_strdup (key);
+            entry->size = info.st_size;
+            entry->last_used = time (NULL);
+            g_hash_table_insert (cache->entries, entry->key, entry);
+            cache->size += entry->size;
+
+            banshee_transcode_cache_evict (cache);
+        } else {
+            g_unlink (temp_path);
+        }
+    }
+
+    g_free (temp_path);
+    g_free (path);
+    g_free (output_path);
+}
@@ -0,0 +1,55 @@
+//
+// banshee-transcode-cache.h
+//
+// Copyright (C) 2026 Banshee Project Contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef _BANSHEE_TRANSCODE_CACHE_H
+#define _BANSHEE_TRANSCODE_CACHE_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct BansheeTranscodeCache BansheeTranscodeCache;
+
+// Directory of finished transcodes, one file per entry named by its key.
+// The least recently used entries are evicted to stay under max_size
+// bytes; recency is the file modification time, so it survives restarts.
+// Entries are served and stored by hard link when the output is on the
+// same file system and copied otherwise, so a linked output shares its
+// data with the entry and has to be replaced rather than modified in
+// place. Not thread safe.
+BansheeTranscodeCache *banshee_transcode_cache_new      (const gchar *directory, guint64 max_size);
+void                   banshee_transcode_cache_free     (BansheeTranscodeCache *cache);
+void                   banshee_transcode_cache_set_max_size (BansheeTranscodeCache *cache, guint64 max_size);
+guint64                banshee_transcode_cache_get_size (BansheeTranscodeCache *cache);
+
+gchar                 *banshee_transcode_cache_get_key  (const gchar *input_uri, const gchar *encoder_pipeline);
+gboolean               banshee_transcode_cache_fetch    (BansheeTranscodeCache *cache, const gchar *key,
+                                                         const gchar *output_uri);
+void                   banshee_transcode_cache_store    (BansheeTranscodeCache *cache, const gchar *key,
+                                                         const gchar *output_uri);
+
+G_END_DECLS
+
+#endif /* _BANSHEE_TRANSCODE_CACHE_H */
@@ -27,11 +27,16 @@
 //
 
 #include <gst/gst.h>
+#include <gst/pbutils/pbutils.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <glib.h>
 #include <glib/gi18n.h>
 #include <glib/gstdio.h>
+#include <string.h>
+
+#include "banshee-gst.h"
+#include "banshee-transcode-cache.h"
 
 typedef struct GstTranscoder GstTranscoder;
 
@@ -39,15 +44,102 @@ typedef void (* GstTranscoderProgressCallback) (GstTranscoder *transcoder, gdoub
 typedef void (* GstTranscoderFinishedCallback) (GstTranscoder *transcoder);
 typedef void (* GstTranscoderErrorCallback) (GstTranscoder *transcoder, const gchar *error, const gchar *debug);
 
+// Default progress step, as a fraction of the track
+#define GST_TRANSCODER_PROGRESS_STEP 0.005
+
+// How long looking at the source before building the pipeline may take
+#define GST_TRANSCODER_DISCOVER_TIMEOUT (10 * GST_SECOND)
+
+typedef enum {
+    GST_TRANSCODER_MODE_TRANSCODE,
+    GST_TRANSCODER_MODE_REMUX,
+    GST_TRANSCODER_MODE_COPY
+} GstTranscoderMode;
+
 struct GstTranscoder {
     gboolean is_transcoding;
-    guint iterate_timeout_id;
+    gboolean passthrough;
+    GstDiscoverer *discoverer;
+    GstDiscovererInfo *discovered_info;
+    guint discovered_id;
+    GstCaps *passthrough_caps;
+    guint bus_watch_id;
+    BansheeProgressProbe *progress_probe;
+    gdouble progress_step;
     GstElement *pipeline;
     GstElement *sink_bin;
+    gchar *input_uri;
     gchar *output_uri;
+    gchar *encoder_pipeline;
     GstTranscoderProgressCallback progress_cb;
     GstTranscoderFinishedCallback finished_cb;
     GstTranscoderErrorCallback error_cb;
+    gpointer user_data;
+};
+
+typedef struct GstTranscoderPool GstTranscoderPool;
+
+typedef void (* GstTranscoderPoolProgressCallback) (GstTranscoderPool *pool, guint job_id, gdouble progress);
+typedef void (* GstTranscoderPoolFinishedCallback) (GstTranscoderPool *pool, guint job_id);
+typedef void (* GstTranscoderPoolErrorCallback) (GstTranscoderPool *pool, guint job_id,
+    const gchar *error, const gchar *debug);
+
+// Upper bound on concurrent jobs whatever the CPU count; beyond this the
+// sinks mostly contend for the same output device
+#define GST_TRANSCODER_POOL_MAX_JOBS 8
+
+typedef struct {
+    GstTranscoderPool *pool;
+    guint id;
+    gchar *input_uri;
+    gchar *output_uri;
+    gchar *encoder_pipeline;
+    gchar *cache_key;
+    GstTranscoder *transcoder;
+    gboolean done;
+    // Set while a cache lookup or store for the job runs on the cache
+    // thread, which keeps the reaper away from it
+    gboolean caching;
+    gboolean cache_hit;
+    gboolean cancelled;
+} GstTranscoderJob;
+
+typedef enum {
+    GST_TRANSCODER_CACHE_FETCH,
+    GST_TRANSCODER_CACHE_STORE
+} GstTranscoderCacheOp;
+
+typedef struct {
+    GstTranscoderJob *job;
+    GstTranscoderCacheOp op;
+} GstTranscoderCacheTask;
+
+// Runs up to max_jobs transcoders at once and queues the rest. Jobs are
+// started and reported from the main loop; finished transcoders are freed
+// from an idle callback since they finish inside their own bus callback.
+// Cache keys, lookups and stores read and write whole files, so they run
+// on a thread of their own and report back through idle callbacks.
+struct GstTranscoderPool {
+    GMutex *lock;
+    guint max_jobs;
+    guint next_id;
+    GQueue *pending;
+    GList *running;
+    GList *finished;
+    guint pump_id;
+    guint reap_id;
+    gdouble progress_step;
+    gboolean passthrough;
+    GMutex *cache_lock;
+    BansheeTranscodeCache *cache;
+    GThreadPool *cache_thread;
+    GQueue *fetched;
+    guint fetched_id;
+    GQueue *cached;
+    guint cached_id;
+    GstTranscoderPoolProgressCallback progress_cb;
+    GstTranscoderPoolFinishedCallback finished_cb;
+    GstTranscoderPoolErrorCallback error_cb;
 };
 
 // private methods
@@ -61,50 +153,41 @@ gst_transcoder_raise_error(GstTranscoder *transcoder, const gchar *error, const
     transcoder->error_cb(transcoder, error, debug);
 }
 
-static gboolean
-gst_transcoder_iterate_timeout(GstTranscoder *transcoder)
+static void
+gst_transcoder_progress(GstClockTime position, GstClockTime duration, gpointer data)
 {
-    gint64 position;
-    gint64 duration;
-
-    g_return_val_if_fail(transcoder != NULL, FALSE);
-
-    if(!gst_element_query_duration(transcoder->pipeline, GST_FORMAT_TIME, &duration) ||
-        !gst_element_query_position(transcoder->sink_bin, GST_FORMAT_TIME, &position)) {
-        return TRUE;
-    }
+    GstTranscoder *transcoder = (GstTranscoder *)data;
 
-    if(transcoder->progress_cb != NULL) {
-        transcoder->progress_cb(transcoder, (double)position / (double)duration);
+    if(transcoder->progress_cb != NULL && GST_CLOCK_TIME_IS_VALID(duration)) {
+        transcoder->progress_cb(transcoder, MIN((gdouble)position / (gdouble)duration, 1.0));
     }
-    
-    return TRUE;
 }
 
 static void
-gst_transcoder_start_iterate_timeout(GstTranscoder *transcoder)
+gst_transcoder_destroy_pipeline(GstTranscoder *transcoder)
 {
-    g_return_if_fail(transcoder != NULL);
+    if(transcoder->bus_watch_id != 0) {
+        g_source_remove(transcoder->bus_watch_id);
+        transcoder->bus_watch_id = 0;
+    }
 
-    if(transcoder->iterate_timeout_id != 0) {
-        return;
+    if(GST_IS_ELEMENT(transcoder->pipeline)) {
+        gst_element_set_state(GST_ELEMENT(transcoder->pipeline), GST_STATE_NULL);
     }
-    
-    transcoder->iterate_timeout_id = g_timeout_add(200, 
-        (GSourceFunc)gst_transcoder_iterate_timeout, transcoder);
-}
 
-static void
-gst_transcoder_stop_iterate_timeout(GstTranscoder *transcoder)
-{
-    g_return_if_fail(transcoder != NULL);
-    
-    if(transcoder->iterate_timeout_id == 0) {
-        return;
+    banshee_progress_probe_free(transcoder->progress_probe);
+    transcoder->progress_probe = NULL;
+
+    if(GST_IS_ELEMENT(transcoder->pipeline)) {
+        gst_object_unref(GST_OBJECT(transcoder->pipeline));
     }
-    
-    g_source_remove(transcoder->iterate_timeout_id);
-    transcoder->iterate_timeout_id = 0;
+
+    if(transcoder->passthrough_caps != NULL) {
+        gst_caps_unref(transcoder->passthrough_caps);
+        transcoder->passthrough_caps = NULL;
+    }
+
+    transcoder->pipeline = NULL;
 }
 
 static gboolean
@@ -120,7 +203,7 @@ gst_transcoder_bus_callback(GstBus *bus, GstMessage *message, gpointer data)
             gchar *debug;
             
             transcoder->is_transcoding = FALSE;
-            gst_transcoder_stop_iterate_timeout(transcoder);
+            BANSHEE_TRACE_ASYNC_END("transcoder", "transcode", transcoder);
             
             if(transcoder->error_cb != NULL) {
                 gst_message_parse_error(message, &error, &debug);
@@ -132,12 +215,10 @@ gst_transcoder_bus_callback(GstBus *bus, GstMessage *message, gpointer data)
             break;
         }        
         case GST_MESSAGE_EOS:
-            gst_element_set_state(GST_ELEMENT(transcoder->pipeline), GST_STATE_NULL);
-            g_object_unref(G_OBJECT(transcoder->pipeline));
-            transcoder->pipeline = NULL;
+            gst_transcoder_destroy_pipeline(transcoder);
             
             transcoder->is_transcoding = FALSE;
-            gst_transcoder_stop_iterate_timeout(transcoder);
+            BANSHEE_TRACE_ASYNC_END("transcoder", "transcode", transcoder);
 
             /*
              FIXME: Replace with regular stat
@@ -170,14 +251,15 @@ static GstElement *
 gst_transcoder_build_encoder(const gchar *encoder_pipeline)
 {
     GstElement *encoder = NULL;
-    gchar *pipeline;
     GError *error = NULL;
     
-    pipeline = g_strdup_printf("%s", encoder_pipeline); 
-    encoder = gst_parse_bin_from_description(pipeline, TRUE, &error);
-    g_free(pipeline);
+    encoder = banshee_encoder_bin_new(encoder_pipeline, &error);
     
     if(error != NULL) {
+        g_error_free(error);
+        if(encoder != NULL) {
+            gst_object_unref(gst_object_ref_sink(encoder));
+        }
         return NULL;
     }
     
@@ -215,18 +297,345 @@ gst_transcoder_pad_added(GstElement *decodebin, GstPad *pad,
     gst_pad_link(pad, audiopad);
 }
 
+static gboolean
+gst_transcoder_autoplug_continue(GstElement *decodebin, GstPad *pad, GstCaps *caps,
+    gpointer data)
+{
+    GstTranscoder *transcoder = (GstTranscoder *)data;
+    GstStructure *str;
+    gboolean parsed = FALSE;
+    gboolean framed = FALSE;
+
+    if(transcoder->passthrough_caps == NULL) {
+        return TRUE;
+    }
+
+    // Stop decoding at the parsed stream when the encoder would produce
+    // the same format; it goes straight to the muxer
+    str = gst_caps_get_structure(caps, 0);
+    gst_structure_get_boolean(str, "parsed", &parsed);
+    gst_structure_get_boolean(str, "framed", &framed);
+
+    return !((parsed || framed) && gst_caps_can_intersect(caps, transcoder->passthrough_caps));
+}
+
+static GstElement *
+gst_transcoder_find_encoder(GstElement *encoder_bin)
+{
+    GstElement *encoder = NULL;
+    GstIterator *iter;
+
+    if(!GST_IS_BIN(encoder_bin)) {
+        return NULL;
+    }
+
+    iter = gst_bin_iterate_recurse(GST_BIN(encoder_bin));
+    BANSHEE_GST_ITERATOR_ITERATE(iter, GstElement *, element, TRUE, {
+        GstElementFactory *factory = gst_element_get_factory(element);
+        const gchar *klass = factory != NULL
+            ? gst_element_factory_get_metadata(factory, GST_ELEMENT_METADATA_KLASS)
+            : NULL;
+
+        if(encoder == NULL && klass != NULL && strstr(klass, "Encoder") != NULL) {
+            encoder = gst_object_ref(element);
+        }
+    });
+
+    return encoder;
+}
+
+// Only conversions may feed the encoder for its output to be replaceable
+// by the source stream; a capsfilter or effect in the profile means the
+// audio really has to be processed
+static gboolean
+gst_transcoder_encoder_is_replaceable(GstElement *encoder)
+{
+    GstElement *element = gst_object_ref(encoder);
+    gboolean replaceable = TRUE;
+
+    while(element != NULL) {
+        GstPad *sink = gst_element_get_static_pad(element, "sink");
+        GstPad *peer = sink != NULL ? gst_pad_get_peer(sink) : NULL;
+        GstElement *previous = peer != NULL ? gst_pad_get_parent_element(peer) : NULL;
+
+        if(element != encoder) {
+            GstElementFactory *factory = gst_element_get_factory(element);
+            const gchar *name = factory != NULL ? GST_OBJECT_NAME(factory) : NULL;
+            if(name == NULL || (strcmp(name, "audioconvert") != 0 && strcmp(name, "audioresample") != 0)) {
+                replaceable = FALSE;
+            }
+        }
+
+        if(sink != NULL) {
+            gst_object_unref(sink);
+        }
+        if(peer != NULL) {
+            gst_object_unref(peer);
+        }
+        gst_object_unref(element);
+        element = previous;
+    }
+
+    return replaceable;
+}
+
+// Removes the encoder and everything feeding it from the encoder bin and
+// points the bin's sink pad at the muxer that followed it
+static gboolean
+gst_transcoder_strip_encoder(GstElement *encoder_bin, GstElement *encoder)
+{
+    GstPad *encoder_src = gst_element_get_static_pad(encoder, "src");
+    GstPad *muxer_sink = gst_pad_get_peer(encoder_src);
+    GstPad *bin_sink = gst_element_get_static_pad(encoder_bin, "sink");
+    GstElement *element;
+    gboolean result = FALSE;
+
+    if(muxer_sink != NULL && bin_sink != NULL && GST_IS_GHOST_PAD(bin_sink)) {
+        gst_ghost_pad_set_target(GST_GHOST_PAD(bin_sink), NULL);
+        gst_pad_unlink(encoder_src, muxer_sink);
+
+        element = gst_object_ref(encoder);
+        while(element != NULL) {
+            GstPad *sink = gst_element_get_static_pad(element, "sink");
+            GstPad *peer = sink != NULL ? gst_pad_get_peer(sink) : NULL;
+            GstElement *previous = peer != NULL ? gst_pad_get_parent_element(peer) : NULL;
+
+            gst_bin_remove(GST_BIN(encoder_bin), element);
+
+            if(sink != NULL) {
+                gst_object_unref(sink);
+            }
+            if(peer != NULL) {
+                gst_object_unref(peer);
+            }
+            gst_object_unref(element);
+            element = previous;
+        }
+
+        result = gst_ghost_pad_set_target(GST_GHOST_PAD(bin_sink), muxer_sink);
+    }
+
+    gst_object_unref(encoder_src);
+    if(muxer_sink != NULL) {
+        gst_object_unref(muxer_sink);
+    }
+    if(bin_sink != NULL) {
+        gst_object_unref(bin_sink);
+    }
+
+    return result;
+}
+
+// The bitrate the profile sets on the encoder in bits per second, or 0
+// when it encodes for a quality level instead of a bitrate
+static gint64
+gst_transcoder_encoder_get_bitrate(GstElement *encoder)
+{
+    GObjectClass *klass = G_OBJECT_GET_CLASS(encoder);
+    GParamSpec *bitrate_spec = g_object_class_find_property(klass, "bitrate");
+    GParamSpec *target_spec = g_object_class_find_property(klass, "target");
+    gint64 bitrate = 0;
+
+    if(bitrate_spec == NULL) {
+        return 0;
+    }
+
+    // lamemp3enc keeps a bitrate even when it targets a quality
+    if(target_spec != NULL && G_IS_PARAM_SPEC_ENUM(target_spec)) {
+        GEnumValue *target;
+        gint value;
+
+        g_object_get(encoder, "target", &value, NULL);
+        target = g_enum_get_value(G_PARAM_SPEC_ENUM(target_spec)->enum_class, value);
+        if(target == NULL || strcmp(target->value_nick, "bitrate") != 0) {
+            return 0;
+        }
+    }
+
+    if(G_IS_PARAM_SPEC_INT(bitrate_spec)) {
+        gint value;
+        g_object_get(encoder, "bitrate", &value, NULL);
+        bitrate = value;
+    } else if(G_IS_PARAM_SPEC_UINT(bitrate_spec)) {
+        guint value;
+        g_object_get(encoder, "bitrate", &value, NULL);
+        bitrate = value;
+    }
+
+    // vorbisenc leaves it at -1 unless managed; lamemp3enc counts in kbit/s
+    if(bitrate <= 0) {
+        return 0;
+    }
+    return bitrate < 1000 ? bitrate * 1000 : bitrate;
+}
+
+static gboolean
+gst_transcoder_caps_accept_rate(GstCaps *caps, guint rate)
+{
+    gboolean accepted = FALSE;
+    GValue value = { 0, };
+    guint i;
+
+    if(gst_caps_is_any(caps)) {
+        return TRUE;
+    }
+
+    g_value_init(&value, G_TYPE_INT);
+    g_value_set_int(&value, rate);
+
+    for(i = 0; i < gst_caps_get_size(caps) && !accepted; i++) {
+        const GValue *field = gst_structure_get_value(gst_caps_get_structure(caps, i), "rate");
+        accepted = field == NULL || gst_value_can_intersect(field, &value);
+    }
+
+    g_value_unset(&value);
+    return accepted;
+}
+
+// The stream must also match the settings of the profile: its sample rate
+// has to be one the encoder would produce, and a profile asking for a
+// bitrate must not be handed a source that is noticeably larger
+static gboolean
+gst_transcoder_stream_matches_encoder(GstDiscovererAudioInfo *audio, GstElement *encoder,
+    GstCaps *encoded_caps)
+{
+    GstPad *encoder_sink;
+    GstCaps *raw_caps;
+    guint rate = gst_discoverer_audio_info_get_sample_rate(audio);
+    guint source_bitrate = gst_discoverer_audio_info_get_bitrate(audio);
+    gint64 target_bitrate = gst_transcoder_encoder_get_bitrate(encoder);
+    gboolean matches;
+
+    if(rate == 0 || !gst_transcoder_caps_accept_rate(encoded_caps, rate)) {
+        return FALSE;
+    }
+
+    encoder_sink = gst_element_get_static_pad(encoder, "sink");
+    raw_caps = encoder_sink != NULL ? gst_pad_query_caps(encoder_sink, NULL) : NULL;
+    matches = raw_caps == NULL || gst_transcoder_caps_accept_rate(raw_caps, rate);
+    if(raw_caps != NULL) {
+        gst_caps_unref(raw_caps);
+    }
+    if(encoder_sink != NULL) {
+        gst_object_unref(encoder_sink);
+    }
+
+    if(!matches || target_bitrate == 0) {
+        return matches;
+    }
+
+    if(source_bitrate == 0) {
+        source_bitrate = gst_discoverer_audio_info_get_max_bitrate(audio);
+    }
+
+    // Allow 5% over the target for VBR sources whose nominal rate rounds
+    // up; an unknown bitrate cannot be vouched for and is transcoded
+    return source_bitrate > 0 && source_bitrate <= target_bitrate + target_bitrate / 20;
+}
+
+// Compares what discovery found in the source with what the profile
+// produces. A source already in the target codec, sample rate and (for
+// profiles that set one) bitrate is remuxed; one that also has the target
+// container and nothing but the audio is copied.
+static GstTranscoderMode
+gst_transcoder_choose_mode(GstTranscoder *transcoder, GstElement *encoder_bin,
+    GstElement *encoder, GstDiscovererInfo *info)
+{
+    GstTranscoderMode mode = GST_TRANSCODER_MODE_TRANSCODE;
+    GstDiscovererStreamInfo *top;
+    GList *audio_streams, *video_streams, *subtitle_streams;
+    GstCaps *audio_caps, *encoded_caps, *top_caps;
+    GstPad *encoder_src;
+    gboolean has_muxer;
+
+    if(info == NULL || encoder == NULL ||
+        gst_discoverer_info_get_result(info) != GST_DISCOVERER_OK ||
+        !gst_transcoder_encoder_is_replaceable(encoder)) {
+        return mode;
+    }
+
+    audio_streams = gst_discoverer_info_get_audio_streams(info);
+    video_streams = gst_discoverer_info_get_video_streams(info);
+    subtitle_streams = gst_discoverer_info_get_subtitle_streams(info);
+
+    if(audio_streams == NULL || audio_streams->next != NULL) {
+        goto done;
+    }
+
+    encoder_src = gst_element_get_static_pad(encoder, "src");
+    encoded_caps = gst_pad_query_caps(encoder_src, NULL);
+    has_muxer = gst_pad_is_linked(encoder_src);
+    gst_object_unref(encoder_src);
+
+    audio_caps = gst_discoverer_stream_info_get_caps(GST_DISCOVERER_STREAM_INFO(audio_streams->data));
+    if(audio_caps == NULL || !gst_caps_can_intersect(audio_caps, encoded_caps) ||
+        !gst_transcoder_stream_matches_encoder(GST_DISCOVERER_AUDIO_INFO(audio_streams->data),
+            encoder, encoded_caps)) {
+        if(audio_caps != NULL) {
+            gst_caps_unref(audio_caps);
+        }
+        gst_caps_unref(encoded_caps);
+        goto done;
+    }
+
+    mode = GST_TRANSCODER_MODE_REMUX;
+
+    top = gst_discoverer_info_get_stream_info(info);
+    top_caps = top != NULL ? gst_discoverer_stream_info_get_caps(top) : NULL;
+
+    if(top_caps != NULL && video_streams == NULL && subtitle_streams == NULL) {
+        if(!has_muxer && GST_IS_DISCOVERER_AUDIO_INFO(top)) {
+            mode = GST_TRANSCODER_MODE_COPY;
+        } else if(has_muxer && GST_IS_DISCOVERER_CONTAINER_INFO(top)) {
+            GstPad *bin_src = gst_element_get_static_pad(encoder_bin, "src");
+            if(bin_src != NULL) {
+                GstCaps *container_caps = gst_pad_query_caps(bin_src, NULL);
+                if(gst_caps_can_intersect(top_caps, container_caps)) {
+                    mode = GST_TRANSCODER_MODE_COPY;
+                }
+                gst_caps_unref(container_caps);
+                gst_object_unref(bin_src);
+            }
+        }
+    }
+
+    if(mode == GST_TRANSCODER_MODE_REMUX) {
+        transcoder->passthrough_caps = gst_caps_ref(encoded_caps);
+    }
+
+    if(top_caps != NULL) {
+        gst_caps_unref(top_caps);
+    }
+    if(top != NULL) {
+        gst_discoverer_stream_info_unref(top);
+    }
+    gst_caps_unref(audio_caps);
+    gst_caps_unref(encoded_caps);
+
+done:
+    gst_discoverer_stream_info_list_free(audio_streams);
+    gst_discoverer_stream_info_list_free(video_streams);
+    gst_discoverer_stream_info_list_free(subtitle_streams);
+    return mode;
+}
+
 static gboolean
 gst_transcoder_create_pipeline(GstTranscoder *transcoder, 
     const char *input_uri, const char *output_uri, 
-    const gchar *encoder_pipeline)
+    const gchar *encoder_pipeline, GstDiscovererInfo *info)
 {
     GstElement *source_elem;
-    GstElement *decoder_elem;
+    GstElement *decoder_elem = NULL;
     GstElement *encoder_elem;
     GstElement *sink_elem;
     GstElement *conv_elem;
     GstElement *resample_elem;
+    GstElement *encoder;
+    GstTranscoderMode mode;
+    gboolean has_muxer = FALSE;
     GstPad *encoder_pad;
+    GstPad *sink_pad;
+    GstBus *bus;
 
     if(transcoder == NULL) {
         return FALSE;
@@ -239,12 +648,6 @@ gst_transcoder_create_pipeline(GstTranscoder *transcoder,
         gst_transcoder_raise_error(transcoder, _("Could not create source element"), NULL);
         return FALSE;
     }
-
-    decoder_elem = gst_element_factory_make("decodebin", "decodebin");
-    if(decoder_elem == NULL) {
-        gst_transcoder_raise_error(transcoder, _("Could not create decodebin plugin"), NULL);
-        return FALSE;
-    }
     
     sink_elem = gst_element_make_from_uri(GST_URI_SINK, output_uri, "sink", NULL);
     if(sink_elem == NULL) {
@@ -257,18 +660,6 @@ gst_transcoder_create_pipeline(GstTranscoder *transcoder,
         gst_transcoder_raise_error(transcoder, _("Could not create sinkbin plugin"), NULL);
         return FALSE;
     }
-    
-    conv_elem = gst_element_factory_make("audioconvert", "audioconvert");
-    if(conv_elem == NULL) {
-        gst_transcoder_raise_error(transcoder, _("Could not create audioconvert plugin"), NULL);
-        return FALSE;
-    }
-    
-    resample_elem = gst_element_factory_make("audioresample", "audioresample");
-    if(resample_elem == NULL) {
-        gst_transcoder_raise_error(transcoder, _("Could not create audioresample plugin"), NULL);
-        return FALSE;
-    }
 
     encoder_elem = gst_transcoder_build_encoder(encoder_pipeline);
     if(encoder_elem == NULL) {
@@ -276,56 +667,210 @@ gst_transcoder_create_pipeline(GstTranscoder *transcoder,
          return FALSE;
     }
 
-    encoder_pad = gst_element_get_static_pad(conv_elem, "sink");
+    encoder = gst_transcoder_find_encoder(encoder_elem);
+    mode = gst_transcoder_choose_mode(transcoder, encoder_elem, encoder, info);
+
+    if(mode == GST_TRANSCODER_MODE_REMUX) {
+        GstPad *encoder_src = gst_element_get_static_pad(encoder, "src");
+        has_muxer = gst_pad_is_linked(encoder_src);
+        gst_object_unref(encoder_src);
+    }
+
+    if(mode == GST_TRANSCODER_MODE_REMUX && has_muxer && !gst_transcoder_strip_encoder(encoder_elem, encoder)) {
+        gst_caps_unref(transcoder->passthrough_caps);
+        transcoder->passthrough_caps = NULL;
+        gst_object_unref(gst_object_ref_sink(encoder_elem));
+        encoder_elem = gst_transcoder_build_encoder(encoder_pipeline);
+        mode = GST_TRANSCODER_MODE_TRANSCODE;
+    }
+
+    if(encoder != NULL) {
+        gst_object_unref(encoder);
+    }
+
+    switch(mode) {
+        case GST_TRANSCODER_MODE_COPY:
+            // The source is already what the profile produces: no decoding
+            // at all, the file is copied as is
+            banshee_log_debug("transcoder", "Copying %s as is", input_uri);
+            gst_object_unref(gst_object_ref_sink(encoder_elem));
+            gst_bin_add(GST_BIN(transcoder->sink_bin), sink_elem);
+            encoder_pad = gst_element_get_static_pad(sink_elem, "sink");
+            break;
+
+        case GST_TRANSCODER_MODE_REMUX:
+            // The parsed stream goes to the profile's muxer, or straight to
+            // the file when the profile has none
+            banshee_log_debug("transcoder", "Remuxing %s without reencoding", input_uri);
+            if(has_muxer) {
+                gst_bin_add_many(GST_BIN(transcoder->sink_bin), encoder_elem, sink_elem, NULL);
+                gst_element_link(encoder_elem, sink_elem);
+                encoder_pad = gst_element_get_static_pad(encoder_elem, "sink");
+            } else {
+                gst_object_unref(gst_object_ref_sink(encoder_elem));
+                gst_bin_add(GST_BIN(transcoder->sink_bin), sink_elem);
+                encoder_pad = gst_element_get_static_pad(sink_elem, "sink");
+            }
+            break;
+
+        default:
+            conv_elem = gst_element_factory_make("audioconvert", "audioconvert");
+            if(conv_elem == NULL) {
+                gst_transcoder_raise_error(transcoder, _("Could not create audioconvert plugin"), NULL);
+                return FALSE;
+            }
+
+            resample_elem = gst_element_factory_make("audioresample", "audioresample");
+            if(resample_elem == NULL) {
+                gst_transcoder_raise_error(transcoder, _("Could not create audioresample plugin"), NULL);
+                return FALSE;
+            }
+
+            gst_bin_add_many(GST_BIN(transcoder->sink_bin), conv_elem, resample_elem, encoder_elem, sink_elem, NULL);
+            gst_element_link_many(conv_elem, resample_elem, encoder_elem, sink_elem, NULL);
+            encoder_pad = gst_element_get_static_pad(conv_elem, "sink");
+            break;
+    }
+
     if(encoder_pad == NULL) {
         gst_transcoder_raise_error(transcoder, _("Could not get sink pad from encoder"), NULL);
         return FALSE;
     }
     
-    gst_bin_add_many(GST_BIN(transcoder->sink_bin), conv_elem, resample_elem, encoder_elem, sink_elem, NULL);
-    gst_element_link_many(conv_elem, resample_elem, encoder_elem, sink_elem, NULL);
-    
     gst_element_add_pad(transcoder->sink_bin, gst_ghost_pad_new("sink", encoder_pad));
     gst_object_unref(encoder_pad);
-    
-    gst_bin_add_many(GST_BIN(transcoder->pipeline), source_elem, decoder_elem, 
-        transcoder->sink_bin, NULL);
+
+    // Progress follows the buffers entering the sink bin instead of polling
+    sink_pad = gst_element_get_static_pad(transcoder->sink_bin, "sink");
+    transcoder->progress_probe = banshee_progress_probe_new(sink_pad,
+        transcoder->progress_step, gst_transcoder_progress, transcoder);
+    gst_object_unref(sink_pad);
+
+    if(mode == GST_TRANSCODER_MODE_COPY) {
+        gst_bin_add_many(GST_BIN(transcoder->pipeline), source_elem, transcoder->sink_bin, NULL);
+        gst_element_link(source_elem, transcoder->sink_bin);
+    } else {
+        decoder_elem = gst_element_factory_make("decodebin", "decodebin");
+        if(decoder_elem == NULL) {
+            gst_transcoder_raise_error(transcoder, _("Could not create decodebin plugin"), NULL);
+            return FALSE;
+        }
+
+        gst_bin_add_many(GST_BIN(transcoder->pipeline), source_elem, decoder_elem, 
+            transcoder->sink_bin, NULL);
         
-    gst_element_link(source_elem, decoder_elem);
+        gst_element_link(source_elem, decoder_elem);
 
-    g_signal_connect(decoder_elem, "pad-added", 
-        G_CALLBACK(gst_transcoder_pad_added), transcoder);
+        g_signal_connect(decoder_elem, "autoplug-continue", 
+            G_CALLBACK(gst_transcoder_autoplug_continue), transcoder);
+        g_signal_connect(decoder_elem, "pad-added", 
+            G_CALLBACK(gst_transcoder_pad_added), transcoder);
+    }
 
-    gst_bus_add_watch(gst_pipeline_get_bus(GST_PIPELINE(transcoder->pipeline)), 
-        gst_transcoder_bus_callback, transcoder);
+    bus = gst_pipeline_get_bus(GST_PIPELINE(transcoder->pipeline));
+    transcoder->bus_watch_id = gst_bus_add_watch(bus, gst_transcoder_bus_callback, transcoder);
+    gst_object_unref(bus);
     
     return TRUE;
 }
 
+static void
+gst_transcoder_start(GstTranscoder *transcoder, GstDiscovererInfo *info)
+{
+    gboolean created;
+
+    BANSHEE_TRACE_BEGIN("transcoder", "create-pipeline");
+    created = gst_transcoder_create_pipeline(transcoder, transcoder->input_uri, transcoder->output_uri,
+        transcoder->encoder_pipeline, info);
+    BANSHEE_TRACE_END("transcoder", "create-pipeline");
+
+    if(!created) {
+        transcoder->is_transcoding = FALSE;
+        BANSHEE_TRACE_ASYNC_END("transcoder", "transcode", transcoder);
+        gst_transcoder_raise_error(transcoder, _("Could not construct pipeline"), NULL); 
+        return;
+    }
+
+    gst_element_set_state(GST_ELEMENT(transcoder->pipeline), GST_STATE_PLAYING);
+}
+
+static gboolean
+gst_transcoder_discovered_idle(GstTranscoder *transcoder)
+{
+    GstDiscovererInfo *info = transcoder->discovered_info;
+
+    transcoder->discovered_id = 0;
+    transcoder->discovered_info = NULL;
+    gst_discoverer_stop(transcoder->discoverer);
+    BANSHEE_TRACE_ASYNC_END("transcoder", "discover", transcoder);
+
+    gst_transcoder_start(transcoder, info);
+
+    if(info != NULL) {
+        gst_discoverer_info_unref(info);
+    }
+
+    return FALSE;
+}
+
+static void
+gst_transcoder_discovered(GstDiscoverer *discoverer, GstDiscovererInfo *info,
+    GError *error, gpointer data)
+{
+    GstTranscoder *transcoder = (GstTranscoder *)data;
+
+    // Failed discovery just means a regular transcode, which reports the
+    // actual problem if there is one
+    if(transcoder->discovered_id == 0) {
+        transcoder->discovered_info = error == NULL ? gst_discoverer_info_ref(info) : NULL;
+        transcoder->discovered_id = g_idle_add((GSourceFunc)gst_transcoder_discovered_idle, transcoder);
+    }
+}
+
+static void
+gst_transcoder_stop_discovery(GstTranscoder *transcoder)
+{
+    if(transcoder->discovered_id != 0) {
+        g_source_remove(transcoder->discovered_id);
+        transcoder->discovered_id = 0;
+        BANSHEE_TRACE_ASYNC_END("transcoder", "discover", transcoder);
+    }
+
+    if(transcoder->discovered_info != NULL) {
+        gst_discoverer_info_unref(transcoder->discovered_info);
+        transcoder->discovered_info = NULL;
+    }
+
+    if(transcoder->discoverer != NULL) {
+        gst_discoverer_stop(transcoder->discoverer);
+    }
+}
+
 // public methods
 
 GstTranscoder *
 gst_transcoder_new ()
 {
-    return g_new0 (GstTranscoder, 1);
+    GstTranscoder *transcoder = g_new0 (GstTranscoder, 1);
+    transcoder->progress_step = GST_TRANSCODER_PROGRESS_STEP;
+    transcoder->passthrough = TRUE;
+    return transcoder;
 }
 
 void
 gst_transcoder_free(GstTranscoder *transcoder)
 {
     g_return_if_fail(transcoder != NULL);
-    gst_transcoder_stop_iterate_timeout(transcoder);
-    
-    if(GST_IS_ELEMENT(transcoder->pipeline)) {
-        gst_element_set_state(GST_ELEMENT(transcoder->pipeline), GST_STATE_NULL);
-        gst_object_unref(GST_OBJECT(transcoder->pipeline));
-    }
+    gst_transcoder_stop_discovery(transcoder);
+    gst_transcoder_destroy_pipeline(transcoder);
 
-    if(transcoder->output_uri != NULL) {
-        g_free(transcoder->output_uri);
-        transcoder->output_uri = NULL;
+    if(transcoder->discoverer != NULL) {
+        g_object_unref(transcoder->discoverer);
     }
-    
+
+    g_free(transcoder->input_uri);
+    g_free(transcoder->output_uri);
+    g_free(transcoder->encoder_pipeline);
     g_free(transcoder);
     transcoder = NULL;
 }
@@ -339,37 +884,65 @@ gst_transcoder_transcode(GstTranscoder *transcoder, const gchar *input_uri,
     if(transcoder->is_transcoding) {
         return;
     }
-    
-    if(!gst_transcoder_create_pipeline(transcoder, input_uri, output_uri, encoder_pipeline)) {
-        gst_transcoder_raise_error(transcoder, _("Could not construct pipeline"), NULL); 
-        return;
-    }
-    
-    if(transcoder->output_uri != NULL) {
-        g_free(transcoder->output_uri);
-    }
-    
+
+    g_free(transcoder->input_uri);
+    g_free(transcoder->output_uri);
+    g_free(transcoder->encoder_pipeline);
+    transcoder->input_uri = g_strdup(input_uri);
     transcoder->output_uri = g_strdup(output_uri);
+    transcoder->encoder_pipeline = g_strdup(encoder_pipeline);
     transcoder->is_transcoding = TRUE;
-    
-    gst_element_set_state(GST_ELEMENT(transcoder->pipeline), GST_STATE_PLAYING);
-    gst_transcoder_start_iterate_timeout(transcoder);
+    BANSHEE_TRACE_ASYNC_BEGIN("transcoder", "transcode", transcoder);
+
+    // Look at the source before building the pipeline, so a compatible
+    // stream can be copied or remuxed instead of reencoded
+    if(transcoder->passthrough) {
+        if(transcoder->discoverer == NULL) {
+            transcoder->discoverer = gst_discoverer_new(GST_TRANSCODER_DISCOVER_TIMEOUT, NULL);
+            if(transcoder->discoverer != NULL) {
+                g_signal_connect(transcoder->discoverer, "discovered",
+                    G_CALLBACK(gst_transcoder_discovered), transcoder);
+            }
+        }
+
+        if(transcoder->discoverer != NULL) {
+            gst_discoverer_start(transcoder->discoverer);
+            if(gst_discoverer_discover_uri_async(transcoder->discoverer, input_uri)) {
+                BANSHEE_TRACE_ASYNC_BEGIN("transcoder", "discover", transcoder);
+                return;
+            }
+            gst_discoverer_stop(transcoder->discoverer);
+        }
+    }
+
+    gst_transcoder_start(transcoder, NULL);
 }
 
 void 
 gst_transcoder_cancel(GstTranscoder *transcoder)
 {
     g_return_if_fail(transcoder != NULL);
-    gst_transcoder_stop_iterate_timeout(transcoder);
+
+    if(transcoder->is_transcoding) {
+        BANSHEE_TRACE_ASYNC_END("transcoder", "transcode", transcoder);
+    }
     
     transcoder->is_transcoding = FALSE;
+    gst_transcoder_stop_discovery(transcoder);
+    gst_transcoder_destroy_pipeline(transcoder);
     
-    if(GST_IS_ELEMENT(transcoder->pipeline)) {
-        gst_element_set_state(GST_ELEMENT(transcoder->pipeline), GST_STATE_NULL);
-        gst_object_unref(GST_OBJECT(transcoder->pipeline));
+    if(transcoder->output_uri != NULL) {
+        g_remove(transcoder->output_uri);
     }
-    
-    g_remove(transcoder->output_uri);
+}
+
+// Whether sources already in the target format may be copied or remuxed
+// rather than reencoded
+void
+gst_transcoder_set_passthrough(GstTranscoder *transcoder, gboolean passthrough)
+{
+    g_return_if_fail(transcoder != NULL);
+    transcoder->passthrough = passthrough;
 }
 
 void
@@ -380,6 +953,19 @@ gst_transcoder_set_progress_callback(GstTranscoder *transcoder,
     transcoder->progress_cb = cb;
 }
 
+// Minimum change of progress, as a fraction of the track, between two
+// progress callbacks
+void
+gst_transcoder_set_progress_step(GstTranscoder *transcoder, gdouble step)
+{
+    g_return_if_fail(transcoder != NULL);
+    transcoder->progress_step = step;
+
+    if(transcoder->progress_probe != NULL) {
+        banshee_progress_probe_set_step(transcoder->progress_probe, step);
+    }
+}
+
 void
 gst_transcoder_set_finished_callback(GstTranscoder *transcoder, 
     GstTranscoderFinishedCallback cb)
@@ -402,3 +988,630 @@ gst_transcoder_get_is_transcoding(GstTranscoder *transcoder)
     g_return_val_if_fail(transcoder != NULL, FALSE);
     return transcoder->is_transcoding;
 }
+
+// pool private methods
+
+static void
+gst_transcoder_job_free(GstTranscoderJob *job)
+{
+    if(job->transcoder != NULL) {
+        gst_transcoder_free(job->transcoder);
+    }
+
+    g_free(job->input_uri);
+    g_free(job->output_uri);
+    g_free(job->encoder_pipeline);
+    g_free(job->cache_key);
+    g_free(job);
+}
+
+static gboolean
+gst_transcoder_pool_reap(GstTranscoderPool *pool)
+{
+    GList *finished = NULL, *node, *next;
+
+    g_mutex_lock(pool->lock);
+    for(node = pool->finished; node != NULL; node = next) {
+        next = node->next;
+        if(!((GstTranscoderJob *)node->data)->caching) {
+            pool->finished = g_list_remove_link(pool->finished, node);
+            finished = g_list_concat(node, finished);
+        }
+    }
+    pool->reap_id = 0;
+    g_mutex_unlock(pool->lock);
+
+    g_list_foreach(finished, (GFunc)gst_transcoder_job_free, NULL);
+    g_list_free(finished);
+
+    return FALSE;
+}
+
+// Must be called with the pool lock held
+static void
+gst_transcoder_pool_retire_job(GstTranscoderPool *pool, GstTranscoderJob *job)
+{
+    job->done = TRUE;
+    pool->running = g_list_remove(pool->running, job);
+    pool->finished = g_list_prepend(pool->finished, job);
+
+    if(pool->reap_id == 0) {
+        pool->reap_id = g_idle_add((GSourceFunc)gst_transcoder_pool_reap, pool);
+    }
+}
+
+// Must be called with the pool lock held. Stops reporting the job and
+// takes it out of the running ones without handing it to the reaper, so
+// it stays valid while its transcoder is cancelled outside the lock; it
+// is retired after that.
+static void
+gst_transcoder_pool_detach_job(GstTranscoderPool *pool, GstTranscoderJob *job)
+{
+    job->done = TRUE;
+    job->cancelled = TRUE;
+    pool->running = g_list_remove(pool->running, job);
+}
+
+static gboolean gst_transcoder_pool_pump(GstTranscoderPool *pool);
+static gboolean gst_transcoder_pool_cache_push(GstTranscoderPool *pool, GstTranscoderJob *job,
+    GstTranscoderCacheOp op);
+
+// Must be called with the pool lock held
+static void
+gst_transcoder_pool_schedule_pump(GstTranscoderPool *pool)
+{
+    if(pool->pump_id == 0) {
+        pool->pump_id = g_idle_add((GSourceFunc)gst_transcoder_pool_pump, pool);
+    }
+}
+
+static void
+gst_transcoder_pool_job_progress(GstTranscoder *transcoder, gdouble progress)
+{
+    GstTranscoderJob *job = (GstTranscoderJob *)transcoder->user_data;
+
+    if(!job->done && job->pool->progress_cb != NULL) {
+        job->pool->progress_cb(job->pool, job->id, progress);
+    }
+}
+
+static void
+gst_transcoder_pool_job_finished(GstTranscoder *transcoder)
+{
+    GstTranscoderJob *job = (GstTranscoderJob *)transcoder->user_data;
+    GstTranscoderPool *pool = job->pool;
+
+    g_mutex_lock(pool->lock);
+    if(job->done) {
+        g_mutex_unlock(pool->lock);
+        return;
+    }
+    gst_transcoder_pool_retire_job(pool, job);
+    gst_transcoder_pool_schedule_pump(pool);
+
+    // Stored before the owner of the output gets to move it, so the finish
+    // is reported once the store is done
+    if(job->cache_key != NULL && gst_transcoder_pool_cache_push(pool, job, GST_TRANSCODER_CACHE_STORE)) {
+        g_mutex_unlock(pool->lock);
+        return;
+    }
+    g_mutex_unlock(pool->lock);
+
+    if(pool->finished_cb != NULL) {
+        pool->finished_cb(pool, job->id);
+    }
+}
+
+// Reports one job finished through the cache per call, served from it or
+// stored in it. The pool may be freed from the callback, so it is not
+// touched afterwards.
+static gboolean
+gst_transcoder_pool_report_cached(GstTranscoderPool *pool)
+{
+    guint id;
+    gboolean more;
+
+    g_mutex_lock(pool->lock);
+    id = GPOINTER_TO_UINT(g_queue_pop_head(pool->cached));
+    more = !g_queue_is_empty(pool->cached);
+    if(!more) {
+        pool->cached_id = 0;
+    }
+    g_mutex_unlock(pool->lock);
+
+    if(id != 0 && pool->finished_cb != NULL) {
+        pool->finished_cb(pool, id);
+    }
+
+    return more;
+}
+
+// Must be called with the pool lock held
+static void
+gst_transcoder_pool_report_cached_later(GstTranscoderPool *pool, GstTranscoderJob *job)
+{
+    g_queue_push_tail(pool->cached, GUINT_TO_POINTER(job->id));
+    if(pool->cached_id == 0) {
+        pool->cached_id = g_idle_add((GSourceFunc)gst_transcoder_pool_report_cached, pool);
+    }
+}
+
+// Starts the jobs whose cache lookup is done: those served from the cache
+// are reported finished, the others are transcoded
+static gboolean
+gst_transcoder_pool_report_fetched(GstTranscoderPool *pool)
+{
+    GstTranscoderJob *job;
+
+    g_mutex_lock(pool->lock);
+    pool->fetched_id = 0;
+
+    while((job = (GstTranscoderJob *)g_queue_pop_head(pool->fetched)) != NULL) {
+        job->caching = FALSE;
+
+        // Cancelled during the lookup; it is retired already
+        if(job->cancelled) {
+            if(job->cache_hit) {
+                gchar *output_path = g_filename_from_uri(job->output_uri, NULL, NULL);
+                if(output_path != NULL) {
+                    g_remove(output_path);
+                    g_free(output_path);
+                }
+            }
+            if(pool->reap_id == 0) {
+                pool->reap_id = g_idle_add((GSourceFunc)gst_transcoder_pool_reap, pool);
+            }
+            continue;
+        }
+
+        if(job->cache_hit) {
+            banshee_log_debug("transcoder", "Using cached transcode of %s", job->input_uri);
+            gst_transcoder_pool_retire_job(pool, job);
+            gst_transcoder_pool_schedule_pump(pool);
+            gst_transcoder_pool_report_cached_later(pool, job);
+            continue;
+        }
+
+        // Starting may report an error right away, which takes the lock
+        g_mutex_unlock(pool->lock);
+        gst_transcoder_transcode(job->transcoder, job->input_uri, job->output_uri, job->encoder_pipeline);
+        g_mutex_lock(pool->lock);
+    }
+
+    g_mutex_unlock(pool->lock);
+    return FALSE;
+}
+
+// Serves a job from the cache if it can, or stores its finished output
+// there. Runs on the cache thread, which is the only one using the cache
+// apart from gst_transcoder_pool_set_cache.
+static void
+gst_transcoder_pool_cache_run(GstTranscoderCacheTask *task, GstTranscoderPool *pool)
+{
+    GstTranscoderJob *job = task->job;
+    gboolean cancelled;
+
+    g_mutex_lock(pool->lock);
+    cancelled = job->cancelled;
+    g_mutex_unlock(pool->lock);
+
+    if(task->op == GST_TRANSCODER_CACHE_FETCH) {
+        gboolean hit = FALSE;
+
+        if(!cancelled) {
+            // Passthrough output differs from the transcoded one
+            gchar *key_pipeline = g_strdup_printf("%s%s", job->encoder_pipeline,
+                job->transcoder->passthrough ? " (passthrough)" : "");
+            gchar *key = banshee_transcode_cache_get_key(job->input_uri, key_pipeline);
+            g_free(key_pipeline);
+
+            g_mutex_lock(pool->cache_lock);
+            hit = key != NULL && pool->cache != NULL &&
+                banshee_transcode_cache_fetch(pool->cache, key, job->output_uri);
+            g_mutex_unlock(pool->cache_lock);
+
+            // Only read on the main loop once the job is handed back
+            job->cache_key = key;
+        }
+
+        g_mutex_lock(pool->lock);
+        job->cache_hit = hit;
+        g_queue_push_tail(pool->fetched, job);
+        if(pool->fetched_id == 0) {
+            pool->fetched_id = g_idle_add((GSourceFunc)gst_transcoder_pool_report_fetched, pool);
+        }
+        g_mutex_unlock(pool->lock);
+    } else {
+        if(!cancelled) {
+            g_mutex_lock(pool->cache_lock);
+            if(pool->cache != NULL) {
+                banshee_transcode_cache_store(pool->cache, job->cache_key, job->output_uri);
+            }
+            g_mutex_unlock(pool->cache_lock);
+        }
+
+        g_mutex_lock(pool->lock);
+        job->caching = FALSE;
+        if(!job->cancelled) {
+            gst_transcoder_pool_report_cached_later(pool, job);
+        }
+        if(pool->reap_id == 0) {
+            pool->reap_id = g_idle_add((GSourceFunc)gst_transcoder_pool_reap, pool);
+        }
+        g_mutex_unlock(pool->lock);
+    }
+
+    g_free(task);
+}
+
+// Must be called with the pool lock held. Returns FALSE if the task could
+// not be queued, in which case the job goes on without the cache.
+static gboolean
+gst_transcoder_pool_cache_push(GstTranscoderPool *pool, GstTranscoderJob *job, GstTranscoderCacheOp op)
+{
+    GstTranscoderCacheTask *task;
+
+    if(pool->cache_thread == NULL) {
+        return FALSE;
+    }
+
+    task = g_new0(GstTranscoderCacheTask, 1);
+    task->job = job;
+    task->op = op;
+    job->caching = TRUE;
+
+    if(!g_thread_pool_push(pool->cache_thread, task, NULL)) {
+        job->caching = FALSE;
+        g_free(task);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static void
+gst_transcoder_pool_job_error(GstTranscoder *transcoder, const gchar *error, const gchar *debug)
+{
+    GstTranscoderJob *job = (GstTranscoderJob *)transcoder->user_data;
+    GstTranscoderPool *pool = job->pool;
+
+    // A failing pipeline can report more than one error; only the first
+    // one ends the job
+    g_mutex_lock(pool->lock);
+    if(job->done) {
+        g_mutex_unlock(pool->lock);
+        return;
+    }
+    gst_transcoder_pool_retire_job(pool, job);
+    gst_transcoder_pool_schedule_pump(pool);
+    g_mutex_unlock(pool->lock);
+
+    if(pool->error_cb != NULL) {
+        pool->error_cb(pool, job->id, error, debug);
+    }
+}
+
+// Starts queued jobs until max_jobs are running. The transcoders are
+// started outside the lock since they may report errors right away.
+static gboolean
+gst_transcoder_pool_pump(GstTranscoderPool *pool)
+{
+    GList *start = NULL, *node;
+    gboolean use_cache;
+
+    g_mutex_lock(pool->cache_lock);
+    use_cache = pool->cache != NULL;
+    g_mutex_unlock(pool->cache_lock);
+
+    g_mutex_lock(pool->lock);
+    pool->pump_id = 0;
+    while(g_list_length(pool->running) < pool->max_jobs && !g_queue_is_empty(pool->pending)) {
+        GstTranscoderJob *job = (GstTranscoderJob *)g_queue_pop_head(pool->pending);
+
+        job->transcoder = gst_transcoder_new();
+        job->transcoder->user_data = job;
+        job->transcoder->progress_step = pool->progress_step;
+        job->transcoder->passthrough = pool->passthrough;
+        gst_transcoder_set_progress_callback(job->transcoder, gst_transcoder_pool_job_progress);
+        gst_transcoder_set_finished_callback(job->transcoder, gst_transcoder_pool_job_finished);
+        gst_transcoder_set_error_callback(job->transcoder, gst_transcoder_pool_job_error);
+
+        pool->running = g_list_append(pool->running, job);
+
+        // Looked up in the cache first, if there is one; the lookup starts
+        // the transcode when it misses
+        if(!use_cache || !gst_transcoder_pool_cache_push(pool, job, GST_TRANSCODER_CACHE_FETCH)) {
+            start = g_list_append(start, job);
+        }
+    }
+    g_mutex_unlock(pool->lock);
+
+    for(node = start; node != NULL; node = node->next) {
+        GstTranscoderJob *job = (GstTranscoderJob *)node->data;
+        gst_transcoder_transcode(job->transcoder, job->input_uri, job->output_uri, job->encoder_pipeline);
+    }
+
+    g_list_free(start);
+    return FALSE;
+}
+
+static gint
+gst_transcoder_pool_job_compare(gconstpointer a, gconstpointer b)
+{
+    return ((const GstTranscoderJob *)a)->id == GPOINTER_TO_UINT(b) ? 0 : 1;
+}
+
+// pool public methods
+
+GstTranscoderPool *
+gst_transcoder_pool_new(gint max_jobs)
+{
+    GstTranscoderPool *pool = g_new0(GstTranscoderPool, 1);
+
+    if(max_jobs <= 0) {
+#if GLIB_CHECK_VERSION(2,36,0)
+        max_jobs = MIN(g_get_num_processors(), GST_TRANSCODER_POOL_MAX_JOBS);
+#else
+        max_jobs = 2;
+#endif
+    }
+
+    pool->max_jobs = max_jobs;
+    pool->next_id = 1;
+    pool->progress_step = GST_TRANSCODER_PROGRESS_STEP;
+    pool->passthrough = TRUE;
+    pool->lock = g_mutex_new();
+    pool->cache_lock = g_mutex_new();
+    pool->pending = g_queue_new();
+    pool->fetched = g_queue_new();
+    pool->cached = g_queue_new();
+
+    // One thread is enough, the cache is read and written one file at a
+    // time; without it the cache is not used
+    pool->cache_thread = g_thread_pool_new((GFunc)gst_transcoder_pool_cache_run, pool, 1, FALSE, NULL);
+
+    return pool;
+}
+
+guint
+gst_transcoder_pool_add_job(GstTranscoderPool *pool, const gchar *input_uri,
+    const gchar *output_uri, const gchar *encoder_pipeline)
+{
+    GstTranscoderJob *job;
+    guint id;
+
+    g_return_val_if_fail(pool != NULL, 0);
+    g_return_val_if_fail(input_uri != NULL && output_uri != NULL && encoder_pipeline != NULL, 0);
+
+    job = g_new0(GstTranscoderJob, 1);
+    job->pool = pool;
+    job->input_uri = g_strdup(input_uri);
+    job->output_uri = g_strdup(output_uri);
+    job->encoder_pipeline = g_strdup(encoder_pipeline);
+
+    // The job is only started from the main loop, so the caller always
+    // knows its id before any callback for it
+    g_mutex_lock(pool->lock);
+    id = job->id = pool->next_id++;
+    g_queue_push_tail(pool->pending, job);
+    gst_transcoder_pool_schedule_pump(pool);
+    g_mutex_unlock(pool->lock);
+
+    return id;
+}
+
+void
+gst_transcoder_pool_cancel_job(GstTranscoderPool *pool, guint job_id)
+{
+    GstTranscoderJob *job = NULL;
+    GList *node;
+
+    g_return_if_fail(pool != NULL);
+
+    g_mutex_lock(pool->lock);
+
+    node = g_queue_find_custom(pool->pending, GUINT_TO_POINTER(job_id), gst_transcoder_pool_job_compare);
+    if(node != NULL) {
+        job = (GstTranscoderJob *)node->data;
+        g_queue_delete_link(pool->pending, node);
+        g_mutex_unlock(pool->lock);
+        gst_transcoder_job_free(job);
+        return;
+    }
+
+    node = g_list_find_custom(pool->running, GUINT_TO_POINTER(job_id), gst_transcoder_pool_job_compare);
+    if(node != NULL) {
+        job = (GstTranscoderJob *)node->data;
+        gst_transcoder_pool_detach_job(pool, job);
+        gst_transcoder_pool_schedule_pump(pool);
+    }
+
+    // Finished, but its output is still being stored in the cache
+    node = g_list_find_custom(pool->finished, GUINT_TO_POINTER(job_id), gst_transcoder_pool_job_compare);
+    if(node != NULL) {
+        ((GstTranscoderJob *)node->data)->cancelled = TRUE;
+    }
+
+    g_queue_remove(pool->cached, GUINT_TO_POINTER(job_id));
+    g_mutex_unlock(pool->lock);
+
+    if(job != NULL) {
+        gst_transcoder_cancel(job->transcoder);
+
+        g_mutex_lock(pool->lock);
+        gst_transcoder_pool_retire_job(pool, job);
+        g_mutex_unlock(pool->lock);
+    }
+}
+
+void
+gst_transcoder_pool_cancel(GstTranscoderPool *pool)
+{
+    GList *running, *node;
+    GstTranscoderJob *job;
+
+    g_return_if_fail(pool != NULL);
+
+    g_mutex_lock(pool->lock);
+    while((job = (GstTranscoderJob *)g_queue_pop_head(pool->pending)) != NULL) {
+        gst_transcoder_job_free(job);
+    }
+
+    g_queue_clear(pool->cached);
+    for(node = pool->finished; node != NULL; node = node->next) {
+        ((GstTranscoderJob *)node->data)->cancelled = TRUE;
+    }
+    running = g_list_copy(pool->running);
+    for(node = running; node != NULL; node = node->next) {
+        gst_transcoder_pool_detach_job(pool, (GstTranscoderJob *)node->data);
+    }
+    g_mutex_unlock(pool->lock);
+
+    for(node = running; node != NULL; node = node->next) {
+        gst_transcoder_cancel(((GstTranscoderJob *)node->data)->transcoder);
+    }
+
+    g_mutex_lock(pool->lock);
+    for(node = running; node != NULL; node = node->next) {
+        gst_transcoder_pool_retire_job(pool, (GstTranscoderJob *)node->data);
+    }
+    g_mutex_unlock(pool->lock);
+    g_list_free(running);
+}
+
+void
+gst_transcoder_pool_free(GstTranscoderPool *pool)
+{
+    g_return_if_fail(pool != NULL);
+
+    gst_transcoder_pool_cancel(pool);
+    banshee_encoder_bin_cache_log_stats("transcoder");
+
+    // Every job is cancelled, so what is left on the cache thread is quick
+    if(pool->cache_thread != NULL) {
+        g_thread_pool_free(pool->cache_thread, FALSE, TRUE);
+    }
+
+    if(pool->fetched_id != 0) {
+        g_source_remove(pool->fetched_id);
+    }
+    gst_transcoder_pool_report_fetched(pool);
+
+    if(pool->pump_id != 0) {
+        g_source_remove(pool->pump_id);
+    }
+
+    if(pool->reap_id != 0) {
+        g_source_remove(pool->reap_id);
+    }
+    gst_transcoder_pool_reap(pool);
+
+    if(pool->cached_id != 0) {
+        g_source_remove(pool->cached_id);
+    }
+
+    if(pool->cache != NULL) {
+        banshee_transcode_cache_free(pool->cache);
+    }
+
+    g_queue_free(pool->cached);
+    g_queue_free(pool->fetched);
+    g_queue_free(pool->pending);
+    g_mutex_free(pool->cache_lock);
+    g_mutex_free(pool->lock);
+    g_free(pool);
+}
+
+guint
+gst_transcoder_pool_get_max_jobs(GstTranscoderPool *pool)
+{
+    g_return_val_if_fail(pool != NULL, 0);
+    return pool->max_jobs;
+}
+
+guint
+gst_transcoder_pool_get_job_count(GstTranscoderPool *pool)
+{
+    guint count;
+
+    g_return_val_if_fail(pool != NULL, 0);
+
+    g_mutex_lock(pool->lock);
+    count = g_queue_get_length(pool->pending) + g_list_length(pool->running);
+    g_mutex_unlock(pool->lock);
+
+    return count;
+}
+
+void
+gst_transcoder_pool_set_progress_callback(GstTranscoderPool *pool, 
+    GstTranscoderPoolProgressCallback cb)
+{
+    g_return_if_fail(pool != NULL);
+    pool->progress_cb = cb;
+}
+
+// Applies to the running jobs as well as to jobs started later
+void
+gst_transcoder_pool_set_progress_step(GstTranscoderPool *pool, gdouble step)
+{
+    GList *node;
+
+    g_return_if_fail(pool != NULL);
+
+    g_mutex_lock(pool->lock);
+    pool->progress_step = step;
+    for(node = pool->running; node != NULL; node = node->next) {
+        GstTranscoderJob *job = (GstTranscoderJob *)node->data;
+        if(job->transcoder != NULL) {
+            gst_transcoder_set_progress_step(job->transcoder, step);
+        }
+    }
+    g_mutex_unlock(pool->lock);
+}
+
+// Applies to jobs started from now on
+void
+gst_transcoder_pool_set_passthrough(GstTranscoderPool *pool, gboolean passthrough)
+{
+    g_return_if_fail(pool != NULL);
+    pool->passthrough = passthrough;
+}
+
+// Keeps finished transcodes in directory, up to max_size bytes, and serves
+// later jobs for the same source and pipeline from there. A max_size of 0
+// turns the cache off.
+void
+gst_transcoder_pool_set_cache(GstTranscoderPool *pool, const gchar *directory, guint64 max_size)
+{
+    g_return_if_fail(pool != NULL);
+
+    g_mutex_lock(pool->cache_lock);
+
+    if(pool->cache != NULL) {
+        banshee_transcode_cache_free(pool->cache);
+        pool->cache = NULL;
+    }
+
+    if(directory != NULL && max_size > 0) {
+        pool->cache = banshee_transcode_cache_new(directory, max_size);
+    }
+
+    g_mutex_unlock(pool->cache_lock);
+}
+
+void
+gst_transcoder_pool_set_finished_callback(GstTranscoderPool *pool, 
+    GstTranscoderPoolFinishedCallback cb)
+{
+    g_return_if_fail(pool != NULL);
+    pool->finished_cb = cb;
+}
+
+void
+gst_transcoder_pool_set_error_callback(GstTranscoderPool *pool, 
+    GstTranscoderPoolErrorCallback cb)
+{
+    g_return_if_fail(pool != NULL);
+    pool->error_cb = cb;
+}
@@ -145,6 +145,10 @@ namespace Banshee.GStreamerSharp
             Finish ();
         }
 
+        public int MaxConcurrentTracks {
+            get { return 1; }
+        }
+
         private void TrackReset ()
         {
             current_track = null;
@@ -910,6 +910,16 @@ namespace Banshee.GStreamerSharp
             }
         }
 
+        public void SetEqualizerGains (double [] gains, double amplifierLevel)
+        {
+            if (SupportsEqualizer) {
+                audio_sink.AmplifierLevel = amplifierLevel;
+                for (uint band = 0; band < gains.Length; band++) {
+                    audio_sink.SetEqualizerGain (band, gains[band]);
+                }
+            }
+        }
+
         public override VideoDisplayContextType VideoDisplayContextType {
             get { return video_manager != null ? video_manager.VideoDisplayContextType : VideoDisplayContextType.Unsupported; }
         }
@@ -306,6 +306,10 @@ namespace Banshee.GStreamerSharp
             }
         }
 
+        public int MaxConcurrentTracks {
+            get { return 1; }
+        }
+
         public bool IsTranscoding {
             get { return is_transcoding; }
         }
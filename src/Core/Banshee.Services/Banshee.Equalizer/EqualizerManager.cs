@@ -158,10 +158,7 @@ namespace Banshee.Equalizer
         {
             if (eq == null) {
                 var engine_eq = (IEqualizer)ServiceManager.PlayerEngine.ActiveEngine;
-                engine_eq.AmplifierLevel = 0;
-                for (uint i = 0; i < engine_eq.EqualizerFrequencies.Length; i++) {
-                    engine_eq.SetEqualizerGain (i, 0);
-                }
+                engine_eq.SetEqualizerGains (new double[engine_eq.EqualizerFrequencies.Length], 0);
 
                 Log.DebugFormat ("Disabled equalizer");
             } else {
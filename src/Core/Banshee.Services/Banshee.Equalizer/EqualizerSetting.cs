@@ -130,10 +130,7 @@ namespace Banshee.Equalizer
             }
 
             var engine_eq = (IEqualizer)ServiceManager.PlayerEngine.ActiveEngine;
-            engine_eq.AmplifierLevel = AmplifierLevel;
-            for (uint band = 0; band < bands.Length; band++) {
-                engine_eq.SetEqualizerGain (band, bands[band]);
-            }
+            engine_eq.SetEqualizerGains (bands, AmplifierLevel);
 
             OnChanged ();
         }
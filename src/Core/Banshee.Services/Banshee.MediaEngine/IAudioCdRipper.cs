@@ -49,6 +49,10 @@ namespace Banshee.MediaEngine
         void Cancel ();
 
         void RipTrack (int trackIndex, TrackInfo track, SafeUri outputUri, out bool taggingSupported);
+
+        // How many tracks may be in progress at once; RipTrack can be called
+        // again until that many have not finished yet
+        int MaxConcurrentTracks { get; }
     }
 
     public sealed class AudioCdRipperProgressArgs : EventArgs
@@ -38,6 +38,12 @@ namespace Banshee.MediaEngine
         /// </summary>
         void SetEqualizerGain (uint band, double value);
 
+        /// <summary>
+        /// Sets the gains of all equalizer bands and the amplifier level
+        /// at once, so the engine can switch to the new response in one step.
+        /// </summary>
+        void SetEqualizerGains (double [] gains, double amplifierLevel);
+
         /// <summary>
         /// Whether or not the engine supports the equalizer.
         /// </summary>
@@ -48,6 +48,10 @@ namespace Banshee.MediaEngine
         void TranscodeTrack (TrackInfo track, SafeUri outputUri, ProfileConfiguration config);
         void Finish ();
         void Cancel ();
+
+        // How many tracks may be in progress at once; TranscodeTrack can be
+        // called again until that many are running
+        int MaxConcurrentTracks { get; }
     }
 
     public sealed class TranscoderProgressArgs : EventArgs
@@ -93,11 +93,12 @@ namespace Banshee.MediaEngine
         private ITranscoder transcoder;
         private BatchUserJob user_job;
         private Queue<TranscodeContext> queue;
-        private TranscodeContext current_context;
+        private List<TranscodeContext> running;
 
         public TranscoderService ()
         {
             queue = new Queue <TranscodeContext> ();
+            running = new List<TranscodeContext> ();
 
             try {
                 Banshee.IO.Directory.Delete (cache_dir, true);
@@ -165,12 +166,12 @@ namespace Banshee.MediaEngine
                     context.CancelledHandler ();
                 }
 
-                if (transcoding) {
-                    current_context.CancelledHandler ();
-                    transcoding = false;
+                foreach (TranscodeContext context in running) {
+                    context.CancelledHandler ();
                 }
 
                 queue.Clear ();
+                running.Clear ();
             }
         }
 
@@ -183,50 +184,71 @@ namespace Banshee.MediaEngine
         public void Enqueue (TrackInfo track, SafeUri out_uri, ProfileConfiguration config,
             TrackTranscodedHandler handler, TranscodeCancelledHandler cancelledHandler, TranscodeErrorHandler errorHandler)
         {
-            bool start = false;
             lock (queue) {
-                start = (queue.Count == 0 && !transcoding);
                 queue.Enqueue (new TranscodeContext (track, out_uri, config, handler, cancelledHandler, errorHandler));
                 UserJob.Total++;
             }
 
-            if (start)
-                ProcessQueue ();
+            ProcessQueue ();
         }
 
-        private bool transcoding = false;
+        // Hands queued tracks to the transcoder until as many are running as
+        // it can convert concurrently
         private void ProcessQueue ()
         {
-            TranscodeContext context;
+            List<TranscodeContext> start = new List<TranscodeContext> ();
             lock (queue) {
-                if (queue.Count == 0) {
+                if (queue.Count == 0 && running.Count == 0) {
                     Reset ();
                     return;
                 }
 
-                context = queue.Dequeue ();
-                transcoding = true;
+                int max = Math.Max (1, Transcoder.MaxConcurrentTracks);
+                while (queue.Count > 0 && running.Count < max) {
+                    TranscodeContext context = queue.Dequeue ();
+                    running.Add (context);
+                    start.Add (context);
+                }
+            }
+
+            foreach (TranscodeContext context in start) {
+                UserJob.Status = String.Format("{0} - {1}", context.Track.ArtistName, context.Track.TrackTitle);
+                Transcoder.TranscodeTrack (context.Track, context.OutUri, context.Config);
             }
+        }
+
+        private bool TakeRunning (TrackInfo track, out TranscodeContext context)
+        {
+            lock (queue) {
+                int index = running.FindIndex (c => c.Track == track);
+                if (index < 0) {
+                    context = default (TranscodeContext);
+                    return false;
+                }
 
-            current_context = context;
-            UserJob.Status = String.Format("{0} - {1}", context.Track.ArtistName, context.Track.TrackTitle);
-            Transcoder.TranscodeTrack (context.Track, context.OutUri, context.Config);
+                context = running[index];
+                running.RemoveAt (index);
+                return true;
+            }
         }
 
 #region Transcoder Event Handlers
 
         private void OnTrackFinished (object o, TranscoderTrackFinishedArgs args)
         {
-            transcoding = false;
+            TranscodeContext context;
+            if (!TakeRunning (args.Track, out context)) {
+                return;
+            }
 
             if (user_job == null || transcoder == null) {
                 return;
             }
 
             UserJob.Completed++;
-            args.Track.MimeType = current_context.Config.Profile.MimeTypes[0];
-            args.Track.FileSize = Banshee.IO.File.GetSize (current_context.OutUri);
-            current_context.Handler (args.Track, current_context.OutUri);
+            args.Track.MimeType = context.Config.Profile.MimeTypes[0];
+            args.Track.FileSize = Banshee.IO.File.GetSize (context.OutUri);
+            context.Handler (args.Track, context.OutUri);
 
             ProcessQueue ();
         }
@@ -237,19 +259,29 @@ namespace Banshee.MediaEngine
                 return;
             }
 
+            // With several tracks in flight, follow the oldest one
+            lock (queue) {
+                if (running.Count == 0 || running[0].Track != args.Track) {
+                    return;
+                }
+            }
+
             UserJob.DetailedProgress = args.Fraction;
         }
 
         private void OnError (object o, TranscoderErrorArgs args)
         {
-            transcoding = false;
+            TranscodeContext context;
+            if (!TakeRunning (args.Track, out context)) {
+                return;
+            }
 
             if (user_job == null || transcoder == null) {
                 return;
             }
 
             UserJob.Completed++;
-            current_context.ErrorHandler (current_context.Track);
+            context.ErrorHandler (context.Track);
             Hyena.Log.Error ("Cannot Convert File", args.Message);
             ProcessQueue ();
         }
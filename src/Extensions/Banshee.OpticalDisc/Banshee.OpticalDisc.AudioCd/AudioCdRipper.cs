@@ -76,6 +76,7 @@ namespace Banshee.OpticalDisc.AudioCd
 
         // State to process the rip operation
         private Queue<AudioCdTrackInfo> queue = new Queue<AudioCdTrackInfo> ();
+        private Dictionary<AudioCdTrackInfo, TimeSpan> in_progress = new Dictionary<AudioCdTrackInfo, TimeSpan> ();
 
         private TimeSpan ripped_duration;
         private TimeSpan total_duration;
@@ -85,6 +86,7 @@ namespace Banshee.OpticalDisc.AudioCd
         private TimeSpan last_speed_poll_duration;
         private DateTime last_speed_poll_time;
         private double last_speed_poll_factor;
+        private AudioCdTrackInfo status_track;
         private string status;
 
         public AudioCdRipper (AudioCdSource source)
@@ -138,6 +140,7 @@ namespace Banshee.OpticalDisc.AudioCd
 
             ripper.Begin (source.Model.Volume.DeviceNode, AudioCdService.ErrorCorrection.Get ());
 
+            UpdateTitle ();
             RipNextTrack ();
         }
 
@@ -168,29 +171,56 @@ namespace Banshee.OpticalDisc.AudioCd
             last_speed_poll_duration = TimeSpan.Zero;
             last_speed_poll_time = DateTime.MinValue;
             last_speed_poll_factor = 0;
+            status_track = null;
             status = null;
             queue.Clear ();
+            in_progress.Clear ();
         }
 
+        // Hands tracks to the ripper until as many are in progress as it can
+        // take; rippers that read ahead of their encoders take them all
         private void RipNextTrack ()
         {
-            if (queue.Count == 0) {
+            if (queue.Count == 0 && in_progress.Count == 0) {
                 OnFinished ();
                 Dispose ();
                 return;
             }
 
-            AudioCdTrackInfo track = queue.Dequeue ();
+            while (queue.Count > 0 && in_progress.Count < Math.Max (1, ripper.MaxConcurrentTracks)) {
+                AudioCdTrackInfo track = queue.Dequeue ();
+                in_progress[track] = TimeSpan.Zero;
+
+                SafeUri uri = new SafeUri (MusicLibrarySource.MusicFileNamePattern.BuildFull (
+                    ServiceManager.SourceManager.MusicLibrary.BaseDirectory, track, null));
+                bool tagging_supported;
+                ripper.RipTrack (track.IndexOnDisc, track, uri, out tagging_supported);
+
+                // Finishing the rip disposes the ripper
+                if (ripper == null) {
+                    return;
+                }
+            }
+        }
 
+        // Several tracks may be in progress at once, so the title counts the
+        // tracks done and the status follows the track the last progress
+        // report came from
+        private void UpdateTitle ()
+        {
+            int total = source.Model.EnabledCount;
             user_job.Title = String.Format (Catalog.GetString ("Importing {0} of {1}"),
-                ++track_index, source.Model.EnabledCount);
-            status = String.Format("{0} - {1}", track.ArtistName, track.TrackTitle);
-            user_job.Status = status;
-
-            SafeUri uri = new SafeUri (MusicLibrarySource.MusicFileNamePattern.BuildFull (
-                ServiceManager.SourceManager.MusicLibrary.BaseDirectory, track, null));
-            bool tagging_supported;
-            ripper.RipTrack (track.IndexOnDisc, track, uri, out tagging_supported);
+                Math.Min (track_index + 1, total), total);
+        }
+
+        private void UpdateStatus (AudioCdTrackInfo track)
+        {
+            if (track == null || track == status_track) {
+                return;
+            }
+
+            status_track = track;
+            status = String.Format ("{0} - {1}", track.ArtistName, track.TrackTitle);
         }
 
 #region Ripper Event Handlers
@@ -203,6 +233,7 @@ namespace Banshee.OpticalDisc.AudioCd
 
             AudioCdTrackInfo track = (AudioCdTrackInfo)args.Track;
 
+            in_progress.Remove (track);
             ripped_duration += track.Duration;
             track.PrimarySource = ServiceManager.SourceManager.MusicLibrary;
             track.Uri = args.Uri;
@@ -218,6 +249,13 @@ namespace Banshee.OpticalDisc.AudioCd
             track.Save ();
 
             source.UnlockTrack (track);
+
+            track_index++;
+            if (status_track == track) {
+                status_track = null;
+            }
+            UpdateTitle ();
+
             RipNextTrack ();
         }
 
@@ -227,7 +265,16 @@ namespace Banshee.OpticalDisc.AudioCd
                 return;
             }
 
-            TimeSpan total_ripped_duration = ripped_duration + args.EncodedTime;
+            AudioCdTrackInfo track = args.Track as AudioCdTrackInfo;
+            if (track != null && in_progress.ContainsKey (track)) {
+                in_progress[track] = args.EncodedTime;
+                UpdateStatus (track);
+            }
+
+            TimeSpan total_ripped_duration = ripped_duration;
+            foreach (TimeSpan progress in in_progress.Values) {
+                total_ripped_duration += progress;
+            }
             user_job.Progress = total_ripped_duration.TotalMilliseconds / total_duration.TotalMilliseconds;
 
             TimeSpan poll_diff = DateTime.Now - last_speed_poll_time;
@@ -242,6 +289,10 @@ namespace Banshee.OpticalDisc.AudioCd
                 last_speed_poll_factor = factor > 1 ? factor : 0;
             }
 
+            if (status == null) {
+                return;
+            }
+
             // Make sure the speed factor is between 1 and 200 to allow it to ramp and settle
             user_job.Status = last_speed_poll_factor > 1 && last_speed_poll_factor <= 200
                 ? String.Format ("{0} ({1:0.0}x)", status, last_speed_poll_factor)
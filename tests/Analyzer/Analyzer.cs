@@ -86,7 +86,13 @@ namespace Banshee.Tests
                         }
 
                         Console.Write ("      {0,-36}", test.RunId);
-                        Console.Write (" {0,3:#00}   {1,3:#00}   {2,3:#00}", 100*test.Min/first_avg, 100*test.Avg/first_avg, 100*test.Max/first_avg);
+                        // Results like a gap in samples can be 0, which no
+                        // other run can be given relative to
+                        if (first_avg != 0) {
+                            Console.Write (" {0,3:#00}   {1,3:#00}   {2,3:#00}", 100*test.Min/first_avg, 100*test.Avg/first_avg, 100*test.Max/first_avg);
+                        } else {
+                            Console.Write ("   -     -     -");
+                        }
                         Console.Write ("     ({0,5:##0.00}   {1,5:##0.00}   {2,5:##0.00})", test.Min, test.Avg, test.Max);
                         Console.WriteLine ();
 